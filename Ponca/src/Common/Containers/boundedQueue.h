@@ -0,0 +1,85 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace Ponca {
+
+/// Thread-safe FIFO queue with a maximum capacity, connecting producer and consumer threads
+///
+/// push blocks while the queue is full, so that a fast producer is slowed down to the speed of its consumer, and pop
+/// blocks while the queue is empty. Once the queue is closed, push fails and pop returns the remaining elements.
+///
+template<class T>
+class BoundedQueue
+{
+public:
+    /// Type of value stored in the BoundedQueue
+    using ValueType = T;
+
+    inline explicit BoundedQueue(std::size_t capacity = 1) : m_capacity(capacity > 0 ? capacity : 1) {}
+
+    /// Add an element, waiting for a free slot. Return false if the queue is closed.
+    inline bool push(T value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this]() { return m_closed || m_queue.size() < m_capacity; });
+        if (m_closed) return false;
+        m_queue.push_back(std::move(value));
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /// Remove the oldest element, waiting for one. Return false if the queue is closed and empty.
+    inline bool pop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this]() { return m_closed || ! m_queue.empty(); });
+        if (m_queue.empty()) return false;
+        value = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    /// Close the queue, waking up the waiting threads
+    inline void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    /// Get the number of elements in the BoundedQueue
+    inline std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size();
+    }
+
+    /// Maximum number of elements
+    inline std::size_t capacity() const { return m_capacity; }
+
+private:
+    const std::size_t m_capacity;
+    std::deque<T> m_queue;
+    bool m_closed {false};
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notFull, m_notEmpty;
+};
+
+} // namespace Ponca
@@ -0,0 +1,144 @@
+/**
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "../defines.h" //STD_SAFE_AT
+
+namespace Ponca {
+
+/// Contiguous container storing up to N elements in a fixed-size buffer, and moving to heap storage when more
+/// elements are added
+///
+/// Once moved to the heap, the storage keeps its capacity when the container is cleared, so a SmallVector reused
+/// across computations allocates only when its size reaches a new maximum.
+///
+/// \warning As for Stack, elements are not destroyed when the container is cleared.
+///
+template<class T, int N>
+class SmallVector
+{
+public:
+    /// Type of value stored in the SmallVector
+    using ValueType = T;
+
+    inline SmallVector();
+
+    /// Read access to the i-th element
+    inline const T& operator[](int i) const;
+    /// Write access to the i-th element
+    inline       T& operator[](int i);
+
+    /// Pointer to the first element
+    inline const T* begin() const;
+    /// Pointer past the last element
+    inline const T* end() const;
+
+    /// Is the container empty
+    inline bool empty() const;
+    /// Get the number of elements in the container
+    inline int  size() const;
+    /// Are the elements stored in the fixed-size buffer
+    inline bool isSmall() const;
+
+    /// Add an element at the end of the container, moving to heap storage if the fixed-size buffer is full
+    inline void push_back(const T& value);
+    /// Clear the container content, and go back to the fixed-size buffer
+    /// \note Heap storage capacity is kept for future use
+    inline void clear();
+
+protected:
+    /// Number of elements in the container
+    int m_size;
+    /// Fixed-size data buffer
+    std::array<T,N> m_data;
+    /// Heap storage, used when more than N elements are stored
+    std::vector<T> m_heap;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+template<class T, int N>
+SmallVector<T,N>::SmallVector() :
+    m_size(0),
+    m_data(),
+    m_heap()
+{
+}
+
+template<class T, int N>
+const T& SmallVector<T,N>::operator[](int i) const
+{
+    return isSmall() ? STD_SAFE_AT(m_data,i) : STD_SAFE_AT(m_heap,i);
+}
+
+template<class T, int N>
+T& SmallVector<T,N>::operator[](int i)
+{
+    return isSmall() ? STD_SAFE_AT(m_data,i) : STD_SAFE_AT(m_heap,i);
+}
+
+template<class T, int N>
+const T* SmallVector<T,N>::begin() const
+{
+    return isSmall() ? m_data.data() : m_heap.data();
+}
+
+template<class T, int N>
+const T* SmallVector<T,N>::end() const
+{
+    return begin() + m_size;
+}
+
+template<class T, int N>
+bool SmallVector<T,N>::empty() const
+{
+    return m_size==0;
+}
+
+template<class T, int N>
+int SmallVector<T,N>::size() const
+{
+    return m_size;
+}
+
+template<class T, int N>
+bool SmallVector<T,N>::isSmall() const
+{
+    return m_heap.empty();
+}
+
+template<class T, int N>
+void SmallVector<T,N>::push_back(const T& value)
+{
+    if (isSmall())
+    {
+        if (m_size < N)
+        {
+            m_data[m_size++] = value;
+            return;
+        }
+        // Move to the heap
+        m_heap.reserve(2*N);
+        m_heap.assign(m_data.begin(), m_data.end());
+    }
+    m_heap.push_back(value);
+    ++m_size;
+}
+
+template<class T, int N>
+void SmallVector<T,N>::clear()
+{
+    m_size = 0;
+    m_heap.clear();
+}
+
+} // namespace Ponca
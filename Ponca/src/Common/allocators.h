@@ -0,0 +1,456 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+namespace Ponca {
+
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    /// \brief Size in bytes of `n` objects of type T
+    template <typename T>
+    inline std::size_t allocationBytes(std::size_t n)
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+        return n * sizeof(T);
+    }
+
+    inline void* heapAllocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return ::operator new(bytes, std::align_val_t(alignment));
+        return ::operator new(bytes);
+    }
+
+    inline void heapDeallocate(void* p, std::size_t alignment) noexcept
+    {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            ::operator delete(p, std::align_val_t(alignment));
+        else
+            ::operator delete(p);
+    }
+
+#if defined(__linux__)
+    /// \brief Tell if allocators can map pages directly (huge pages, NUMA placement)
+    constexpr bool PAGE_MAPPING_SUPPORTED = true;
+#else
+    constexpr bool PAGE_MAPPING_SUPPORTED = false;
+#endif
+
+    /// \brief Size of the transparent huge pages (x86-64 and most aarch64 kernels)
+    constexpr std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+
+    /// \brief Granularity of the mappings made by mapPages
+    inline std::size_t pageGranularity(bool hugePages)
+    {
+#if defined(__linux__)
+        return hugePages ? HUGE_PAGE_SIZE : std::size_t(sysconf(_SC_PAGESIZE));
+#else
+        (void)hugePages;
+        return 4096;
+#endif
+    }
+
+    inline std::size_t roundUp(std::size_t bytes, std::size_t granularity)
+    {
+        return (bytes + granularity - 1) / granularity * granularity;
+    }
+
+    /*!
+     * \brief Map `bytes` of anonymous memory, aligned on the page granularity
+     *
+     * With `hugePages`, the mapping is aligned on HUGE_PAGE_SIZE and advised to be backed by transparent huge pages.
+     * Throws std::bad_alloc on failure. Must only be called when PAGE_MAPPING_SUPPORTED.
+     */
+    inline void* mapPages(std::size_t bytes, bool hugePages)
+    {
+#if defined(__linux__)
+        const std::size_t granularity = pageGranularity(hugePages);
+        const std::size_t size   = roundUp(bytes, granularity);
+        const std::size_t mapped = hugePages ? size + granularity : size;
+        void* res = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (res == MAP_FAILED) throw std::bad_alloc();
+        if (hugePages)
+        {
+            // Keep the aligned part of the mapping
+            auto begin = reinterpret_cast<std::uintptr_t>(res);
+            const auto aligned = roundUp(begin, granularity);
+            if (aligned > begin) munmap(res, aligned - begin);
+            if (aligned + size < begin + mapped) munmap(reinterpret_cast<void*>(aligned + size), begin + mapped - aligned - size);
+            res = reinterpret_cast<void*>(aligned);
+#  ifdef MADV_HUGEPAGE
+            madvise(res, size, MADV_HUGEPAGE);
+#  endif
+        }
+        return res;
+#else
+        (void)bytes; (void)hugePages;
+        throw std::bad_alloc();
+#endif
+    }
+
+    /// \brief Unmap memory returned by mapPages(bytes, hugePages)
+    inline void unmapPages(void* p, std::size_t bytes, bool hugePages) noexcept
+    {
+#if defined(__linux__)
+        munmap(p, roundUp(bytes, pageGranularity(hugePages)));
+#else
+        (void)p; (void)bytes; (void)hugePages;
+#endif
+    }
+
+    /// \brief NUMA node of the CPU running the calling thread, 0 when unknown
+    inline int currentNumaNode()
+    {
+#if defined(__linux__) && defined(SYS_getcpu)
+        unsigned int cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return int(node);
+#endif
+        return 0;
+    }
+
+    /// \brief Ask the kernel to allocate the pages of [p, p+bytes) on `node`, when possible
+    inline void preferNumaNode(void* p, std::size_t bytes, int node) noexcept
+    {
+#if defined(__linux__) && defined(SYS_mbind)
+        constexpr int MPOL_PREFERRED_MODE = 1; // MPOL_PREFERRED from <linux/mempolicy.h>
+        constexpr int MAX_NODES = 1024;
+        if (node < 0 || node >= MAX_NODES) return;
+        unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))] = {};
+        mask[std::size_t(node) / (8 * sizeof(unsigned long))] = 1ul << (std::size_t(node) % (8 * sizeof(unsigned long)));
+        // Failures (e.g. kernels without NUMA support) leave the default policy, i.e. first touch
+        syscall(SYS_mbind, p, bytes, MPOL_PREFERRED_MODE, mask, (unsigned long)(MAX_NODES + 1), 0u);
+#else
+        (void)p; (void)bytes; (void)node;
+#endif
+    }
+}
+#endif
+
+/*!
+ * \brief Memory arena allocating by bumping a pointer in large blocks, and releasing the memory all at once
+ *
+ * Deallocations are no-ops: a structure built in the arena (e.g. the KdTree of a tile, rebuilt for each tile) costs a
+ * few block allocations instead of one allocation per container growth, and reset() makes the memory available to
+ * the next structure without giving it back to the system. Allocations are thread-safe.
+ *
+ * Containers using ArenaAllocator allocate from the arena made current by a Scope when they are constructed:
+ * \code
+ * using Tree = KdTreeDenseBase<KdTreeAllocatorTraits<Point, ArenaAllocator>>;
+ * MonotonicArena arena;
+ * for (const auto& tile : tiles)
+ * {
+ *     {
+ *         MonotonicArena::Scope scope (arena);
+ *         Tree tree (tile.points);
+ *         // ... queries
+ *     }
+ *     arena.reset(); // once the tree is destroyed
+ * }
+ * \endcode
+ */
+class MonotonicArena
+{
+public:
+    /// \brief Make an arena current in the calling thread, until the end of the scope
+    class Scope
+    {
+    public:
+        inline explicit Scope(MonotonicArena& arena) : m_previous(currentArena()) { currentArena() = &arena; }
+        inline ~Scope() { currentArena() = m_previous; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        MonotonicArena* m_previous;
+    };
+
+    /// \param blockSize Minimal size of the blocks requested to the heap, in bytes. Each new block is at least as
+    ///        large as the memory already reserved, so that the number of blocks grows logarithmically.
+    inline explicit MonotonicArena(std::size_t blockSize = std::size_t(1) << 20)
+        : m_blockSize(std::max<std::size_t>(blockSize, 4096)) {}
+    inline ~MonotonicArena() { release(); }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    /// \brief Arena made current in the calling thread by a Scope, or nullptr
+    static inline MonotonicArena* current() { return currentArena(); }
+
+    /// \brief Allocate `bytes` bytes aligned on `alignment`, a power of two
+    inline void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::uintptr_t p = align(m_current, alignment);
+        if (m_current == 0 || p + bytes > m_end)
+        {
+            addBlock(bytes + alignment);
+            p = align(m_current, alignment);
+        }
+        m_current = p + bytes;
+        m_used += bytes;
+        return reinterpret_cast<void*>(p);
+    }
+
+    /// \brief Make all the memory available again, merged in a single block
+    /// \warning The objects allocated in the arena must be destroyed before
+    inline void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_blocks.size() > 1)
+        {
+            const std::size_t reserved = m_reserved;
+            freeBlocks();
+            addBlock(reserved);
+        }
+        else if (! m_blocks.empty())
+        {
+            m_current = reinterpret_cast<std::uintptr_t>(m_blocks[0].data);
+        }
+        m_used = 0;
+    }
+
+    /// \brief Give all the memory back to the heap
+    /// \warning The objects allocated in the arena must be destroyed before
+    inline void release()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        freeBlocks();
+        m_used = 0;
+    }
+
+    /// \brief Number of bytes allocated since the last reset
+    inline std::size_t usedBytes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_used;
+    }
+
+    /// \brief Number of bytes requested to the heap
+    inline std::size_t reservedBytes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_reserved;
+    }
+
+private:
+    struct Block
+    {
+        void* data;
+        std::size_t size;
+    };
+
+    static inline MonotonicArena*& currentArena()
+    {
+        static thread_local MonotonicArena* arena = nullptr;
+        return arena;
+    }
+
+    static inline std::uintptr_t align(std::uintptr_t p, std::size_t alignment)
+    {
+        return (p + alignment - 1) & ~std::uintptr_t(alignment - 1);
+    }
+
+    inline void addBlock(std::size_t minSize)
+    {
+        const std::size_t size = std::max({m_blockSize, minSize, m_reserved});
+        void* data = ::operator new(size);
+        m_blocks.push_back({data, size});
+        m_reserved += size;
+        m_current = reinterpret_cast<std::uintptr_t>(data);
+        m_end     = m_current + size;
+    }
+
+    inline void freeBlocks()
+    {
+        for (const Block& b : m_blocks) ::operator delete(b.data);
+        m_blocks.clear();
+        m_reserved = 0;
+        m_current = m_end = 0;
+    }
+
+    const std::size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    std::uintptr_t m_current {0}, m_end {0};
+    std::size_t m_used {0}, m_reserved {0};
+    mutable std::mutex m_mutex;
+};
+
+/*!
+ * \brief Allocator using the MonotonicArena current when it is constructed (see MonotonicArena::Scope), or the heap
+ * when there is none
+ *
+ * The allocator is copied and moved with its container, so that a container keeps allocating from its arena.
+ * \warning The arena must outlive the containers using it
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    inline ArenaAllocator() noexcept : m_arena(MonotonicArena::current()) {}
+    inline explicit ArenaAllocator(MonotonicArena* arena) noexcept : m_arena(arena) {}
+    template <typename U>
+    inline ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.arena()) {}
+
+    inline T* allocate(std::size_t n)
+    {
+        const std::size_t bytes = internal::allocationBytes<T>(n);
+        if (m_arena != nullptr) return static_cast<T*>(m_arena->allocate(bytes, alignof(T)));
+        return static_cast<T*>(internal::heapAllocate(bytes, alignof(T)));
+    }
+
+    inline void deallocate(T* p, std::size_t) noexcept
+    {
+        if (m_arena == nullptr) internal::heapDeallocate(p, alignof(T));
+    }
+
+    /// \brief Arena of the allocator, nullptr for the heap
+    inline MonotonicArena* arena() const noexcept { return m_arena; }
+
+private:
+    MonotonicArena* m_arena;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() == b.arena(); }
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena() != b.arena(); }
+
+/*!
+ * \brief Allocator backing large allocations with transparent huge pages
+ *
+ * Allocations of at least MIN_BYTES are mapped on 2MB boundaries and advised to be backed by huge pages
+ * (`MADV_HUGEPAGE`), so that traversing a large tree needs 512 times fewer TLB entries than with 4KB pages. Smaller
+ * allocations use the heap. On systems other than Linux, or when transparent huge pages are disabled, this behaves
+ * like the default allocator.
+ */
+template <typename T>
+class HugePageAllocator
+{
+public:
+    using value_type      = T;
+    using is_always_equal = std::true_type;
+
+    /// \brief Minimal size of the allocations backed by huge pages
+    static constexpr std::size_t MIN_BYTES = internal::HUGE_PAGE_SIZE;
+
+    HugePageAllocator() = default;
+    template <typename U>
+    inline HugePageAllocator(const HugePageAllocator<U>&) noexcept {}
+
+    inline T* allocate(std::size_t n)
+    {
+        const std::size_t bytes = internal::allocationBytes<T>(n);
+        if (usePages(bytes)) return static_cast<T*>(internal::mapPages(bytes, true));
+        return static_cast<T*>(internal::heapAllocate(bytes, alignof(T)));
+    }
+
+    inline void deallocate(T* p, std::size_t n) noexcept
+    {
+        const std::size_t bytes = n * sizeof(T);
+        if (usePages(bytes)) internal::unmapPages(p, bytes, true);
+        else internal::heapDeallocate(p, alignof(T));
+    }
+
+private:
+    static inline bool usePages(std::size_t bytes)
+    {
+        return internal::PAGE_MAPPING_SUPPORTED && alignof(T) <= internal::HUGE_PAGE_SIZE && bytes >= MIN_BYTES;
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return true; }
+template <typename T, typename U>
+inline bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return false; }
+
+/*!
+ * \brief Allocator placing large allocations on a NUMA node
+ *
+ * Allocations of at least MIN_BYTES are mapped directly, and their pages are allocated on the preferred node given at
+ * construction. Without this, the pages are placed on the node of the thread touching them first, which is not always
+ * the thread that will query the structure. Smaller allocations use the heap. On systems other than Linux, this
+ * behaves like the default allocator.
+ *
+ * \note When the preferred node runs out of memory, the pages are allocated on another node.
+ * \warning The default node, #CurrentNode, is the node of the thread calling allocate. The containers of the KdTree
+ * and of the KnnGraph are filled by the thread allocating them, so this gives the same placement as the default
+ * first-touch policy: only the mapping of the pages changes. Give an explicit node, e.g. the node of the threads
+ * running the queries, to change the placement.
+ */
+template <typename T>
+class NumaLocalAllocator
+{
+public:
+    using value_type      = T;
+    using is_always_equal = std::true_type; // the node only affects the placement, not the deallocation
+
+    /// \brief Node value selecting the node of the thread calling allocate, i.e. the first-touch placement when this
+    /// thread also fills the container
+    static constexpr int CurrentNode = -1;
+    /// \brief Minimal size of the allocations placed on the preferred node
+    static constexpr std::size_t MIN_BYTES = std::size_t(64) << 10;
+
+    inline explicit NumaLocalAllocator(int node = CurrentNode) noexcept : m_node(node) {}
+    template <typename U>
+    inline NumaLocalAllocator(const NumaLocalAllocator<U>& other) noexcept : m_node(other.node()) {}
+
+    inline T* allocate(std::size_t n)
+    {
+        const std::size_t bytes = internal::allocationBytes<T>(n);
+        if (! usePages(bytes)) return static_cast<T*>(internal::heapAllocate(bytes, alignof(T)));
+        void* p = internal::mapPages(bytes, false);
+        internal::preferNumaNode(p, internal::roundUp(bytes, internal::pageGranularity(false)),
+                                 m_node == CurrentNode ? internal::currentNumaNode() : m_node);
+        return static_cast<T*>(p);
+    }
+
+    inline void deallocate(T* p, std::size_t n) noexcept
+    {
+        const std::size_t bytes = n * sizeof(T);
+        if (usePages(bytes)) internal::unmapPages(p, bytes, false);
+        else internal::heapDeallocate(p, alignof(T));
+    }
+
+    /// \brief Preferred node, or CurrentNode
+    inline int node() const noexcept { return m_node; }
+
+private:
+    static inline bool usePages(std::size_t bytes)
+    {
+        return internal::PAGE_MAPPING_SUPPORTED && alignof(T) <= 4096 && bytes >= MIN_BYTES;
+    }
+
+    int m_node;
+};
+
+template <typename T, typename U>
+inline bool operator==(const NumaLocalAllocator<T>&, const NumaLocalAllocator<U>&) { return true; }
+template <typename T, typename U>
+inline bool operator!=(const NumaLocalAllocator<T>&, const NumaLocalAllocator<U>&) { return false; }
+
+} // namespace Ponca
@@ -0,0 +1,494 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#if defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+namespace Ponca {
+
+/*!
+ * \brief Interface of the executors running the parallel loops of the library
+ *
+ * Parallel algorithms (KdTree construction, KnnGraph construction, batched queries, batch fitting engines) split
+ * their work in ranges of indices, run by an executor. The executor used by an algorithm can be set explicitly (e.g.
+ * KdTreeBase::set_executor), and defaults to defaultExecutor(), which can be replaced in one place by
+ * setDefaultExecutor, e.g. to use the thread pool of an application:
+ * \code
+ * // Run all the parallel loops of Ponca in the thread pool of the application
+ * TaskExecutor executor ([&pool](std::function<void()> task) { pool.submit(std::move(task)); }, pool.size());
+ * setDefaultExecutor(&executor);
+ * \endcode
+ *
+ * Available executors: ThreadPoolExecutor (default), OpenMPExecutor, SerialExecutor and TaskExecutor.
+ *
+ * When a task throws, the ranges that are not started yet are skipped, and the first exception is rethrown by
+ * parallelFor in the calling thread once the running tasks are done.
+ */
+class Executor
+{
+public:
+    /// \brief Task processing the indices in [begin, end)
+    using RangeTask = std::function<void(std::ptrdiff_t /*begin*/, std::ptrdiff_t /*end*/)>;
+
+    virtual ~Executor() = default;
+
+    /*!
+     * \brief Call `task` on disjoint ranges covering [0, n), and wait for their completion
+     *
+     * \param grain Minimum number of indices processed by a call to `task`, or 0 to let the executor choose. Ranges
+     *        are processed concurrently, in any order.
+     */
+    virtual void parallelFor(std::ptrdiff_t n, const RangeTask& task, std::ptrdiff_t grain = 0) = 0;
+
+    /// \brief Maximum number of ranges processed concurrently
+    virtual int concurrency() const = 0;
+
+    /// \brief Call `f(i)` for each index i in [0, n), concurrently
+    template <typename Functor>
+    inline void forEach(std::ptrdiff_t n, Functor&& f, std::ptrdiff_t grain = 0)
+    {
+        parallelFor(n, [&f](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            for (std::ptrdiff_t i = begin; i < end; ++i) f(i);
+        }, grain);
+    }
+
+protected:
+    /// \brief Grain used when none is given: a few ranges per thread, to balance the load
+    inline std::ptrdiff_t defaultGrain(std::ptrdiff_t n, std::ptrdiff_t grain) const
+    {
+        return grain > 0 ? grain : std::max<std::ptrdiff_t>(1, n / (8 * std::ptrdiff_t(concurrency())));
+    }
+};
+
+/// \brief Executor running the loops in the calling thread
+class SerialExecutor : public Executor
+{
+public:
+    inline void parallelFor(std::ptrdiff_t n, const RangeTask& task, std::ptrdiff_t = 0) override
+    {
+        if (n > 0) task(0, n);
+    }
+    inline int concurrency() const override { return 1; }
+};
+
+/*!
+ * \brief Executor running the loops with OpenMP (`parallel for` with a dynamic schedule)
+ *
+ * Runs the loops in the calling thread when OpenMP is not enabled.
+ */
+class OpenMPExecutor : public Executor
+{
+public:
+    /// \param threads Number of threads, or 0 to use the OpenMP default (e.g. `OMP_NUM_THREADS`)
+    inline explicit OpenMPExecutor(int threads = 0) : m_threads(std::max(threads, 0)) {}
+
+    inline void parallelFor(std::ptrdiff_t n, const RangeTask& task, std::ptrdiff_t grain = 0) override
+    {
+        if (n <= 0) return;
+        const std::ptrdiff_t g = defaultGrain(n, grain);
+        const std::ptrdiff_t nbRanges = (n + g - 1) / g;
+        // Exceptions must not leave the parallel region
+        std::exception_ptr error;
+        std::atomic<bool> failed {false};
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(concurrency()) if(nbRanges > 1)
+#endif
+        for (std::ptrdiff_t r = 0; r < nbRanges; ++r)
+        {
+            if (failed.load(std::memory_order_relaxed)) continue;
+            try
+            {
+                task(r * g, std::min(n, (r + 1) * g));
+            }
+            catch (...)
+            {
+                if (! failed.exchange(true)) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    inline int concurrency() const override
+    {
+#ifdef _OPENMP
+        return m_threads > 0 ? m_threads : omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+private:
+    int m_threads;
+};
+
+/*!
+ * \brief Executor running the loops in a pool of threads, balancing the load by work stealing
+ *
+ * The range of a loop is split evenly between the threads of the pool and the calling thread. Each thread processes
+ * its range by pieces of `grain` indices, and steals half of the remaining range of another thread when it runs out of
+ * work, so that no synchronization is needed as long as the load is balanced.
+ *
+ * Loops started from a thread of the pool (nested loops), or while the pool is running a loop started by another
+ * thread, are run in the calling thread.
+ */
+class ThreadPoolExecutor : public Executor
+{
+public:
+    /*!
+     * \param threads Number of threads running the loops, including the calling thread, or 0 to use the number of
+     *        hardware threads
+     * \param pinThreads Pin each thread of the pool to a core (Linux only)
+     */
+    inline explicit ThreadPoolExecutor(int threads = 0, bool pinThreads = false)
+    {
+        if (threads <= 0) threads = std::max(1, int(std::thread::hardware_concurrency()));
+        m_slots = std::vector<Slot>(std::size_t(threads));
+        for (int w = 1; w < threads; ++w)
+        {
+            m_workers.emplace_back([this, w]() { workerLoop(w); });
+#if defined(__linux__)
+            if (pinThreads)
+            {
+                const int nbCores = std::max(1, int(std::thread::hardware_concurrency()));
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(w % nbCores, &set);
+                pthread_setaffinity_np(m_workers.back().native_handle(), sizeof(cpu_set_t), &set);
+            }
+#else
+            (void)pinThreads;
+#endif
+        }
+    }
+
+    inline ~ThreadPoolExecutor() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeUp.notify_all();
+        for (auto& t : m_workers) t.join();
+    }
+
+    ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+    ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+
+    inline int concurrency() const override { return int(m_slots.size()); }
+
+    inline void parallelFor(std::ptrdiff_t n, const RangeTask& task, std::ptrdiff_t grain = 0) override
+    {
+        if (n <= 0) return;
+        const std::ptrdiff_t g = defaultGrain(n, grain);
+        std::unique_lock<std::mutex> job (m_jobMutex, std::defer_lock);
+        if (n <= g || m_workers.empty() || currentPool() == this || ! job.try_lock())
+        {
+            task(0, n);
+            return;
+        }
+
+        // Split the range between the slots, and wake up the workers
+        const auto nbSlots = std::ptrdiff_t(m_slots.size());
+        for (std::ptrdiff_t s = 0; s < nbSlots; ++s)
+        {
+            std::lock_guard<std::mutex> lock(m_slots[s].mutex);
+            m_slots[s].begin = n * s / nbSlots;
+            m_slots[s].end   = n * (s + 1) / nbSlots;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task   = &task;
+            m_grain  = g;
+            m_active = int(nbSlots);
+            m_error  = nullptr;
+            m_failed.store(false);
+            ++m_generation;
+        }
+        m_wakeUp.notify_all();
+
+        // The calling thread takes part in the loop
+        {
+            CurrentPoolGuard guard (this);
+            process(0);
+        }
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            --m_active;
+            m_done.wait(lock, [this]() { return m_active == 0; });
+            m_task = nullptr;
+            std::swap(error, m_error);
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    /// \brief Remaining range of a thread
+    struct alignas(64) Slot
+    {
+        std::mutex mutex;
+        std::ptrdiff_t begin {0}, end {0};
+    };
+
+    static inline ThreadPoolExecutor*& currentPool()
+    {
+        static thread_local ThreadPoolExecutor* pool = nullptr;
+        return pool;
+    }
+
+    /// \brief Set currentPool() for the lifetime of the guard
+    struct CurrentPoolGuard
+    {
+        inline explicit CurrentPoolGuard(ThreadPoolExecutor* pool) : previous(currentPool()) { currentPool() = pool; }
+        inline ~CurrentPoolGuard() { currentPool() = previous; }
+        ThreadPoolExecutor* previous;
+    };
+
+    /// \brief Take the next piece of the range of slot `s`, or steal from another slot
+    inline bool next(int s, std::ptrdiff_t& begin, std::ptrdiff_t& end)
+    {
+        Slot& own = m_slots[std::size_t(s)];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.begin < own.end)
+            {
+                begin = own.begin;
+                end   = std::min(own.end, own.begin + m_grain);
+                own.begin = end;
+                return true;
+            }
+        }
+        const int nbSlots = int(m_slots.size());
+        for (int i = 1; i < nbSlots; ++i)
+        {
+            Slot& victim = m_slots[std::size_t((s + i) % nbSlots)];
+            std::ptrdiff_t b, e;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                const std::ptrdiff_t remaining = victim.end - victim.begin;
+                if (remaining <= m_grain) continue;
+                b = victim.begin + remaining / 2;
+                e = victim.end;
+                victim.end = b;
+            }
+            std::lock_guard<std::mutex> lock(own.mutex);
+            begin = b;
+            end   = std::min(e, b + m_grain);
+            own.begin = end;
+            own.end   = e;
+            return true;
+        }
+        return false;
+    }
+
+    /// \brief Process the ranges of slot `s` until the loop is done, or a task has thrown
+    inline void process(int s)
+    {
+        std::ptrdiff_t begin, end;
+        while (! m_failed.load(std::memory_order_relaxed) && next(s, begin, end))
+        {
+            try
+            {
+                (*m_task)(begin, end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (! m_error) m_error = std::current_exception();
+                m_failed.store(true);
+            }
+        }
+    }
+
+    inline void workerLoop(int s)
+    {
+        currentPool() = this;
+        std::size_t generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [&]() { return m_stop || m_generation != generation; });
+                if (m_stop) return;
+                generation = m_generation;
+            }
+            process(s);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_active;
+            }
+            m_done.notify_one();
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<std::thread> m_workers;
+    std::mutex m_jobMutex;                       ///< Held by the thread running a loop in the pool
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp, m_done;
+    const RangeTask* m_task {nullptr};
+    std::exception_ptr m_error;                  ///< First exception thrown by a task of the current loop
+    std::atomic<bool> m_failed {false};          ///< Set when a task of the current loop has thrown
+    std::ptrdiff_t m_grain {1};
+    int m_active {0};
+    std::size_t m_generation {0};
+    bool m_stop {false};
+};
+
+/*!
+ * \brief Executor submitting the loops to a task system provided by the user (e.g. the thread pool of an application)
+ *
+ * A loop is split in `concurrency` tasks pulling ranges from a shared counter. One of them runs in the calling thread,
+ * so that the loop completes even if the submitted tasks are delayed: tasks starting after the end of the loop return
+ * immediately.
+ */
+class TaskExecutor : public Executor
+{
+public:
+    /// \brief Function submitting a task to the task system
+    using Submit = std::function<void(std::function<void()>)>;
+
+    /// \param submit Function submitting a task \param concurrency Number of tasks run concurrently
+    inline TaskExecutor(Submit submit, int concurrency)
+        : m_submit(std::move(submit)), m_concurrency(std::max(concurrency, 1)) {}
+
+    inline int concurrency() const override { return m_concurrency; }
+
+    inline void parallelFor(std::ptrdiff_t n, const RangeTask& task, std::ptrdiff_t grain = 0) override
+    {
+        if (n <= 0) return;
+        struct Loop
+        {
+            std::atomic<std::ptrdiff_t> next {0};
+            std::ptrdiff_t n {0}, grain {1};
+            const RangeTask* task {nullptr};
+            std::mutex mutex;
+            std::condition_variable done;
+            int active {0};
+            bool finished {false};
+            std::exception_ptr error;
+            std::atomic<bool> failed {false};
+
+            void fail(std::exception_ptr e)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (! error) error = std::move(e);
+                failed.store(true);
+            }
+
+            void run()
+            {
+                try
+                {
+                    for (std::ptrdiff_t b = next.fetch_add(grain); b < n && ! failed.load(std::memory_order_relaxed);
+                         b = next.fetch_add(grain))
+                        (*task)(b, std::min(n, b + grain));
+                }
+                catch (...)
+                {
+                    fail(std::current_exception());
+                }
+            }
+        };
+        auto loop   = std::make_shared<Loop>();
+        loop->n     = n;
+        loop->grain = defaultGrain(n, grain);
+        loop->task  = &task;
+
+        const std::ptrdiff_t nbTasks = std::min<std::ptrdiff_t>(m_concurrency, (n + loop->grain - 1) / loop->grain);
+        try
+        {
+            for (std::ptrdiff_t t = 1; t < nbTasks; ++t)
+                m_submit([loop]() {
+                    {
+                        std::lock_guard<std::mutex> lock(loop->mutex);
+                        if (loop->finished) return;
+                        ++loop->active;
+                    }
+                    loop->run();
+                    std::lock_guard<std::mutex> lock(loop->mutex);
+                    if (--loop->active == 0) loop->done.notify_all();
+                });
+        }
+        catch (...)
+        {
+            // The tasks already submitted must still be waited for, as they reference `task`
+            loop->fail(std::current_exception());
+        }
+
+        loop->run();
+        {
+            std::unique_lock<std::mutex> lock(loop->mutex);
+            loop->finished = true;
+            loop->done.wait(lock, [&]() { return loop->active == 0; });
+        }
+        if (loop->error) std::rethrow_exception(loop->error);
+    }
+
+private:
+    Submit m_submit;
+    int m_concurrency;
+};
+
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    inline std::atomic<Executor*>& userDefaultExecutor()
+    {
+        static std::atomic<Executor*> executor {nullptr};
+        return executor;
+    }
+}
+#endif
+
+/*!
+ * \brief Executor used by the parallel algorithms when none is set explicitly
+ *
+ * Returns the executor set by setDefaultExecutor, or a ThreadPoolExecutor using all the hardware threads, created on
+ * first use.
+ */
+inline Executor& defaultExecutor()
+{
+    if (Executor* e = internal::userDefaultExecutor().load()) return *e;
+    static ThreadPoolExecutor pool;
+    return pool;
+}
+
+/// \brief Replace the default executor (see defaultExecutor), or restore the built-in thread pool with nullptr
+/// \warning The executor must outlive its use by the library
+inline void setDefaultExecutor(Executor* executor)
+{
+    internal::userDefaultExecutor().store(executor);
+}
+
+/// \brief `*executor`, or the default executor when `executor` is nullptr
+inline Executor& executorOrDefault(Executor* executor)
+{
+    return executor != nullptr ? *executor : defaultExecutor();
+}
+
+} // namespace Ponca
@@ -9,8 +9,13 @@
 #include "defines.h"
 #include "enums.h"
 #include "primitive.h"
+#include "neighborPacket.h"
+#ifdef PONCA_CPU_ARCH
+#  include "neighborCache.h"
+#endif
 
 #include PONCA_MULTIARCH_INCLUDE_STD(iterator)
+#include PONCA_MULTIARCH_INCLUDE_CU_STD(type_traits)
 
 namespace Ponca
 {
@@ -22,6 +27,32 @@ namespace Ponca
 /*! \brief Namespace used for structure or classes used internally by the lib */
 namespace internal
 {
+    /*! \brief Call a functor on each sample of a range of iterators (see Basket::computeCached) */
+    template <typename IteratorBegin, typename IteratorEnd>
+    struct ForEachInRange
+    {
+        const IteratorBegin& begin;
+        const IteratorEnd&   end;
+
+        template <typename Functor>
+        PONCA_MULTIARCH inline void operator()(const Functor& f) const {
+            for (auto it = begin; it != end; ++it) f(*it);
+        }
+    };
+
+    /*! \brief Call a functor on each sample of a container selected by a range of indices (see Basket::computeWithIdsCached) */
+    template <typename IndexRange, typename PointContainer>
+    struct ForEachInIds
+    {
+        IndexRange&           ids; // range queries may only be iterated when mutable
+        const PointContainer& points;
+
+        template <typename Functor>
+        PONCA_MULTIARCH inline void operator()(const Functor& f) const {
+            for (const auto& i : ids) f(points[i]);
+        }
+    };
+
     template <class P, class W,
         typename Aggregate,
         template <class, class, typename> class Ext,
@@ -69,6 +100,48 @@ namespace internal
     struct BasketDiffAggregate : BasketDiffAggregateImpl<BasketType, Type, BasketType, PrimitiveDer, Exts...>
     {
     };
+
+    /// \brief Class declaring a member function, deduced from a pointer to this member (only used in decltype)
+    template <typename C, typename R, typename... Args>
+    C declaringClass(R (C::*)(Args...));
+
+    /// \brief Base class of an extension of a Basket (void for unknown classes)
+    template <typename Ext>
+    struct ExtensionBase { using type = void; };
+
+    template <template <class, class, typename> class Ext, class P, class W, typename T>
+    struct ExtensionBase<Ext<P, W, T>> { using type = T; };
+
+    template <typename ScalarDecl, typename PacketDecl, int Size>
+    struct PacketAccumulationChain;
+
+    /*! \brief Tell if neighbors can be accumulated by packets of `Size` neighbors through the extensions of `Ext`
+
+        Packets can be accumulated if each extension accumulating neighbors, i.e. declaring `addLocalNeighbor`, also
+        declares its packet counterpart `addLocalNeighbors` (see PONCA_FITTING_DECLARE_ADDNEIGHBORS). Otherwise, the
+        packet function of a base class would be called, and the accumulation of the extension silently skipped.
+     */
+    template <typename Ext, int Size, typename = void>
+    struct HasPacketAccumulation : PONCA_MULTIARCH_CU_STD_NAMESPACE(false_type) {};
+
+    template <typename Ext, int Size>
+    struct HasPacketAccumulation<Ext, Size,
+        decltype(void(declaringClass(&Ext::addLocalNeighbor)),
+                 void(declaringClass(&Ext::template addLocalNeighbors<Size>)))>
+        : PacketAccumulationChain<decltype(declaringClass(&Ext::addLocalNeighbor)),
+                                  decltype(declaringClass(&Ext::template addLocalNeighbors<Size>)), Size> {};
+
+    // The last extension accumulating neighbors does not declare the packet function
+    template <typename ScalarDecl, typename PacketDecl, int Size>
+    struct PacketAccumulationChain : PONCA_MULTIARCH_CU_STD_NAMESPACE(false_type) {};
+
+    template <typename Decl, int Size>
+    struct PacketAccumulationChain<Decl, Decl, Size>
+        : HasPacketAccumulation<typename ExtensionBase<Decl>::type, Size> {};
+
+    template <class P, class W, typename T, int Size>
+    struct PacketAccumulationChain<PrimitiveBase<P, W, T>, PrimitiveBase<P, W, T>, Size>
+        : PONCA_MULTIARCH_CU_STD_NAMESPACE(true_type) {};
 }
 #endif
 
@@ -79,6 +152,108 @@ namespace internal
     PONCA_MULTIARCH inline                                                                            \
     FIT_RESULT compute(const Container& c){                                                           \
         return Self::compute(std::begin(c), std::end(c));                                             \
+    }                                                                                                 \
+    /*! \brief Convenience function for STL-like iterators, processing the neighbors by packets */    \
+    /*! Same as #compute(const IteratorBegin&,const IteratorEnd&), but the neighbors are gathered  */ \
+    /*! in packets of `PacketSize` samples that are weighted at once (see #addNeighbors). */          \
+    /*! \warning The iterators must give access to samples stored in memory (not to temporaries) */  \
+    template <int PacketSize = 8, typename IteratorBegin, typename IteratorEnd>                       \
+    PONCA_MULTIARCH inline                                                                            \
+    FIT_RESULT computeWithPackets(const IteratorBegin& begin, const IteratorEnd& end){                \
+        static_assert(std::is_lvalue_reference<decltype(*begin)>::value,                              \
+                      "Packets store pointers to the samples: iterators must return references");     \
+        FIT_RESULT res = UNDEFINED;                                                                   \
+        NeighborPacket<DataPoint, PacketSize> packet;                                                 \
+        do {                                                                                          \
+            Self::startNewPass();                                                                     \
+            packet.clear();                                                                           \
+            for (auto it = begin; it != end; ++it){                                                   \
+                packet.push(*it);                                                                     \
+                if (packet.full()) {                                                                  \
+                    Self::addNeighbors(packet);                                                       \
+                    packet.clear();                                                                   \
+                }                                                                                     \
+            }                                                                                         \
+            if (! packet.empty()) Self::addNeighbors(packet);                                         \
+            res = Base::finalize();                                                                   \
+        } while ( res == NEED_OTHER_PASS );                                                           \
+        return res;                                                                                   \
+    }                                                                                                 \
+    /*! \copydoc computeWithPackets(const IteratorBegin&,const IteratorEnd&) */                       \
+    template <int PacketSize = 8, typename Container>                                                 \
+    PONCA_MULTIARCH inline                                                                            \
+    FIT_RESULT computeWithPackets(const Container& c){                                                \
+        return Self::template computeWithPackets<PacketSize>(std::begin(c), std::end(c));             \
+    }                                                                                                 \
+    /*! \brief Fit the neighbors visited by `forEachNeighbor(f)`, replaying them from `cache` after the first pass */ \
+    /*! `forEachNeighbor` calls `f(const DataPoint&)` for each neighbor stored in memory. The weights are  */ \
+    /*! replayed from the cache when they are the same at each pass (see IsPassInvariantWeight), */   \
+    /*! and recomputed otherwise. \see computeCached, computeWithIdsCached */                            \
+    template <typename ForEachNeighbor, int N>                                                        \
+    PONCA_MULTIARCH inline                                                                            \
+    FIT_RESULT computeCachedNeighbors(const ForEachNeighbor& forEachNeighbor,                         \
+                                      NeighborCache<DataPoint, N>& cache){                            \
+        constexpr bool cacheWeights = IsPassInvariantWeight<typename Base::WFunctor>::value;          \
+        cache.clear();                                                                                \
+        Self::startNewPass();                                                                         \
+        forEachNeighbor([&](const DataPoint& nei){                                                    \
+            auto wres = Base::m_w.w(nei.pos(), nei);                                                  \
+            /* neighbors outside the support are kept when their weights may change */                \
+            if (! cacheWeights || wres.first > Scalar(0.))                                            \
+                cache.push_back({wres.first, wres.second, &nei});                                     \
+            if (wres.first > Scalar(0.))                                                              \
+                Self::addWeightedNeighbor(wres.first, wres.second, nei);                              \
+        });                                                                                           \
+        FIT_RESULT res = Base::finalize();                                                            \
+        while ( res == NEED_OTHER_PASS ) {                                                            \
+            Self::startNewPass();                                                                     \
+            for (const auto& n : cache){                                                              \
+                if (cacheWeights) Self::addWeightedNeighbor(n.weight, n.localQ, *n.point);            \
+                else Self::addNeighbor(*n.point);                                                     \
+            }                                                                                         \
+            res = Base::finalize();                                                                   \
+        }                                                                                             \
+        return res;                                                                                   \
+    }                                                                                                 \
+    /*! \brief Convenience function for STL-like iterators, iterating only once over the neighbors  */ \
+    /*! Same as #compute(const IteratorBegin&,const IteratorEnd&), but the neighbors are stored in */   \
+    /*! `cache` during the first pass, and replayed from the cache during the next passes (see */       \
+    /*! #NEED_OTHER_PASS). Prefer for multi-pass fits with costly neighbor queries. */                  \
+    /*! \warning The iterators must give access to samples stored in memory (not to temporaries) */   \
+    template <typename IteratorBegin, typename IteratorEnd, int N>                                    \
+    PONCA_MULTIARCH inline                                                                            \
+    FIT_RESULT computeCached(const IteratorBegin& begin, const IteratorEnd& end,                      \
+                             NeighborCache<DataPoint, N>& cache){                                     \
+        static_assert(std::is_lvalue_reference<decltype(*begin)>::value,                              \
+                      "The cache stores pointers to the samples: iterators must return references");  \
+        return Self::computeCachedNeighbors(                                                          \
+            internal::ForEachInRange<IteratorBegin, IteratorEnd>{begin, end}, cache);                 \
+    }                                                                                                 \
+    /*! \copydoc computeCached(const IteratorBegin&,const IteratorEnd&,NeighborCache<DataPoint,N>&) */ \
+    /*! Uses a temporary cache, allocated on the heap only for large neighborhoods. */                \
+    template <typename IteratorBegin, typename IteratorEnd>                                           \
+    PONCA_MULTIARCH inline                                                                            \
+    FIT_RESULT computeCached(const IteratorBegin& begin, const IteratorEnd& end){                     \
+        NeighborCache<DataPoint> cache;                                                               \
+        return Self::computeCached(begin, end, cache);                                                \
+    }                                                                                                 \
+    /*! \brief Convenience function to iterate only once over a subset of samples in a PointContainer */ \
+    /*! Same as #computeWithIds, but the neighbors are replayed from `cache` after the first pass */    \
+    /*! \see computeCached(const IteratorBegin&,const IteratorEnd&,NeighborCache<DataPoint,N>&) */     \
+    template <typename IndexRange, typename PointContainer, int N>                                    \
+    PONCA_MULTIARCH inline                                                                            \
+    FIT_RESULT computeWithIdsCached(IndexRange ids, const PointContainer& points,                     \
+                                    NeighborCache<DataPoint, N>& cache){                              \
+        return Self::computeCachedNeighbors(                                                          \
+            internal::ForEachInIds<IndexRange, PointContainer>{ids, points}, cache);                  \
+    }                                                                                                 \
+    /*! \copydoc computeWithIdsCached(IndexRange,const PointContainer&,NeighborCache<DataPoint,N>&) */ \
+    /*! Uses a temporary cache, allocated on the heap only for large neighborhoods. */                \
+    template <typename IndexRange, typename PointContainer>                                           \
+    PONCA_MULTIARCH inline                                                                            \
+    FIT_RESULT computeWithIdsCached(IndexRange ids, const PointContainer& points){                    \
+        NeighborCache<DataPoint> cache;                                                               \
+        return Self::computeWithIdsCached(ids, points, cache);                                        \
     }
 #else
 #   define WRITE_BASKET_SINGLE_HOST_FUNCTIONS
@@ -120,6 +295,24 @@ namespace internal
         } while ( res == NEED_OTHER_PASS );                                                           \
         return res;                                                                                   \
     }                                                                                                 \
+    /*! \brief Convenience function to fit neighbors whose weights are already known */              \
+    /*! Add the neighbors using #addWeightedNeighbor, and call finalize at the end. The neighbors are */ \
+    /*! replayed if the fit requires multiple passes (see #NEED_OTHER_PASS). */                        \
+    /*! \tparam WeightedRange STL-like range of WeightedNeighbor (e.g. NeighborCache), or of any type */ \
+    /*! with the same members */                                                                       \
+    template <typename WeightedRange>                                                                 \
+    PONCA_MULTIARCH inline                                                                            \
+    FIT_RESULT computeWeighted(const WeightedRange& neighbors){                                       \
+        FIT_RESULT res = UNDEFINED;                                                                   \
+        do {                                                                                          \
+            Self::startNewPass();                                                                     \
+            for (const auto& n : neighbors){                                                          \
+                Self::addWeightedNeighbor(n.weight, n.localQ, *n.point);                              \
+            }                                                                                         \
+            res = Base::finalize();                                                                   \
+        } while ( res == NEED_OTHER_PASS );                                                           \
+        return res;                                                                                   \
+    }                                                                                                 \
     WRITE_BASKET_SINGLE_HOST_FUNCTIONS
 
     /*!
@@ -156,12 +349,16 @@ namespace internal
     public:
     /// Base type, which aggregates all the computational objects using the CRTP
     using Base = typename internal::BasketDiffAggregate<BasketType, Type, Ext0, Exts...>::type;
+    /// Differentiated Basket, which is also a base class of BasketDiff
+    using BasketFit = BasketType;
         /// Weighting function
     using WeightFunction = BSKW;
     /// Point type used for computation
     using DataPoint = BSKP;
     /// Scalar type used for computation, as defined from Basket
     using Scalar = typename DataPoint::Scalar;
+    /// Vector type used for computation, as defined from Basket
+    using VectorType = typename DataPoint::VectorType;
 
     WRITE_BASKET_FUNCTIONS
 
@@ -177,6 +374,66 @@ namespace internal
         }
         return false;
     }
+
+    /// \copydoc Basket::addNeighbor(const DataPoint&,const Scalar&)
+    PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei, const Scalar& _sqDist) {
+        // compute weight
+        auto wres = Base::m_w.w(_nei.pos(), _nei, _sqDist);
+        typename Base::ScalarArray dw;
+
+        if (wres.first > Scalar(0.)) {
+            Base::addLocalNeighbor(wres.first, wres.second, _nei, dw);
+            return true;
+        }
+        return false;
+    }
+
+    /// \brief Add a packet of neighbors to perform the fit
+    ///
+    /// The weights of the whole packet are computed at once (see DistWeightFunc::wPacket and UsePacketWeights), and
+    /// the neighbors of the packet are then accumulated one by one, together with the derivatives of their weights.
+    /// \see Basket::addNeighbors
+    /// \return the number of valid neighbors in the packet (weight > 0)
+    template <int Size>
+    PONCA_MULTIARCH inline int addNeighbors(const NeighborPacket<DataPoint, Size>& _packet) {
+        // weighting functions defining their own w cannot use wPacket
+        if constexpr (! UsePacketWeights<WeightFunction>::value)
+        {
+            int nb = 0;
+            for (int i = 0; i < _packet.count; ++i)
+                if (addNeighbor(*_packet.points[i])) ++nb;
+            return nb;
+        }
+        else
+        {
+            // compute weights of the whole packet
+            typename NeighborPacket<DataPoint, Size>::ScalarPacket   w;
+            typename NeighborPacket<DataPoint, Size>::PositionPacket localQ;
+            Base::m_w.wPacket(_packet.positions, w, localQ);
+            typename Base::ScalarArray dw;
+
+            int nb = 0;
+            for (int i = 0; i < _packet.count; ++i) {
+                if (w(i) > Scalar(0.)) {
+                    Base::addLocalNeighbor(w(i), localQ.col(i), *_packet.points[i], dw);
+                    ++nb;
+                }
+            }
+            return nb;
+        }
+    }
+
+    /// \copydoc Basket::addWeightedNeighbor
+    /// \note Weight derivatives are still computed from the weighting function
+    PONCA_MULTIARCH inline bool addWeightedNeighbor(Scalar _w, const VectorType& _localQ, const DataPoint &_nei) {
+        typename Base::ScalarArray dw;
+
+        if (_w > Scalar(0.)) {
+            Base::addLocalNeighbor(_w, _localQ, _nei, dw);
+            return true;
+        }
+        return false;
+    }
 };
 
 /*!
@@ -218,6 +475,8 @@ namespace internal
         using Scalar = typename P::Scalar;
         /// Point type used for computation
         using DataPoint = P;
+        /// Vector type used for computation, as defined from template parameter `P`
+        using VectorType = typename P::VectorType;
         /// Weighting function
         using WeightFunction = W;
 
@@ -239,6 +498,90 @@ namespace internal
             }
             return false;
         }
+
+        /// \brief Add a neighbor to perform the fit, knowing its squared distance to the basis center
+        ///
+        /// Avoids computing the distance again when it is given by the spatial query (see
+        /// KdTreeRangeIterator::squaredDistance and DistWeightFunc::w).
+        /// \return false if param nei is not a valid neighbor (weight = 0)
+        PONCA_MULTIARCH inline bool addNeighbor(const DataPoint &_nei, const Scalar& _sqDist) {
+            // compute weight
+            auto wres = Base::m_w.w(_nei.pos(), _nei, _sqDist);
+
+            if (wres.first > Scalar(0.)) {
+                Base::addLocalNeighbor(wres.first, wres.second, _nei);
+                return true;
+            }
+            return false;
+        }
+
+        /// \brief Tell if the extensions accumulate packets of `Size` neighbors at once (see #addNeighbors)
+        template <int Size>
+        static constexpr bool hasPacketAccumulation() { return internal::HasPacketAccumulation<Base, Size>::value; }
+
+        /// \brief Add a packet of neighbors to perform the fit
+        ///
+        /// The weights and local coordinates of the neighbors are computed for the whole packet at once (see
+        /// DistWeightFunc::wPacket), or one by one for the weighting functions that do not enable UsePacketWeights,
+        /// and the weights of the lanes after NeighborPacket::count are set to zero.
+        /// When all the extensions provide a packet accumulation (see #hasPacketAccumulation, e.g. CovarianceFitBase,
+        /// MeanPosition, MeanNormal and the sphere fits), the packet is accumulated at once. Otherwise, each neighbor
+        /// with a non-zero weight is accumulated as in #addNeighbor.
+        /// When called directly, don't forget to call PrimitiveBase::startNewPass when starting multiple passes
+        /// \see computeWithPackets
+        /// \return the number of valid neighbors in the packet (weight > 0)
+        template <int Size>
+        PONCA_MULTIARCH inline int addNeighbors(const NeighborPacket<DataPoint, Size>& _packet) {
+            typename NeighborPacket<DataPoint, Size>::ScalarPacket   w;
+            typename NeighborPacket<DataPoint, Size>::PositionPacket localQ;
+            // weighting functions defining their own w cannot use wPacket
+            if constexpr (UsePacketWeights<WeightFunction>::value)
+            {
+                // compute weights of the whole packet
+                Base::m_w.wPacket(_packet.positions, w, localQ);
+            }
+            else
+            {
+                localQ.setZero(); // unused lanes must stay finite
+                for (int i = 0; i < _packet.count; ++i) {
+                    auto wres = Base::m_w.w(_packet.points[i]->pos(), *_packet.points[i]);
+                    w(i) = wres.first;
+                    localQ.col(i) = wres.second;
+                }
+            }
+            for (int i = _packet.count; i < Size; ++i) w(i) = Scalar(0.);
+
+            if constexpr (hasPacketAccumulation<Size>())
+                return Base::addLocalNeighbors(_packet, w, localQ);
+            else
+            {
+                int nb = 0;
+                for (int i = 0; i < _packet.count; ++i) {
+                    if (w(i) > Scalar(0.)) {
+                        Base::addLocalNeighbor(w(i), localQ.col(i), *_packet.points[i]);
+                        ++nb;
+                    }
+                }
+                return nb;
+            }
+        }
+
+        /// \brief Add a neighbor whose weight has already been computed, without evaluating the weighting function
+        ///
+        /// Allows to share the weights between several fits, or to reuse them across passes (see #computeWeighted).
+        /// When called directly, don't forget to call PrimitiveBase::startNewPass when starting multiple passes
+        /// \param _w Weight of the neighbor
+        /// \param _localQ Neighbor position expressed in the local basis of the weighting function of this fit
+        /// (see DistWeightFunc::w)
+        /// \param _nei Neighbor
+        /// \return false if the neighbor is not valid (weight = 0)
+        PONCA_MULTIARCH inline bool addWeightedNeighbor(Scalar _w, const VectorType& _localQ, const DataPoint &_nei) {
+            if (_w > Scalar(0.)) {
+                Base::addLocalNeighbor(_w, _localQ, _nei);
+                return true;
+            }
+            return false;
+        }
     }; // class Basket
 
 } //namespace Ponca
@@ -9,12 +9,30 @@
 
 #pragma once
 #include "./defines.h"
+#include "./neighborPacket.h"
+#include "./symmetricEigenSolver.h"
 
 #include <Eigen/Dense>
+#include PONCA_MULTIARCH_INCLUDE_CU_STD(utility)
 
 namespace Ponca
 {
 
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    /// \brief Scalar type used to accumulate sums: `DataPoint::AccumulationScalar` if defined, `DataPoint::Scalar`
+    /// otherwise
+    template <typename DataPoint, typename = void>
+    struct AccumulationScalar { using type = typename DataPoint::Scalar; };
+
+    template <typename DataPoint>
+    struct AccumulationScalar<DataPoint,
+        decltype(void(PONCA_MULTIARCH_CU_STD_NAMESPACE(declval)<typename DataPoint::AccumulationScalar>()))>
+    { using type = typename DataPoint::AccumulationScalar; };
+}
+#endif
+
 /*!
    \brief Line fitting procedure that minimize the orthogonal distance
    between the samples and the fitted primitive.
@@ -25,6 +43,16 @@ namespace Ponca
 
    \todo Add equations
 
+   The covariance is accumulated around the first neighbor (shifted-origin covariance), and centered on the
+   barycenter at the end of the fit. This avoids the catastrophic cancellation of \f$ \frac{1}{\sum w_i} \sum w_i
+   \mathbf{q_i}\mathbf{q_i}^T - \mathbf{b}\mathbf{b}^T \f$ when the barycenter \f$ \mathbf{b} \f$ is far from the
+   evaluation position compared to the spread of the neighbors.
+
+   The sums are accumulated using #AccumulationScalar, which can be wider than `Scalar`: points stored in `float` can
+   be accumulated in `double` by defining `using AccumulationScalar = double;` in the DataPoint class. The barycenter
+   on which the covariance is centered is computed from the same sums (see #covarianceBarycenter), while
+   MeanPosition::barycenter is still computed from the `Scalar` sums of MeanPosition.
+
    \warning This class is valid only in 3D.
  */
 
@@ -43,16 +71,27 @@ namespace Ponca
     public:
         using MatrixType = typename DataPoint::MatrixType; /*!< \brief Alias to matrix type*/
         /*! \brief Solver used to analyse the covariance matrix*/
-        using Solver = Eigen::SelfAdjointEigenSolver<MatrixType>;
+        using Solver = SymmetricEigenSolver<MatrixType>;
+        /*! \brief Scalar type used to accumulate the covariance: `DataPoint::AccumulationScalar` if defined, `Scalar`
+            otherwise */
+        using AccumulationScalar = typename internal::AccumulationScalar<DataPoint>::type;
 
     protected:
+        using AccumulationVector = Eigen::Matrix<AccumulationScalar, DataPoint::Dim, 1>;
+        using AccumulationMatrix = Eigen::Matrix<AccumulationScalar, DataPoint::Dim, DataPoint::Dim>;
+
         // computation data
-        MatrixType m_cov {MatrixType::Zero()};     /*!< \brief Covariance matrix */
+        MatrixType m_cov {MatrixType::Zero()};     /*!< \brief Covariance matrix, centered on the barycenter by finalize */
+        AccumulationMatrix m_sumShiftedCov {AccumulationMatrix::Zero()}; /*!< \brief Weighted sum of \f$ (\mathbf{q_i} - \mathbf{s})(\mathbf{q_i} - \mathbf{s})^T \f$ */
+        AccumulationVector m_sumShiftedP {AccumulationVector::Zero()};   /*!< \brief Weighted sum of \f$ \mathbf{q_i} - \mathbf{s} \f$ */
+        AccumulationScalar m_sumShiftedW {0};      /*!< \brief Sum of the weights, in accumulation precision */
+        VectorType m_shift {VectorType::Zero()};   /*!< \brief Origin \f$ \mathbf{s} \f$ of the accumulation: first neighbor, in local basis */
         Solver m_solver;  /*!<\brief Solver used to analyse the covariance matrix */
 
     public:
         PONCA_EXPLICIT_CAST_OPERATORS(CovarianceFitBase,covarianceFit)
         PONCA_FITTING_DECLARE_INIT_ADD_FINALIZE
+        PONCA_FITTING_DECLARE_ADDNEIGHBORS
 
         /*! \brief Implements \cite Pauly:2002:PSSimplification surface variation.
             It computes the ratio \f$ d \frac{\lambda_0}{\sum_i \lambda_i} \f$ with \c d the dimension of the ambient space.
@@ -62,6 +101,20 @@ namespace Ponca
 
         /*! \brief Reading access to the Solver used to analyse the covariance matrix */
         PONCA_MULTIARCH inline const Solver& solver() const { return m_solver; }
+
+        /*! \brief Barycenter of the input points on which the covariance is centered, computed from the shifted sums
+            in #AccumulationScalar
+
+            Same value as MeanPosition::barycenter up to rounding, which is accumulated in `Scalar` around the basis
+            center. Used as origin of the covariance primitives (e.g. CovariancePlaneFit, CovarianceLineFit).
+            \see MeanPosition::barycenter */
+        PONCA_MULTIARCH inline VectorType covarianceBarycenter() const {
+            return (m_shift.template cast<AccumulationScalar>() + m_sumShiftedP / m_sumShiftedW).template cast<Scalar>();
+        }
+
+        /*! \brief Set the strategy used to analyse the covariance matrix. Kept by #init.
+            \see SymmetricEigenSolver */
+        PONCA_MULTIARCH inline void setSolverPolicy(EigenSolverPolicy _policy) { m_solver.setPolicy(_policy); }
     };
 
 
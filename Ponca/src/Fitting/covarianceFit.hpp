@@ -14,6 +14,10 @@ CovarianceFitBase<DataPoint, _WFunctor, T>::init(const VectorType& _evalPos)
 {
     Base::init(_evalPos);
     m_cov.setZero();
+    m_sumShiftedCov.setZero();
+    m_sumShiftedP.setZero();
+    m_sumShiftedW = AccumulationScalar(0);
+    m_shift.setZero();
 }
 
 template < class DataPoint, class _WFunctor, typename T>
@@ -23,12 +27,47 @@ CovarianceFitBase<DataPoint, _WFunctor, T>::addLocalNeighbor(Scalar w,
                                                               const DataPoint &attributes)
 {
     if( Base::addLocalNeighbor(w, localQ, attributes) ) {
-        m_cov  += w * localQ * localQ.transpose();
+        // The origin can be moved as long as nothing has been accumulated
+        if (m_sumShiftedW == AccumulationScalar(0))
+            m_shift = localQ;
+        const AccumulationScalar aw = AccumulationScalar(w);
+        const AccumulationVector d  = localQ.template cast<AccumulationScalar>() - m_shift.template cast<AccumulationScalar>();
+        m_sumShiftedW   += aw;
+        m_sumShiftedP   += aw * d;
+        m_sumShiftedCov += aw * d * d.transpose();
         return true;
     }
     return false;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+template <int Size>
+int
+CovarianceFitBase<DataPoint, _WFunctor, T>::addLocalNeighbors(const NeighborPacket<DataPoint, Size>& packet,
+                                                               const typename NeighborPacket<DataPoint, Size>::ScalarPacket& w,
+                                                               const typename NeighborPacket<DataPoint, Size>::PositionPacket& localQ)
+{
+    const int nb = Base::addLocalNeighbors(packet, w, localQ);
+    if (nb == 0) return 0;
+    // The origin can be moved as long as nothing has been accumulated: first valid lane, as in addLocalNeighbor
+    if (m_sumShiftedW == AccumulationScalar(0))
+    {
+        int first = 0;
+        while (! (w(first) > Scalar(0.))) ++first;
+        m_shift = localQ.col(first);
+    }
+    // Invalid lanes have a zero weight, and do not contribute to the sums
+    using AccumulationPacket = Eigen::Matrix<AccumulationScalar, DataPoint::Dim, Size>;
+    const Eigen::Array<AccumulationScalar, 1, Size> aw = w.template cast<AccumulationScalar>();
+    const AccumulationPacket d  = localQ.template cast<AccumulationScalar>().colwise()
+                                - m_shift.template cast<AccumulationScalar>();
+    const AccumulationPacket wd = (d.array().rowwise() * aw).matrix();
+    m_sumShiftedW   += aw.sum();
+    m_sumShiftedP   += wd.rowwise().sum();
+    m_sumShiftedCov += wd * d.transpose();
+    return nb;
+}
+
 
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
@@ -41,15 +80,11 @@ CovarianceFitBase<DataPoint, _WFunctor, T>::finalize ()
     if(Base::getNumNeighbors() < DataPoint::Dim)
         return Base::m_eCurrentState = UNDEFINED;
 
-    // Center the covariance on the centroid
-    auto centroid = Base::barycenter();
-    m_cov = m_cov/Base::getWeightSum() - centroid * centroid.transpose();
+    // Center the covariance on the centroid, expressed relatively to the accumulation origin
+    const AccumulationVector centroid = m_sumShiftedP / m_sumShiftedW;
+    m_cov = (m_sumShiftedCov / m_sumShiftedW - centroid * centroid.transpose()).template cast<Scalar>();
 
-#ifdef __CUDACC__
-    m_solver.computeDirect(m_cov);
-#else
     m_solver.compute(m_cov);
-#endif
     Base::m_eCurrentState = ( m_solver.info() == Eigen::Success ? STABLE : UNDEFINED );
 
     return Base::m_eCurrentState;
@@ -52,7 +52,7 @@ public:
         static const int smallestEigenValue = DataPoint::Dim - 1;
         if (Base::finalize() == STABLE) {
             if (Base::line().isValid()) Base::m_eCurrentState = CONFLICT_ERROR_FOUND;
-            Base::setLine(Base::barycenter(), Base::m_solver.eigenvectors().col(smallestEigenValue).normalized());
+            Base::setLine(Base::covarianceBarycenter(), Base::m_solver.eigenvectors().col(smallestEigenValue).normalized());
         }
         return Base::m_eCurrentState;
     }
@@ -13,7 +13,7 @@ CovariancePlaneFitImpl<DataPoint, _WFunctor, T>::finalize ()
 {
     if (Base::finalize() == STABLE) {
         if (Base::plane().isValid()) Base::m_eCurrentState = CONFLICT_ERROR_FOUND;
-        Base::setPlane(Base::m_solver.eigenvectors().col(0), Base::barycenter());
+        Base::setPlane(Base::m_solver.eigenvectors().col(0), Base::covarianceBarycenter());
     }
 
     return Base::m_eCurrentState;
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "./defines.h"
+#include "./symmetricEigenSolver.h"
 
 namespace Ponca
 {
@@ -65,6 +66,9 @@ namespace Ponca
  * eigenvalues and associated eigenvectors of the covariance matrix
  * \cite Liang:1990:RRSS.
  *
+ * The covariance matrix is decomposed with #DirectEigenSolverWithFallback by default: results computed with the
+ * unchecked closed-form solution, used before, are obtained with `setSolverPolicy(DirectEigenSolver)`.
+ *
  * \todo Refactor curvature estimators, and link to tangent plane
  *
  * \warning Not it test suite, to be added !
@@ -90,16 +94,20 @@ protected:
 
 public:
     /*! \brief Solver used to analyse the covariance matrix*/
-    typedef Eigen::SelfAdjointEigenSolver<MatrixType> Solver;
+    typedef SymmetricEigenSolver<MatrixType> Solver;
 
 protected:
     MatrixType m_cov;   /*!< \brief Covariance matrix of the normal vectors \todo We have this somewhere else */
     VectorType m_cog;   /*!< \brief Gravity center of the normal vectors \todo Use MeanNormal */
-    Solver m_solver;    /*!< \brief Solver used to analyse the covariance matrix */
+    Solver m_solver {DirectEigenSolverWithFallback}; /*!< \brief Solver used to analyse the covariance matrix */
 
 public:
     PONCA_EXPLICIT_CAST_OPERATORS_DER(NormalCovarianceCurvatureEstimator, normalCovarianceCurvatureEstimator)
     PONCA_FITTING_DECLARE_INIT_ADDDER_FINALIZE
+
+    /*! \brief Set the strategy used to analyse the covariance matrix. Kept by #init.
+        \see SymmetricEigenSolver */
+    PONCA_MULTIARCH inline void setSolverPolicy(EigenSolverPolicy _policy) { m_solver.setPolicy(_policy); }
 };
 
 
@@ -112,6 +120,9 @@ public:
  * the eigenvalues and associated eigenvectors of the covariance matrix
  * \cite Berkmann:1994:CSG.
  *
+ * The covariance matrix is decomposed with #DirectEigenSolverWithFallback by default: results computed with the
+ * unchecked closed-form solution, used before, are obtained with `setSolverPolicy(DirectEigenSolver)`.
+ *
  * \note This procedure requires two passes, the first one for plane fitting
  * and local frame estimation, and the second one for covariance analysis.
  * \warning This class is valid only in 3D.
@@ -150,18 +161,22 @@ public:
     typedef Eigen::Matrix<Scalar,2,1> Vector2;
     typedef typename VectorType::Index Index;
     /*! \brief Solver used to analyse the covariance matrix*/
-    typedef Eigen::SelfAdjointEigenSolver<Mat22> Solver;
+    typedef SymmetricEigenSolver<Mat22> Solver;
 
 protected:
     Vector2 m_cog;      /*!< \brief Gravity center */
     Mat22 m_cov;        /*!< \brief Covariance matrix */
-    Solver m_solver;    /*!< \brief Solver used to analyse the covariance matrix */
+    Solver m_solver {DirectEigenSolverWithFallback}; /*!< \brief Solver used to analyse the covariance matrix */
     PASS m_pass;        /*!< \brief Current pass */
     Mat32 m_tframe;     /*!< \brief Tangent frame */
 
 public:
     PONCA_EXPLICIT_CAST_OPERATORS_DER(ProjectedNormalCovarianceCurvatureEstimator, projectedNormalCovarianceCurvature)
     PONCA_FITTING_DECLARE_INIT_ADDDER_FINALIZE
+
+    /*! \brief Set the strategy used to analyse the covariance matrix. Kept by #init.
+        \see SymmetricEigenSolver */
+    PONCA_MULTIARCH inline void setSolverPolicy(EigenSolverPolicy _policy) { m_solver.setPolicy(_policy); }
 };
 
 #include "curvatureEstimation.hpp"
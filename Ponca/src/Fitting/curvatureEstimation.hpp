@@ -146,7 +146,7 @@ NormalCovarianceCurvatureEstimator<DataPoint, _WFunctor, DiffType, T>::finalize
         // Center the covariance on the centroid
         m_cov = m_cov/Base::getWeightSum() - m_cog * m_cog.transpose();
 
-        m_solver.computeDirect(m_cov);
+        m_solver.compute(m_cov);
 
         Scalar kmin = m_solver.eigenvalues()(1);
         Scalar kmax = m_solver.eigenvalues()(2);
@@ -257,7 +257,7 @@ ProjectedNormalCovarianceCurvatureEstimator<DataPoint, _WFunctor, DiffType, T>::
         // Center the covariance on the centroid
         m_cov = m_cov/Base::getWeightSum() - m_cog * m_cog.transpose();
 
-        m_solver.computeDirect(m_cov);
+        m_solver.compute(m_cov);
 
         Base::m_kmin = m_solver.eigenvalues()(0);
         Base::m_kmax = m_solver.eigenvalues()(1);
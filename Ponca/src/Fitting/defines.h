@@ -69,6 +69,8 @@ using VectorArray = typename Base::VectorArray;     /*!< \brief Alias to vector
 /*! Set the evaluation position and reset the internal states. \warning Must be called be for any computation (but after #setWeightFunc) */
 #define PONCA_FITTING_APIDOC_ADDNEIGHBOR \
 /*! Add a neighbor to perform the fit \return false if param nei is not a valid neighbour (weight = 0) */
+#define PONCA_FITTING_APIDOC_ADDNEIGHBORS \
+/*! Add a packet of neighbors to perform the fit, with the weights of its lanes (0 for invalid lanes) and their positions in local basis \return the number of valid neighbors (weight > 0) \see Basket::addNeighbors */
 #define PONCA_FITTING_APIDOC_ADDNEIGHBOR_DER \
 /*! Add a neighbor to perform the fit \return false if param nei is not a valid neighbour (weight = 0) */
 #define PONCA_FITTING_APIDOC_FINALIZE \
@@ -92,6 +94,15 @@ PONCA_MULTIARCH inline void init (const VectorType& _evalPos);
 PONCA_FITTING_APIDOC_ADDNEIGHBOR                                                                                   \
 PONCA_MULTIARCH inline bool addLocalNeighbor(Scalar w, const VectorType &localQ, const DataPoint &attributes);
 
+/// Declare the packet counterpart of Concept::ComputationalObjectConcept::addLocalNeighbor (see NeighborPacket)
+#define PONCA_FITTING_DECLARE_ADDNEIGHBORS                                                                         \
+PONCA_FITTING_APIDOC_ADDNEIGHBORS                                                                                  \
+template <int Size>                                                                                                \
+PONCA_MULTIARCH inline int                                                                                         \
+addLocalNeighbors(const NeighborPacket<DataPoint, Size>& packet,                                                   \
+                  const typename NeighborPacket<DataPoint, Size>::ScalarPacket& w,                                 \
+                  const typename NeighborPacket<DataPoint, Size>::PositionPacket& localQ);
+
 /// Declare Concept::ComputationalDerivativesConcept::addLocalNeighbor
 #define PONCA_FITTING_DECLARE_ADDNEIGHBOR_DER                                                                      \
 PONCA_FITTING_APIDOC_ADDNEIGHBOR_DER                                                                               \
@@ -37,4 +37,13 @@ FitSpaceDer = 0x02,                          /*!< \brief Flag indicating a space
 FitScaleSpaceDer = FitScaleDer | FitSpaceDer /*!< \brief Flag indicating a scale-space differentiation. */
 };
 
+/// Strategies used to compute the eigen decomposition of self-adjoint matrices
+/// \see SymmetricEigenSolver
+enum EigenSolverPolicy: unsigned char
+{
+IterativeEigenSolver = 0,         /*!< \brief Iterative QR algorithm, accurate but slower. */
+DirectEigenSolver = 1,            /*!< \brief Closed-form solution for 2x2 and 3x3 matrices, fast but less robust. */
+DirectEigenSolverWithFallback = 2 /*!< \brief Closed-form solution, using the iterative algorithm when not accurate. */
+};
+
 } //namespace Ponca
@@ -0,0 +1,217 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+#include "./neighborPacket.h"
+
+#include "../Common/executor.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    /// \brief Tell if a fit can process packets of neighbors, i.e. if it defines `addNeighbors` (see Basket)
+    template <typename Fit, int Size, typename = void>
+    struct HasPacketNeighbors : std::false_type {};
+
+    template <typename Fit, int Size>
+    struct HasPacketNeighbors<Fit, Size,
+        decltype(void(std::declval<Fit&>().addNeighbors(
+            std::declval<const NeighborPacket<typename Fit::DataPoint, Size>&>())))>
+        : std::true_type {};
+}
+#endif
+
+/*!
+    \brief Compute a fit at each pixel of an organized point cloud (e.g. a depth image), using image-space neighbors
+
+    This is the CPU counterpart of the screen-space GLS CUDA example: the neighbors of each pixel are the valid pixels
+    of a circular window centered on it (see ImageGrid::window_neighbors), and no spatial partitioning structure is
+    required. The neighbors are then weighted by the weighting function of the fit, e.g. to discard the samples across
+    depth discontinuities.
+
+    The image is split in square tiles processed in parallel (see #setExecutor), so that the pixels
+    processed by a thread share most of their neighbors in cache. Fits providing `addNeighbors` (see Basket) weight
+    the neighbors by packets, when their weighting function allows it (see UsePacketWeights).
+
+    Typical use, to compute a normal image and a curvature image:
+    \code
+    using Fit = Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<Scalar>>, OrientedSphereFit, GLSParam>;
+    ImageGrid<Point> grid;
+    grid.buildFromDepth(width, height, depth, normals, fx, fy, cx, cy);
+
+    ImageGridFit<Fit> engine;
+    engine.setWeightFunc(WeightFunc(scale));
+    engine.setWindowRadius(8);
+    auto kappa   = engine.computeImage(grid, [](const Fit& f) { return f.kappa(); }, Scalar(0));
+    auto normals = engine.computeImage(grid, [](const Fit& f) { return f.primitiveGradient(); }, VectorType(VectorType::Zero()));
+    \endcode
+
+    \tparam FitType Basket or BasketDiff type
+*/
+template <typename FitType>
+class ImageGridFit
+{
+public:
+    using Fit            = FitType;                              /*!< \brief Fit computed at each pixel */
+    using DataPoint      = typename Fit::DataPoint;              /*!< \brief Point type used for computation */
+    using Scalar         = typename DataPoint::Scalar;           /*!< \brief Scalar type used for computation */
+    using VectorType     = typename DataPoint::VectorType;       /*!< \brief Vector type used for computation */
+    using WeightFunction = typename Fit::WeightFunction;         /*!< \brief Weighting function of the fit */
+
+    /// \brief Number of neighbors weighted at once, for fits processing packets of neighbors
+    static constexpr int PacketSize = 8;
+    /// \brief Tell if the neighbors are weighted by packets (see UsePacketWeights)
+    static constexpr bool usePackets = UsePacketWeights<WeightFunction>::value &&
+                                       internal::HasPacketNeighbors<Fit, PacketSize>::value;
+
+    /// \copydoc PrimitiveBase::setWeightFunc
+    inline void setWeightFunc(const WeightFunction& _w) { m_w = _w; }
+
+    /// \brief Set the radius of the image-space windows, in pixels
+    inline void setWindowRadius(int _radius) { m_radius = std::max(_radius, 0); }
+
+    /// \brief Set the size of the square tiles processed in parallel, in pixels
+    inline void setTileSize(int _size) { m_tileSize = std::max(_size, 1); }
+
+    /// \brief Set the executor processing the tiles, or nullptr to use defaultExecutor()
+    inline void setExecutor(Executor* _executor) { m_executor = _executor; }
+
+    /// \brief Radius of the image-space windows, in pixels
+    inline int windowRadius() const { return m_radius; }
+
+    /// \brief Size of the square tiles processed in parallel, in pixels
+    inline int tileSize() const { return m_tileSize; }
+
+    /*!
+        \brief Fit the neighborhood of a single pixel
+        \param _grid ImageGrid (or any type with the same API)
+        \param _index Index of the pixel, must be valid
+        \param _fit Fit, initialized by this function
+        \param _neighbors Scratch storage receiving the indices of the window neighbors. They are gathered once, and
+        replayed for each pass of multi-pass fits (see #NEED_OTHER_PASS). Reuse it between pixels to avoid allocations.
+    */
+    template <typename Grid>
+    inline FIT_RESULT computeAt(const Grid& _grid, int _index, Fit& _fit, std::vector<int>& _neighbors) const
+    {
+        const auto& points = _grid.points();
+        _fit.setWeightFunc(m_w);
+        _fit.init(points[_index].pos());
+
+        _neighbors.clear();
+        for (int j : _grid.window_neighbors(_index, m_radius))
+            _neighbors.push_back(j);
+
+        FIT_RESULT res = UNDEFINED;
+        do {
+            _fit.startNewPass();
+            if constexpr (usePackets)
+            {
+                NeighborPacket<DataPoint, PacketSize> packet;
+                for (int j : _neighbors)
+                {
+                    packet.push(points[j]);
+                    if (packet.full())
+                    {
+                        _fit.addNeighbors(packet);
+                        packet.clear();
+                    }
+                }
+                if (! packet.empty()) _fit.addNeighbors(packet);
+            }
+            else
+            {
+                for (int j : _neighbors)
+                    _fit.addNeighbor(points[j]);
+            }
+            res = _fit.finalize();
+        } while (res == NEED_OTHER_PASS);
+        return res;
+    }
+
+    /// \copybrief computeAt(const Grid&,int,Fit&,std::vector<int>&) const
+    /// Uses a temporary storage for the window neighbors.
+    template <typename Grid>
+    inline FIT_RESULT computeAt(const Grid& _grid, int _index, Fit& _fit) const
+    {
+        std::vector<int> neighbors;
+        return computeAt(_grid, _index, _fit, neighbors);
+    }
+
+    /*!
+        \brief Compute the fit of all the valid pixels, tile by tile
+
+        \param _grid ImageGrid (or any type with the same API)
+        \param _f Functor called as `_f(index, fit)` for each valid pixel, once its fit is computed. It is called
+        concurrently from several threads, but never twice for the same pixel.
+    */
+    template <typename Grid, typename Functor>
+    inline void compute(const Grid& _grid, Functor&& _f) const
+    {
+        const int width    = _grid.width();
+        const int height   = _grid.height();
+        const int tilesX   = (width  + m_tileSize - 1) / m_tileSize;
+        const int tilesY   = (height + m_tileSize - 1) / m_tileSize;
+        const int nbTiles  = tilesX * tilesY;
+
+        executorOrDefault(m_executor).forEach(nbTiles, [&](std::ptrdiff_t t)
+        {
+            const int x0 = int(t % tilesX) * m_tileSize;
+            const int y0 = int(t / tilesX) * m_tileSize;
+            const int x1 = std::min(x0 + m_tileSize, width);
+            const int y1 = std::min(y0 + m_tileSize, height);
+
+            Fit fit;
+            std::vector<int> neighbors; // window neighbors, reused by the pixels of the tile
+            for (int y = y0; y < y1; ++y)
+            {
+                for (int x = x0; x < x1; ++x)
+                {
+                    const int idx = _grid.index(x, y);
+                    if (! _grid.isValid(idx)) continue;
+                    computeAt(_grid, idx, fit, neighbors);
+                    _f(idx, static_cast<const Fit&>(fit));
+                }
+            }
+        }, 1);
+    }
+
+    /*!
+        \brief Compute an image storing a value extracted from the fit of each pixel
+
+        \param _grid ImageGrid (or any type with the same API)
+        \param _extract Functor returning the value of a stable fit, called as `_extract(fit)`
+        \param _invalid Value of invalid pixels, and of pixels whose fit is not stable
+        \return Image storing one value per pixel, row by row
+    */
+    template <typename Grid, typename Extractor, typename Value>
+    inline std::vector<Value> computeImage(const Grid& _grid, Extractor&& _extract, const Value& _invalid) const
+    {
+        std::vector<Value> image (size_t(_grid.width()) * _grid.height(), _invalid);
+        compute(_grid, [&image, &_extract](int _idx, const Fit& _fit) {
+            if (_fit.isStable()) image[_idx] = _extract(_fit);
+        });
+        return image;
+    }
+
+private:
+    WeightFunction m_w;            /*!< \brief Weighting function of the fits */
+    int            m_radius   {4}; /*!< \brief Radius of the image-space windows, in pixels */
+    int            m_tileSize {32};/*!< \brief Size of the tiles processed in parallel, in pixels */
+    Executor*      m_executor {nullptr}; /*!< \brief Executor processing the tiles, nullptr for the default */
+}; // class ImageGridFit
+
+} //namespace Ponca
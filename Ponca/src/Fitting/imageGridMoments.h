@@ -0,0 +1,282 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+#include "./symmetricEigenSolver.h"
+
+#include "../Common/executor.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Weighted position moments of square windows of an organized point cloud, in constant time per pixel
+
+    The zeroth, first and second order moments of the samples of an ImageGrid are stored in summed-area tables, so
+    that the weight sum, barycenter and covariance matrix of any square image-space window are obtained from four
+    lookups, whatever the size of the window. This computes the same statistics than MeanPosition and
+    CovarianceFitBase, without visiting the neighbors.
+
+    This requires the weight of a sample to be independent of the evaluation position: either unit weights, or
+    per-sample weights (e.g. sensor confidence) given to #build. Fits using weighting functions that depend on the
+    evaluation position (e.g. DistWeightFunc with a non-constant kernel) must weight each neighbor, and are computed by
+    ImageGridFit.
+
+    The windows are squares of `2 * radius + 1` pixels (clipped by the image borders), while ImageGridFit uses
+    circular windows. Invalid pixels are ignored.
+
+    Typical use, to compute a normal image at sensor frame rate:
+    \code
+    ImageGrid<Point> grid;
+    grid.buildFromDepth(width, height, depth, normals, fx, fy, cx, cy);
+
+    ImageGridMoments<Point> moments;
+    moments.build(grid);
+    auto normals = moments.computeNormals(grid, 5);
+    \endcode
+
+    \note The moments of a window are recovered from sums over the whole image, and are thus subject to cancellation.
+    The summed-area tables store the positions relatively to the barycenter of the image, using `_SumScalar`
+    precision (double by default).
+
+    \tparam _DataPoint Point type stored by the grid
+    \tparam _SumScalar Scalar type of the summed-area tables
+*/
+template <typename _DataPoint, typename _SumScalar = double>
+class ImageGridMoments
+{
+public:
+    using DataPoint  = _DataPoint;                                        /*!< \brief Point type used for computation */
+    using Scalar     = typename DataPoint::Scalar;                        /*!< \brief Scalar type used for computation */
+    using VectorType = typename DataPoint::VectorType;                    /*!< \brief Vector type used for computation */
+    using MatrixType = Eigen::Matrix<Scalar, DataPoint::Dim, DataPoint::Dim>; /*!< \brief Matrix type used for computation */
+    using SumScalar  = _SumScalar;                                        /*!< \brief Scalar type of the summed-area tables */
+
+    /// \brief Moments of a window
+    struct Moments
+    {
+        int        count      {0};                     ///< \brief Number of valid pixels in the window
+        Scalar     weightSum  {0};                     ///< \brief Sum of the weights of the valid pixels
+        VectorType barycenter {VectorType::Zero()};    ///< \brief Weighted barycenter of the samples
+        MatrixType covariance {MatrixType::Zero()};    ///< \brief Weighted covariance, normalized by #weightSum
+    };
+
+protected:
+    using SumVector = Eigen::Matrix<SumScalar, DataPoint::Dim, 1>;
+
+    /// \brief Number of values per entry: count, weight, first order moments and upper part of second order moments
+    static constexpr int NbChannels = 2 + DataPoint::Dim + DataPoint::Dim * (DataPoint::Dim + 1) / 2;
+
+public:
+    /*!
+        \brief Build the summed-area tables of a grid, using unit weights
+        \param _grid ImageGrid (or any type with the same API)
+    */
+    template <typename Grid>
+    inline void build(const Grid& _grid)
+    {
+        build(_grid, [](const DataPoint&) { return Scalar(1); });
+    }
+
+    /*!
+        \brief Build the summed-area tables of a grid
+        \param _grid ImageGrid (or any type with the same API)
+        \param _weight Functor returning the (non-negative) weight of a sample, called as `_weight(point)`
+    */
+    template <typename Grid, typename WeightFunctor>
+    inline void build(const Grid& _grid, WeightFunctor&& _weight)
+    {
+        constexpr int Dim = DataPoint::Dim;
+        const auto& points = _grid.points();
+
+        m_width  = _grid.width();
+        m_height = _grid.height();
+        const int stride = m_width + 1;
+
+        // Reference position: barycenter of the valid samples
+        m_reference.setZero();
+        int nbValid = 0;
+        for (int i = 0; i < m_width * m_height; ++i)
+        {
+            if (! _grid.isValid(i)) continue;
+            m_reference += points[i].pos().template cast<SumScalar>();
+            ++nbValid;
+        }
+        if (nbValid > 0) m_reference /= SumScalar(nbValid);
+
+        // The first row and column of the tables are null
+        m_sums.assign(size_t(stride) * (m_height + 1) * NbChannels, SumScalar(0));
+
+        // Prefix sums along the rows
+        executorOrDefault(m_executor).forEach(m_height, [&](std::ptrdiff_t y)
+        {
+            SumScalar* prev = entry(0, int(y) + 1);
+            for (int x = 0; x < m_width; ++x)
+            {
+                SumScalar* cur = prev + NbChannels;
+                for (int c = 0; c < NbChannels; ++c) cur[c] = prev[c];
+
+                const int idx = _grid.index(x, int(y));
+                if (_grid.isValid(idx))
+                {
+                    const SumScalar w = SumScalar(_weight(points[idx]));
+                    const SumVector q = points[idx].pos().template cast<SumScalar>() - m_reference;
+                    cur[0] += SumScalar(1);
+                    cur[1] += w;
+                    int c = 2;
+                    for (int i = 0; i < Dim; ++i)
+                        cur[c++] += w * q(i);
+                    for (int i = 0; i < Dim; ++i)
+                        for (int j = i; j < Dim; ++j)
+                            cur[c++] += w * q(i) * q(j);
+                }
+                prev = cur;
+            }
+        });
+
+        // Prefix sums along the columns
+        const int rowSize = stride * NbChannels;
+        for (int y = 1; y < m_height; ++y)
+        {
+            const SumScalar* prev = entry(0, y);
+            SumScalar* cur = entry(0, y + 1);
+            for (int k = 0; k < rowSize; ++k)
+                cur[k] += prev[k];
+        }
+    }
+
+    /*!
+        \brief Moments of the square window of radius `_radius` (in pixels) centered on pixel \f$ (x, y) \f$
+        \warning The moments are undefined when the window does not contain any sample of positive weight
+    */
+    inline Moments moments(int _x, int _y, int _radius) const
+    {
+        constexpr int Dim = DataPoint::Dim;
+        const int x0 = std::max(_x - _radius, 0),           y0 = std::max(_y - _radius, 0);
+        const int x1 = std::min(_x + _radius + 1, m_width), y1 = std::min(_y + _radius + 1, m_height);
+
+        const SumScalar* a = entry(x1, y1);
+        const SumScalar* b = entry(x0, y1);
+        const SumScalar* c = entry(x1, y0);
+        const SumScalar* d = entry(x0, y0);
+        SumScalar s[NbChannels];
+        for (int k = 0; k < NbChannels; ++k)
+            s[k] = a[k] - b[k] - c[k] + d[k];
+
+        Moments res;
+        res.count     = int(s[0] + SumScalar(0.5));
+        res.weightSum = Scalar(s[1]);
+        if (res.count == 0 || s[1] <= SumScalar(0))
+            return res;
+
+        SumVector mean;
+        for (int i = 0; i < Dim; ++i)
+            mean(i) = s[2 + i] / s[1];
+
+        int k = 2 + Dim;
+        for (int i = 0; i < Dim; ++i)
+        {
+            for (int j = i; j < Dim; ++j)
+            {
+                const Scalar cov = Scalar(s[k++] / s[1] - mean(i) * mean(j));
+                res.covariance(i, j) = cov;
+                res.covariance(j, i) = cov;
+            }
+        }
+        res.barycenter = (mean + m_reference).template cast<Scalar>();
+        return res;
+    }
+
+    /// \brief Moments of the square window of radius `_radius` (in pixels) centered on the pixel `_index`
+    inline Moments moments(int _index, int _radius) const
+    {
+        return moments(_index % m_width, _index / m_width, _radius);
+    }
+
+    /*!
+        \brief Compute the moments of the window centered on each valid pixel, row by row
+
+        \param _grid Grid given to #build
+        \param _radius Radius of the square windows, in pixels
+        \param _f Functor called as `_f(index, moments)` for each valid pixel. It is called concurrently from several
+        threads, but never twice for the same pixel.
+    */
+    template <typename Grid, typename Functor>
+    inline void compute(const Grid& _grid, int _radius, Functor&& _f) const
+    {
+        executorOrDefault(m_executor).forEach(m_height, [&](std::ptrdiff_t y)
+        {
+            for (int x = 0; x < m_width; ++x)
+            {
+                const int idx = _grid.index(x, int(y));
+                if (! _grid.isValid(idx)) continue;
+                const Moments m = moments(x, int(y), _radius);
+                _f(idx, m);
+            }
+        });
+    }
+
+    /*!
+        \brief Compute the normal of each valid pixel, as the eigenvector of the smallest eigenvalue of the covariance
+        of its window (see CovariancePlaneFit)
+
+        The normals are oriented toward the origin, i.e. toward the camera center for grids built using
+        ImageGrid::buildFromDepth.
+
+        \param _grid Grid given to #build
+        \param _radius Radius of the square windows, in pixels
+        \param _policy Strategy used to solve the eigen problems
+        \return Image storing one normal per pixel, row by row. The normal of invalid pixels, and of pixels whose
+        window contains less than `Dim` samples, is null.
+    */
+    template <typename Grid>
+    inline std::vector<VectorType> computeNormals(const Grid& _grid, int _radius,
+                                                  EigenSolverPolicy _policy = DirectEigenSolverWithFallback) const
+    {
+        const auto& points = _grid.points();
+        std::vector<VectorType> normals (size_t(m_width) * m_height, VectorType::Zero());
+        compute(_grid, _radius, [&](int _idx, const Moments& _m) {
+            if (_m.count < DataPoint::Dim || _m.weightSum <= Scalar(0)) return;
+            SymmetricEigenSolver<MatrixType> solver (_policy);
+            solver.compute(_m.covariance);
+            if (solver.info() != Eigen::Success) return;
+            VectorType n = solver.eigenvectors().col(0);
+            if (n.dot(points[_idx].pos()) > Scalar(0)) n = -n;
+            normals[_idx] = n;
+        });
+        return normals;
+    }
+
+    /// \brief Set the executor processing the rows in #build and #compute, or nullptr to use defaultExecutor()
+    inline void setExecutor(Executor* _executor) { m_executor = _executor; }
+
+    /// \brief Number of columns of the grid given to #build
+    inline int width() const { return m_width; }
+    /// \brief Number of rows of the grid given to #build
+    inline int height() const { return m_height; }
+
+protected:
+    /// \brief Summed-area table entry storing the sums over the pixels \f$ [0, x[ \times [0, y[ \f$
+    inline SumScalar* entry(int _x, int _y) { return m_sums.data() + (size_t(_y) * (m_width + 1) + _x) * NbChannels; }
+    inline const SumScalar* entry(int _x, int _y) const { return m_sums.data() + (size_t(_y) * (m_width + 1) + _x) * NbChannels; }
+
+private:
+    int m_width {0};
+    int m_height {0};
+    SumVector m_reference {SumVector::Zero()}; /*!< \brief Origin of the positions stored in the tables */
+    std::vector<SumScalar> m_sums;             /*!< \brief Summed-area tables, interleaved per pixel */
+    Executor* m_executor {nullptr};            /*!< \brief Executor processing the rows, nullptr for the default */
+}; // class ImageGridMoments
+
+} //namespace Ponca
@@ -0,0 +1,309 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+
+#include "../Common/executor.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Evaluate the implicit field defined by a fit (e.g. the potential of an OrientedSphereFit), reusing the fits
+    computed at nearby positions
+
+    The space is split in cubic cells of size `tolerance * scale`, stored in a sparse hash map. The fit of a cell is
+    computed once, at the center of the cell, from the neighbors collected in a spatial partitioning structure. All
+    the evaluations located in the cell then reuse this fit: as the primitives are defined in global coordinates (e.g.
+    AlgebraicSphere::potential), they can be evaluated at any position, the error being controlled by the tolerance.
+
+    This is well suited to dense evaluations (e.g. meshing or SDF baking), where many samples share the same cell.
+    Grids are evaluated block by block in parallel (see #setExecutor), see #compute and #potentialGrid.
+
+    Typical use, to bake a signed distance field:
+    \code
+    using Fit = Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<Scalar>>, OrientedSphereFit>;
+    KdTreeDense<Point> tree (points);
+
+    ImplicitFieldCache<Fit> field;
+    field.setWeightFunc(WeightFunc(scale));
+    field.setTolerance(Scalar(0.05));
+    auto sdf = field.potentialGrid(tree, origin, step, size, std::numeric_limits<Scalar>::quiet_NaN());
+    \endcode
+
+    \warning The single-position accessors (#fitAt, #potential) modify the cache, and are not thread-safe.
+
+    \tparam FitType Basket or BasketDiff type, defining the field to evaluate (e.g. `potential(q)` and
+    `primitiveGradient(q)`). Its weighting function must define `evalScale()` (see DistWeightFunc).
+*/
+template <typename FitType>
+class ImplicitFieldCache
+{
+public:
+    using Fit            = FitType;                              /*!< \brief Fit cached in each cell */
+    using DataPoint      = typename Fit::DataPoint;              /*!< \brief Point type used for computation */
+    using Scalar         = typename DataPoint::Scalar;           /*!< \brief Scalar type used for computation */
+    using VectorType     = typename DataPoint::VectorType;       /*!< \brief Vector type used for computation */
+    using WeightFunction = typename Fit::WeightFunction;         /*!< \brief Weighting function of the fit */
+
+    /// \brief Integer coordinates of a cell, or of a grid vertex
+    using CellIndex = Eigen::Matrix<int, DataPoint::Dim, 1>;
+
+protected:
+    /// \brief Hash of the integer coordinates of a cell
+    struct CellHash
+    {
+        inline std::size_t operator()(const CellIndex& _c) const
+        {
+            std::uint64_t h = 0;
+            for (int i = 0; i < DataPoint::Dim; ++i)
+                h = (h ^ std::uint64_t(std::uint32_t(_c(i)))) * std::uint64_t(0x100000001b3);
+            return std::size_t(h);
+        }
+    };
+
+    using CellMap = std::unordered_map<CellIndex, Fit, CellHash>;
+
+public:
+    /// \copydoc PrimitiveBase::setWeightFunc
+    /// \note Clears the cache
+    inline void setWeightFunc(const WeightFunction& _w) { m_w = _w; clear(); }
+
+    /// \brief Set the size of the cells, relatively to the scale
+    /// \note Clears the cache
+    inline void setTolerance(Scalar _tol) { m_tolerance = _tol; clear(); }
+
+    /// \brief Set the size of the blocks of grid vertices evaluated in parallel
+    inline void setBlockSize(int _size) { m_blockSize = std::max(_size, 1); }
+
+    /// \brief Set the executor evaluating the blocks, or nullptr to use defaultExecutor()
+    inline void setExecutor(Executor* _executor) { m_executor = _executor; }
+
+    /// \brief Size of the cells, relatively to the scale
+    inline Scalar tolerance() const { return m_tolerance; }
+    /// \brief Size of the cells
+    inline Scalar cellSize() const { return m_tolerance * m_w.evalScale(); }
+    /// \brief Size of the blocks of grid vertices evaluated in parallel
+    inline int blockSize() const { return m_blockSize; }
+
+    /// \brief Number of cached fits
+    inline std::size_t size() const { return m_cells.size(); }
+    /// \brief Remove all the cached fits
+    inline void clear() { m_cells.clear(); }
+
+    /// \brief Integer coordinates of the cell containing `_q`
+    inline CellIndex cell(const VectorType& _q) const
+    {
+        return (_q / cellSize()).array().floor().template cast<int>();
+    }
+
+    /// \brief Center of the cell `_c`, where its fit is computed
+    inline VectorType cellCenter(const CellIndex& _c) const
+    {
+        return (_c.template cast<Scalar>().array() + Scalar(0.5)).matrix() * cellSize();
+    }
+
+    /*!
+        \brief Fit of the cell containing `_q`, computed if not already cached
+        \param _tree Spatial partitioning structure providing `range_neighbors(position, radius)` and `points()`
+        (e.g. KdTreeBase)
+    */
+    template <typename Tree>
+    inline const Fit& fitAt(const Tree& _tree, const VectorType& _q)
+    {
+        const CellIndex c = cell(_q);
+        auto it = m_cells.find(c);
+        if (it == m_cells.end())
+            it = m_cells.emplace(c, computeFit(_tree, c)).first;
+        return it->second;
+    }
+
+    /*!
+        \brief Value of the field at `_q`
+        \return false if the fit of the cell containing `_q` is not stable, in which case `_potential` is not modified
+    */
+    template <typename Tree>
+    inline bool potential(const Tree& _tree, const VectorType& _q, Scalar& _potential)
+    {
+        const Fit& fit = fitAt(_tree, _q);
+        if (! fit.isStable()) return false;
+        _potential = fit.potential(_q);
+        return true;
+    }
+
+    /*!
+        \brief Evaluate all the vertices of a regular grid, block by block
+
+        The cached fits are used, and the fits computed during the evaluation are added to the cache. Each missing
+        fit is computed once: its cell is owned by the block containing the first vertex of the grid lying in the cell
+        (see #ownerBlock), even when the vertices of several blocks lie in the cell.
+
+        \param _tree Spatial partitioning structure providing `range_neighbors(position, radius)` and `points()`
+        \param _origin Position of the first vertex of the grid
+        \param _step Distance between two consecutive vertices
+        \param _size Number of vertices along each axis
+        \param _f Functor called as `_f(index, position, fit)` for each vertex, where `index` is the linear index of
+        the vertex (the first axis varying the fastest) and `fit` the (possibly unstable) fit of its cell. It is called
+        concurrently from several threads, but never twice for the same vertex.
+    */
+    template <typename Tree, typename Functor>
+    inline void compute(const Tree& _tree, const VectorType& _origin, Scalar _step, const CellIndex& _size,
+                        Functor&& _f)
+    {
+        constexpr int Dim = DataPoint::Dim;
+        CellIndex nbBlocks;
+        int blockCount = 1;
+        for (int i = 0; i < Dim; ++i)
+        {
+            nbBlocks(i) = (std::max(_size(i), 0) + m_blockSize - 1) / m_blockSize;
+            blockCount *= nbBlocks(i);
+        }
+        Executor& executor = executorOrDefault(m_executor);
+
+        // The shared cache is only read during the parallel evaluations: the missing fits are computed by the blocks
+        // owning their cell, and merged before evaluating the vertices
+        std::vector<CellMap> newCells (blockCount);
+        executor.forEach(blockCount, [&](std::ptrdiff_t b)
+        {
+            CellMap& local = newCells[b];
+            std::unordered_set<CellIndex, CellHash> visited;
+            forEachVertex(int(b), nbBlocks, _size, [&](int, const CellIndex& _v) {
+                const CellIndex c = cell(vertexPosition(_origin, _step, _v));
+                if (m_cells.find(c) != m_cells.end() || ! visited.insert(c).second) return;
+                if (ownerBlock(_origin, _step, _v, c, nbBlocks) == int(b))
+                    local.emplace(c, computeFit(_tree, c));
+            });
+        }, 1);
+
+        for (auto& local : newCells)
+            m_cells.insert(local.begin(), local.end());
+
+        executor.forEach(blockCount, [&](std::ptrdiff_t b)
+        {
+            forEachVertex(int(b), nbBlocks, _size, [&](int _index, const CellIndex& _v) {
+                const VectorType pos = vertexPosition(_origin, _step, _v);
+                const Fit& fit = m_cells.find(cell(pos))->second;
+                _f(_index, static_cast<const VectorType&>(pos), fit);
+            });
+        }, 1);
+    }
+
+    /*!
+        \brief Value of the field at all the vertices of a regular grid
+        \param _invalid Value of the vertices whose fit is not stable
+        \return Values of the vertices, the first axis varying the fastest
+        \see compute
+    */
+    template <typename Tree>
+    inline std::vector<Scalar> potentialGrid(const Tree& _tree, const VectorType& _origin, Scalar _step,
+                                             const CellIndex& _size, Scalar _invalid)
+    {
+        std::vector<Scalar> values (std::size_t(std::max(_size.prod(), 0)), _invalid);
+        compute(_tree, _origin, _step, _size, [&values](int _i, const VectorType& _pos, const Fit& _fit) {
+            if (_fit.isStable()) values[_i] = _fit.potential(_pos);
+        });
+        return values;
+    }
+
+protected:
+    /// \brief Position of the grid vertex `_v`
+    static inline VectorType vertexPosition(const VectorType& _origin, Scalar _step, const CellIndex& _v)
+    {
+        return _origin + _step * _v.template cast<Scalar>();
+    }
+
+    /// \brief Call `_f(index, v)` for each vertex `v` of the block `_b`, `index` being the linear index of `v`
+    template <typename VertexFunctor>
+    inline void forEachVertex(int _b, const CellIndex& _nbBlocks, const CellIndex& _size, VertexFunctor&& _f) const
+    {
+        constexpr int Dim = DataPoint::Dim;
+        CellIndex first, last;
+        for (int i = 0; i < Dim; ++i)
+        {
+            first(i) = (_b % _nbBlocks(i)) * m_blockSize;
+            last(i)  = std::min(first(i) + m_blockSize, _size(i));
+            _b /= _nbBlocks(i);
+        }
+
+        CellIndex v = first;
+        while (true)
+        {
+            int index = 0;
+            for (int i = Dim - 1; i >= 0; --i)
+                index = index * _size(i) + v(i);
+            _f(index, static_cast<const CellIndex&>(v));
+
+            // Next vertex of the block
+            int i = 0;
+            for (; i < Dim; ++i)
+            {
+                if (++v(i) < last(i)) break;
+                v(i) = first(i);
+            }
+            if (i == Dim) break;
+        }
+    }
+
+    /*!
+        \brief Block owning the cell `_c`, i.e. containing the first vertex of the grid lying in `_c`
+        \param _v Vertex lying in `_c`
+
+        The cells are boxes aligned with the grid axes: the first vertex is found independently along each axis, by
+        moving `_v` backward while it stays in `_c`.
+    */
+    inline int ownerBlock(const VectorType& _origin, Scalar _step, CellIndex _v, const CellIndex& _c,
+                          const CellIndex& _nbBlocks) const
+    {
+        constexpr int Dim = DataPoint::Dim;
+        for (int i = 0; i < Dim; ++i)
+        {
+            while (_v(i) > 0)
+            {
+                CellIndex prev = _v;
+                --prev(i);
+                if (cell(vertexPosition(_origin, _step, prev))(i) != _c(i)) break;
+                _v = prev;
+            }
+        }
+        int b = 0;
+        for (int i = Dim - 1; i >= 0; --i)
+            b = b * _nbBlocks(i) + _v(i) / m_blockSize;
+        return b;
+    }
+
+    /// \brief Compute the fit of a cell, at its center
+    template <typename Tree>
+    inline Fit computeFit(const Tree& _tree, const CellIndex& _c) const
+    {
+        const VectorType center = cellCenter(_c);
+        Fit fit;
+        fit.setWeightFunc(m_w);
+        fit.init(center);
+        fit.computeWithIds(_tree.range_neighbors(center, m_w.evalScale()), _tree.points());
+        return fit;
+    }
+
+private:
+    WeightFunction m_w;                          /*!< \brief Weighting function of the fits */
+    Scalar         m_tolerance {Scalar(0.1)};    /*!< \brief Size of the cells, relatively to the scale */
+    int            m_blockSize {16};             /*!< \brief Size of the blocks of grid vertices evaluated in parallel */
+    Executor*      m_executor  {nullptr};        /*!< \brief Executor evaluating the blocks, nullptr for the default */
+    CellMap        m_cells;                      /*!< \brief Cached fits, indexed by the integer coordinates of their cell */
+}; // class ImplicitFieldCache
+
+} //namespace Ponca
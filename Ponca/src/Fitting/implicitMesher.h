@@ -0,0 +1,466 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+
+#include "../Common/executor.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Extract the zero level set of the implicit field defined by a fit (e.g. the potential of an
+    OrientedSphereFit) as an indexed triangle mesh
+
+    The field is sampled on a regular lattice of step #cellSize, restricted to a narrow band around the samples of a
+    spatial partitioning structure: the lattice is split in cubic blocks of #blockSize cells, and only the blocks
+    located closer than the scale of the weighting function to a sample are processed. Outside of this band, the fits
+    have no neighbors and the field is undefined.
+
+    The blocks are processed in parallel (see #setExecutor). The field is evaluated once per lattice vertex (computing
+    a fit at this vertex): each block evaluates its interior and lower-face vertices, and reads the vertices of its
+    upper faces from the adjacent blocks (see #vertexOwner). The values are then shared by all the cells of the
+    block. Each cell is split into
+    six tetrahedra along its main diagonal (Kuhn triangulation), which are polygonized independently. This
+    triangulation is consistent between adjacent cells and blocks: the mesh vertices, identified by the lattice edge
+    they lie on, are shared by the adjacent triangles, and the mesh is watertight wherever the field is defined. The
+    cells having a vertex where the fit is not stable are skipped.
+
+    Typical use:
+    \code
+    using Fit = Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<Scalar>>, OrientedSphereFit>;
+    KdTreeDense<Point> tree (points);
+
+    ImplicitMesher<Fit> mesher;
+    mesher.setWeightFunc(WeightFunc(scale));
+    mesher.setCellSize(scale / 4);
+    auto mesh = mesher.compute(tree);
+    \endcode
+
+    \tparam FitType Basket or BasketDiff type, defining `potential(q)`. Its weighting function must define
+    `evalScale()` (see DistWeightFunc).
+    \warning This class is valid only in 3D.
+*/
+template <typename FitType>
+class ImplicitMesher
+{
+public:
+    using Fit            = FitType;                              /*!< \brief Fit computed at each lattice vertex */
+    using DataPoint      = typename Fit::DataPoint;              /*!< \brief Point type used for computation */
+    using Scalar         = typename DataPoint::Scalar;           /*!< \brief Scalar type used for computation */
+    using VectorType     = typename DataPoint::VectorType;       /*!< \brief Vector type used for computation */
+    using WeightFunction = typename Fit::WeightFunction;         /*!< \brief Weighting function of the fit */
+
+    static_assert(DataPoint::Dim == 3, "ImplicitMesher is only valid in 3D");
+
+    /// \brief Indexed triangle mesh
+    struct Mesh
+    {
+        std::vector<VectorType>         vertices;  ///< \brief Vertex positions
+        std::vector<std::array<int, 3>> triangles; ///< \brief Vertex indices, oriented toward increasing potential
+    };
+
+    /// \copydoc PrimitiveBase::setWeightFunc
+    inline void setWeightFunc(const WeightFunction& _w) { m_w = _w; }
+
+    /// \brief Set the step of the lattice
+    inline void setCellSize(Scalar _size) { m_cellSize = _size; }
+
+    /// \brief Set the number of cells along each axis of the blocks processed in parallel
+    inline void setBlockSize(int _size) { m_blockSize = std::max(_size, 1); }
+
+    /// \brief Set the executor processing the blocks, or nullptr to use defaultExecutor()
+    inline void setExecutor(Executor* _executor) { m_executor = _executor; }
+
+    /// \brief Step of the lattice
+    inline Scalar cellSize() const { return m_cellSize; }
+    /// \brief Number of cells along each axis of the blocks processed in parallel
+    inline int blockSize() const { return m_blockSize; }
+
+    /*!
+        \brief Extract the zero level set of the field
+        \param _tree Spatial partitioning structure providing `range_neighbors(position, radius)`,
+        `nearest_neighbor(position)` and `points()` (e.g. KdTreeBase)
+    */
+    template <typename Tree>
+    inline Mesh compute(const Tree& _tree) const
+    {
+        Mesh mesh;
+        const auto& points = _tree.points();
+        if (points.empty() || m_cellSize <= Scalar(0)) return mesh;
+
+        // Lattice covering the samples, enlarged by the scale
+        const Scalar band = m_w.evalScale();
+        VectorType bbMin = points[0].pos(), bbMax = points[0].pos();
+        for (const auto& p : points)
+        {
+            bbMin = bbMin.cwiseMin(p.pos());
+            bbMax = bbMax.cwiseMax(p.pos());
+        }
+        Lattice lattice;
+        lattice.origin   = bbMin - VectorType::Constant(band + m_cellSize);
+        lattice.cellSize = m_cellSize;
+        for (int i = 0; i < 3; ++i)
+        {
+            const int nbCells = int(std::ceil((bbMax(i) - lattice.origin(i) + band + m_cellSize) / m_cellSize));
+            lattice.nbBlocks[i]   = (nbCells + m_blockSize - 1) / m_blockSize;
+            lattice.nbVertices[i] = std::int64_t(lattice.nbBlocks[i]) * m_blockSize + 1;
+        }
+
+        const std::vector<std::int64_t> blocks = occupiedBlocks(_tree, lattice);
+
+        // Evaluate the field at the vertices owned by each block, then polygonize the blocks in parallel, identifying
+        // the mesh vertices by their lattice edge
+        Executor& executor = executorOrDefault(m_executor);
+        std::vector<std::vector<Scalar>> blockValues (blocks.size());
+        executor.forEach(std::ptrdiff_t(blocks.size()), [&](std::ptrdiff_t b)
+        {
+            evaluateBlock(_tree, lattice, blocks, b, blockValues[b]);
+        }, 1);
+
+        std::vector<BlockMesh> blockMeshes (blocks.size());
+        executor.forEach(std::ptrdiff_t(blocks.size()), [&](std::ptrdiff_t b)
+        {
+            polygonizeBlock(lattice, blocks, b, blockValues, blockMeshes[b]);
+        }, 1);
+
+        // Merge the vertices shared by several blocks
+        std::unordered_map<EdgeKey, int, EdgeHash> globalIds;
+        for (const auto& bm : blockMeshes)
+        {
+            std::vector<int> localToGlobal (bm.edges.size());
+            for (size_t v = 0; v < bm.edges.size(); ++v)
+            {
+                auto res = globalIds.emplace(bm.edges[v], int(mesh.vertices.size()));
+                if (res.second) mesh.vertices.push_back(bm.vertices[v]);
+                localToGlobal[v] = res.first->second;
+            }
+            for (const auto& t : bm.triangles)
+                mesh.triangles.push_back({localToGlobal[t[0]], localToGlobal[t[1]], localToGlobal[t[2]]});
+        }
+        return mesh;
+    }
+
+protected:
+    /// \brief Lattice edge, identified by the indices of its two vertices (smallest first)
+    using EdgeKey = std::pair<std::int64_t, std::int64_t>;
+
+    struct EdgeHash
+    {
+        inline std::size_t operator()(const EdgeKey& _e) const
+        {
+            return std::size_t((std::uint64_t(_e.first) * std::uint64_t(0x9E3779B97F4A7C15)) ^ std::uint64_t(_e.second));
+        }
+    };
+
+    /// \brief Triangles of a block, indexing vertices local to the block
+    struct BlockMesh
+    {
+        std::vector<EdgeKey>            edges;     ///< \brief Lattice edge of each vertex
+        std::vector<VectorType>         vertices;
+        std::vector<std::array<int, 3>> triangles;
+    };
+
+    /// \brief Regular lattice sampling the field, split in blocks
+    struct Lattice
+    {
+        VectorType   origin {VectorType::Zero()}; ///< \brief Position of the first lattice vertex
+        Scalar       cellSize {0};                ///< \brief Step of the lattice
+        int          nbBlocks[3] {0, 0, 0};       ///< \brief Number of blocks along each axis
+        std::int64_t nbVertices[3] {0, 0, 0};     ///< \brief Number of lattice vertices along each axis
+
+        /// \brief Linear index of the block \f$ (x, y, z) \f$
+        inline std::int64_t blockIndex(int _x, int _y, int _z) const
+        {
+            return std::int64_t(_x) + std::int64_t(nbBlocks[0]) * (_y + std::int64_t(nbBlocks[1]) * _z);
+        }
+
+        /// \brief Coordinates of the block `_b`, in blocks
+        inline std::array<int, 3> blockCoordinates(std::int64_t _b) const
+        {
+            return {int(_b % nbBlocks[0]), int((_b / nbBlocks[0]) % nbBlocks[1]),
+                    int(_b / (std::int64_t(nbBlocks[0]) * nbBlocks[1]))};
+        }
+
+        /// \brief Linear index of the lattice vertex \f$ (x, y, z) \f$
+        inline std::int64_t vertexIndex(std::int64_t _x, std::int64_t _y, std::int64_t _z) const
+        {
+            return _x + nbVertices[0] * (_y + nbVertices[1] * _z);
+        }
+
+        /// \brief Position of the lattice vertex \f$ (x, y, z) \f$
+        inline VectorType vertexPosition(std::int64_t _x, std::int64_t _y, std::int64_t _z) const
+        {
+            return origin + cellSize * VectorType(Scalar(_x), Scalar(_y), Scalar(_z));
+        }
+
+        /// \brief Position of the lattice vertex of linear index `_id`
+        inline VectorType vertexPosition(std::int64_t _id) const
+        {
+            return vertexPosition(_id % nbVertices[0], (_id / nbVertices[0]) % nbVertices[1],
+                                  _id / (nbVertices[0] * nbVertices[1]));
+        }
+    };
+
+    /// \brief Blocks containing a sample, dilated by the scale, and kept only if close enough to a sample
+    template <typename Tree>
+    inline std::vector<std::int64_t> occupiedBlocks(const Tree& _tree, const Lattice& _lattice) const
+    {
+        const Scalar blockLength = m_cellSize * Scalar(m_blockSize);
+        const Scalar band        = m_w.evalScale();
+        const int    dilation    = int(std::ceil(band / blockLength));
+        const int*   nbBlocks    = _lattice.nbBlocks;
+
+        std::vector<std::int64_t> seeds;
+        seeds.reserve(_tree.points().size());
+        for (const auto& p : _tree.points())
+        {
+            const VectorType b = (p.pos() - _lattice.origin) / blockLength;
+            seeds.push_back(_lattice.blockIndex(std::min(int(b(0)), nbBlocks[0] - 1),
+                                                std::min(int(b(1)), nbBlocks[1] - 1),
+                                                std::min(int(b(2)), nbBlocks[2] - 1)));
+        }
+        std::sort(seeds.begin(), seeds.end());
+        seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+
+        std::vector<std::int64_t> blocks;
+        for (std::int64_t s : seeds)
+        {
+            const auto c = _lattice.blockCoordinates(s);
+            for (int k = std::max(c[2] - dilation, 0); k <= std::min(c[2] + dilation, nbBlocks[2] - 1); ++k)
+                for (int j = std::max(c[1] - dilation, 0); j <= std::min(c[1] + dilation, nbBlocks[1] - 1); ++j)
+                    for (int i = std::max(c[0] - dilation, 0); i <= std::min(c[0] + dilation, nbBlocks[0] - 1); ++i)
+                        blocks.push_back(_lattice.blockIndex(i, j, k));
+        }
+        std::sort(blocks.begin(), blocks.end());
+        blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+        // Narrow band: remove the dilated blocks too far from the samples
+        const Scalar halfDiagonal = Scalar(0.5) * std::sqrt(Scalar(3)) * blockLength;
+        std::vector<char> keep (blocks.size(), 0);
+        executorOrDefault(m_executor).forEach(std::ptrdiff_t(blocks.size()), [&](std::ptrdiff_t b)
+        {
+            const auto c = _lattice.blockCoordinates(blocks[b]);
+            const VectorType center = _lattice.origin + blockLength * VectorType(
+                Scalar(c[0]) + Scalar(0.5), Scalar(c[1]) + Scalar(0.5), Scalar(c[2]) + Scalar(0.5));
+            for (int j : _tree.nearest_neighbor(center))
+                keep[b] = (_tree.points()[j].pos() - center).norm() <= halfDiagonal + band;
+        });
+        std::vector<std::int64_t> res;
+        for (size_t b = 0; b < blocks.size(); ++b)
+            if (keep[b]) res.push_back(blocks[b]);
+        return res;
+    }
+
+    /*!
+        \brief Position in `_blocks` of the block evaluating the lattice vertex \f$ (x, y, z) \f$, -1 if none
+
+        Among the occupied blocks sharing the vertex, the vertex is owned by the block of largest linear index: a block
+        owns its interior and lower-face vertices, and the vertices of its upper faces are owned by the adjacent
+        blocks, unless they are not occupied.
+    */
+    inline std::ptrdiff_t vertexOwner(const Lattice& _lattice, const std::vector<std::int64_t>& _blocks,
+                                      std::int64_t _x, std::int64_t _y, std::int64_t _z) const
+    {
+        const std::int64_t v[3] = {_x, _y, _z};
+        for (int d = 0; d < 8; ++d)
+        {
+            // Offsets (bit 0: x, bit 1: y, bit 2: z), by decreasing linear index of the block
+            int c[3];
+            bool inside = true;
+            for (int i = 0; i < 3; ++i)
+            {
+                const int offset = (d >> i) & 1;
+                c[i] = int(v[i] / m_blockSize) - offset;
+                inside = inside && c[i] >= 0 && c[i] < _lattice.nbBlocks[i]
+                                && (offset == 0 || v[i] % m_blockSize == 0);
+            }
+            if (! inside) continue;
+            const auto it = std::lower_bound(_blocks.begin(), _blocks.end(), _lattice.blockIndex(c[0], c[1], c[2]));
+            if (it != _blocks.end() && *it == _lattice.blockIndex(c[0], c[1], c[2]))
+                return std::ptrdiff_t(it - _blocks.begin());
+        }
+        return -1;
+    }
+
+    /// \brief Evaluate the field at the vertices of the block `_blocks[_b]` it owns, the others being set to NaN
+    template <typename Tree>
+    inline void evaluateBlock(const Tree& _tree, const Lattice& _lattice, const std::vector<std::int64_t>& _blocks,
+                              std::ptrdiff_t _b, std::vector<Scalar>& _values) const
+    {
+        const int n = m_blockSize + 1; // vertices per axis
+        const auto c = _lattice.blockCoordinates(_blocks[_b]);
+        const std::int64_t x0 = std::int64_t(c[0]) * m_blockSize;
+        const std::int64_t y0 = std::int64_t(c[1]) * m_blockSize;
+        const std::int64_t z0 = std::int64_t(c[2]) * m_blockSize;
+
+        _values.assign(size_t(n) * n * n, std::numeric_limits<Scalar>::quiet_NaN());
+        Fit fit;
+        fit.setWeightFunc(m_w);
+        for (int z = 0; z < n; ++z)
+            for (int y = 0; y < n; ++y)
+                for (int x = 0; x < n; ++x)
+                {
+                    // Interior and lower-face vertices are always owned
+                    const bool upper = x == m_blockSize || y == m_blockSize || z == m_blockSize;
+                    if (upper && vertexOwner(_lattice, _blocks, x0 + x, y0 + y, z0 + z) != _b) continue;
+
+                    const VectorType pos = _lattice.vertexPosition(x0 + x, y0 + y, z0 + z);
+                    fit.init(pos);
+                    fit.computeWithIds(_tree.range_neighbors(pos, m_w.evalScale()), _tree.points());
+                    if (fit.isStable()) _values[x + n * (y + n * z)] = fit.potential(pos);
+                }
+    }
+
+    /*!
+        \brief Polygonize the cells of the block `_blocks[_b]`
+
+        The values of the vertices owned by the adjacent blocks are first copied from `_blockValues`. Only the entries
+        not owned by a block are written, and only the owned entries are read: the blocks can be processed in parallel.
+    */
+    inline void polygonizeBlock(const Lattice& _lattice, const std::vector<std::int64_t>& _blocks, std::ptrdiff_t _b,
+                                std::vector<std::vector<Scalar>>& _blockValues, BlockMesh& _mesh) const
+    {
+        const int n = m_blockSize + 1; // vertices per axis
+        const auto c = _lattice.blockCoordinates(_blocks[_b]);
+        const std::int64_t x0 = std::int64_t(c[0]) * m_blockSize;
+        const std::int64_t y0 = std::int64_t(c[1]) * m_blockSize;
+        const std::int64_t z0 = std::int64_t(c[2]) * m_blockSize;
+        const auto local = [n](std::int64_t _x, std::int64_t _y, std::int64_t _z) {
+            return size_t(_x + n * (_y + n * _z));
+        };
+
+        std::vector<Scalar>& blockValues = _blockValues[_b];
+        for (int z = 0; z < n; ++z)
+            for (int y = 0; y < n; ++y)
+                for (int x = 0; x < n; ++x)
+                {
+                    if (x < m_blockSize && y < m_blockSize && z < m_blockSize) continue;
+                    const std::ptrdiff_t owner = vertexOwner(_lattice, _blocks, x0 + x, y0 + y, z0 + z);
+                    if (owner == _b) continue;
+                    const auto o = _lattice.blockCoordinates(_blocks[owner]);
+                    blockValues[local(x, y, z)] = _blockValues[owner][local(x0 + x - std::int64_t(o[0]) * m_blockSize,
+                                                                             y0 + y - std::int64_t(o[1]) * m_blockSize,
+                                                                             z0 + z - std::int64_t(o[2]) * m_blockSize)];
+                }
+
+        // Kuhn triangulation: the corners of a cell are indexed by their offsets (bit 0: x, bit 1: y, bit 2: z),
+        // and each tetrahedron goes from corner 0 to corner 7 along the edges of the cell
+        static constexpr int tetrahedra[6][4] = {
+            {0, 1, 3, 7}, {0, 1, 5, 7}, {0, 2, 3, 7}, {0, 2, 6, 7}, {0, 4, 5, 7}, {0, 4, 6, 7}
+        };
+
+        std::unordered_map<EdgeKey, int, EdgeHash> localIds;
+        for (int z = 0; z < m_blockSize; ++z)
+            for (int y = 0; y < m_blockSize; ++y)
+                for (int x = 0; x < m_blockSize; ++x)
+                {
+                    std::int64_t ids[8];
+                    Scalar values[8];
+                    bool valid = true;
+                    for (int c = 0; c < 8; ++c)
+                    {
+                        const int dx = c & 1, dy = (c >> 1) & 1, dz = (c >> 2) & 1;
+                        ids[c]    = _lattice.vertexIndex(x0 + x + dx, y0 + y + dy, z0 + z + dz);
+                        values[c] = blockValues[local(x + dx, y + dy, z + dz)];
+                        valid = valid && ! std::isnan(values[c]);
+                    }
+                    if (! valid) continue;
+
+                    for (const auto& tet : tetrahedra)
+                        polygonizeTetrahedron(_lattice, tet, ids, values, localIds, _mesh);
+                }
+    }
+
+    /// \brief Add the triangles of the zero level set inside a tetrahedron
+    inline void polygonizeTetrahedron(const Lattice& _lattice, const int _tet[4], const std::int64_t _ids[8],
+                                      const Scalar _values[8], std::unordered_map<EdgeKey, int, EdgeHash>& _localIds,
+                                      BlockMesh& _mesh) const
+    {
+        int inside[4], outside[4];
+        int nbInside = 0, nbOutside = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (_values[_tet[i]] < Scalar(0)) inside[nbInside++] = _tet[i];
+            else                              outside[nbOutside++] = _tet[i];
+        }
+        if (nbInside == 0 || nbOutside == 0) return;
+
+        // Direction of increasing potential, used to orient the triangles
+        VectorType in = VectorType::Zero(), out = VectorType::Zero();
+        for (int i = 0; i < nbInside; ++i)  in  += _lattice.vertexPosition(_ids[inside[i]]);
+        for (int i = 0; i < nbOutside; ++i) out += _lattice.vertexPosition(_ids[outside[i]]);
+        const VectorType dir = out / Scalar(nbOutside) - in / Scalar(nbInside);
+
+        const auto vertex = [&](int _a, int _b) {
+            return edgeVertex(_lattice, _ids[_a], _ids[_b], _values[_a], _values[_b], _localIds, _mesh);
+        };
+        if (nbInside == 1 || nbOutside == 1)
+        {
+            const int lone = nbInside == 1 ? inside[0] : outside[0];
+            const int* others = nbInside == 1 ? outside : inside;
+            addTriangle(vertex(lone, others[0]), vertex(lone, others[1]), vertex(lone, others[2]), dir, _mesh);
+        }
+        else
+        {
+            const int a = vertex(inside[0], outside[0]);
+            const int b = vertex(inside[0], outside[1]);
+            const int c = vertex(inside[1], outside[1]);
+            const int d = vertex(inside[1], outside[0]);
+            addTriangle(a, b, c, dir, _mesh);
+            addTriangle(a, c, d, dir, _mesh);
+        }
+    }
+
+    /// \brief Local index of the zero crossing on the lattice edge \f$ (a, b) \f$, created if needed
+    inline int edgeVertex(const Lattice& _lattice, std::int64_t _a, std::int64_t _b, Scalar _fa, Scalar _fb,
+                          std::unordered_map<EdgeKey, int, EdgeHash>& _localIds, BlockMesh& _mesh) const
+    {
+        // Canonical order, such that adjacent blocks compute exactly the same position
+        if (_b < _a) { std::swap(_a, _b); std::swap(_fa, _fb); }
+        const EdgeKey key (_a, _b);
+        auto res = _localIds.emplace(key, int(_mesh.vertices.size()));
+        if (res.second)
+        {
+            const Scalar t = _fa / (_fa - _fb);
+            const VectorType pa = _lattice.vertexPosition(_a), pb = _lattice.vertexPosition(_b);
+            _mesh.edges.push_back(key);
+            _mesh.vertices.push_back(pa + t * (pb - pa));
+        }
+        return res.first->second;
+    }
+
+    /// \brief Add a triangle, oriented such that its normal points toward `_dir`
+    inline void addTriangle(int _a, int _b, int _c, const VectorType& _dir, BlockMesh& _mesh) const
+    {
+        const VectorType& pa = _mesh.vertices[_a];
+        const VectorType n = (_mesh.vertices[_b] - pa).cross(_mesh.vertices[_c] - pa);
+        if (n.dot(_dir) < Scalar(0)) std::swap(_b, _c);
+        _mesh.triangles.push_back({_a, _b, _c});
+    }
+
+private:
+    WeightFunction m_w;                          /*!< \brief Weighting function of the fits */
+    Scalar         m_cellSize  {Scalar(1)};      /*!< \brief Step of the lattice */
+    int            m_blockSize {16};             /*!< \brief Number of cells along each axis of the blocks */
+    Executor*      m_executor  {nullptr};        /*!< \brief Executor processing the blocks, nullptr for the default */
+}; // class ImplicitMesher
+
+} //namespace Ponca
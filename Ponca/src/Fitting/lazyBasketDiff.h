@@ -0,0 +1,143 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+#include "./neighborCache.h"
+
+#include <iterator>
+
+namespace Ponca
+{
+
+/*!
+    \brief Fit a primitive, and compute its derivatives only when they are requested
+
+    The fit is computed in two tiers:
+     - #compute and #computeWithIds only fit the primitive described by the differentiated Basket (see
+       BasketDiff::BasketFit): weight derivatives are not evaluated, and derivative sums are not accumulated. The valid
+       neighbors are stored in a NeighborCache,
+     - the first call to #diff computes the complete BasketDiff from the cached neighbors, without querying the
+       neighborhood again. The cached weights are reused when they are the same at each pass (see
+       IsPassInvariantWeight). Otherwise, all the neighbors are cached, and weighted again at each pass.
+
+    Fits that need derivatives only occasionally thus pay only the cost of the cache per neighbor.
+
+    \code
+    using FitDer = BasketDiff<Basket<Point, WeightFunc, OrientedSphereFit, GLSParam>,
+                              FitScaleSpaceDer, OrientedSphereDer, GLSDer>;
+    LazyBasketDiff<FitDer> fit;
+    fit.setWeightFunc(WeightFunc(scale));
+    fit.init(evalPos);
+    fit.computeWithIds(tree.range_neighbors(evalPos, scale), tree.points());
+    if (fit.fit().isStable() && fit.fit().tau() < threshold)
+        std::cout << fit.diff().dNormal() << std::endl; // derivatives are computed here
+    \endcode
+
+    \tparam BasketDiffType BasketDiff type
+    \warning The samples must remain valid and unchanged until the derivatives are computed.
+*/
+template <typename BasketDiffType>
+class LazyBasketDiff
+{
+public:
+    using DiffFit        = BasketDiffType;                          /*!< \brief Fit with derivatives */
+    using Fit            = typename BasketDiffType::BasketFit;      /*!< \brief Fit without derivatives */
+    using DataPoint      = typename DiffFit::DataPoint;             /*!< \brief Point type used for computation */
+    using Scalar         = typename DataPoint::Scalar;              /*!< \brief Scalar type used for computation */
+    using VectorType     = typename DataPoint::VectorType;          /*!< \brief Vector type used for computation */
+    using WeightFunction = typename DiffFit::WeightFunction;        /*!< \brief Weighting function */
+
+    /// \copydoc PrimitiveBase::setWeightFunc
+    inline void setWeightFunc(const WeightFunction& _w) { m_fit.setWeightFunc(_w); }
+
+    /// \brief Set the evaluation position, and reset the fit and the cached neighbors
+    inline void init(const VectorType& _evalPos)
+    {
+        m_evalPos = _evalPos;
+        m_fit.init(_evalPos);
+        m_cache.clear();
+        m_diffComputed = false;
+    }
+
+    /// \brief Fit the primitive without its derivatives, from samples accessed using STL-like iterators
+    /// \see Basket::computeCached
+    template <typename IteratorBegin, typename IteratorEnd>
+    inline FIT_RESULT compute(const IteratorBegin& _begin, const IteratorEnd& _end)
+    {
+        m_diffComputed = false;
+        return baseFit().computeCached(_begin, _end, m_cache);
+    }
+
+    /// \brief Fit the primitive without its derivatives, from the samples stored in a container
+    template <typename Container>
+    inline FIT_RESULT compute(const Container& _c)
+    {
+        return compute(std::begin(_c), std::end(_c));
+    }
+
+    /// \brief Fit the primitive without its derivatives, from a subset of samples
+    /// \see Basket::computeWithIdsCached
+    template <typename IndexRange, typename PointContainer>
+    inline FIT_RESULT computeWithIds(IndexRange _ids, const PointContainer& _points)
+    {
+        m_diffComputed = false;
+        return baseFit().computeWithIdsCached(_ids, _points, m_cache);
+    }
+
+    /// \brief Fitted primitive, without derivatives
+    inline const Fit& fit() const { return static_cast<const Fit&>(m_fit); }
+
+    /// \brief Fitted primitive with its derivatives, computed from the cached neighbors at the first call
+    inline const DiffFit& diff()
+    {
+        if (! m_diffComputed) computeDiff();
+        return m_fit;
+    }
+
+    /// \brief Tell if the derivatives have been computed since the last fit
+    inline bool isDiffComputed() const { return m_diffComputed; }
+
+    /// \copydoc PrimitiveBase::getCurrentState
+    inline FIT_RESULT getCurrentState() const { return fit().getCurrentState(); }
+
+    /// \brief Number of neighbors stored in the cache: the valid ones, or all of them when the weights may change
+    /// between the passes (see IsPassInvariantWeight)
+    inline int getNumCachedNeighbors() const { return m_cache.size(); }
+
+private:
+    inline Fit& baseFit() { return static_cast<Fit&>(m_fit); }
+
+    inline void computeDiff()
+    {
+        m_fit.init(m_evalPos);
+        if constexpr (IsPassInvariantWeight<WeightFunction>::value)
+        {
+            // weights are reused, only their derivatives are computed
+            m_fit.computeWeighted(m_cache);
+        }
+        else
+        {
+            // weights may change between the passes: they are computed again, with their derivatives
+            FIT_RESULT res = UNDEFINED;
+            do {
+                m_fit.startNewPass();
+                for (const auto& n : m_cache) m_fit.addNeighbor(*n.point);
+                res = m_fit.finalize();
+            } while (res == NEED_OTHER_PASS);
+        }
+        m_diffComputed = true;
+    }
+
+    DiffFit                   m_fit;                              /*!< \brief Fit, with or without derivatives */
+    NeighborCache<DataPoint>  m_cache;                            /*!< \brief Valid neighbors of the last fit */
+    VectorType                m_evalPos {VectorType::Zero()};     /*!< \brief Evaluation position */
+    bool                      m_diffComputed {false};             /*!< \brief Are the derivatives up to date */
+}; // class LazyBasketDiff
+
+} //namespace Ponca
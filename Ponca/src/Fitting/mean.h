@@ -32,6 +32,7 @@ namespace Ponca {
         PONCA_EXPLICIT_CAST_OPERATORS(MeanPosition,meanPosition)
         PONCA_FITTING_DECLARE_INIT
         PONCA_FITTING_DECLARE_ADDNEIGHBOR
+        PONCA_FITTING_DECLARE_ADDNEIGHBORS
 
         /// \brief Barycenter of the input points
         ///
@@ -73,6 +74,7 @@ namespace Ponca {
         PONCA_EXPLICIT_CAST_OPERATORS(MeanNormal,meanNormal)
         PONCA_FITTING_DECLARE_INIT
         PONCA_FITTING_DECLARE_ADDNEIGHBOR
+        PONCA_FITTING_DECLARE_ADDNEIGHBORS
     }; //class MeanNormal
 
     template<class DataPoint, class _WFunctor, int DiffType, typename T>
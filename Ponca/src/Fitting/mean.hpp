@@ -26,6 +26,17 @@ MeanPosition<DataPoint, _WFunctor, T>::addLocalNeighbor(Scalar w,
     return false;
 }
 
+template<class DataPoint, class _WFunctor, typename T>
+template<int Size>
+int
+MeanPosition<DataPoint, _WFunctor, T>::addLocalNeighbors(const NeighborPacket<DataPoint, Size>& packet,
+                                                         const typename NeighborPacket<DataPoint, Size>::ScalarPacket& w,
+                                                         const typename NeighborPacket<DataPoint, Size>::PositionPacket& localQ) {
+    const int nb = Base::addLocalNeighbors(packet, w, localQ);
+    m_sumP += localQ * w.matrix().transpose();
+    return nb;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 void
 MeanNormal<DataPoint, _WFunctor, T>::init(const VectorType& _evalPos)
@@ -47,6 +58,17 @@ MeanNormal<DataPoint, _WFunctor, T>::addLocalNeighbor(Scalar w,
     return false;
 }
 
+template<class DataPoint, class _WFunctor, typename T>
+template<int Size>
+int
+MeanNormal<DataPoint, _WFunctor, T>::addLocalNeighbors(const NeighborPacket<DataPoint, Size>& packet,
+                                                       const typename NeighborPacket<DataPoint, Size>::ScalarPacket& w,
+                                                       const typename NeighborPacket<DataPoint, Size>::PositionPacket& localQ) {
+    const int nb = Base::addLocalNeighbors(packet, w, localQ);
+    m_sumN += packet.normals() * w.matrix().transpose();
+    return nb;
+}
+
 template<class DataPoint, class _WFunctor, int DiffType, typename T>
 void
 MeanPositionDer<DataPoint, _WFunctor, DiffType, T>::init(const VectorType &_evalPos) {
@@ -0,0 +1,209 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+
+#include "../Common/executor.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace Ponca
+{
+
+/*!
+    \brief Project points on the MLS surface defined by a fit, by iterating fit-then-project steps
+
+    For each input position \f$ \mathbf{x_0} \f$, the fit is computed at \f$ \mathbf{x_k} \f$ from the neighbors
+    collected in a spatial partitioning structure, and \f$ \mathbf{x_{k+1}} \f$ is the projection of \f$ \mathbf{x_k}
+    \f$ on the fitted primitive (see AlgebraicSphere::project). The iterations stop when the position moves by less
+    than `tolerance * scale`, or after `maxIterations` iterations.
+
+    Each iteration starts from the previous projection, and reuses the previous neighborhood when possible: the
+    neighbors are collected in a ball of radius `(1 + margin) * scale`, which contains the support of the weighting
+    function of all the positions located less than `margin * scale` away from the center of the query. No new query
+    is thus needed until the position has moved farther than this distance, and the results are the same than when
+    querying the neighbors at each iteration.
+
+    The input positions are processed in parallel (see #setExecutor).
+
+    Typical use, to denoise a point cloud:
+    \code
+    using WeightFunc = DistWeightFunc<Point, SmoothWeightKernel<Scalar>>;
+    using Fit = Basket<Point, WeightFunc, OrientedSphereFit>;
+    KdTreeDense<Point> tree (points);
+
+    MlsProjection<Fit> projector;
+    projector.setWeightFunc(WeightFunc(scale));
+    auto projected = projector.projectAll(tree, tree.points());
+    \endcode
+
+    \tparam FitType Basket or BasketDiff type, whose primitive defines `project` (e.g. OrientedSphereFit). Its
+    weighting function must define `evalScale()` (see DistWeightFunc).
+*/
+template <typename FitType>
+class MlsProjection
+{
+public:
+    using Fit            = FitType;                              /*!< \brief Fit computed at each iteration */
+    using DataPoint      = typename Fit::DataPoint;              /*!< \brief Point type used for computation */
+    using Scalar         = typename DataPoint::Scalar;           /*!< \brief Scalar type used for computation */
+    using VectorType     = typename DataPoint::VectorType;       /*!< \brief Vector type used for computation */
+    using WeightFunction = typename Fit::WeightFunction;         /*!< \brief Weighting function of the fit */
+
+    /// \copydoc PrimitiveBase::setWeightFunc
+    inline void setWeightFunc(const WeightFunction& _w) { m_w = _w; }
+
+    /// \brief Set the maximum number of fit-then-project iterations per position
+    inline void setMaxIterations(int _nbIter) { m_maxIter = std::max(_nbIter, 1); }
+
+    /// \brief Set the convergence tolerance, relative to the scale
+    inline void setTolerance(Scalar _tol) { m_tolerance = _tol; }
+
+    /// \brief Set the margin of the neighborhood queries, relative to the scale. A null margin queries the neighbors at
+    /// each iteration.
+    inline void setNeighborhoodMargin(Scalar _margin) { m_margin = std::max(_margin, Scalar(0)); }
+
+    /// \brief Set the executor projecting the positions in #compute, or nullptr to use defaultExecutor()
+    inline void setExecutor(Executor* _executor) { m_executor = _executor; }
+
+    /// \brief Scale of the weighting function, i.e. radius of the neighborhood queries without margin
+    inline Scalar scale() const { return m_w.evalScale(); }
+    /// \brief Maximum number of fit-then-project iterations per position
+    inline int maxIterations() const { return m_maxIter; }
+    /// \brief Convergence tolerance, relative to the scale
+    inline Scalar tolerance() const { return m_tolerance; }
+    /// \brief Margin of the neighborhood queries, relative to the scale
+    inline Scalar neighborhoodMargin() const { return m_margin; }
+
+    /*!
+        \brief Project a single position
+
+        \param _tree Spatial partitioning structure providing `range_neighbors(position, radius)` and `points()`
+        (e.g. KdTreeBase)
+        \param _pos Position to project
+        \param _proj Projected position. When the fit is not stable, the last stable projection (or `_pos`)
+        \param _fit Fit, storing the last fit computed
+        \param _nbIter Number of fits computed
+        \return State of the last fit computed
+    */
+    template <typename Tree>
+    inline FIT_RESULT project(const Tree& _tree, const VectorType& _pos, VectorType& _proj, Fit& _fit,
+                              int& _nbIter) const
+    {
+        std::vector<int> ids;
+        return projectWithStorage(_tree, _pos, _proj, _fit, _nbIter, ids);
+    }
+
+    /// \copydoc project(const Tree&,const VectorType&,VectorType&,Fit&,int&) const
+    template <typename Tree>
+    inline FIT_RESULT project(const Tree& _tree, const VectorType& _pos, VectorType& _proj, Fit& _fit) const
+    {
+        int nbIter;
+        return project(_tree, _pos, _proj, _fit, nbIter);
+    }
+
+    /*!
+        \brief Project all the positions stored in a container
+
+        \param _tree Spatial partitioning structure providing `range_neighbors(position, radius)` and `points()`
+        \param _positions Random access container storing positions, or DataPoint
+        \param _f Functor called as `_f(index, projection, fit)` for each position, once it is projected. It is called
+        concurrently from several threads, but never twice for the same position.
+    */
+    template <typename Tree, typename Container, typename Functor>
+    inline void compute(const Tree& _tree, const Container& _positions, Functor&& _f) const
+    {
+        const int nbPositions = int(std::distance(std::begin(_positions), std::end(_positions)));
+
+        executorOrDefault(m_executor).parallelFor(nbPositions, [&](std::ptrdiff_t _begin, std::ptrdiff_t _end)
+        {
+            Fit fit;
+            std::vector<int> ids;
+            for (int i = int(_begin); i < int(_end); ++i)
+            {
+                VectorType proj;
+                int nbIter;
+                projectWithStorage(_tree, positionOf(_positions[i]), proj, fit, nbIter, ids);
+                _f(i, static_cast<const VectorType&>(proj), static_cast<const Fit&>(fit));
+            }
+        }, 64);
+    }
+
+    /*!
+        \brief Project all the positions stored in a container
+        \return Projected positions. Positions whose fit is never stable are left unchanged.
+        \see compute
+    */
+    template <typename Tree, typename Container>
+    inline std::vector<VectorType> projectAll(const Tree& _tree, const Container& _positions) const
+    {
+        std::vector<VectorType> res (std::distance(std::begin(_positions), std::end(_positions)));
+        compute(_tree, _positions, [&res](int _i, const VectorType& _proj, const Fit&) { res[_i] = _proj; });
+        return res;
+    }
+
+protected:
+    static inline const VectorType& positionOf(const VectorType& _p) { return _p; }
+    template <typename Point>
+    static inline const VectorType& positionOf(const Point& _p) { return _p.pos(); }
+
+    /// \brief Same as #project, reusing the storage `_ids` for the neighbor indices
+    template <typename Tree>
+    inline FIT_RESULT projectWithStorage(const Tree& _tree, const VectorType& _pos, VectorType& _proj, Fit& _fit,
+                                         int& _nbIter, std::vector<int>& _ids) const
+    {
+        const auto& points     = _tree.points();
+        const Scalar scale     = m_w.evalScale();
+        const Scalar radius    = (Scalar(1) + m_margin) * scale;
+        const Scalar maxMove   = m_margin * scale;
+        const Scalar tolerance = m_tolerance * scale;
+
+        VectorType x = _pos;
+        VectorType queryCenter = x;
+        bool hasQuery = false;
+
+        _proj = _pos;
+        _fit.setWeightFunc(m_w);
+        FIT_RESULT res = UNDEFINED;
+        for (_nbIter = 0; _nbIter < m_maxIter; )
+        {
+            // Reuse the previous neighborhood while it contains the support of the weighting function
+            if (! hasQuery || (x - queryCenter).norm() > maxMove)
+            {
+                _ids.clear();
+                for (int j : _tree.range_neighbors(x, radius))
+                    _ids.push_back(j);
+                queryCenter = x;
+                hasQuery = true;
+            }
+
+            _fit.init(x);
+            res = _fit.computeWithIds(_ids, points);
+            ++_nbIter;
+            if (res != STABLE) break;
+
+            const VectorType next = _fit.project(x);
+            const Scalar move = (next - x).norm();
+            _proj = x = next;
+            if (move <= tolerance) break;
+        }
+        return res;
+    }
+
+private:
+    WeightFunction m_w;                          /*!< \brief Weighting function of the fits */
+    Scalar         m_tolerance {Scalar(1e-4)};   /*!< \brief Convergence tolerance, relative to the scale */
+    Scalar         m_margin    {Scalar(0.5)};    /*!< \brief Margin of the neighborhood queries, relative to the scale */
+    int            m_maxIter   {16};             /*!< \brief Maximum number of iterations per position */
+    Executor*      m_executor  {nullptr};        /*!< \brief Executor of #compute, nullptr for the default */
+}; // class MlsProjection
+
+} //namespace Ponca
@@ -32,11 +32,11 @@ protected:
     enum { Check = Base::PROVIDES_PLANE && Base::PROVIDES_TANGENT_PLANE_BASIS };
 
 public:
-    using SampleMatrix = Eigen::Matrix<Scalar,Eigen::Dynamic,Eigen::Dynamic>;
+    using SampleMatrix = Eigen::Matrix<Scalar,6,6>;
     using Vector6      = Eigen::Matrix<Scalar,6,1>;
 
 protected:
-    SampleMatrix m_A; /*!< \brief Quadric input samples */
+    SampleMatrix m_A {SampleMatrix::Zero()}; /*!< \brief Quadric input samples (normal equations) */
     Vector6      m_x {Vector6::Zero()};      /*!< \brief Quadric parameters */
     Vector6      m_b {Vector6::Zero()};      /*!< \brief Observations */
 
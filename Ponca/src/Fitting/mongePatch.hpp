@@ -1,4 +1,5 @@
 ﻿
+#include <Eigen/Cholesky>
 #include <Eigen/SVD>
 #include <Eigen/Geometry>
 
@@ -51,7 +52,6 @@ MongePatch<DataPoint, _WFunctor, T>::finalize ()
 
         if(res == STABLE) {  // plane is ready
             m_planeIsReady = true;
-            m_A = SampleMatrix(6,6);
             m_A.setZero();
             m_b.setZero();
 
@@ -61,9 +61,14 @@ MongePatch<DataPoint, _WFunctor, T>::finalize ()
     }
     // end of the monge patch fitting process
     else {
-        // we use BDCSVD as the matrix size is 36
-        // http://eigen.tuxfamily.org/dox/classEigen_1_1BDCSVD.html
-        m_x = m_A.bdcSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(m_b);
+        // m_A is symmetric positive semi-definite: solve the normal equations with a LDLT decomposition, and fall
+        // back to SVD when the system is (nearly) singular, e.g. when the neighbors are aligned
+        Eigen::LDLT<SampleMatrix> ldlt (m_A);
+        if (ldlt.info() == Eigen::Success && ldlt.isPositive() &&
+            ldlt.rcond() > Eigen::NumTraits<Scalar>::epsilon())
+            m_x = ldlt.solve(m_b);
+        else
+            m_x = Eigen::JacobiSVD<SampleMatrix>(m_A, Eigen::ComputeFullU | Eigen::ComputeFullV).solve(m_b);
         return Base::m_eCurrentState = STABLE;
     }
 }
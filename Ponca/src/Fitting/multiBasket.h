@@ -0,0 +1,349 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+#include "./neighborCache.h"
+#include "../Common/Containers/smallVector.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace Ponca
+{
+
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    /// \brief Index of the first occurrence of type `T` in the pack `Ts`
+    template <typename T, typename... Ts>
+    struct FirstIndexOf;
+
+    template <typename T, typename... Ts>
+    struct FirstIndexOf<T, T, Ts...> : std::integral_constant<std::size_t, 0> {};
+
+    template <typename T, typename T0, typename... Ts>
+    struct FirstIndexOf<T, T0, Ts...> : std::integral_constant<std::size_t, 1 + FirstIndexOf<T, Ts...>::value> {};
+
+    template <typename Seq, typename... Ts>
+    struct DistinctTypeCountImpl;
+
+    template <std::size_t... Is, typename... Ts>
+    struct DistinctTypeCountImpl<std::index_sequence<Is...>, Ts...>
+        : std::integral_constant<int, (int(FirstIndexOf<Ts, Ts...>::value == Is) + ... + 0)> {};
+
+    /// \brief Number of distinct types in the pack `Ts`
+    template <typename... Ts>
+    struct DistinctTypeCount : DistinctTypeCountImpl<std::index_sequence_for<Ts...>, Ts...> {};
+
+    /// \brief Tell if two weighting functions of type `W` can be compared, i.e. if `W` defines `operator==`
+    template <typename W, typename = void>
+    struct HasWeightFuncEquality : std::false_type {};
+
+    template <typename W>
+    struct HasWeightFuncEquality<W,
+        decltype(void(bool(std::declval<const W&>() == std::declval<const W&>())))> : std::true_type {};
+}
+#endif
+
+/*!
+    \brief Compute several fits from a single traversal of the neighborhood
+
+    Each neighbor is dispatched to all the fits (see Basket::addWeightedNeighbor). Fits using the same weighting
+    function type share the same weighting function (see #setWeightFunc): its weight is computed only once per
+    neighbor, whatever the number of fits using it. The weights are shared only while the weighting functions of the
+    fits compare equal (see DistWeightFunc::operator==): a fit changing its basis between two passes computes its own
+    weights. Weighting functions without `operator==` are never shared.
+
+    Multi-pass fits (see #NEED_OTHER_PASS) are supported: the neighbors are dispatched again only to the fits
+    requiring another pass, the other fits keeping their results. #compute and #computeWithIds traverse the
+    neighborhood only once: the neighbors of the first pass are recorded, and replayed during the next passes.
+
+    Typical use, to compute a plane, a GLS descriptor and a Monge patch from one neighborhood query:
+    \code
+    using WeightFunc = DistWeightFunc<Point, SmoothWeightKernel<Scalar>>;
+    using PlaneFit = Basket<Point, WeightFunc, CovariancePlaneFit>;
+    using GLSFit   = Basket<Point, WeightFunc, OrientedSphereFit, GLSParam>;
+    using MongeFit = Basket<Point, WeightFunc, CovariancePlaneFit, MongePatch>;
+
+    MultiBasket<PlaneFit, GLSFit, MongeFit> fit; // weights are computed once per neighbor
+    fit.setWeightFunc(WeightFunc(scale));
+    fit.init(evalPos);
+    fit.computeWithIds(tree.range_neighbors(evalPos, scale), tree.points());
+    if (fit.get<GLSFit>().isStable()) std::cout << fit.get<GLSFit>().tau() << std::endl;
+    \endcode
+
+    \tparam Fits Basket or BasketDiff types, using the same DataPoint type
+*/
+template <typename... Fits>
+class MultiBasket
+{
+    static_assert(sizeof...(Fits) > 0, "MultiBasket requires at least one fit");
+
+public:
+    using FitTuple   = std::tuple<Fits...>;                                 /*!< \brief Type storing the fits */
+    using DataPoint  = typename std::tuple_element_t<0, FitTuple>::DataPoint; /*!< \brief Point type used for computation */
+    using Scalar     = typename DataPoint::Scalar;                          /*!< \brief Scalar type used for computation */
+    using VectorType = typename DataPoint::VectorType;                      /*!< \brief Vector type used for computation */
+
+    /// \brief Fit of index `I`
+    template <std::size_t I>
+    using FitAt = std::tuple_element_t<I, FitTuple>;
+
+    static_assert((std::is_same<DataPoint, typename Fits::DataPoint>::value && ...),
+                  "All the fits must use the same DataPoint type");
+
+    /// \brief Number of fits
+    static constexpr std::size_t Size = sizeof...(Fits);
+
+    /// \brief Number of distinct weighting function types, ie. of weights computed per neighbor when the weighting
+    /// functions of the same type are equal
+    static constexpr int weightFunctionCount = internal::DistinctTypeCount<typename Fits::WeightFunction...>::value;
+
+    /*!
+        \brief Set the weighting function of all the fits using this weighting function type
+        \see PrimitiveBase::setWeightFunc
+    */
+    template <typename WeightFunction>
+    inline void setWeightFunc(const WeightFunction& _w)
+    {
+        static_assert((std::is_same<WeightFunction, typename Fits::WeightFunction>::value || ...),
+                      "No fit uses this weighting function type");
+        setWeightFuncImpl(_w, std::make_index_sequence<Size>());
+        updateWeightSources(std::make_index_sequence<Size>());
+    }
+
+    /// \brief Set the evaluation position of all the fits
+    /// \see PrimitiveBase::init
+    inline void init(const VectorType& _evalPos)
+    {
+        std::apply([&_evalPos](auto&... f) { (f.init(_evalPos), ...); }, m_fits);
+        m_active.fill(true);
+        updateWeightSources(std::make_index_sequence<Size>());
+    }
+
+    /// \brief Start a new pass for the fits that have not been finalized yet, or that need another pass
+    inline void startNewPass()
+    {
+        startNewPassImpl(std::make_index_sequence<Size>());
+        // the fits may have changed their weighting functions when finalized
+        updateWeightSources(std::make_index_sequence<Size>());
+    }
+
+    /*!
+        \brief Add a neighbor to all the fits of the current pass
+        \return false if the neighbor is not valid for any fit (weight = 0)
+    */
+    inline bool addNeighbor(const DataPoint& _nei)
+    {
+        return addNeighborImpl(_nei, [&_nei](const auto& _w) { return _w.w(_nei.pos(), _nei); },
+                               std::make_index_sequence<Size>());
+    }
+
+    /*!
+        \brief Add a neighbor to all the fits of the current pass, knowing its squared distance to the basis center
+        \see Basket::addNeighbor(const DataPoint&, const Scalar&)
+    */
+    inline bool addNeighbor(const DataPoint& _nei, const Scalar& _sqDist)
+    {
+        return addNeighborImpl(_nei, [&_nei, &_sqDist](const auto& _w) { return _w.w(_nei.pos(), _nei, _sqDist); },
+                               std::make_index_sequence<Size>());
+    }
+
+    /*!
+        \brief Finalize the fits of the current pass
+        \return #NEED_OTHER_PASS if at least one fit needs another pass, the current state otherwise (see
+        #getCurrentState)
+    */
+    inline FIT_RESULT finalize()
+    {
+        finalizeImpl(std::make_index_sequence<Size>());
+        return needAnotherPass() ? NEED_OTHER_PASS : getCurrentState();
+    }
+
+    /*!
+        \brief Convenience function for STL-like iterators
+
+        Add the neighbors to all the fits, and finalize them. The neighbors are recorded during the first pass, and
+        replayed while a fit requires another pass: the iterators are traversed only once.
+        \warning The iterators must give access to samples stored in memory (not to temporaries)
+    */
+    template <typename IteratorBegin, typename IteratorEnd>
+    inline FIT_RESULT compute(const IteratorBegin& _begin, const IteratorEnd& _end)
+    {
+        static_assert(std::is_lvalue_reference<decltype(*_begin)>::value,
+                      "The neighbors are recorded as pointers to the samples: iterators must return references");
+        return computeRecorded([&](const auto& _f) {
+            for (auto it = _begin; it != _end; ++it) _f(*it);
+        });
+    }
+
+    /// \copydoc compute(const IteratorBegin&,const IteratorEnd&)
+    template <typename Container>
+    inline FIT_RESULT compute(const Container& _c)
+    {
+        return compute(std::begin(_c), std::end(_c));
+    }
+
+    /*!
+        \brief Convenience function to iterate over a subset of samples in a PointContainer
+
+        The ids are traversed only once, see #compute(const IteratorBegin&,const IteratorEnd&).
+        \see Basket::computeWithIds
+    */
+    template <typename IndexRange, typename PointContainer>
+    inline FIT_RESULT computeWithIds(IndexRange _ids, const PointContainer& _points)
+    {
+        return computeRecorded([&](const auto& _f) {
+            for (const auto& i : _ids) _f(_points[i]);
+        });
+    }
+
+    /// \brief Tell if at least one fit needs another pass
+    inline bool needAnotherPass() const
+    {
+        return std::any_of(m_active.begin(), m_active.end(), [](bool _a) { return _a; });
+    }
+
+    /*!
+        \brief Least favorable state of the fits
+
+        Fit states are ordered from #STABLE to #CONFLICT_ERROR_FOUND: the result is #STABLE only if all the fits are
+        stable.
+    */
+    inline FIT_RESULT getCurrentState() const
+    {
+        return std::apply([](const auto&... f) { return std::max({f.getCurrentState()...}); }, m_fits);
+    }
+
+    /// \brief Fit of index `I`
+    template <std::size_t I>
+    inline const FitAt<I>& get() const { return std::get<I>(m_fits); }
+
+    /// \brief Fit of type `Fit`, which must appear only once in the parameters of the MultiBasket
+    template <typename Fit>
+    inline const Fit& get() const { return std::get<Fit>(m_fits); }
+
+    /// \brief All the fits
+    inline const FitTuple& fits() const { return m_fits; }
+
+private:
+    /// \brief Neighbors outside the support of all the fits can be skipped by the next passes
+    static constexpr bool passInvariantWeights =
+        (IsPassInvariantWeight<typename Fits::WeightFunction>::value && ...);
+
+    /// \brief Run the first pass over the neighbors given by `_forEachNeighbor`, and replay them for the next passes
+    template <typename ForEachNeighbor>
+    inline FIT_RESULT computeRecorded(const ForEachNeighbor& _forEachNeighbor)
+    {
+        m_neighbors.clear();
+        startNewPass();
+        _forEachNeighbor([this](const DataPoint& _nei) {
+            // neighbors outside the support are kept when their weights may change
+            if (addNeighbor(_nei) || ! passInvariantWeights) m_neighbors.push_back(&_nei);
+        });
+        FIT_RESULT res = finalize();
+        while (res == NEED_OTHER_PASS)
+        {
+            startNewPass();
+            for (const DataPoint* nei : m_neighbors) addNeighbor(*nei);
+            res = finalize();
+        }
+        return res;
+    }
+
+    /// \brief Tell if the fits of index `I` and `K` have equal weighting functions, and thus the same weights
+    template <std::size_t I, std::size_t K>
+    inline bool haveSameWeights() const
+    {
+        using WeightFunction = typename FitAt<I>::WeightFunction;
+        if constexpr (std::is_same<WeightFunction, typename FitAt<K>::WeightFunction>::value &&
+                      internal::HasWeightFuncEquality<WeightFunction>::value)
+            return std::get<I>(m_fits).getWeightFunc() == std::get<K>(m_fits).getWeightFunc();
+        else
+            return false;
+    }
+
+    /// \brief Index of the first fit whose weights can be reused by the fit of index `I` (`I` itself if none)
+    template <std::size_t I, std::size_t... Ks>
+    inline std::size_t weightSourceOf(std::index_sequence<Ks...>) const
+    {
+        std::size_t source = I;
+        (void)((haveSameWeights<I, Ks>() && (source = Ks, true)) || ...);
+        return source;
+    }
+
+    template <std::size_t... Is>
+    inline void updateWeightSources(std::index_sequence<Is...>)
+    {
+        ((m_weightSource[Is] = weightSourceOf<Is>(std::make_index_sequence<Is>())), ...);
+    }
+
+    template <typename WeightFunction, std::size_t... Is>
+    inline void setWeightFuncImpl(const WeightFunction& _w, std::index_sequence<Is...>)
+    {
+        (setWeightFuncAt<Is>(_w), ...);
+    }
+
+    template <std::size_t I, typename WeightFunction>
+    inline void setWeightFuncAt(const WeightFunction& _w)
+    {
+        if constexpr (std::is_same<WeightFunction, typename FitAt<I>::WeightFunction>::value)
+            std::get<I>(m_fits).setWeightFunc(_w);
+    }
+
+    template <std::size_t... Is>
+    inline void startNewPassImpl(std::index_sequence<Is...>)
+    {
+        ((m_active[Is] ? std::get<Is>(m_fits).startNewPass() : void()), ...);
+    }
+
+    template <std::size_t... Is>
+    inline void finalizeImpl(std::index_sequence<Is...>)
+    {
+        ((m_active[Is] = m_active[Is] && std::get<Is>(m_fits).finalize() == NEED_OTHER_PASS), ...);
+    }
+
+    /// \brief Compute the weights lazily, once per weighting function, and dispatch the neighbor to the active fits
+    template <typename WeightEval, std::size_t... Is>
+    inline bool addNeighborImpl(const DataPoint& _nei, const WeightEval& _eval, std::index_sequence<Is...>)
+    {
+        std::array<std::pair<Scalar, VectorType>, Size> wres;
+        std::array<bool, Size> computed {};
+        bool added = false;
+        ((added |= addNeighborAt<Is>(_nei, _eval, wres, computed)), ...);
+        return added;
+    }
+
+    template <std::size_t I, typename WeightEval>
+    inline bool addNeighborAt(const DataPoint& _nei, const WeightEval& _eval,
+                              std::array<std::pair<Scalar, VectorType>, Size>& _wres,
+                              std::array<bool, Size>& _computed)
+    {
+        if (! m_active[I]) return false;
+        const std::size_t j = m_weightSource[I];
+        if (! _computed[j])
+        {
+            // the fit j might not be active anymore, but its weighting function is equal to the one of this fit
+            _wres[j] = _eval(std::get<I>(m_fits).getWeightFunc());
+            _computed[j] = true;
+        }
+        return std::get<I>(m_fits).addWeightedNeighbor(_wres[j].first, _wres[j].second, _nei);
+    }
+
+    FitTuple                          m_fits;            /*!< \brief Fits */
+    std::array<bool, Size>            m_active {};       /*!< \brief Fits not finalized yet, or requiring another pass */
+    std::array<std::size_t, Size>     m_weightSource {}; /*!< \brief Index of the fit whose weights are reused by each fit */
+    SmallVector<const DataPoint*, 64> m_neighbors;       /*!< \brief Neighbors of the first pass, replayed by the next ones */
+}; // class MultiBasket
+
+} //namespace Ponca
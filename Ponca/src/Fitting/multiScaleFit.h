@@ -0,0 +1,239 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+#include "./weightFunc.h"
+#include "./weightKernel.h"
+#include "../Common/Assert.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace Ponca
+{
+
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    /// \brief Tell if the weights computed by a weighting function do not depend on the scale inside its support
+    template <typename WFunctor>
+    struct IsScaleIndependentWeight : std::false_type {};
+
+    template <typename DataPoint, typename Scalar>
+    struct IsScaleIndependentWeight<DistWeightFunc<DataPoint, ConstantWeightKernel<Scalar>>> : std::true_type {};
+}
+#endif
+
+/*!
+    \brief Fit the same primitive at several scales, from a single neighborhood query
+
+    The neighborhood is collected once at the largest scale, and the neighbors are sorted by increasing distance to
+    the evaluation position. The fits are then computed for all the scales at once:
+     - when the weights do not depend on the scale inside the support of the weighting function (e.g.
+       ConstantWeightKernel), the fit is accumulated incrementally as the radius grows: each neighbor is added only
+       once, and the accumulated fit is copied and finalized at each scale,
+     - otherwise, all the scales are evaluated in one pass over the sorted neighbors: each neighbor is added to the
+       fits of the scales containing it.
+
+    Multi-pass fits (see #NEED_OTHER_PASS) are supported, by replaying the sorted neighbors for the scales requiring
+    another pass.
+
+    Typical use, to compute GLS descriptors at several scales:
+    \code
+    using Fit = Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<Scalar>>, OrientedSphereFit, GLSParam>;
+    MultiScaleFit<Fit> msFit;
+    msFit.setScales(scales);
+    msFit.init(evalPos);
+    msFit.computeWithIds(tree.range_neighbors(evalPos, msFit.maxScale()), tree.points());
+    for (int s = 0; s < msFit.scaleCount(); ++s)
+        if (msFit.fit(s).isStable()) std::cout << msFit.fit(s).tau() << std::endl;
+    \endcode
+
+    \tparam FitType Basket or BasketDiff type. Its weighting function must be constructible from a scale, and
+    define `init(evalPos)` (see DistWeightFunc).
+*/
+template <typename FitType>
+class MultiScaleFit
+{
+public:
+    using Fit            = FitType;                              /*!< \brief Fit computed at each scale */
+    using DataPoint      = typename Fit::DataPoint;              /*!< \brief Point type used for computation */
+    using Scalar         = typename DataPoint::Scalar;           /*!< \brief Scalar type used for computation */
+    using VectorType     = typename DataPoint::VectorType;       /*!< \brief Vector type used for computation */
+    using WeightFunction = typename Fit::WeightFunction;         /*!< \brief Weighting function of the fit */
+
+    /// \brief Tell if the fits are accumulated incrementally across scales
+    static constexpr bool isIncremental = internal::IsScaleIndependentWeight<WeightFunction>::value;
+
+    /*!
+        \brief Set the scales at which the fit is computed
+        \param _scales Range of strictly positive scales, sorted internally in increasing order
+        \warning Without scale, the computations return #UNDEFINED
+    */
+    template <typename ScaleRange>
+    inline void setScales(const ScaleRange& _scales)
+    {
+        m_scales.assign(std::begin(_scales), std::end(_scales));
+        std::sort(m_scales.begin(), m_scales.end());
+        m_fits.resize(m_scales.size());
+    }
+
+    /// \brief Set the evaluation position and reset the internal states
+    /// \warning Must be called before any computation (but after #setScales)
+    inline void init(const VectorType& _evalPos)
+    {
+        m_evalPos = _evalPos;
+        m_neighbors.clear();
+        for (int s = 0; s < scaleCount(); ++s)
+        {
+            m_fits[s].setWeightFunc(WeightFunction(m_scales[s]));
+            m_fits[s].init(_evalPos);
+        }
+    }
+
+    /// \brief Compute the fits at all scales from the samples stored in a container
+    /// \return The state of the fit at the largest scale, #UNDEFINED if there is no scale
+    template <typename Container>
+    inline FIT_RESULT compute(const Container& _points)
+    {
+        if (scaleCount() == 0) return UNDEFINED;
+        m_neighbors.clear();
+        for (const auto& p : _points)
+            collectNeighbor(p);
+        return computeFromCollectedNeighbors();
+    }
+
+    /*!
+        \brief Compute the fits at all scales from a subset of samples
+        \param _ids Indices of the neighbors, typically a range query at the largest scale (see #maxScale)
+        \param _points Container storing the samples
+        \return The state of the fit at the largest scale, #UNDEFINED if there is no scale
+    */
+    template <typename IndexRange, typename PointContainer>
+    inline FIT_RESULT computeWithIds(IndexRange _ids, const PointContainer& _points)
+    {
+        if (scaleCount() == 0) return UNDEFINED;
+        m_neighbors.clear();
+        for (const auto& i : _ids)
+            collectNeighbor(_points[i]);
+        return computeFromCollectedNeighbors();
+    }
+
+    /// \brief Number of scales
+    inline int scaleCount() const { return int(m_scales.size()); }
+
+    /// \brief Scale of index `_s`, scales being sorted in increasing order
+    inline Scalar scale(int _s) const { return m_scales[_s]; }
+
+    /// \brief Largest scale, to be used to query the neighbors \warning Requires at least one scale
+    inline Scalar maxScale() const { PONCA_DEBUG_ASSERT(scaleCount() > 0); return m_scales.back(); }
+
+    /// \brief Fit computed at the scale of index `_s`
+    inline const Fit& fit(int _s) const { return m_fits[_s]; }
+
+    /// \brief Fits computed at all scales, sorted by increasing scale
+    inline const std::vector<Fit>& fits() const { return m_fits; }
+
+private:
+    /// \brief Neighbor with its squared distance to the evaluation position
+    struct Neighbor
+    {
+        Scalar sqDist;
+        const DataPoint* point;
+        inline bool operator<(const Neighbor& _other) const { return sqDist < _other.sqDist; }
+    };
+
+    /// \brief Squared scale of index `_s`, compared to squared distances as in DistWeightFunc
+    inline Scalar squaredScale(int _s) const { return m_scales[_s] * m_scales[_s]; }
+
+    inline void collectNeighbor(const DataPoint& _p)
+    {
+        // Same distance computation than DistWeightFunc, to select exactly the same neighbors
+        const Scalar d2 = (_p.pos() - m_evalPos).squaredNorm();
+        if (d2 <= squaredScale(scaleCount() - 1))
+            m_neighbors.push_back({d2, &_p});
+    }
+
+    inline FIT_RESULT computeFromCollectedNeighbors()
+    {
+        std::sort(m_neighbors.begin(), m_neighbors.end());
+        if (isIncremental && computeIncremental())
+            return m_fits.back().getCurrentState();
+        computeSinglePass();
+        return m_fits.back().getCurrentState();
+    }
+
+    /// \brief Accumulate the neighbors once, and finalize a copy of the accumulated fit at each scale
+    /// \return false if the fit requires multiple passes, and thus cannot be computed incrementally
+    inline bool computeIncremental()
+    {
+        Fit acc;
+        acc.setWeightFunc(WeightFunction(maxScale()));
+        acc.init(m_evalPos);
+
+        size_t k = 0;
+        for (int s = 0; s < scaleCount(); ++s)
+        {
+            for (; k < m_neighbors.size() && m_neighbors[k].sqDist <= squaredScale(s); ++k)
+                acc.addNeighbor(*m_neighbors[k].point, m_neighbors[k].sqDist);
+
+            WeightFunction w(m_scales[s]);
+            w.init(m_evalPos);
+            m_fits[s] = acc;
+            m_fits[s].setWeightFunc(w);
+            if (m_fits[s].finalize() == NEED_OTHER_PASS)
+            {
+                // restore initial state before recomputing all the fits
+                for (int i = 0; i <= s; ++i)
+                {
+                    m_fits[i].setWeightFunc(WeightFunction(m_scales[i]));
+                    m_fits[i].init(m_evalPos);
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief Traverse the neighbors once per pass, adding each neighbor to all the scales containing it
+    inline void computeSinglePass()
+    {
+        std::vector<char> active (m_fits.size(), 1);
+        bool needAnotherPass = false;
+        do {
+            for (int s = 0; s < scaleCount(); ++s)
+                if (active[s]) m_fits[s].startNewPass();
+
+            // neighbors are sorted: the first scale containing a neighbor never decreases
+            int first = 0;
+            for (const auto& n : m_neighbors)
+            {
+                while (first < scaleCount() && n.sqDist > squaredScale(first)) ++first;
+                for (int s = first; s < scaleCount(); ++s)
+                    if (active[s]) m_fits[s].addNeighbor(*n.point, n.sqDist);
+            }
+
+            needAnotherPass = false;
+            for (int s = 0; s < scaleCount(); ++s)
+            {
+                if (! active[s]) continue;
+                active[s] = m_fits[s].finalize() == NEED_OTHER_PASS;
+                needAnotherPass |= bool(active[s]);
+            }
+        } while (needAnotherPass);
+    }
+
+    std::vector<Scalar>   m_scales;    /*!< \brief Scales, sorted in increasing order */
+    std::vector<Fit>      m_fits;      /*!< \brief One fit per scale */
+    std::vector<Neighbor> m_neighbors; /*!< \brief Neighbors at the largest scale, sorted by distance */
+    VectorType            m_evalPos {VectorType::Zero()}; /*!< \brief Evaluation position */
+}; // class MultiScaleFit
+
+} //namespace Ponca
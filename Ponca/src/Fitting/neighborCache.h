@@ -0,0 +1,60 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "../Common/Containers/smallVector.h"
+
+#include <type_traits>
+
+namespace Ponca
+{
+
+/*!
+    \brief Neighbor with its weight and its coordinates expressed in the local basis of the weighting function
+
+    \see NeighborCache
+    \tparam DataPoint Implements \ref ponca_concepts "PointConcept"
+*/
+template <class DataPoint>
+struct WeightedNeighbor
+{
+    using Scalar     = typename DataPoint::Scalar;     /*!< \brief Scalar type from DataPoint */
+    using VectorType = typename DataPoint::VectorType; /*!< \brief Vector type from DataPoint */
+
+    Scalar           weight;  /*!< \brief Weight of the neighbor */
+    VectorType       localQ;  /*!< \brief Neighbor position, expressed in the local basis of the weighting function */
+    const DataPoint* point;   /*!< \brief Neighbor, used to access its attributes */
+};
+
+/*!
+    \brief Scratch storage used to replay a neighborhood during multi-pass fitting
+
+    The first `N` neighbors are stored without heap allocation. Reusing the same cache for several fits avoids
+    allocations once its heap storage is large enough.
+
+    \see Basket::computeCached
+*/
+template <class DataPoint, int N = 64>
+using NeighborCache = SmallVector<WeightedNeighbor<DataPoint>, N>;
+
+/*!
+    \brief Tell if the weights computed by a weighting function are the same at each pass of a fit
+
+    When true, the weights stored in a NeighborCache are replayed by Basket::computeCached, and the neighbors outside
+    the support of the first pass are skipped by the next ones (see also MultiBasket and LazyBasketDiff). Weighting
+    functions only depend on their basis, which is usually kept between the passes. Specialize to `std::false_type`
+    for weighting functions whose weights change between the passes, e.g. when the fit moves its basis: all the
+    neighbors are then replayed, and weighted again. For instance:
+    \code
+    template <> struct Ponca::IsPassInvariantWeight<MyWeightFunc> : std::false_type {};
+    \endcode
+ */
+template <typename WFunctor>
+struct IsPassInvariantWeight : std::true_type {};
+
+} //namespace Ponca
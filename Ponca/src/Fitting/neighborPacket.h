@@ -0,0 +1,97 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+
+#include <Eigen/Core>
+#include PONCA_MULTIARCH_INCLUDE_CU_STD(type_traits)
+
+namespace Ponca
+{
+
+/*!
+    \brief Fixed-size batch of neighbors, stored as a structure of arrays
+
+    Positions are stored in a row-major matrix: row \f$d\f$ stores the \f$d\f$-th coordinate of all the neighbors of
+    the packet, so that distance and weight computations can be vectorized over the neighbors
+    (see DistWeightFunc::wPacket). The attributes of each neighbor are accessed through a pointer to the original
+    sample, which must outlive the packet.
+
+    Only the first #count lanes of the packet are valid. The other lanes are still processed by the packet
+    computations, and thus always hold finite values: they are zero at construction, and keep the neighbors of the
+    previous packets after #clear. Their weights are masked before accumulation (see Basket::addNeighbors).
+
+    \see Basket::addNeighbors
+    \tparam DataPoint Implements \ref ponca_concepts "PointConcept"
+    \tparam _Size Number of neighbors stored in the packet (typically 4, 8 or 16)
+*/
+template <class DataPoint, int _Size = 8>
+struct NeighborPacket
+{
+    static_assert(_Size > 1, "Packets must contain at least two neighbors");
+
+    enum {
+        Size = _Size,          /*!< \brief Maximum number of neighbors stored in the packet */
+        Dim  = DataPoint::Dim  /*!< \brief Ambient dimension */
+    };
+
+    /// \brief Scalar type from DataPoint
+    using Scalar         = typename DataPoint::Scalar;
+    /// \brief Vector type from DataPoint
+    using VectorType     = typename DataPoint::VectorType;
+    /// \brief Positions of the neighbors, one column per neighbor, coordinates stored contiguously
+    using PositionPacket = Eigen::Matrix<Scalar, Dim, Size, Eigen::RowMajor>;
+    /// \brief One scalar value per neighbor
+    using ScalarPacket   = Eigen::Array<Scalar, 1, Size>;
+
+    PositionPacket   positions {PositionPacket::Zero()}; /*!< \brief Positions of the neighbors */
+    const DataPoint* points[Size] {};                     /*!< \brief Neighbors, used to access their attributes */
+    int              count {0};          /*!< \brief Number of valid lanes */
+
+    /// \brief Remove all the neighbors from the packet
+    PONCA_MULTIARCH inline void clear() { count = 0; }
+
+    /// \brief Tell if no more neighbor can be added to the packet
+    PONCA_MULTIARCH inline bool full() const { return count == Size; }
+
+    /// \brief Tell if the packet does not store any neighbor
+    PONCA_MULTIARCH inline bool empty() const { return count == 0; }
+
+    /// \brief Append a neighbor to the packet
+    /// \warning The packet stores a pointer to `_p`, which must remain valid while the packet is used
+    PONCA_MULTIARCH inline void push(const DataPoint& _p)
+    {
+        positions.col(count) = _p.pos();
+        points[count++] = &_p;
+    }
+
+    /// \brief Normals of the neighbors, with the layout of #positions. Lanes after #count are set to zero.
+    PONCA_MULTIARCH inline PositionPacket normals() const
+    {
+        PositionPacket res = PositionPacket::Zero();
+        for (int i = 0; i < count; ++i)
+            res.col(i) = points[i]->normal();
+        return res;
+    }
+}; // struct NeighborPacket
+
+/*!
+    \brief Tell if the neighbors of a packet can be weighted at once using `WFunctor::wPacket`
+
+    wPacket reproduces DistWeightFunc::w, so it cannot be used by weighting functions defining their own `w`, e.g. a
+    class derived from DistWeightFunc. Packets are thus weighted at once for DistWeightFunc only: other weighting
+    functions weight each neighbor of a packet with `w` (see Basket::addNeighbors), unless they opt in by specializing
+    this trait, e.g.:
+    \code
+    template <> struct Ponca::UsePacketWeights<MyWeightFunc> : std::true_type {};
+    \endcode
+*/
+template <class WFunctor>
+struct UsePacketWeights : PONCA_MULTIARCH_CU_STD_NAMESPACE(false_type) {};
+
+} //namespace Ponca
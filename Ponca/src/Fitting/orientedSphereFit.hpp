@@ -31,6 +31,18 @@ OrientedSphereFitImpl<DataPoint, _WFunctor, T>::addLocalNeighbor(Scalar w,
     return false;
 }
 
+template<class DataPoint, class _WFunctor, typename T>
+template<int Size>
+int
+OrientedSphereFitImpl<DataPoint, _WFunctor, T>::addLocalNeighbors(const NeighborPacket<DataPoint, Size>& packet,
+                                                                  const typename NeighborPacket<DataPoint, Size>::ScalarPacket& w,
+                                                                  const typename NeighborPacket<DataPoint, Size>::PositionPacket& localQ) {
+    const int nb = Base::addLocalNeighbors(packet, w, localQ);
+    m_sumDotPN += (w * packet.normals().cwiseProduct(localQ).colwise().sum().array()).sum();
+    m_sumDotPP += (w * localQ.colwise().squaredNorm().array()).sum();
+    return nb;
+}
+
 
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
@@ -10,6 +10,7 @@
 
 #include "defines.h"
 #include "enums.h"
+#include "neighborPacket.h"
 #include <Eigen/Dense>
 
 namespace Ponca
@@ -117,6 +118,17 @@ public:
         return true;
     }
 
+    PONCA_FITTING_APIDOC_ADDNEIGHBORS
+    template <int Size>
+    PONCA_MULTIARCH inline int addLocalNeighbors(const NeighborPacket<DataPoint, Size>&,
+                                                 const typename NeighborPacket<DataPoint, Size>::ScalarPacket& w,
+                                                 const typename NeighborPacket<DataPoint, Size>::PositionPacket&) {
+        const int nb = int((w > Scalar(0.)).count());
+        m_sumW += w.sum();
+        m_nbNeighbors += nb;
+        return nb;
+    }
+
     PONCA_FITTING_APIDOC_FINALIZE
     PONCA_MULTIARCH inline FIT_RESULT finalize(){
         // handle specific configurations
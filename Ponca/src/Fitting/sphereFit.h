@@ -7,6 +7,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #pragma once
 
 #include "./algebraicSphere.h"
+#include "./neighborPacket.h"
 
 
 namespace Ponca
@@ -78,6 +79,7 @@ protected:
 public:
     PONCA_EXPLICIT_CAST_OPERATORS(SphereFitImpl,sphereFit)
     PONCA_FITTING_DECLARE_INIT_ADD_FINALIZE
+    PONCA_FITTING_DECLARE_ADDNEIGHBORS
     PONCA_FITTING_IS_SIGNED(false)
 
     PONCA_MULTIARCH inline const Solver& solver() const { return m_solver; }
@@ -35,6 +35,23 @@ SphereFitImpl<DataPoint, _WFunctor, T>::addLocalNeighbor(Scalar w,
     return false;
 }
 
+template < class DataPoint, class _WFunctor, typename T>
+template <int Size>
+int
+SphereFitImpl<DataPoint, _WFunctor, T>::addLocalNeighbors(const NeighborPacket<DataPoint, Size>& packet,
+                                                          const typename NeighborPacket<DataPoint, Size>::ScalarPacket& w,
+                                                          const typename NeighborPacket<DataPoint, Size>::PositionPacket& localQ)
+{
+    const int nb = Base::addLocalNeighbors(packet, w, localQ);
+    // One column [1, q, |q|^2] per neighbor
+    Eigen::Matrix<Scalar, DataPoint::Dim+2, Size> a;
+    a.row(0).setOnes();
+    a.template middleRows<DataPoint::Dim>(1) = localQ;
+    a.row(DataPoint::Dim+1) = localQ.colwise().squaredNorm();
+    m_matA += (a.array().rowwise() * w).matrix() * a.transpose();
+    return nb;
+}
+
 
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
@@ -0,0 +1,332 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./defines.h"
+#include "./enums.h"
+
+#include <Eigen/Eigenvalues>
+
+#include <cmath>
+
+namespace Ponca
+{
+
+/*!
+    \brief Eigen decomposition of self-adjoint matrices, with a selectable solving strategy
+
+    This class is a drop-in replacement of Eigen::SelfAdjointEigenSolver (all the reading accessors are inherited),
+    where #compute follows the EigenSolverPolicy set at construction or using #setPolicy:
+     - #IterativeEigenSolver: iterative QR algorithm (Eigen::SelfAdjointEigenSolver::compute), accurate for any
+       matrix but slower,
+     - #DirectEigenSolver: closed-form solution (Eigen::SelfAdjointEigenSolver::computeDirect), much faster for 2x2
+       and 3x3 matrices but less accurate for badly conditioned inputs,
+     - #DirectEigenSolverWithFallback: closed-form solution, checked by #isAccurate. When the decomposition is not
+       accurate enough (see #setTolerance), the iterative solver is used instead (see #usedFallback).
+
+    On CUDA devices, the closed-form solution is always used. On CPU, many 3x3 matrices can be decomposed at once by
+    #computeBatch, which vectorizes the closed-form solution across the matrices.
+
+    \tparam _MatrixType Type of the matrix to decompose. Closed-form solutions are only available for 2x2 and 3x3
+    matrices: for other sizes, computeDirect falls back to the iterative solver.
+*/
+template <typename _MatrixType>
+class SymmetricEigenSolver : public Eigen::SelfAdjointEigenSolver<_MatrixType>
+{
+public:
+    /*! \brief Eigen solver providing the decomposition */
+    using Base       = Eigen::SelfAdjointEigenSolver<_MatrixType>;
+    /*! \brief Type of the decomposed matrices */
+    using MatrixType = _MatrixType;
+    /*! \brief Real scalar type used by the eigenvalues */
+    using RealScalar = typename Base::RealScalar;
+
+    /*! \brief Default constructor \param _policy Solving strategy */
+    PONCA_MULTIARCH inline SymmetricEigenSolver(EigenSolverPolicy _policy =
+#ifdef __CUDACC__
+                                                DirectEigenSolver
+#else
+                                                IterativeEigenSolver
+#endif
+                                                ) : Base(), m_policy(_policy)
+    {
+        // Not decomposed yet, but copies of unsolved fits (e.g. in MultiScaleFit) must not read indeterminate values
+        Base::m_eivec.setZero();
+        Base::m_eivalues.setZero();
+        Base::m_subdiag.setZero();
+        Base::m_hcoeffs.setZero();
+    }
+
+    /*! \brief Compute the eigen decomposition of `_m` using the current policy */
+    PONCA_MULTIARCH inline SymmetricEigenSolver& compute(const MatrixType& _m)
+    {
+        m_usedFallback = false;
+#ifdef __CUDA_ARCH__
+        Base::computeDirect(_m);
+#else
+        switch (m_policy)
+        {
+            case IterativeEigenSolver:
+                Base::compute(_m);
+                break;
+            case DirectEigenSolver:
+                Base::computeDirect(_m);
+                break;
+            case DirectEigenSolverWithFallback:
+                Base::computeDirect(_m);
+                if (! isAccurate(_m))
+                {
+                    Base::compute(_m);
+                    m_usedFallback = true;
+                }
+                break;
+        }
+#endif
+        return *this;
+    }
+
+    /*! \brief Check the accuracy of the last decomposition of `_m`
+
+        The decomposition is considered as accurate when the eigenvectors are orthonormal and when the residual
+        \f$ \| \mathbf{M} \mathbf{V} - \mathbf{V} \Lambda \|_\infty \f$ is small with respect to the largest
+        eigenvalue, both up to #tolerance.
+     */
+    PONCA_MULTIARCH inline bool isAccurate(const MatrixType& _m) const
+    {
+        if (Base::info() != Eigen::Success || ! Base::eigenvalues().allFinite())
+            return false;
+
+        const auto& values  = Base::eigenvalues();
+        const auto& vectors = Base::eigenvectors();
+        const RealScalar tolerance = m_tolerance;
+        const RealScalar scale     = values.cwiseAbs().maxCoeff();
+
+        const RealScalar residual = (_m * vectors - vectors * values.asDiagonal()).cwiseAbs().maxCoeff();
+        const RealScalar orthogonality =
+            (vectors.adjoint() * vectors - MatrixType::Identity(_m.rows(), _m.cols())).cwiseAbs().maxCoeff();
+
+        return residual <= tolerance * scale && orthogonality <= tolerance;
+    }
+
+    /*! \brief Set the solving strategy used by #compute */
+    PONCA_MULTIARCH inline void setPolicy(EigenSolverPolicy _policy) { m_policy = _policy; }
+
+    /*! \brief Solving strategy used by #compute */
+    PONCA_MULTIARCH inline EigenSolverPolicy policy() const { return m_policy; }
+
+    /*! \brief Tell if the last call to #compute had to fall back to the iterative solver */
+    PONCA_MULTIARCH inline bool usedFallback() const { return m_usedFallback; }
+
+    /*! \brief Default tolerance of #isAccurate: `Eigen::NumTraits<RealScalar>::dummy_precision()`
+
+        This is the precision of Eigen fuzzy comparisons (e.g. `isApprox`): 1e-5 for `float` and 1e-12 for `double`,
+        i.e. about 100 and 4500 times the machine epsilon. The closed-form solution of well conditioned matrices
+        stays within a few epsilons of the iterative one, but loses significant digits when eigenvalues are close
+        or differ by orders of magnitude. With this tolerance, the closed form is kept as long as it preserves all
+        but the last two (`float`) or four (`double`) significant digits.
+     */
+    PONCA_MULTIARCH static inline RealScalar defaultTolerance()
+    { return Eigen::NumTraits<RealScalar>::dummy_precision(); }
+
+    /*! \brief Set the relative tolerance of #isAccurate, and thus when #DirectEigenSolverWithFallback falls back
+        to the iterative solver: smaller values favor accuracy, larger values favor the closed-form solution */
+    PONCA_MULTIARCH inline void setTolerance(RealScalar _tolerance) { m_tolerance = _tolerance; }
+
+    /*! \brief Relative tolerance of #isAccurate \see defaultTolerance */
+    PONCA_MULTIARCH inline RealScalar tolerance() const { return m_tolerance; }
+
+#ifdef PONCA_CPU_ARCH
+    /*! \brief Number of 3x3 matrices decomposed at once by #computeBatch */
+    static constexpr int BatchSize = 8;
+
+    /*! \brief Compute the eigen decomposition of `_count` matrices, each one with the policy of its solver
+
+        For 3x3 matrices, the closed-form solution of the solvers using #DirectEigenSolver or
+        #DirectEigenSolverWithFallback is evaluated on packets of #BatchSize matrices, stored one matrix per lane of
+        Eigen arrays, so that the arithmetic is vectorized across the matrices. The decompositions are then checked
+        by #isAccurate for #DirectEigenSolverWithFallback, and computed again by the iterative solver if needed.
+        Other sizes and policies are decomposed one matrix at a time by #compute.
+
+        The packet closed form follows the steps of `Eigen::SelfAdjointEigenSolver::computeDirect`: the results
+        match #compute up to rounding errors, and to the sign of the eigenvectors.
+
+        \param _matrices Matrices to decompose
+        \param _solvers Solvers storing the decomposition of the corresponding matrix
+        \param _count Number of matrices
+     */
+    static inline void computeBatch(const MatrixType* _matrices, SymmetricEigenSolver* _solvers, int _count)
+    {
+        if constexpr (MatrixType::RowsAtCompileTime == 3 && MatrixType::ColsAtCompileTime == 3)
+        {
+            int ids[BatchSize];
+            int n = 0;
+            for (int i = 0; i < _count; ++i)
+            {
+                if (_solvers[i].m_policy == IterativeEigenSolver)
+                {
+                    _solvers[i].compute(_matrices[i]);
+                    continue;
+                }
+                ids[n++] = i;
+                if (n == BatchSize)
+                {
+                    computeDirectPacket(_matrices, _solvers, ids, n);
+                    n = 0;
+                }
+            }
+            if (n > 0) computeDirectPacket(_matrices, _solvers, ids, n);
+        }
+        else
+        {
+            for (int i = 0; i < _count; ++i) _solvers[i].compute(_matrices[i]);
+        }
+    }
+#endif
+
+private:
+#ifdef PONCA_CPU_ARCH
+    using Packet    = Eigen::Array<RealScalar, BatchSize, 1>; /*!< \brief One coefficient per matrix */
+    using PacketVec = Eigen::Array<RealScalar, BatchSize, 3>; /*!< \brief One 3d vector per matrix (row) */
+
+    /// \brief Cross products of the vectors of each lane
+    static inline PacketVec cross(const PacketVec& _u, const PacketVec& _v)
+    {
+        PacketVec w;
+        w.col(0) = _u.col(1) * _v.col(2) - _u.col(2) * _v.col(1);
+        w.col(1) = _u.col(2) * _v.col(0) - _u.col(0) * _v.col(2);
+        w.col(2) = _u.col(0) * _v.col(1) - _u.col(1) * _v.col(0);
+        return w;
+    }
+
+    /// \brief Select the vector of `_a` for the lanes where `_mask` is true, of `_b` otherwise
+    template <typename Mask>
+    static inline PacketVec select(const Mask& _mask, const PacketVec& _a, const PacketVec& _b)
+    {
+        return _mask.template replicate<1, 3>().select(_a, _b);
+    }
+
+    /*! \brief Kernel of the rank 2 matrices \f$ \mathbf{A} - \lambda \mathbf{I} \f$, as the largest cross product
+        of their rows (see `extract_kernel` in Eigen) */
+    static inline PacketVec kernel(const Packet (&_a)[6], const Packet& _lambda)
+    {
+        PacketVec r0, r1, r2;
+        r0 << _a[0] - _lambda, _a[3], _a[4];
+        r1 << _a[3], _a[1] - _lambda, _a[5];
+        r2 << _a[4], _a[5], _a[2] - _lambda;
+        PacketVec best = cross(r0, r1);
+        Packet bestNorm = best.square().rowwise().sum();
+        for (const PacketVec& c : {cross(r0, r2), cross(r1, r2)})
+        {
+            const Packet norm = c.square().rowwise().sum();
+            best     = select(norm > bestNorm, c, best);
+            bestNorm = bestNorm.max(norm);
+        }
+        return best.colwise() / (bestNorm > RealScalar(0)).select(bestNorm.sqrt(), Packet::Ones());
+    }
+
+    /// \brief Closed-form decomposition of the matrices `_matrices[_ids[l]]` for the lanes `l < _n`
+    static inline void computeDirectPacket(const MatrixType* _matrices, SymmetricEigenSolver* _solvers,
+                                           const int* _ids, int _n)
+    {
+        const RealScalar epsilon = Eigen::NumTraits<RealScalar>::epsilon();
+
+        // Lower triangular coefficients a00, a11, a22, a10, a20, a21 (as computeDirect). Unused lanes repeat the
+        // first matrix.
+        Packet a[6];
+        for (int l = 0; l < BatchSize; ++l)
+        {
+            const MatrixType& m = _matrices[_ids[l < _n ? l : 0]];
+            a[0](l) = m(0, 0); a[1](l) = m(1, 1); a[2](l) = m(2, 2);
+            a[3](l) = m(1, 0); a[4](l) = m(2, 0); a[5](l) = m(2, 1);
+        }
+
+        // Shift and scale the matrices to avoid overflows and cancellations
+        const Packet shift = (a[0] + a[1] + a[2]) / RealScalar(3);
+        for (int c = 0; c < 3; ++c) a[c] -= shift;
+        Packet scale = a[0].abs();
+        for (int c = 1; c < 6; ++c) scale = scale.max(a[c].abs());
+        scale = (scale > RealScalar(0)).select(scale, Packet::Ones());
+        for (auto& c : a) c /= scale;
+
+        // Roots of the characteristic polynomial, sorted in increasing order
+        const Packet c0 = a[0] * a[1] * a[2] + RealScalar(2) * a[3] * a[4] * a[5]
+                        - a[0] * a[5].square() - a[1] * a[4].square() - a[2] * a[3].square();
+        const Packet c1 = a[0] * a[1] - a[3].square() + a[0] * a[2] - a[4].square() + a[1] * a[2] - a[5].square();
+        const Packet c2Over3 = (a[0] + a[1] + a[2]) / RealScalar(3);
+        const Packet aOver3 = ((c2Over3 * c2Over3 * RealScalar(3) - c1) / RealScalar(3)).max(RealScalar(0));
+        const Packet halfB = RealScalar(0.5) * (c0 + c2Over3 * (RealScalar(2) * c2Over3.square() - c1));
+        const Packet q = (aOver3.cube() - halfB.square()).max(RealScalar(0));
+        const Packet rho = aOver3.sqrt();
+        const Packet theta = q.sqrt().binaryExpr(halfB, [](RealScalar _y, RealScalar _x) {
+            using std::atan2;
+            return atan2(_y, _x);
+        }) / RealScalar(3);
+        const Packet cosTheta = theta.cos();
+        const Packet sinTheta = theta.sin();
+        const RealScalar sqrt3 = std::sqrt(RealScalar(3));
+        const Packet l0 = c2Over3 - rho * (cosTheta + sqrt3 * sinTheta);
+        const Packet l1 = c2Over3 - rho * (cosTheta - sqrt3 * sinTheta);
+        const Packet l2 = c2Over3 + RealScalar(2) * rho * cosTheta;
+
+        // Eigenvector of the most distinct eigenvalue, then of the other extreme eigenvalue, orthogonalized. The
+        // latter is any vector orthogonal to the former when the two other eigenvalues are the same.
+        const auto topFirst = (l2 - l1) > (l1 - l0);
+        const PacketVec k2 = kernel(a, l2);
+        const PacketVec k0 = kernel(a, l0);
+        const PacketVec first = select(topFirst, k2, k0);
+        PacketVec second = select(topFirst, k0, k2);
+        second -= first.colwise() * (first * second).rowwise().sum();
+        PacketVec orthogonal;
+        const auto useZ = first.col(2).abs() > first.col(0).abs().max(first.col(1).abs());
+        orthogonal << useZ.select(Packet::Zero(), -first.col(1)),
+                      useZ.select(-first.col(2), first.col(0)),
+                      useZ.select(first.col(1), Packet::Zero());
+        const Packet secondNorm = second.square().rowwise().sum();
+        second = select(secondNorm > epsilon, second, orthogonal);
+        second = second.colwise() / second.square().rowwise().sum().sqrt();
+
+        PacketVec v0 = select(topFirst, second, first);
+        PacketVec v2 = select(topFirst, first, second);
+        PacketVec v1 = cross(v2, v0);
+
+        // All the eigenvalues are the same: any basis is an eigen basis
+        const auto isotropic = (l2 - l0) <= epsilon;
+        PacketVec e0, e1, e2;
+        e0 << Packet::Ones(), Packet::Zero(), Packet::Zero();
+        e1 << Packet::Zero(), Packet::Ones(), Packet::Zero();
+        e2 << Packet::Zero(), Packet::Zero(), Packet::Ones();
+        v0 = select(isotropic, e0, v0);
+        v1 = select(isotropic, e1, v1);
+        v2 = select(isotropic, e2, v2);
+
+        for (int l = 0; l < _n; ++l)
+        {
+            SymmetricEigenSolver& solver = _solvers[_ids[l]];
+            solver.m_eivalues << l0(l), l1(l), l2(l);
+            solver.m_eivalues = (solver.m_eivalues.array() * scale(l) + shift(l)).matrix();
+            solver.m_eivec.col(0) = v0.row(l).transpose().matrix();
+            solver.m_eivec.col(1) = v1.row(l).transpose().matrix();
+            solver.m_eivec.col(2) = v2.row(l).transpose().matrix();
+            solver.m_info = Eigen::Success;
+            solver.m_isInitialized = true;
+            solver.m_eigenvectorsOk = true;
+            solver.m_usedFallback = false;
+            if (solver.m_policy == DirectEigenSolverWithFallback && ! solver.isAccurate(_matrices[_ids[l]]))
+            {
+                solver.Base::compute(_matrices[_ids[l]]);
+                solver.m_usedFallback = true;
+            }
+        }
+    }
+#endif
+
+    EigenSolverPolicy m_policy;         /*!< \brief Solving strategy */
+    bool m_usedFallback {false};        /*!< \brief Did the last decomposition fall back to the iterative solver */
+    RealScalar m_tolerance {defaultTolerance()}; /*!< \brief Relative tolerance of #isAccurate */
+}; // class SymmetricEigenSolver
+
+} //namespace Ponca
@@ -82,6 +82,23 @@ UnorientedSphereFitImpl<DataPoint, _WFunctor, T>::addLocalNeighbor(Scalar w,
     return false;
 }
 
+template<class DataPoint, class _WFunctor, typename T>
+template<int Size>
+int
+UnorientedSphereFitImpl<DataPoint, _WFunctor, T>::addLocalNeighbors(const NeighborPacket<DataPoint, Size>& packet,
+                                                                    const typename NeighborPacket<DataPoint, Size>::ScalarPacket& w,
+                                                                    const typename NeighborPacket<DataPoint, Size>::PositionPacket& localQ) {
+    const int nb = Base::addLocalNeighbors(packet, w, localQ);
+    // One column [n, n.q] per neighbor
+    const auto normals = packet.normals();
+    Eigen::Matrix<Scalar, DataPoint::Dim+1, Size> basis;
+    basis.template topRows<DataPoint::Dim>() = normals;
+    basis.row(DataPoint::Dim) = normals.cwiseProduct(localQ).colwise().sum();
+    m_matA     += (basis.array().rowwise() * w).matrix() * basis.transpose();
+    m_sumDotPP += (w * localQ.colwise().squaredNorm().array()).sum();
+    return nb;
+}
+
 template < class DataPoint, class _WFunctor, typename T>
 FIT_RESULT
 UnorientedSphereFitImpl<DataPoint, _WFunctor, T>::finalize ()
@@ -7,10 +7,40 @@
 #pragma once
 
 #include "./defines.h"
+#include "./neighborPacket.h"
+
+#include <Eigen/Core>
 #include PONCA_MULTIARCH_INCLUDE_CU_STD(utility)
+#include PONCA_MULTIARCH_INCLUDE_CU_STD(type_traits)
 
 namespace Ponca
 {
+
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    /// \brief Tell if a weight kernel can be evaluated from \f$ x^2 \f$, i.e. if it defines `f_sq`
+    template <typename WeightKernel, typename = void>
+    struct HasSquaredWeightKernel : PONCA_MULTIARCH_CU_STD_NAMESPACE(false_type) {};
+
+    template <typename WeightKernel>
+    struct HasSquaredWeightKernel<WeightKernel,
+        decltype(void(PONCA_MULTIARCH_CU_STD_NAMESPACE(declval)<const WeightKernel&>().f_sq(
+            PONCA_MULTIARCH_CU_STD_NAMESPACE(declval)<typename WeightKernel::Scalar>())))>
+        : PONCA_MULTIARCH_CU_STD_NAMESPACE(true_type) {};
+
+    /// \brief Tell if a weight kernel can be evaluated on a packet of values, i.e. if it defines `f(ArrayBase)`
+    template <typename WeightKernel, typename = void>
+    struct HasPacketWeightKernel : PONCA_MULTIARCH_CU_STD_NAMESPACE(false_type) {};
+
+    template <typename WeightKernel>
+    struct HasPacketWeightKernel<WeightKernel,
+        decltype(void(PONCA_MULTIARCH_CU_STD_NAMESPACE(declval)<const WeightKernel&>().f(
+            PONCA_MULTIARCH_CU_STD_NAMESPACE(declval)<Eigen::Array<typename WeightKernel::Scalar, 1, 4>>())))>
+        : PONCA_MULTIARCH_CU_STD_NAMESPACE(true_type) {};
+}
+#endif
+
 /*!
     \brief Weighting function based on the euclidean distance between a query and a reference position
 
@@ -19,6 +49,10 @@ namespace Ponca
 
     It can be specialized for any DataPoint and uses a generic 1D BaseWeightKernel.
 
+    When the kernel defines `f_sq` (see weightKernel.h), the weights are computed from the squared distances, without
+    square root nor division. In all cases, a query belongs to the support of the function if its squared distance to
+    the basis center is lower or equal to \f$ t^2 \f$.
+
     \warning it assumes that the evaluation scale t is strictly positive
 
     \todo Add class to use DistWeightFunc with CenterBasis of GlobalBasis
@@ -47,8 +81,15 @@ public:
         //\todo manage that assrt on __host__ and __device__
         //assert(_t > Scalar(0));
         m_t = _t;
+        m_t2 = _t * _t;
+        m_invT2 = Scalar(1.) / m_t2;
     }
 
+    /// \brief Tell if the weights are computed from squared distances (see WeightKernel::f_sq)
+    static constexpr bool isSquaredKernel = internal::HasSquaredWeightKernel<WeightKernel>::value;
+    /// \brief Tell if the weights of a packet of queries are computed at once (see #wPacket)
+    static constexpr bool isPacketKernel = internal::HasPacketWeightKernel<WeightKernel>::value;
+
     /*!
      * \brief Initialization method, called by the fitting procedure
      * @param _evalPos Basis center
@@ -85,6 +126,44 @@ public:
     PONCA_MULTIARCH inline WeightReturnType w(const VectorType& _q,
         const DataPoint&  /*attributes*/) const;
 
+    /*!
+        \brief Compute the weight of the given query, knowing its squared distance to the basis center
+
+        Same as #w, for queries whose squared distance has already been computed, e.g. by a spatial query centered on
+        the basis center (see KdTreeRangeIterator::squaredDistance).
+
+        \param _q Query in global coordinate
+        \param _sqDist Squared distance between the query and the basis center
+        \return The computed weight + the point expressed in local basis
+    */
+    PONCA_MULTIARCH inline WeightReturnType w(const VectorType& _q,
+        const DataPoint&  /*attributes*/, const Scalar& _sqDist) const;
+
+    /*!
+        \brief Compute the weight from the squared distance between a query and the basis center
+        \return 0 for queries outside the support of the function
+    */
+    PONCA_MULTIARCH inline Scalar squaredDistanceWeight(const Scalar& _sqDist) const;
+
+    /*!
+        \brief Compute the weights of a packet of queries
+
+        Packet counterpart of #w: the queries are converted to the local basis and their distances to the basis center
+        are computed for the whole packet at once, using a structure of arrays layout. When the kernel provides a
+        packet API (see #isPacketKernel), it is also evaluated for the whole packet at once.
+
+        All the lanes are evaluated, so unused lanes must hold finite positions (NeighborPacket ensures it). Their
+        weights are meaningless, and must be masked by the caller (see Basket::addNeighbors).
+
+        \param _q Queries in global coordinate, one column per query (see NeighborPacket::PositionPacket)
+        \param _weights Computed weights, one per query
+        \param _localQ Queries expressed in local basis, same layout as `_q`
+    */
+    template <int Size>
+    PONCA_MULTIARCH inline void wPacket(const Eigen::Matrix<Scalar, DataPoint::Dim, Size, Eigen::RowMajor>& _q,
+                                        Eigen::Array<Scalar, 1, Size>& _weights,
+                                        Eigen::Matrix<Scalar, DataPoint::Dim, Size, Eigen::RowMajor>& _localQ) const;
+
 
     /*!
         \brief First order derivative in space (for each spatial dimension \f$\mathsf{x})\f$
@@ -194,13 +273,28 @@ public:
     /*! \brief Access to the evaluation position set during the initialization */
     PONCA_MULTIARCH inline const VectorType & evalPos() const { return m_p; }
 
+    /*!
+        \brief Tell if two weighting functions compute the same weights, i.e. share the same scale and basis center
+
+        Used to share the weights between fits (see MultiBasket). Derived classes with additional parameters must
+        redefine it.
+    */
+    PONCA_MULTIARCH inline bool operator==(const DistWeightFunc& _other) const
+    { return m_t == _other.m_t && m_p == _other.m_p; }
+
 protected:
     Scalar       m_t;  /*!< \brief Evaluation scale */
+    Scalar       m_t2; /*!< \brief Squared evaluation scale */
+    Scalar       m_invT2; /*!< \brief Inverse of the squared evaluation scale */
     WeightKernel m_wk; /*!< \brief 1D function applied to weight queries */
     VectorType   m_p;  /*!< \brief basis center */
 
 };// class DistWeightFunc
 
+/// \brief Packets of neighbors are weighted at once by DistWeightFunc::wPacket
+template <class DataPoint, class WeightKernel>
+struct UsePacketWeights<DistWeightFunc<DataPoint, WeightKernel>> : PONCA_MULTIARCH_CU_STD_NAMESPACE(true_type) {};
+
 #include "weightFunc.hpp"
 
 }// namespace Ponca
@@ -18,8 +18,66 @@ DistWeightFunc<DataPoint, WeightKernel>::w( const VectorType& _q,
 					                        const DataPoint&) const
 {
     VectorType q = convertToLocalBasis(_q);
-    Scalar d  = q.norm();
-    return { (d <= m_t) ? m_wk.f(d/m_t) : Scalar(0.), q };
+    return { squaredDistanceWeight(q.squaredNorm()), q };
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::WeightReturnType
+DistWeightFunc<DataPoint, WeightKernel>::w( const VectorType& _q,
+                                            const DataPoint&,
+                                            const Scalar& _sqDist) const
+{
+    return { squaredDistanceWeight(_sqDist), convertToLocalBasis(_q) };
+}
+
+template <class DataPoint, class WeightKernel>
+typename DistWeightFunc<DataPoint, WeightKernel>::Scalar
+DistWeightFunc<DataPoint, WeightKernel>::squaredDistanceWeight(const Scalar& _sqDist) const
+{
+    if (_sqDist > m_t2) return Scalar(0.);
+    if constexpr (isSquaredKernel)
+        return m_wk.f_sq(_sqDist * m_invT2);
+    else
+    {
+        PONCA_MULTIARCH_STD_MATH(sqrt);
+        return m_wk.f(sqrt(_sqDist) / m_t);
+    }
+}
+
+template <class DataPoint, class WeightKernel>
+template <int Size>
+void
+DistWeightFunc<DataPoint, WeightKernel>::wPacket( const Eigen::Matrix<Scalar, DataPoint::Dim, Size, Eigen::RowMajor>& _q,
+                                                  Eigen::Array<Scalar, 1, Size>& _weights,
+                                                  Eigen::Matrix<Scalar, DataPoint::Dim, Size, Eigen::RowMajor>& _localQ) const
+{
+    _localQ = _q.colwise() - m_p;
+
+    // Distances are computed per query with VectorType::squaredNorm: the reduction order must match #w to get exactly
+    // the same weights, and thus the same fits, than neighbor-by-neighbor accumulation
+    if constexpr (isPacketKernel)
+    {
+        Eigen::Array<Scalar, 1, Size> d2;
+        for (int i = 0; i < Size; ++i)
+            d2(i) = VectorType(_localQ.col(i)).squaredNorm();
+
+        if constexpr (isSquaredKernel)
+            _weights = (d2 <= m_t2).select(m_wk.f_sq(d2 * m_invT2), Scalar(0.));
+        else
+        {
+            // Scalar square roots, as Eigen vectorized version may be approximated (see EIGEN_FAST_MATH)
+            PONCA_MULTIARCH_STD_MATH(sqrt);
+            Eigen::Array<Scalar, 1, Size> d;
+            for (int i = 0; i < Size; ++i)
+                d(i) = sqrt(d2(i));
+            _weights = (d2 <= m_t2).select(m_wk.f(d / m_t), Scalar(0.));
+        }
+    }
+    else
+    {
+        for (int i = 0; i < Size; ++i)
+            _weights(i) = squaredDistanceWeight(VectorType(_localQ.col(i)).squaredNorm());
+    }
 }
 
 template <class DataPoint, class WeightKernel>
@@ -8,8 +8,16 @@
 
 #include "./defines.h"
 
+#include <Eigen/Core>
+
 /*!
     \file weightKernel.h Define 1D weight kernel functors
+
+    Kernels that can be evaluated without computing \f$ x \f$ also define `f_sq`, which takes \f$ x^2 \f$ as input.
+    When available, it is used by DistWeightFunc to compute the weights from squared distances.
+
+    Kernels also define packet versions of `f` (and `f_sq`), taking an Eigen array of values as input. They are used by
+    DistWeightFunc::wPacket to weight several neighbors at once.
 */
 
 
@@ -36,6 +44,16 @@ public:
     // Functor
     //! \brief Return the constant value
     PONCA_MULTIARCH inline Scalar f  (const Scalar&) const { return m_y; }
+    //! \brief Return the constant value, from \f$ x^2 \f$
+    PONCA_MULTIARCH inline Scalar f_sq(const Scalar&) const { return m_y; }
+    //! \brief Packet version of #f
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f(const Eigen::ArrayBase<Derived>& _x) const {
+        return Derived::PlainObject::Constant(_x.rows(), _x.cols(), m_y);
+    }
+    //! \brief Packet version of #f_sq
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f_sq(const Eigen::ArrayBase<Derived>& _x2) const { return f(_x2); }
     //! \brief Return \f$ 0 \f$
     PONCA_MULTIARCH inline Scalar df (const Scalar&) const { return Scalar(0.); }
     //! \brief Return \f$ 0 \f$
@@ -53,7 +71,8 @@ private:
 
 /*!
     \brief Smooth WeightKernel defined in \f$\left[0 : 1\right]\f$
-    \todo Add a degree value as template parameter (in this class or another one), with specialized functions for 2
+
+    \see PolynomialWeightKernel for other degrees
 
     \inherit Concept::WeightKernelConcept
 */
@@ -67,6 +86,19 @@ public:
     // Functor
     /*! \brief Defines the smooth weighting function \f$ w(x) = (x^2-1)^2 \f$ */
     PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const { Scalar v = _x*_x - Scalar(1.); return v*v; }
+    /*! \brief Defines the smooth weighting function from \f$ x^2 \f$: \f$ w(x) = (x^2-1)^2 \f$ */
+    PONCA_MULTIARCH inline Scalar f_sq(const Scalar& _x2) const { Scalar v = _x2 - Scalar(1.); return v*v; }
+    //! \brief Packet version of #f
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f(const Eigen::ArrayBase<Derived>& _x) const {
+        return f_sq(_x.square());
+    }
+    //! \brief Packet version of #f_sq
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f_sq(const Eigen::ArrayBase<Derived>& _x2) const {
+        const typename Derived::PlainObject v = _x2 - Scalar(1.);
+        return v*v;
+    }
     /*! \brief Defines the smooth first order weighting function \f$ \nabla w(x) = 4x(x^2-1) \f$ */
     PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const { return Scalar(4.)*_x*(_x*_x-Scalar(1.)); }
     /*! \brief Defines the smooth second order weighting function \f$ \nabla^2 w(x) = 12x^2-4 \f$ */
@@ -99,6 +131,12 @@ public:
         const Scalar v = Scalar(1.) - _x;
         return v * v * v * v * ((Scalar(4.) * _x) + Scalar(1.));
     }
+    //! \brief Packet version of #f
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f(const Eigen::ArrayBase<Derived>& _x) const {
+        const typename Derived::PlainObject v = Scalar(1.) - _x;
+        return v * v * v * v * ((Scalar(4.) * _x) + Scalar(1.));
+    }
     /*! \brief Defines the Wendland first order weighting function \f$ \nabla w(x) = 20x * (x−1)^3 \f$ */
     PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const {
         const Scalar v = _x - Scalar(1.);
@@ -136,6 +174,20 @@ public:
     PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const {
         return Scalar(1.) / (_x * _x);
     }
+    /*! \brief Defines the Singular weighting function from \f$ x^2 \f$: \f$ w(x) = 1 / (x^2) \f$ */
+    PONCA_MULTIARCH inline Scalar f_sq(const Scalar& _x2) const {
+        return Scalar(1.) / _x2;
+    }
+    //! \brief Packet version of #f
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f(const Eigen::ArrayBase<Derived>& _x) const {
+        return f_sq(_x.square());
+    }
+    //! \brief Packet version of #f_sq
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f_sq(const Eigen::ArrayBase<Derived>& _x2) const {
+        return _x2.inverse();
+    }
     /*! \brief Defines the Singular first order weighting function \f$ \nabla w(x) = -2 / (x^3) \f$ */
     PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const {
         return Scalar(-2.) / (_x * _x * _x);
@@ -172,6 +224,19 @@ public:
      *  \see https://www.wolframalpha.com/input?i=e%5E%28-x%5E2%2F%281+-+x%5E2%29%29&assumption=%22ClashPrefs%22+-%3E+%7B%22Math%22%7D
      */
     PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const { Scalar v = _x*_x; return exp(-v/(Scalar(1)-v)); }
+    /*! \brief Defines the smooth weighting function from \f$ x^2 \f$: \f$ w(x) = e^{-\frac{x^2}{1 - x^2}} \f$ */
+    PONCA_MULTIARCH inline Scalar f_sq(const Scalar& _x2) const { return exp(-_x2/(Scalar(1)-_x2)); }
+    //! \brief Packet version of #f
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f(const Eigen::ArrayBase<Derived>& _x) const {
+        return f_sq(_x.square());
+    }
+    //! \brief Packet version of #f_sq
+    //! \note Uses Eigen vectorized exponential: results may differ from #f_sq by a few ulps
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f_sq(const Eigen::ArrayBase<Derived>& _x2) const {
+        return (-_x2 / (Scalar(1) - _x2)).exp();
+    }
     /*! \brief Defines the smooth first order weighting function \f$ \nabla w(x) = -\frac{2 x e^{\frac{x^2}{x^2 - 1}}}{(1 - x^2)^2} \f$
      * \see https://www.wolframalpha.com/input?i2d=true&i=+-Divide%5B%5C%2840%292+Power%5Be%2C%5C%2840%29Power%5Bx%2CDivide%5B2%2C%5C%2840%29Power%5Bx%2C2%5D+-+1%5C%2841%29%5D%5D%5C%2841%29%5D+x%5C%2841%29%2CPower%5B%5C%2840%291+-+Power%5Bx%2C2%5D%5C%2841%29%2C2%5D%5D
      */
@@ -195,4 +260,90 @@ public:
 };//class CompactExpWeightKernel
 
 
+/*!
+    \brief Polynomial WeightKernel defined in \f$\left[0 : 1\right]\f$, of the form \f$ w(x) = (1-x^2)^n \f$
+
+    The polynomial is expanded in \f$ y = x^2 \f$: \f$ w(x) = \sum_{k=0}^{n} (-1)^k \binom{n}{k} y^k \f$, with
+    coefficients computed at compile time, and evaluated using the Horner scheme. Derivatives are evaluated the same
+    way, from the coefficients of the derivative polynomials.
+
+    `PolynomialWeightKernel<Scalar, 2>` defines the same function than SmoothWeightKernel.
+
+    \inherit Concept::WeightKernelConcept
+
+    \tparam _Scalar Scalar type
+    \tparam _Degree Degree \f$ n \ge 1 \f$ of the polynomial, expressed in \f$ x^2 \f$.
+    The kernel is \f$ C^{n-1} \f$ at \f$ x=1 \f$.
+*/
+template <typename _Scalar, int _Degree>
+class PolynomialWeightKernel
+{
+public:
+    /*! \brief Scalar type defined outside the class*/
+    typedef _Scalar Scalar;
+    /*! \brief Degree of the polynomial in \f$ x^2 \f$ */
+    static constexpr int Degree = _Degree;
+    static_assert(Degree >= 1, "Use ConstantWeightKernel for degree 0");
+
+    /*! \brief Coefficient of \f$ y^k \f$ in the expansion of \f$ (1-y)^n \f$, i.e. \f$ (-1)^k \binom{n}{k} \f$ */
+    PONCA_MULTIARCH static constexpr Scalar coefficient(int _k) {
+        Scalar c = Scalar(1);
+        for (int i = 1; i <= _k; ++i)
+            c = -c * Scalar(Degree - i + 1) / Scalar(i);
+        return c;
+    }
+
+    // Functor
+    /*! \brief Defines the polynomial weighting function \f$ w(x) = (1-x^2)^n \f$ */
+    PONCA_MULTIARCH inline Scalar f  (const Scalar& _x) const { return f_sq(_x*_x); }
+    /*! \brief Defines the polynomial weighting function from \f$ x^2 \f$ */
+    PONCA_MULTIARCH inline Scalar f_sq(const Scalar& _x2) const { return horner<0, Scalar>(_x2); }
+    /*! \brief Defines the first order weighting function \f$ \nabla w(x) = \sum_{k=1}^{n} 2k c_k x^{2k-1} \f$ */
+    PONCA_MULTIARCH inline Scalar df (const Scalar& _x) const { return _x * horner<1, Scalar>(_x*_x); }
+    /*! \brief Defines the second order weighting function \f$ \nabla^2 w(x) = \sum_{k=1}^{n} 2k(2k-1) c_k x^{2k-2} \f$ */
+    PONCA_MULTIARCH inline Scalar ddf(const Scalar& _x) const { return horner<2, Scalar>(_x*_x); }
+
+    //! \brief Packet version of #f
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f(const Eigen::ArrayBase<Derived>& _x) const {
+        return f_sq(_x.square());
+    }
+    //! \brief Packet version of #f_sq
+    template <typename Derived>
+    PONCA_MULTIARCH inline typename Derived::PlainObject f_sq(const Eigen::ArrayBase<Derived>& _x2) const {
+        return horner<0>(typename Derived::PlainObject(_x2));
+    }
+
+    //! \brief #df is defined and valid on the definition interval
+    static constexpr bool isDValid = true;
+    //! \brief #ddf is defined and valid on the definition interval
+    static constexpr bool isDDValid = true;
+
+private:
+    /*! \brief Coefficients of the polynomials in \f$ y \f$ evaluated by #horner: \f$ w \f$ (`Order=0`),
+        \f$ \nabla w / x \f$ (`Order=1`) and \f$ \nabla^2 w \f$ (`Order=2`) */
+    template <int Order>
+    PONCA_MULTIARCH static constexpr Scalar hornerCoefficient(int _k) {
+        return Order == 0 ? coefficient(_k) :
+               Order == 1 ? Scalar(2 * _k) * coefficient(_k) :
+                            Scalar(2 * _k * (2 * _k - 1)) * coefficient(_k);
+    }
+
+    /// \brief Evaluate the polynomial of coefficients #hornerCoefficient at `_y`, using the Horner scheme
+    template <int Order, typename T>
+    PONCA_MULTIARCH static inline T horner(const T& _y) {
+        constexpr int first = Order == 0 ? 0 : 1; // derivatives do not depend on the constant coefficient
+        if constexpr (Degree == first)
+            return T(hornerCoefficient<Order>(first));
+        else
+        {
+            T r = _y * hornerCoefficient<Order>(Degree) + hornerCoefficient<Order>(Degree - 1);
+            for (int k = Degree - 2; k >= first; --k)
+                r = r * _y + hornerCoefficient<Order>(k);
+            return r;
+        }
+    }
+};//class PolynomialWeightKernel
+
+
 }// namespace Ponca
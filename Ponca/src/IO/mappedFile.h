@@ -0,0 +1,150 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace Ponca {
+
+/*!
+ * \brief Read-only memory mapping of a file
+ *
+ * The content of the file is paged in by the operating system when it is accessed, without being copied in user
+ * buffers. The mapping is released when the object is destroyed.
+ *
+ * \code
+ * MappedFile file;
+ * if (! file.open("cloud.ply")) std::cerr << file.errorMessage();
+ * const char* bytes = file.data();
+ * \endcode
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    inline ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline MappedFile(MappedFile&& other) noexcept { swap(other); }
+    inline MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other) { close(); swap(other); }
+        return *this;
+    }
+
+    /// \brief Map the file at `path`, return false on failure (see errorMessage)
+    inline bool open(const std::string& path)
+    {
+        close();
+#if defined(_WIN32)
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return fail("Cannot open " + path);
+        LARGE_INTEGER size;
+        if (! GetFileSizeEx(m_file, &size)) return fail("Cannot read the size of " + path);
+        m_size = std::size_t(size.QuadPart);
+        if (m_size == 0) return true;
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr) return fail("Cannot map " + path);
+        m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr) return fail("Cannot map " + path);
+#else
+        m_fd = ::open(path.c_str(), O_RDONLY);
+        if (m_fd < 0) return fail("Cannot open " + path);
+        struct stat st;
+        if (fstat(m_fd, &st) != 0) return fail("Cannot read the size of " + path);
+        m_size = std::size_t(st.st_size);
+        if (m_size == 0) return true;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (data == MAP_FAILED) return fail("Cannot map " + path);
+        m_data = static_cast<const char*>(data);
+        // Files are mostly read sequentially, from several threads
+        madvise(data, m_size, MADV_SEQUENTIAL);
+#endif
+        return true;
+    }
+
+    /// \brief Release the mapping
+    inline void close()
+    {
+#if defined(_WIN32)
+        if (m_data != nullptr) UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file    = INVALID_HANDLE_VALUE;
+#else
+        if (m_data != nullptr) munmap(const_cast<char*>(m_data), m_size);
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    /// \brief First byte of the file, nullptr if the file is not mapped or empty
+    inline const char* data() const { return m_data; }
+    /// \brief Size of the file, in bytes
+    inline std::size_t size() const { return m_size; }
+    /// \brief Tell if a file is open
+#if defined(_WIN32)
+    inline bool isOpen() const { return m_file != INVALID_HANDLE_VALUE; }
+#else
+    inline bool isOpen() const { return m_fd >= 0; }
+#endif
+    /// \brief Description of the last error
+    inline const std::string& errorMessage() const { return m_error; }
+
+private:
+    inline bool fail(std::string message)
+    {
+        close();
+        m_error = std::move(message);
+        return false;
+    }
+
+    inline void swap(MappedFile& other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_error, other.m_error);
+#if defined(_WIN32)
+        std::swap(m_file, other.m_file);
+        std::swap(m_mapping, other.m_mapping);
+#else
+        std::swap(m_fd, other.m_fd);
+#endif
+    }
+
+    const char* m_data {nullptr};
+    std::size_t m_size {0};
+    std::string m_error;
+#if defined(_WIN32)
+    HANDLE m_file {INVALID_HANDLE_VALUE};
+    HANDLE m_mapping {nullptr};
+#else
+    int m_fd {-1};
+#endif
+};
+
+} // namespace Ponca
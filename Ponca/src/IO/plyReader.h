@@ -0,0 +1,197 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./mappedFile.h"
+#include "./stridedView.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Ponca {
+
+/*!
+ * \brief Reader of PLY files, exposing the properties of the elements as strided views
+ *
+ * The file is memory mapped (see MappedFile):
+ *  - for binary files (little or big endian), the views directly refer to the mapped file, so that opening a file
+ *    only costs the parsing of its header, and the data is read from the disk when it is accessed;
+ *  - for ASCII files, the elements are parsed in parallel chunks (see setExecutor) when the file is opened, and
+ *    stored in buffers with the binary layout of the properties.
+ *
+ * Elements with list properties (e.g. the faces of meshes) are skipped: their properties cannot be exposed as strided
+ * views.
+ *
+ * \code
+ * PlyReader ply;
+ * if (! ply.open("bunny.ply"))
+ *     std::cerr << ply.errorMessage() << std::endl;
+ * StridedView<float> intensity = ply.field<float>("vertex", "intensity");
+ *
+ * KdTreeDense<MyPoint> tree;
+ * tree.build(ply.points<MyPoint::Scalar, 3>(), PointViewConverter());
+ * \endcode
+ *
+ * \warning Views returned by the reader must not be used after the reader is closed or destroyed.
+ */
+class PlyReader
+{
+public:
+    /// \brief Encoding of the data
+    enum class Format { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+    /// \brief Property of an element
+    struct Property
+    {
+        std::string name;
+        IOScalarType type {IOScalarType::Invalid};         ///< Type of the values (of the list items for lists)
+        bool isList {false};
+        IOScalarType countType {IOScalarType::Invalid};    ///< Type of the size of the lists
+        std::size_t offset {0};                            ///< Offset of the property in the element, in bytes
+    };
+
+    /// \brief Element of the file (e.g. `vertex`, `face`), with its properties
+    struct Element
+    {
+        std::string name;
+        std::size_t count {0};                             ///< Number of items
+        std::vector<Property> properties;
+        std::size_t stride {0};                            ///< Size of an item, in bytes (0 for elements with lists)
+        const char* data {nullptr};                        ///< First item, nullptr for elements with lists
+
+        inline bool hasLists() const
+        {
+            return std::any_of(properties.begin(), properties.end(), [](const Property& p) { return p.isList; });
+        }
+        inline const Property* property(const std::string& n) const
+        {
+            for (const auto& p : properties) if (p.name == n) return &p;
+            return nullptr;
+        }
+    };
+
+    PlyReader() = default;
+    PlyReader(const PlyReader&) = delete;
+    PlyReader& operator=(const PlyReader&) = delete;
+    PlyReader(PlyReader&&) = default;
+    PlyReader& operator=(PlyReader&&) = default;
+
+    /// \brief Open the file at `path`, return false on failure (see errorMessage)
+    inline bool open(const std::string& path);
+
+    /// \brief Close the file, invalidating the views
+    inline void close()
+    {
+        m_file.close();
+        m_elements.clear();
+        m_comments.clear();
+        m_buffers.clear();
+    }
+
+    /// \brief Set the executor parsing ASCII files in #open, or nullptr to use defaultExecutor()
+    inline void setExecutor(Executor* _executor) { m_executor = _executor; }
+
+    inline bool isOpen() const { return m_file.isOpen(); }
+    inline Format format() const { return m_format; }
+    inline const std::vector<Element>& elements() const { return m_elements; }
+    inline const std::vector<std::string>& comments() const { return m_comments; }
+    inline const std::string& errorMessage() const { return m_error; }
+
+    /// \brief Element called `name`, nullptr if there is no such element
+    inline const Element* element(const std::string& name) const
+    {
+        for (const auto& e : m_elements) if (e.name == name) return &e;
+        return nullptr;
+    }
+
+    /// \brief Number of vertices
+    inline std::size_t vertexCount() const
+    {
+        const Element* e = element("vertex");
+        return e == nullptr ? 0 : e->count;
+    }
+
+    /// \brief Tell if the non-list property `property` of the element `element` can be read
+    inline bool hasField(const std::string& element, const std::string& property) const
+    {
+        const Element* e = this->element(element);
+        if (e == nullptr || e->data == nullptr) return false;
+        const Property* p = e->property(property);
+        return p != nullptr && ! p->isList;
+    }
+
+    /// \brief View on the property `property` of the element `element`, empty if hasField is false
+    template <typename T>
+    inline StridedView<T> field(const std::string& element, const std::string& property) const
+    {
+        if (! hasField(element, property)) return {};
+        const Element* e = this->element(element);
+        const Property* p = e->property(property);
+        const bool swap = m_format != Format::Ascii && (m_format == Format::BinaryBigEndian) == ioHostIsLittleEndian();
+        return StridedView<T>(e->data + p->offset, e->count, e->stride, p->type, swap);
+    }
+
+    /*!
+     * \brief Positions (properties `x`, `y`, `z`) and normals (`nx`, `ny`, `nz`) of the vertices
+     *
+     * The normals are only set when the three normal properties exist. The view is empty if the positions are missing.
+     */
+    template <typename Scalar, int Dim = 3>
+    inline PointView<Scalar, Dim> points() const
+    {
+        static_assert(Dim >= 1 && Dim <= 3, "PLY files store up to 3 coordinates");
+        static const char* positionNames[] = {"x", "y", "z"};
+        static const char* normalNames[]   = {"nx", "ny", "nz"};
+
+        PointView<Scalar, Dim> res;
+        bool hasPositions = true, hasNormals = true;
+        for (int d = 0; d < Dim; ++d)
+        {
+            hasPositions &= hasField("vertex", positionNames[d]);
+            hasNormals   &= hasField("vertex", normalNames[d]);
+        }
+        if (! hasPositions) return res;
+        for (int d = 0; d < Dim; ++d)
+        {
+            res.positions[d] = field<Scalar>("vertex", positionNames[d]);
+            if (hasNormals) res.normals[d] = field<Scalar>("vertex", normalNames[d]);
+        }
+        return res;
+    }
+
+private:
+    inline bool fail(std::string message)
+    {
+        close();
+        m_error = std::move(message);
+        return false;
+    }
+
+    inline bool parseHeader(std::size_t& headerSize);
+    inline bool locateBinary(std::size_t headerSize);
+    inline bool parseAscii(std::size_t headerSize);
+
+    MappedFile m_file;
+    Format m_format {Format::Ascii};
+    std::vector<Element> m_elements;
+    std::vector<std::string> m_comments;
+    std::vector<std::vector<char>> m_buffers;   ///< Parsed elements of ASCII files
+    std::string m_error;
+    Executor* m_executor {nullptr};
+};
+
+#include "./plyReader.hpp"
+
+} // namespace Ponca
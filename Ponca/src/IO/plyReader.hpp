@@ -0,0 +1,334 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+namespace internal
+{
+    /// \brief Binary representation of a PLY property type, Invalid for unknown names
+    inline IOScalarType plyScalarType(const std::string& name)
+    {
+        if (name == "char"   || name == "int8")    return IOScalarType::Int8;
+        if (name == "uchar"  || name == "uint8")   return IOScalarType::UInt8;
+        if (name == "short"  || name == "int16")   return IOScalarType::Int16;
+        if (name == "ushort" || name == "uint16")  return IOScalarType::UInt16;
+        if (name == "int"    || name == "int32")   return IOScalarType::Int32;
+        if (name == "uint"   || name == "uint32")  return IOScalarType::UInt32;
+        if (name == "float"  || name == "float32") return IOScalarType::Float32;
+        if (name == "double" || name == "float64") return IOScalarType::Float64;
+        return IOScalarType::Invalid;
+    }
+
+    /// \brief Read an unsigned integer of type `t` (e.g. the size of a list) at `p`
+    inline std::size_t readPlyCount(const char* p, IOScalarType t, bool swap)
+    {
+        const double v = StridedView<double>(p, 1, 0, t, swap)[0];
+        return v > 0 ? std::size_t(v) : 0;
+    }
+
+    /// \brief Store `v` at `p` with the binary representation `t` of the host
+    inline void writePlyValue(char* p, IOScalarType t, double v)
+    {
+        auto write = [p](auto value) { std::memcpy(p, &value, sizeof(value)); };
+        switch (t)
+        {
+            case IOScalarType::Int8:    write(std::int8_t(v));   break;
+            case IOScalarType::UInt8:   write(std::uint8_t(v));  break;
+            case IOScalarType::Int16:   write(std::int16_t(v));  break;
+            case IOScalarType::UInt16:  write(std::uint16_t(v)); break;
+            case IOScalarType::Int32:   write(std::int32_t(v));  break;
+            case IOScalarType::UInt32:  write(std::uint32_t(v)); break;
+            case IOScalarType::Float32: write(float(v));         break;
+            case IOScalarType::Float64: write(v);                break;
+            default: break;
+        }
+    }
+
+    /*!
+     * \brief Parse the number starting at `p` (after spaces), without reading past `end`
+     *
+     * Accepts integers and decimal numbers with an optional exponent, as written by PLY exporters. `p` is moved after
+     * the number. Contrary to `strtod`, the parser does not require a null-terminated string, and thus can read
+     * directly from the mapped file.
+     */
+    inline bool parseAsciiNumber(const char*& p, const char* end, double& out)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        if (p == end) return false;
+
+        bool negative = false;
+        if (*p == '-' || *p == '+') { negative = *p == '-'; ++p; }
+
+        double mantissa = 0;
+        int exponent    = 0;
+        bool hasDigits  = false;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p, hasDigits = true) mantissa = mantissa * 10 + (*p - '0');
+        if (p < end && *p == '.')
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p, hasDigits = true)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                --exponent;
+            }
+        if (! hasDigits)
+        {
+            // Special values written by some exporters
+            auto match = [&p, end](const char* word) {
+                const std::size_t n = std::strlen(word);
+                if (std::size_t(end - p) < n || std::strncmp(p, word, n) != 0) return false;
+                p += n;
+                return true;
+            };
+            if (match("nan") || match("NaN")) { out = std::numeric_limits<double>::quiet_NaN(); return true; }
+            if (match("inf") || match("Inf")) { out = negative ? -std::numeric_limits<double>::infinity()
+                                                               :  std::numeric_limits<double>::infinity(); return true; }
+            return false;
+        }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char* e = p + 1;
+            bool negativeExponent = false;
+            if (e < end && (*e == '-' || *e == '+')) { negativeExponent = *e == '-'; ++e; }
+            if (e < end && *e >= '0' && *e <= '9')
+            {
+                int value = 0;
+                for (; e < end && *e >= '0' && *e <= '9'; ++e) value = std::min(value * 10 + (*e - '0'), 100000);
+                exponent += negativeExponent ? -value : value;
+                p = e;
+            }
+        }
+        // Values with many digits may lose the last bit of precision compared to strtod, which is fine for
+        // coordinates and attributes
+        out = exponent >= 0 ? mantissa * std::pow(10., exponent) : mantissa / std::pow(10., -exponent);
+        if (negative) out = -out;
+        return true;
+    }
+} // namespace internal
+
+bool PlyReader::open(const std::string& path)
+{
+    close();
+    m_error.clear();
+    if (! m_file.open(path)) return fail(m_file.errorMessage());
+
+    std::size_t headerSize = 0;
+    if (! parseHeader(headerSize)) return false;
+    return m_format == Format::Ascii ? parseAscii(headerSize) : locateBinary(headerSize);
+}
+
+bool PlyReader::parseHeader(std::size_t& headerSize)
+{
+    const char* begin = m_file.data();
+    const char* end   = begin + m_file.size();
+    if (m_file.size() < 4 || std::strncmp(begin, "ply", 3) != 0 || (begin[3] != '\n' && begin[3] != '\r'))
+        return fail("Not a PLY file");
+
+    // The header is small: copy it to parse it with a stream
+    const char* endHeader = nullptr;
+    for (const char* p = begin; p < end; )
+    {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+        if (eol == nullptr) break;
+        if (eol - p >= 10 && std::strncmp(p, "end_header", 10) == 0) { endHeader = eol + 1; break; }
+        p = eol + 1;
+    }
+    if (endHeader == nullptr) return fail("Missing end_header in PLY file");
+    headerSize = std::size_t(endHeader - begin);
+
+    std::istringstream header(std::string(begin, endHeader));
+    std::string line;
+    bool hasFormat = false;
+    std::getline(header, line); // ply
+    while (std::getline(header, line))
+    {
+        if (! line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+        if (keyword == "format")
+        {
+            std::string format, version;
+            tokens >> format >> version;
+            if (format == "ascii")                     m_format = Format::Ascii;
+            else if (format == "binary_little_endian") m_format = Format::BinaryLittleEndian;
+            else if (format == "binary_big_endian")    m_format = Format::BinaryBigEndian;
+            else return fail("Unknown PLY format: " + format);
+            hasFormat = true;
+        }
+        else if (keyword == "comment" || keyword == "obj_info")
+        {
+            const auto start = line.find_first_not_of(" \t", keyword.size());
+            m_comments.push_back(start == std::string::npos ? std::string() : line.substr(start));
+        }
+        else if (keyword == "element")
+        {
+            Element e;
+            long long count = -1;
+            tokens >> e.name >> count;
+            if (e.name.empty() || count < 0) return fail("Invalid PLY element declaration: " + line);
+            e.count = std::size_t(count);
+            m_elements.push_back(std::move(e));
+        }
+        else if (keyword == "property")
+        {
+            if (m_elements.empty()) return fail("PLY property declared before any element: " + line);
+            Property p;
+            std::string type;
+            tokens >> type;
+            if (type == "list")
+            {
+                std::string countType;
+                tokens >> countType >> type;
+                p.isList    = true;
+                p.countType = internal::plyScalarType(countType);
+                if (p.countType == IOScalarType::Invalid) return fail("Unknown PLY type: " + countType);
+            }
+            p.type = internal::plyScalarType(type);
+            tokens >> p.name;
+            if (p.type == IOScalarType::Invalid) return fail("Unknown PLY type: " + type);
+            if (p.name.empty()) return fail("Invalid PLY property declaration: " + line);
+            m_elements.back().properties.push_back(std::move(p));
+        }
+        else if (keyword == "end_header")
+            break;
+        else if (! keyword.empty())
+            return fail("Unknown PLY header keyword: " + keyword);
+    }
+    if (! hasFormat) return fail("Missing format in PLY header");
+
+    // Layout of the items of fixed-size elements
+    for (auto& e : m_elements)
+    {
+        if (e.hasLists()) continue;
+        for (auto& p : e.properties)
+        {
+            p.offset = e.stride;
+            e.stride += ioScalarSize(p.type);
+        }
+    }
+    return true;
+}
+
+bool PlyReader::locateBinary(std::size_t headerSize)
+{
+    const bool swap = (m_format == Format::BinaryBigEndian) == ioHostIsLittleEndian();
+    const char* begin = m_file.data();
+    std::size_t pos = headerSize;
+    for (std::size_t ei = 0; ei != m_elements.size(); ++ei)
+    {
+        Element& e = m_elements[ei];
+        if (! e.hasLists())
+        {
+            // e.count comes from the header: compare without multiplying, which could overflow
+            if (e.stride > 0 && e.count > (m_file.size() - pos) / e.stride)
+                return fail("Truncated PLY file, in element " + e.name);
+            e.data = begin + pos;
+            pos += e.count * e.stride;
+            continue;
+        }
+        // Items of elements with lists have different sizes, and must be scanned to locate the next elements
+        if (ei + 1 == m_elements.size()) break;
+        for (std::size_t i = 0; i != e.count; ++i)
+            for (const auto& p : e.properties)
+            {
+                const std::size_t valueSize = ioScalarSize(p.type);
+                if (! p.isList)
+                {
+                    if (valueSize > m_file.size() - pos) return fail("Truncated PLY file, in element " + e.name);
+                    pos += valueSize;
+                    continue;
+                }
+                const std::size_t countSize = ioScalarSize(p.countType);
+                if (countSize > m_file.size() - pos) return fail("Truncated PLY file, in element " + e.name);
+                const std::size_t n = internal::readPlyCount(begin + pos, p.countType, swap);
+                pos += countSize;
+                if (n * valueSize > m_file.size() - pos) return fail("Truncated PLY file, in element " + e.name);
+                pos += n * valueSize;
+            }
+    }
+    return true;
+}
+
+bool PlyReader::parseAscii(std::size_t headerSize)
+{
+    // In ASCII files, each item is stored on its own line.
+    // Newlines are first counted in parallel chunks of the body of the file, so that each chunk knows the index of
+    // its first line, and the items of each element are then parsed in parallel from these chunks.
+    const char* body = m_file.data() + headerSize;
+    const char* end  = m_file.data() + m_file.size();
+    const std::size_t bodySize = std::size_t(end - body);
+
+    constexpr std::size_t minChunkSize = std::size_t(1) << 16;
+    const int nChunks = int(std::max<std::size_t>(1, std::min<std::size_t>(bodySize / minChunkSize, 1024)));
+
+    // Chunks start at the beginning of lines
+    std::vector<const char*> chunkBegin(nChunks + 1, end);
+    chunkBegin[0] = body;
+    for (int c = 1; c < nChunks; ++c)
+    {
+        const char* p = body + bodySize * std::size_t(c) / std::size_t(nChunks);
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+        chunkBegin[c] = eol == nullptr ? end : std::max(eol + 1, chunkBegin[c - 1]);
+    }
+
+    Executor& executor = executorOrDefault(m_executor);
+    std::vector<std::size_t> chunkFirstLine(nChunks + 1, 0);
+    executor.forEach(nChunks, [&](std::ptrdiff_t c) {
+        std::size_t n = 0;
+        for (const char* p = chunkBegin[c]; p < chunkBegin[c + 1]; ++p)
+        {
+            p = static_cast<const char*>(std::memchr(p, '\n', std::size_t(chunkBegin[c + 1] - p)));
+            if (p == nullptr) break;
+            ++n;
+        }
+        chunkFirstLine[c + 1] = n;
+    }, 1);
+    // The last line may not end with a newline
+    if (bodySize != 0 && *(end - 1) != '\n') ++chunkFirstLine[nChunks];
+    for (int c = 0; c < nChunks; ++c) chunkFirstLine[c + 1] += chunkFirstLine[c];
+    const std::size_t nLines = chunkFirstLine[nChunks];
+
+    m_buffers.resize(m_elements.size());
+    std::size_t elementFirstLine = 0;
+    for (std::size_t ei = 0; ei != m_elements.size(); ++ei)
+    {
+        Element& e = m_elements[ei];
+        if (e.count > nLines - elementFirstLine) return fail("Truncated PLY file, in element " + e.name);
+        const std::size_t elementEndLine = elementFirstLine + e.count;
+        if (e.hasLists() || e.count == 0)
+        {
+            elementFirstLine = elementEndLine;
+            continue;
+        }
+
+        std::vector<char>& buffer = m_buffers[ei];
+        buffer.resize(e.count * e.stride);
+        std::atomic<bool> valid {true};
+        executor.forEach(nChunks, [&](std::ptrdiff_t c) {
+            const std::size_t first = std::max(chunkFirstLine[c], elementFirstLine);
+            const std::size_t last  = std::min(chunkFirstLine[c + 1], elementEndLine);
+            if (first >= last) return;
+
+            const char* p = chunkBegin[c];
+            for (std::size_t l = chunkFirstLine[c]; l < first; ++l)
+                p = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p))) + 1;
+            for (std::size_t l = first; l < last && valid.load(std::memory_order_relaxed); ++l)
+            {
+                const char* eol = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+                const char* lineEnd = eol == nullptr ? end : eol;
+                char* item = buffer.data() + (l - elementFirstLine) * e.stride;
+                for (const auto& prop : e.properties)
+                {
+                    double v;
+                    if (! internal::parseAsciiNumber(p, lineEnd, v)) { valid = false; break; }
+                    internal::writePlyValue(item + prop.offset, prop.type, v);
+                }
+                p = lineEnd + 1;
+            }
+        }, 1);
+        if (! valid) return fail("Invalid value in PLY element " + e.name);
+        e.data = buffer.data();
+        elementFirstLine = elementEndLine;
+    }
+    return true;
+}
@@ -0,0 +1,190 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./stridedView.h"
+
+#include <Eigen/Core>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ponca {
+
+/*!
+ * \brief Streaming writer of per-point attributes (e.g. fit results) stored as structures of arrays
+ *
+ * Attributes are declared as columns (scalars, fixed-size Eigen vectors, or enums such as FIT_RESULT), and written
+ * chunk by chunk, e.g. after each batch of fits. Chunks are packed in large buffers which are written to the file by
+ * a background thread, so that the output overlaps with the computation of the next chunks.
+ *
+ * Two formats are supported:
+ *  - Format::BinaryPly: binary PLY file (host endianness), with one `vertex` element, and one property per component
+ *    of each column. The file can be read with PlyReader, or by any PLY reader.
+ *  - Format::Columnar: text header followed by blocks of points, each block storing the columns one after the other.
+ *    Writing a chunk is then a copy of the arrays, without interleaving. The header lists the columns:
+ *    \code{.unparsed}
+ *    ponca_columns
+ *    format binary_little_endian 1.0
+ *    count 1000
+ *    column float 3 nx ny nz
+ *    column uchar 1 state
+ *    end_header
+ *    \endcode
+ *    Each block starts with its number of points, as a 64 bits unsigned integer, followed by the values of each column
+ *    for these points (components of a point are consecutive).
+ *
+ * \code
+ * PointAttributeWriter writer;
+ * writer.addColumn<float>({"nx", "ny", "nz"});
+ * writer.addColumn<float>("k1");
+ * writer.addColumn<FIT_RESULT>("state");
+ * writer.open("results.ply");
+ * for (const auto& chunk : chunks)
+ * {
+ *     compute(chunk, normals, k1, states);   // overlaps with the writing of the previous chunk
+ *     writer.writeChunk(chunk.size(), {normals.data(), k1.data(), states.data()});
+ * }
+ * if (! writer.close()) std::cerr << writer.errorMessage();
+ * \endcode
+ */
+class PointAttributeWriter
+{
+public:
+    /// \brief Format of the output file
+    enum class Format { BinaryPly, Columnar };
+
+    /// \brief Number of points given to open when it is not known in advance
+    static constexpr std::size_t UnknownCount = std::numeric_limits<std::size_t>::max();
+
+    /// \brief Values of a column for the points of a chunk, see writeChunk
+    struct ColumnData
+    {
+        /// \brief Array of scalars or enums
+        template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value>>
+        inline ColumnData(const T* d) : data(d), type(ioScalarTypeOf<T>()), components(1) {}
+
+        /// \brief Array of fixed-size vectors
+        template <typename S, int R, int C, int O, int MR, int MC>
+        inline ColumnData(const Eigen::Matrix<S, R, C, O, MR, MC>* d)
+            : data(d), type(ioScalarTypeOf<S>()), components(R * C)
+        {
+            static_assert(R > 0 && C == 1, "Only fixed-size column vectors can be written");
+            static_assert(sizeof(Eigen::Matrix<S, R, C, O, MR, MC>) == sizeof(S) * R, "Vectors must not be padded");
+        }
+
+        const void* data;
+        IOScalarType type;
+        int components;
+    };
+
+    PointAttributeWriter() = default;
+    inline ~PointAttributeWriter() { close(); }
+
+    PointAttributeWriter(const PointAttributeWriter&) = delete;
+    PointAttributeWriter& operator=(const PointAttributeWriter&) = delete;
+
+    /// \brief Declare a column of scalars (or enums) of type `T`. Must be called before open.
+    template <typename T>
+    inline void addColumn(const std::string& name) { addColumn<T>(std::vector<std::string> {name}); }
+
+    /// \brief Declare a column of vectors of type `T`, with one name per component. Must be called before open.
+    template <typename T>
+    inline void addColumn(std::vector<std::string> componentNames)
+    {
+        static_assert(ioScalarTypeOf<T>() != IOScalarType::Invalid, "Unsupported column type");
+        PONCA_DEBUG_ASSERT(! isOpen() && ! componentNames.empty());
+        m_columns.push_back({std::move(componentNames), ioScalarTypeOf<T>(), 0});
+    }
+
+    /// \brief Remove the declared columns. Must not be called while a file is open.
+    inline void clearColumns() { PONCA_DEBUG_ASSERT(! isOpen()); m_columns.clear(); }
+
+    /// \brief Set the executor interleaving the columns in #writeChunk, or nullptr to use defaultExecutor()
+    inline void setExecutor(Executor* _executor) { m_executor = _executor; }
+
+    /// \brief Size of the buffers sent to the output thread (default: 8MB)
+    inline void setBufferSize(std::size_t bytes) { m_bufferSize = bytes; }
+
+    /*!
+     * \brief Create the file at `path` and write its header, return false on failure (see errorMessage)
+     *
+     * \param count Total number of points. When it is UnknownCount, the number of points is written in the header
+     *        when the file is closed.
+     * \param asynchronous Tell if the buffers are written by a background thread
+     */
+    inline bool open(const std::string& path, Format format = Format::BinaryPly,
+                     std::size_t count = UnknownCount, bool asynchronous = true);
+
+    /*!
+     * \brief Append `count` points, given as one array per column (in the order of declaration), return false on
+     * failure (see errorMessage)
+     *
+     * The arrays are copied before the function returns, and can be overwritten by the next chunk.
+     */
+    inline bool writeChunk(std::size_t count, const std::vector<ColumnData>& columns);
+
+    /// \brief Write the remaining buffers and close the file, return false if any write failed
+    inline bool close();
+
+    inline bool isOpen() const { return m_file != nullptr; }
+    /// \brief Number of points written so far
+    inline std::size_t writtenCount() const { return m_written; }
+    inline const std::string& errorMessage() const { return m_error; }
+
+private:
+    struct Column
+    {
+        std::vector<std::string> names;
+        IOScalarType type;
+        std::size_t offset;   ///< Offset in a PLY vertex, in bytes
+        inline std::size_t size() const { return names.size() * ioScalarSize(type); }
+    };
+
+    inline bool fail(std::string message);
+    inline void dispatch();
+    inline void writeBuffer(const std::vector<char>& buffer);
+    inline void writerLoop();
+
+    std::vector<Column> m_columns;
+    Format m_format {Format::BinaryPly};
+    std::FILE* m_file {nullptr};
+    std::size_t m_rowSize {0};
+    std::size_t m_expected {UnknownCount};
+    std::size_t m_written {0};
+    long m_countPosition {0};                    ///< Position of the number of points in the header
+    std::size_t m_bufferSize {std::size_t(8) << 20};
+    std::string m_error;
+    Executor* m_executor {nullptr};
+
+    // Output thread
+    bool m_asynchronous {false};
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<char> m_current;                 ///< Buffer being filled by writeChunk
+    std::deque<std::vector<char>> m_pending;     ///< Buffers waiting for the output thread
+    std::vector<std::vector<char>> m_free;       ///< Written buffers, reused to avoid allocations
+    bool m_stop {false};
+    std::atomic<bool> m_failed {false};
+};
+
+#include "./pointAttributeWriter.hpp"
+
+} // namespace Ponca
@@ -0,0 +1,217 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+namespace internal
+{
+    /// \brief Name of the type `t` in PLY headers
+    inline const char* plyTypeName(IOScalarType t)
+    {
+        switch (t)
+        {
+            case IOScalarType::Int8:    return "char";
+            case IOScalarType::UInt8:   return "uchar";
+            case IOScalarType::Int16:   return "short";
+            case IOScalarType::UInt16:  return "ushort";
+            case IOScalarType::Int32:   return "int";
+            case IOScalarType::UInt32:  return "uint";
+            case IOScalarType::Float32: return "float";
+            case IOScalarType::Float64: return "double";
+            default: return "";
+        }
+    }
+} // namespace internal
+
+bool PointAttributeWriter::open(const std::string& path, Format format, std::size_t count, bool asynchronous)
+{
+    close();
+    m_error.clear();
+    if (m_columns.empty()) return fail("No column declared");
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (m_file == nullptr) return fail("Cannot create " + path);
+    m_format       = format;
+    m_expected     = count;
+    m_written      = 0;
+    m_asynchronous = asynchronous;
+    m_failed       = false;
+    m_stop         = false;
+
+    m_rowSize = 0;
+    for (auto& c : m_columns)
+    {
+        c.offset = m_rowSize;
+        m_rowSize += c.size();
+    }
+
+    // When the number of points is unknown, it is written over a placeholder when the file is closed
+    const std::string endianness = ioHostIsLittleEndian() ? "binary_little_endian" : "binary_big_endian";
+    std::string header = format == Format::BinaryPly ? "ply\nformat " + endianness + " 1.0\nelement vertex "
+                                                     : "ponca_columns\nformat " + endianness + " 1.0\ncount ";
+    m_countPosition = long(header.size());
+    std::string countField = count == UnknownCount ? std::string() : std::to_string(count);
+    countField.resize(std::numeric_limits<std::size_t>::digits10 + 1, ' ');
+    header += countField + "\n";
+    for (const auto& c : m_columns)
+    {
+        if (format == Format::BinaryPly)
+            for (const auto& n : c.names) header += std::string("property ") + internal::plyTypeName(c.type) + " " + n + "\n";
+        else
+        {
+            header += std::string("column ") + internal::plyTypeName(c.type) + " " + std::to_string(c.names.size());
+            for (const auto& n : c.names) header += " " + n;
+            header += "\n";
+        }
+    }
+    header += "end_header\n";
+
+    if (std::fwrite(header.data(), 1, header.size(), m_file) != header.size())
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+        return fail("Cannot write to " + path);
+    }
+    if (m_asynchronous) m_thread = std::thread(&PointAttributeWriter::writerLoop, this);
+    return true;
+}
+
+bool PointAttributeWriter::writeChunk(std::size_t count, const std::vector<ColumnData>& columns)
+{
+    if (! isOpen()) return fail("No file open");
+    if (m_failed) return fail("Cannot write to the file");
+    if (columns.size() != m_columns.size()) return fail("Number of columns mismatch");
+    for (std::size_t c = 0; c != columns.size(); ++c)
+        if (columns[c].type != m_columns[c].type || std::size_t(columns[c].components) != m_columns[c].names.size())
+            return fail("Type of column " + m_columns[c].names.front() + " mismatch");
+    if (m_expected != UnknownCount && count > m_expected - m_written)
+        return fail("More points written than announced in open");
+    if (count == 0) return true;
+
+    const std::size_t begin = m_current.size();
+    if (m_format == Format::BinaryPly)
+    {
+        // Interleave the columns in vertices
+        m_current.resize(begin + count * m_rowSize);
+        char* out = m_current.data() + begin;
+        // Small chunks are interleaved by a single range, in the calling thread
+        const auto minRows = std::ptrdiff_t(std::max<std::size_t>(1, (std::size_t(1) << 16) / m_rowSize));
+        executorOrDefault(m_executor).forEach(std::ptrdiff_t(count), [&](std::ptrdiff_t i) {
+            for (std::size_t c = 0; c != columns.size(); ++c)
+            {
+                const std::size_t size = m_columns[c].size();
+                std::memcpy(out + std::size_t(i) * m_rowSize + m_columns[c].offset,
+                            static_cast<const char*>(columns[c].data) + std::size_t(i) * size, size);
+            }
+        }, minRows);
+    }
+    else
+    {
+        // One block per chunk: the columns are copied as is
+        const std::uint64_t blockCount = count;
+        m_current.resize(begin + sizeof(blockCount) + count * m_rowSize);
+        char* out = m_current.data() + begin;
+        std::memcpy(out, &blockCount, sizeof(blockCount));
+        out += sizeof(blockCount);
+        for (std::size_t c = 0; c != columns.size(); ++c)
+        {
+            const std::size_t size = count * m_columns[c].size();
+            std::memcpy(out, columns[c].data, size);
+            out += size;
+        }
+    }
+    m_written += count;
+
+    if (m_current.size() >= m_bufferSize) dispatch();
+    return true;
+}
+
+bool PointAttributeWriter::close()
+{
+    if (! isOpen()) return true;
+
+    if (! m_current.empty()) dispatch();
+    if (m_asynchronous)
+    {
+        {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+    }
+    m_free.clear();
+
+    bool ok = ! m_failed;
+    if (! ok) fail("Cannot write to the file");
+    if (ok && m_expected == UnknownCount)
+    {
+        const std::string count = std::to_string(m_written);
+        ok = std::fseek(m_file, m_countPosition, SEEK_SET) == 0
+             && std::fwrite(count.data(), 1, count.size(), m_file) == count.size();
+        if (! ok) fail("Cannot write the number of points in the header");
+    }
+    else if (ok && m_written != m_expected)
+    {
+        ok = false;
+        fail("Fewer points written than announced in open");
+    }
+    ok = (std::fclose(m_file) == 0) && ok;
+    m_file = nullptr;
+    return ok;
+}
+
+bool PointAttributeWriter::fail(std::string message)
+{
+    m_error = std::move(message);
+    return false;
+}
+
+void PointAttributeWriter::writeBuffer(const std::vector<char>& buffer)
+{
+    if (! m_failed && std::fwrite(buffer.data(), 1, buffer.size(), m_file) != buffer.size())
+        m_failed = true;
+}
+
+void PointAttributeWriter::dispatch()
+{
+    if (! m_asynchronous)
+    {
+        writeBuffer(m_current);
+        m_current.clear();
+        return;
+    }
+
+    // At most two buffers are waiting: the computation is slowed down to the speed of the output, bounding the memory
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_condition.wait(lock, [this]() { return m_pending.size() < 2; });
+    m_pending.push_back(std::move(m_current));
+    m_current = std::vector<char>();
+    if (! m_free.empty())
+    {
+        m_current = std::move(m_free.back());
+        m_free.pop_back();
+    }
+    lock.unlock();
+    m_condition.notify_all();
+}
+
+void PointAttributeWriter::writerLoop()
+{
+    std::unique_lock<std::mutex> lock (m_mutex);
+    while (true)
+    {
+        m_condition.wait(lock, [this]() { return m_stop || ! m_pending.empty(); });
+        if (m_pending.empty()) return;
+
+        std::vector<char> buffer = std::move(m_pending.front());
+        m_pending.pop_front();
+        lock.unlock();
+        writeBuffer(buffer);
+        buffer.clear();
+        lock.lock();
+        m_free.push_back(std::move(buffer));
+        m_condition.notify_all();
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./mappedFile.h"
+#include "./stridedView.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace Ponca {
+
+/*!
+ * \brief Reader of raw binary point files, storing packed records of coordinates (XYZ), optionally followed by
+ * normals (XYZ NxNyNz)
+ *
+ * The layout of the file is given by the user: type of the values, endianness, presence of normals and size of an
+ * optional header to skip. The points are exposed as a PointView referring to the mapped file, without copy.
+ *
+ * \code
+ * RawPointReader raw;
+ * raw.open("cloud.xyz", IOScalarType::Float32);
+ * KdTreeDense<MyPoint> tree;
+ * tree.build(raw.points<MyPoint::Scalar, 3>(), PointViewConverter());
+ * \endcode
+ *
+ * \warning Views returned by the reader must not be used after the reader is closed or destroyed.
+ */
+class RawPointReader
+{
+public:
+    RawPointReader() = default;
+
+    /*!
+     * \brief Open the file at `path`, return false on failure (see errorMessage)
+     *
+     * \param type Type of the values
+     * \param hasNormals Tell if each position is followed by a normal
+     * \param dim Number of coordinates of the positions (and normals)
+     * \param headerSize Number of bytes to skip at the beginning of the file
+     * \param bigEndian Tell if the values are stored in big endian
+     */
+    inline bool open(const std::string& path, IOScalarType type, bool hasNormals = false, int dim = 3,
+                     std::size_t headerSize = 0, bool bigEndian = false)
+    {
+        close();
+        m_error.clear();
+        if (type == IOScalarType::Invalid || dim <= 0) return fail("Invalid raw point layout");
+        if (! m_file.open(path)) return fail(m_file.errorMessage());
+        if (headerSize > m_file.size()) return fail("Truncated raw point file");
+
+        m_type       = type;
+        m_dim        = dim;
+        m_hasNormals = hasNormals;
+        m_headerSize = headerSize;
+        m_stride     = ioScalarSize(type) * std::size_t(dim) * (hasNormals ? 2 : 1);
+        m_swap       = bigEndian == ioHostIsLittleEndian();
+        if ((m_file.size() - headerSize) % m_stride != 0)
+            return fail("Size of the raw point file is not a multiple of the size of a point");
+        m_size = (m_file.size() - headerSize) / m_stride;
+        return true;
+    }
+
+    /// \brief Close the file, invalidating the views
+    inline void close()
+    {
+        m_file.close();
+        m_size = 0;
+    }
+
+    inline bool isOpen() const { return m_file.isOpen(); }
+    /// \brief Number of points
+    inline std::size_t size() const { return m_size; }
+    inline bool hasNormals() const { return m_hasNormals; }
+    inline const std::string& errorMessage() const { return m_error; }
+
+    /// \brief View on the points, empty if the reader is closed or if `Dim` does not match the file layout
+    template <typename Scalar, int Dim = 3>
+    inline PointView<Scalar, Dim> points() const
+    {
+        PointView<Scalar, Dim> res;
+        if (Dim != m_dim || m_size == 0) return res;
+        const char* data = m_file.data() + m_headerSize;
+        const std::size_t valueSize = ioScalarSize(m_type);
+        for (int d = 0; d < Dim; ++d)
+        {
+            res.positions[d] = StridedView<Scalar>(data + d * valueSize, m_size, m_stride, m_type, m_swap);
+            if (m_hasNormals)
+                res.normals[d] = StridedView<Scalar>(data + (Dim + d) * valueSize, m_size, m_stride, m_type, m_swap);
+        }
+        return res;
+    }
+
+private:
+    inline bool fail(std::string message)
+    {
+        close();
+        m_error = std::move(message);
+        return false;
+    }
+
+    MappedFile m_file;
+    IOScalarType m_type {IOScalarType::Invalid};
+    int m_dim {3};
+    bool m_hasNormals {false};
+    bool m_swap {false};
+    std::size_t m_headerSize {0};
+    std::size_t m_stride {0};
+    std::size_t m_size {0};
+    std::string m_error;
+};
+
+} // namespace Ponca
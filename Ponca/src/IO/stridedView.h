@@ -0,0 +1,226 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../Common/Assert.h"
+#include "../Common/executor.h"
+
+#include <Eigen/Core>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace Ponca {
+
+/// \brief Binary representation of the values stored in files
+enum class IOScalarType
+{
+    Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid
+};
+
+/// \brief Size in bytes of a value of type `t`
+inline std::size_t ioScalarSize(IOScalarType t)
+{
+    switch (t)
+    {
+        case IOScalarType::Int8:    case IOScalarType::UInt8:  return 1;
+        case IOScalarType::Int16:   case IOScalarType::UInt16: return 2;
+        case IOScalarType::Int32:   case IOScalarType::UInt32: case IOScalarType::Float32: return 4;
+        case IOScalarType::Float64: return 8;
+        default: return 0;
+    }
+}
+
+/// \brief Binary representation of values of type `T` (arithmetic or enum type), Invalid for unsupported types
+template <typename T>
+constexpr IOScalarType ioScalarTypeOf()
+{
+    if constexpr (std::is_enum<T>::value)
+        return ioScalarTypeOf<typename std::underlying_type<T>::type>();
+    else if constexpr (std::is_floating_point<T>::value)
+        return sizeof(T) == 4 ? IOScalarType::Float32 : sizeof(T) == 8 ? IOScalarType::Float64 : IOScalarType::Invalid;
+    else if constexpr (std::is_integral<T>::value)
+    {
+        constexpr bool s = std::is_signed<T>::value;
+        return sizeof(T) == 1 ? (s ? IOScalarType::Int8  : IOScalarType::UInt8)
+             : sizeof(T) == 2 ? (s ? IOScalarType::Int16 : IOScalarType::UInt16)
+             : sizeof(T) == 4 ? (s ? IOScalarType::Int32 : IOScalarType::UInt32)
+             : IOScalarType::Invalid;
+    }
+    else
+        return IOScalarType::Invalid;
+}
+
+/// \brief Tell if the host stores values in little endian
+inline bool ioHostIsLittleEndian()
+{
+    const std::uint16_t v = 1;
+    char c;
+    std::memcpy(&c, &v, 1);
+    return c == 1;
+}
+
+/*!
+ * \brief Read-only view on values stored with a constant stride, e.g. a property of the vertices of a binary PLY file
+ *
+ * Values are read from their binary representation (IOScalarType and endianness) and converted to `T` on access.
+ * The view does not own the data: it must not outlive the file mapping or the buffer it refers to.
+ *
+ * \tparam T Type of the values returned by the view
+ */
+template <typename T>
+class StridedView
+{
+public:
+    using value_type = T;
+
+    StridedView() = default;
+
+    /*!
+     * \param data First value
+     * \param size Number of values
+     * \param stride Number of bytes between two consecutive values
+     * \param type Binary representation of the values
+     * \param swapBytes Tell if the values are stored with the opposite endianness of the host
+     */
+    inline StridedView(const char* data, std::size_t size, std::size_t stride, IOScalarType type, bool swapBytes = false)
+        : m_data(data), m_size(size), m_stride(stride), m_type(type), m_swap(swapBytes) {}
+
+    inline std::size_t size() const { return m_size; }
+    inline bool empty() const { return m_size == 0; }
+    inline std::size_t stride() const { return m_stride; }
+    inline IOScalarType type() const { return m_type; }
+
+    /// \brief Value at index `i`, converted to `T`
+    inline T operator[](std::size_t i) const
+    {
+        PONCA_DEBUG_ASSERT(i < m_size);
+        const char* p = m_data + i * m_stride;
+        switch (m_type)
+        {
+            case IOScalarType::Int8:    return T(read<std::int8_t>(p));
+            case IOScalarType::UInt8:   return T(read<std::uint8_t>(p));
+            case IOScalarType::Int16:   return T(read<std::int16_t>(p));
+            case IOScalarType::UInt16:  return T(read<std::uint16_t>(p));
+            case IOScalarType::Int32:   return T(read<std::int32_t>(p));
+            case IOScalarType::UInt32:  return T(read<std::uint32_t>(p));
+            case IOScalarType::Float32: return T(read<float>(p));
+            case IOScalarType::Float64: return T(read<double>(p));
+            default: return T(0);
+        }
+    }
+
+private:
+    // Values may be unaligned in files: copy them instead of dereferencing a cast pointer
+    template <typename S>
+    inline S read(const char* p) const
+    {
+        char bytes[sizeof(S)];
+        std::memcpy(bytes, p, sizeof(S));
+        if (m_swap)
+            for (std::size_t b = 0; b < sizeof(S) / 2; ++b) std::swap(bytes[b], bytes[sizeof(S) - 1 - b]);
+        S res;
+        std::memcpy(&res, bytes, sizeof(S));
+        return res;
+    }
+
+    const char* m_data {nullptr};
+    std::size_t m_size {0};
+    std::size_t m_stride {0};
+    IOScalarType m_type {IOScalarType::Invalid};
+    bool m_swap {false};
+};
+
+/*!
+ * \brief Positions, and optionally normals, of points stored in a file, exposed as one StridedView per coordinate
+ *
+ * A PointView is accepted by KdTreeBase::build together with PointViewConverter, which converts the points directly
+ * from the file to the KdTree point container:
+ * \code
+ * PlyReader ply;
+ * ply.open("cloud.ply");
+ * KdTreeDense<MyPoint> tree;
+ * tree.build(ply.points<MyPoint::Scalar, 3>(), PointViewConverter());
+ * \endcode
+ */
+template <typename _Scalar, int _Dim>
+struct PointView
+{
+    using Scalar = _Scalar;
+    enum { Dim = _Dim };
+
+    StridedView<Scalar> positions[Dim];
+    StridedView<Scalar> normals[Dim];   ///< Empty views when the file does not store normals
+
+    inline std::size_t size() const { return positions[0].size(); }
+    inline bool hasNormals() const { return ! normals[0].empty(); }
+
+    /// \brief Position of point `i`
+    template <typename VectorType = Eigen::Matrix<Scalar, Dim, 1>>
+    inline VectorType position(std::size_t i) const
+    {
+        VectorType res;
+        for (int d = 0; d < Dim; ++d) res[d] = typename VectorType::Scalar(positions[d][i]);
+        return res;
+    }
+
+    /// \brief Normal of point `i`, requires hasNormals()
+    template <typename VectorType = Eigen::Matrix<Scalar, Dim, 1>>
+    inline VectorType normal(std::size_t i) const
+    {
+        PONCA_DEBUG_ASSERT(hasNormals());
+        VectorType res;
+        for (int d = 0; d < Dim; ++d) res[d] = typename VectorType::Scalar(normals[d][i]);
+        return res;
+    }
+};
+
+/*!
+ * \brief KdTree converter building the point container from a PointView
+ *
+ * Points are constructed as `DataPoint(position, normal)` when the view stores normals and DataPoint provides such a
+ * constructor, and as `DataPoint(position)` otherwise. The conversion runs in parallel in `executor`, or in
+ * defaultExecutor() when it is nullptr:
+ * \code
+ * tree.build(ply.points<MyPoint::Scalar, 3>(), PointViewConverter {&executor});
+ * \endcode
+ *
+ * \see KdTreeBase::build(PointUserContainer&&, Converter)
+ */
+struct PointViewConverter
+{
+    Executor* executor {nullptr};   ///< Executor converting the points, or nullptr to use defaultExecutor()
+
+    template <typename View, typename PointContainer>
+    inline void operator()(const View& view, PointContainer& o) const
+    {
+        using DataPoint  = typename PointContainer::value_type;
+        using VectorType = typename DataPoint::VectorType;
+        static_assert(int(View::Dim) == int(DataPoint::Dim), "PointView and DataPoint dimensions mismatch");
+
+        const auto n = std::ptrdiff_t(view.size());
+        o.resize(std::size_t(n));
+        constexpr bool withNormals = std::is_constructible<DataPoint, VectorType, VectorType>::value;
+        const bool useNormals = withNormals && view.hasNormals();
+        executorOrDefault(executor).forEach(n, [&](std::ptrdiff_t i) {
+            if constexpr (withNormals)
+            {
+                if (useNormals)
+                {
+                    o[i] = DataPoint(view.template position<VectorType>(i), view.template normal<VectorType>(i));
+                    return;
+                }
+            }
+            o[i] = DataPoint(view.template position<VectorType>(i));
+        });
+    }
+};
+
+} // namespace Ponca
@@ -0,0 +1,49 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+namespace Ponca {
+
+template <typename DataPoint>
+class ImageGridWindowQuery;
+
+template <typename DataPoint>
+class ImageGridWindowIterator
+{
+protected:
+    friend class ImageGridWindowQuery<DataPoint>;
+
+public:
+    inline ImageGridWindowIterator(const ImageGridWindowQuery<DataPoint>* query, int index = -1)
+        : m_query(query), m_index(index) {}
+
+public:
+    bool operator != (const ImageGridWindowIterator& other) const{
+        return m_index != other.m_index;
+    }
+
+    void operator ++ (){
+        m_query->advance(*this);
+    }
+
+    int  operator *  () const{
+        return m_index;
+    }
+
+    /// \brief Column of the current neighbor in the image
+    inline int x() const { return m_x; }
+    /// \brief Row of the current neighbor in the image
+    inline int y() const { return m_y; }
+
+protected:
+    const ImageGridWindowQuery<DataPoint>* m_query {nullptr};
+    int m_index {-1};
+    int m_x {0};
+    int m_y {0};
+};
+
+} // namespace Ponca
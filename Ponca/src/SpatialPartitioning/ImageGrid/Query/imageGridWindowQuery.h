@@ -0,0 +1,92 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../Iterator/imageGridWindowIterator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Ponca {
+template <typename DataPoint> class ImageGrid;
+
+/*!
+ * \brief Iterate over the valid pixels of an ImageGrid inside a circular window
+ *
+ * The window contains the pixels \f$ (x, y) \f$ such that \f$ (x - x_c)^2 + (y - y_c)^2 \leq r^2 \f$, including the
+ * center pixel \f$ (x_c, y_c) \f$. Pixels are visited row by row, and dereferencing the iterator gives their index in
+ * ImageGrid::points.
+ */
+template <typename DataPoint>
+class ImageGridWindowQuery
+{
+protected:
+    friend class ImageGridWindowIterator<DataPoint>; // This type must be equal to ImageGridWindowQuery::Iterator
+
+public:
+    using Iterator = ImageGridWindowIterator<DataPoint>;
+
+public:
+    inline ImageGridWindowQuery(const ImageGrid<DataPoint>* grid, int x, int y, int radius):
+        m_grid(grid), m_cx(x), m_cy(y), m_radius(std::max(radius, 0)) {}
+
+public:
+    inline Iterator begin() const{
+        Iterator it(this);
+        it.m_y = std::max(m_cy - m_radius, 0);
+        it.m_x = m_cx - m_radius - 1;
+        advance(it);
+        return it;
+    }
+
+    inline Iterator end() const{
+        return Iterator(this, -1);
+    }
+
+    /// \brief Radius of the window, in pixels
+    inline int radius() const { return m_radius; }
+
+protected:
+    /// \brief Largest horizontal offset in the window for the row at vertical offset dy
+    inline int halfWidth(int dy) const{
+        const int r2 = m_radius * m_radius - dy * dy;
+        int hw = int(std::sqrt(double(r2)));
+        while (hw * hw > r2) --hw;
+        while ((hw + 1) * (hw + 1) <= r2) ++hw;
+        return hw;
+    }
+
+    inline void advance(Iterator& it) const{
+        const int width  = m_grid->width();
+        const int yEnd   = std::min(m_cy + m_radius, m_grid->height() - 1);
+
+        int x = it.m_x + 1;
+        for (int y = it.m_y; y <= yEnd; ++y)
+        {
+            const int hw   = halfWidth(y - m_cy);
+            const int xEnd = std::min(m_cx + hw, width - 1);
+            for (x = std::max(x, std::max(m_cx - hw, 0)); x <= xEnd; ++x)
+            {
+                const int idx = y * width + x;
+                if (m_grid->isValid(idx))
+                {
+                    it.m_index = idx;
+                    it.m_x = x;
+                    it.m_y = y;
+                    return;
+                }
+            }
+            x = 0;
+        }
+        it.m_index = -1;
+    }
+
+    const ImageGrid<DataPoint>* m_grid {nullptr};
+    int m_cx, m_cy, m_radius;
+};
+
+} // namespace Ponca
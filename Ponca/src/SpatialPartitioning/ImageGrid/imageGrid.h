@@ -0,0 +1,167 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../defines.h"
+#include "../../Common/Assert.h"
+
+#include "Query/imageGridWindowQuery.h"
+
+#include <cmath>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace Ponca {
+
+/*!
+ * \brief Organized point cloud, where the samples are stored in a regular 2D grid (e.g. depth images)
+ *
+ * Neighbors are collected in image-space windows (see #window_neighbors), without building any spatial
+ * partitioning structure: the cost of a query only depends on the radius of the window.
+ * Pixels without sample (e.g. background pixels of a depth image) are marked as invalid, and are never returned by
+ * the queries.
+ *
+ * The samples are stored row by row: the sample of pixel \f$ (x, y) \f$ has index \f$ x + y \times width \f$.
+ *
+ * \code
+ * ImageGrid<Point> grid;
+ * grid.buildFromDepth(width, height, depth.data(), normals.data(), fx, fy, cx, cy);
+ * for (int j : grid.window_neighbors(x, y, radius))
+ *     fit.addNeighbor(grid.points()[j]);
+ * \endcode
+ *
+ * \see ImageGridFit to compute fits for all the pixels
+ */
+template <typename _DataPoint>
+class ImageGrid
+{
+public:
+    using DataPoint      = _DataPoint;                     ///< DataPoint given by user
+    using Scalar         = typename DataPoint::Scalar;     ///< Scalar given by user via DataPoint
+    using VectorType     = typename DataPoint::VectorType; ///< VectorType given by user via DataPoint
+    using IndexType      = int;                            ///< Type used to index the pixels
+    using PointContainer = std::vector<DataPoint>;         ///< Container for DataPoint used inside the grid
+
+    using WindowIndexQuery = ImageGridWindowQuery<DataPoint>;
+
+    // Construction ------------------------------------------------------------
+public:
+    /*!
+     * \brief Build the grid from samples stored row by row, all the pixels being valid
+     * \param points Container of `width * height` samples
+     */
+    template <typename PointUserContainer>
+    inline void build(int width, int height, PointUserContainer&& points)
+    {
+        build(width, height, std::forward<PointUserContainer>(points), [](const DataPoint&) { return true; });
+    }
+
+    /*!
+     * \brief Build the grid from samples stored row by row
+     * \param points Container of `width * height` samples
+     * \param isValid Functor returning true for the samples corresponding to valid pixels
+     */
+    template <typename PointUserContainer, typename ValidityFunctor>
+    inline void build(int width, int height, PointUserContainer&& points, ValidityFunctor isValid)
+    {
+        PONCA_DEBUG_ASSERT(int(std::distance(std::begin(points), std::end(points))) == width * height);
+
+        m_width  = width;
+        m_height = height;
+        m_points.assign(std::begin(points), std::end(points));
+        m_valid.resize(m_points.size());
+        m_validCount = 0;
+        for (size_t i = 0; i < m_points.size(); ++i)
+        {
+            m_valid[i] = isValid(m_points[i]);
+            m_validCount += m_valid[i] ? 1 : 0;
+        }
+    }
+
+    /*!
+     * \brief Build the grid from a depth buffer and a normal buffer, unprojected using a pinhole camera model
+     *
+     * Pixel \f$ (x, y) \f$ of depth \f$ z \f$ is unprojected to \f$ ((x - c_x) z / f_x, (y - c_y) z / f_y, z) \f$.
+     * Pixels with a null, negative or non-finite depth, or with a null normal, are invalid.
+     *
+     * \param depth Depth buffer, storing `width * height` values row by row
+     * \param normals Normal buffer, storing `width * height` 3D vectors row by row (i.e. `3 * width * height` values)
+     * \param fx,fy Focal lengths, in pixels
+     * \param cx,cy Principal point, in pixels
+     * \note DataPoint must be constructible from its position and normal
+     */
+    template <typename BufferScalar>
+    inline void buildFromDepth(int width, int height, const BufferScalar* depth, const BufferScalar* normals,
+                               Scalar fx, Scalar fy, Scalar cx, Scalar cy)
+    {
+        m_width  = width;
+        m_height = height;
+        m_points.clear();
+        m_points.reserve(size_t(width) * height);
+        m_valid.resize(size_t(width) * height);
+        m_validCount = 0;
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const int idx   = y * width + x;
+                const Scalar z  = Scalar(depth[idx]);
+                VectorType n;
+                n << Scalar(normals[3*idx]), Scalar(normals[3*idx+1]), Scalar(normals[3*idx+2]);
+
+                VectorType p;
+                p << (Scalar(x) - cx) * z / fx, (Scalar(y) - cy) * z / fy, z;
+                m_points.emplace_back(p, n);
+                m_valid[idx] = std::isfinite(z) && z > Scalar(0) && n.squaredNorm() > Scalar(0);
+                m_validCount += m_valid[idx] ? 1 : 0;
+            }
+        }
+    }
+
+    // Query -------------------------------------------------------------------
+public:
+    /// \brief Valid pixels in the circular window of radius `radius` (in pixels) centered on pixel \f$ (x, y) \f$
+    inline WindowIndexQuery window_neighbors(int x, int y, int radius) const
+    {
+        return WindowIndexQuery(this, x, y, radius);
+    }
+
+    /// \brief Valid pixels in the circular window of radius `radius` (in pixels) centered on the pixel `index`
+    inline WindowIndexQuery window_neighbors(IndexType index, int radius) const
+    {
+        return WindowIndexQuery(this, index % m_width, index / m_width, radius);
+    }
+
+    // Accessors ---------------------------------------------------------------
+public:
+    /// \brief Number of columns
+    inline int width() const { return m_width; }
+    /// \brief Number of rows
+    inline int height() const { return m_height; }
+    /// \brief Number of pixels, including invalid ones
+    inline IndexType point_count() const { return IndexType(m_points.size()); }
+    /// \brief Number of valid pixels
+    inline IndexType valid_count() const { return m_validCount; }
+    /// \brief Index of the pixel \f$ (x, y) \f$
+    inline IndexType index(int x, int y) const { return y * m_width + x; }
+    /// \brief Tell if the pixel `index` stores a sample
+    inline bool isValid(IndexType index) const { return m_valid[index]; }
+
+    /// \brief Samples, stored row by row
+    inline const PointContainer& points() const { return m_points; }
+
+    // Data --------------------------------------------------------------------
+private:
+    int m_width {0};
+    int m_height {0};
+    IndexType m_validCount {0};
+    PointContainer m_points;
+    std::vector<char> m_valid; ///< \brief Validity of the pixels
+};
+
+} // namespace Ponca
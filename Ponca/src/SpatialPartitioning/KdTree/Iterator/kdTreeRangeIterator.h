@@ -28,10 +28,14 @@ public:
     inline KdTreeRangeIterator& operator++() {m_query->advance(*this); return *this;}
     inline Index operator *() const {return m_index;}
 
+    /// Squared distance between the current neighbor and the query point, as computed during the traversal
+    inline Scalar squaredDistance() const {return m_squaredDist;}
+
 protected:
     QueryType* m_query {nullptr};
     Index m_index {-1};
     Index m_start {0};
     Index m_end {0};
+    Scalar m_squaredDist {0};
 };
 } // namespace ponca
@@ -8,12 +8,19 @@
 
 #include "../../indexSquaredDistance.h"
 #include "../../../Common/Containers/stack.h"
+#include "../kdTreeStatistics.h"
 
 namespace Ponca {
 template <typename Traits> class KdTreeBase;
 
+/*!
+ * \brief Base class of the queries, storing the traversal stack
+ *
+ * The query counters (see KdTreeCollectStatistics) are stored as an empty base class when the queries are not
+ * instrumented, so that they do not increase the size of the queries.
+ */
 template <typename Traits>
-class KdTreeQuery
+class KdTreeQuery : protected internal::KdTreeQueryRecorder<internal::KdTreeStatisticsPolicy<Traits>::type::ENABLED>
 {
 public:
     using DataPoint  = typename Traits::DataPoint;
@@ -21,15 +28,42 @@ public:
     using Scalar     = typename DataPoint::Scalar;
     using VectorType = typename DataPoint::VectorType;
 
+    /// \brief Tell if the queries are instrumented (see KdTreeCollectStatistics)
+    static constexpr bool STATISTICS_ENABLED = internal::KdTreeStatisticsPolicy<Traits>::type::ENABLED;
+
     explicit inline KdTreeQuery(const KdTreeBase<Traits>* kdtree) : m_kdtree( kdtree ), m_stack() {}
 
+    inline ~KdTreeQuery() { commitStatistics(); }
+
+    // The destructor disables the implicit moves: declare them, with the copies
+    KdTreeQuery(const KdTreeQuery&) = default;
+    KdTreeQuery(KdTreeQuery&&) = default;
+    KdTreeQuery& operator=(const KdTreeQuery&) = default;
+    KdTreeQuery& operator=(KdTreeQuery&&) = default;
+
 protected:
+    /// \brief Counters of the current search, empty when the queries are not instrumented
+    using Recorder = internal::KdTreeQueryRecorder<STATISTICS_ENABLED>;
+
+    inline Recorder& recorder() { return *this; }
+
     /// \brief Init stack for a new search
     inline void reset() {
+        commitStatistics();
         m_stack.clear();
         m_stack.push({0,0});
     }
 
+    /// \brief Accumulate the counters of the current search in the statistics of the kd-tree
+    inline void commitStatistics() {
+        if constexpr (STATISTICS_ENABLED) {
+            if (m_kdtree != nullptr && !recorder().empty()) {
+                m_kdtree->m_query_statistics.commit(recorder().counters);
+                recorder().clear();
+            }
+        }
+    }
+
     /// [KdTreeQuery kdtree type]
     const KdTreeBase<Traits>* m_kdtree { nullptr };
     /// [KdTreeQuery kdtree type]
@@ -52,6 +86,7 @@ protected:
         if (nodes.empty() || points.empty() || m_kdtree->sample_count() == 0)
             throw std::invalid_argument("Empty KdTree");
 
+        recorder().stackSize(m_stack.size());
         while(!m_stack.empty())
         {
             auto& qnode = m_stack.top();
@@ -59,8 +94,10 @@ protected:
 
             if(qnode.squared_distance < descentDistanceThreshold())
             {
+                recorder().visitNode();
                 if(node.is_leaf())
                 {
+                    recorder().visitLeaf();
                     m_stack.pop();
                     IndexType start = node.leaf_start();
                     IndexType end = node.leaf_start() + node.leaf_size();
@@ -71,9 +108,11 @@ protected:
                         if(skipFunctor(idx)) continue;
 
                         Scalar d = (point - points[idx].pos()).squaredNorm();
+                        recorder().testPoint();
 
                         if(d < descentDistanceThreshold())
                         {
+                            recorder().acceptPoint();
                             if( processNeighborFunctor( idx, i, d )) return false;
                         }
                     }
@@ -83,6 +122,7 @@ protected:
                     // replace the stack top by the farthest and push the closest
                     Scalar newOff = point[node.inner_split_dim()] - node.inner_split_value();
                     m_stack.push();
+                    recorder().stackSize(m_stack.size());
                     if(newOff < 0)
                     {
                         m_stack.top().index = node.inner_first_child_id();
@@ -53,10 +53,11 @@ protected:
 
         auto descentDistanceThreshold = [this](){return QueryType::descentDistanceThreshold();};
         auto skipFunctor              = [this](IndexType idx){return QueryType::skipIndexFunctor(idx);};
-        auto processNeighborFunctor   = [&it](IndexType idx, IndexType i, Scalar)
+        auto processNeighborFunctor   = [&it](IndexType idx, IndexType i, Scalar d)
         {
             it.m_index = idx;
             it.m_start = i+1;
+            it.m_squaredDist = d;
             return true;
         };
 
@@ -69,8 +70,10 @@ protected:
             if(skipFunctor(idx)) continue;
 
             Scalar d = (point - points[idx].pos()).squaredNorm();
+            QueryAccelType::recorder().testPoint();
             if(d < descentDistanceThreshold())
             {
+                QueryAccelType::recorder().acceptPoint();
                 if( processNeighborFunctor(idx, i, d) ) return;
             }
         }
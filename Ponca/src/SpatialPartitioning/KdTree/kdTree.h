@@ -19,6 +19,7 @@
 #include <Eigen/Geometry> // aabb
 
 #include "../../Common/Assert.h"
+#include "../../Common/executor.h"
 
 #include "Query/kdTreeNearestQueries.h"
 #include "Query/kdTreeKNearestQueries.h"
@@ -137,6 +138,12 @@ public:
 
     static_assert(MAX_DEPTH > 0, "Max depth must be strictly positive");
 
+    /// \brief Minimal number of samples for the tree to be built in parallel
+    static constexpr IndexType PARALLEL_BUILD_MIN_SAMPLES = 16384;
+
+    /// \brief Tell if the queries are instrumented (see KdTreeCollectStatistics)
+    static constexpr bool STATISTICS_ENABLED = internal::KdTreeStatisticsPolicy<Traits>::type::ENABLED;
+
     // Construction ------------------------------------------------------------
 public:
     /// Generate a tree from a custom contained type converted using the specified converter
@@ -231,6 +238,19 @@ public:
         m_min_cell_size = min_cell_size;
     }
 
+    /// Read the executor running the construction and the batched queries
+    inline Executor& executor() const
+    {
+        return executorOrDefault(m_executor);
+    }
+
+    /// Write the executor running the construction and the batched queries, or nullptr to use defaultExecutor()
+    /// \warning The executor must outlive its use by the tree
+    inline void set_executor(Executor* executor)
+    {
+        m_executor = executor;
+    }
+
     // Index mapping -----------------------------------------------------------
 public:
     /// Return the point index associated with the specified sample index
@@ -286,12 +306,62 @@ public :
     {
         return KdTreeRangeIndexQuery<Traits>(this, r, index);
     }
+
+    /// \brief Compute the k-nearest neighbors of a set of points in parallel, using executor()
+    ///
+    /// The neighbors of `queries[q]` are stored in `neighbors[q*k, (q+1)*k)`, in the order of the k-nearest query,
+    /// and completed with -1 when the tree has less than k samples.
+    /// \tparam VectorContainer Random access container of \ref VectorType
+    template<typename VectorContainer>
+    inline void k_nearest_neighbors_batch(const VectorContainer& queries, IndexType k,
+                                          IndexContainer& neighbors) const;
+
+    /// \brief Compute the neighbors of a set of points within a radius in parallel, using executor()
+    ///
+    /// The neighbors of `queries[q]` are stored in `neighbors[offsets[q], offsets[q+1])`.
+    /// \tparam VectorContainer Random access container of \ref VectorType
+    template<typename VectorContainer>
+    inline void range_neighbors_batch(const VectorContainer& queries, Scalar r,
+                                      std::vector<std::size_t>& offsets, IndexContainer& neighbors) const;
     
+    // Statistics --------------------------------------------------------------
+public:
+    /// \brief Statistics of the queries run on this tree, aggregated over all threads
+    /// \warning Only available when the queries are instrumented (see KdTreeCollectStatistics), and must not be
+    /// called while queries are running
+    inline KdTreeQueryStatistics query_statistics() const
+    {
+        static_assert(STATISTICS_ENABLED, "Query statistics require KdTreeCollectStatistics in the traits");
+        return m_query_statistics.merged();
+    }
+
+    /// \brief Statistics of the queries run on this tree, for each thread having run queries
+    /// \copydetails query_statistics
+    inline std::vector<KdTreeQueryStatistics> query_statistics_per_thread() const
+    {
+        static_assert(STATISTICS_ENABLED, "Query statistics require KdTreeCollectStatistics in the traits");
+        return m_query_statistics.perThread();
+    }
+
+    /// \brief Clear the statistics of the queries
+    /// \copydetails query_statistics
+    inline void reset_query_statistics()
+    {
+        static_assert(STATISTICS_ENABLED, "Query statistics require KdTreeCollectStatistics in the traits");
+        m_query_statistics.reset();
+    }
+
     // Utilities ---------------------------------------------------------------
 public:
     inline bool valid() const;
     inline void print(std::ostream& os, bool verbose = false) const;
 
+    /// \brief Compute the structure and memory footprint of the tree
+    ///
+    /// The bounding boxes of the leaves are recomputed from the points, which requires a traversal of the samples.
+    /// \see KdTreeStats::print_json
+    inline KdTreeStats stats() const;
+
     // Data --------------------------------------------------------------------
 protected:
     PointContainer m_points;
@@ -300,6 +370,11 @@ protected:
 
     LeafSizeType m_min_cell_size {64}; ///< Minimal number of points per leaf
     NodeIndexType m_leaf_count {0}; ///< Number of leaves in the Kdtree (computed during construction)
+    Executor* m_executor {nullptr}; ///< Executor of the construction and batched queries, nullptr for the default
+
+    /// Statistics of the queries, empty when the queries are not instrumented
+    mutable internal::KdTreeStatisticsCollector<STATISTICS_ENABLED> m_query_statistics;
+    friend class KdTreeQuery<Traits>;
 
     // Internal ----------------------------------------------------------------
 protected:
@@ -330,7 +405,21 @@ protected:
     }
 
 private:
-    inline void build_rec(NodeIndexType node_id, IndexType start, IndexType end, int level);
+    /// Subtree built independently by the parallel construction
+    struct BuildTask
+    {
+        NodeIndexType node_id;
+        IndexType start, end;
+        int level;
+    };
+
+    /// Build the subtree of node `node_id` in `nodes`. When `tasks` is set, the subtrees of at most `task_size`
+    /// samples are not built, but recorded as tasks.
+    inline void build_rec(NodeContainer& nodes, NodeIndexType& leaf_count, std::size_t max_node_count,
+                          NodeIndexType node_id, IndexType start, IndexType end, int level,
+                          std::vector<BuildTask>* tasks = nullptr, IndexType task_size = 0);
+    /// Build the top of the tree, then its subtrees concurrently in separate containers merged afterwards
+    inline void build_parallel(Executor& executor);
     inline IndexType partition(IndexType start, IndexType end, int dim, Scalar value);
 };
 
@@ -116,6 +116,74 @@ void KdTreeBase<Traits>::print(std::ostream& os, bool verbose) const
     }
 }
 
+template<typename Traits>
+KdTreeStats KdTreeBase<Traits>::stats() const
+{
+    KdTreeStats res;
+    res.point_count  = point_count();
+    res.sample_count = sample_count();
+    res.node_count   = node_count();
+    res.leaf_count   = leaf_count();
+
+    res.points_bytes           = internal::ContainerBytes<PointContainer>::used(m_points);
+    res.nodes_bytes            = internal::ContainerBytes<NodeContainer>::used(m_nodes);
+    res.indices_bytes          = internal::ContainerBytes<IndexContainer>::used(m_indices);
+    res.points_reserved_bytes  = internal::ContainerBytes<PointContainer>::reserved(m_points);
+    res.nodes_reserved_bytes   = internal::ContainerBytes<NodeContainer>::reserved(m_nodes);
+    res.indices_reserved_bytes = internal::ContainerBytes<IndexContainer>::reserved(m_indices);
+
+    if (m_nodes.empty())
+        return res;
+
+    double aspectRatioSum = 0;
+    std::uint64_t aspectRatioCount = 0;
+
+    std::vector<std::pair<NodeIndexType, int>> stack {{0, 0}};
+    while (!stack.empty())
+    {
+        const auto [n, depth] = stack.back();
+        stack.pop_back();
+        const NodeType& node = m_nodes[n];
+        if (! node.is_leaf())
+        {
+            stack.emplace_back(node.inner_first_child_id(), depth + 1);
+            stack.emplace_back(node.inner_first_child_id() + 1, depth + 1);
+            continue;
+        }
+
+        if (res.depth_histogram.size() <= std::size_t(depth))
+            res.depth_histogram.resize(depth + 1, 0);
+        ++res.depth_histogram[depth];
+
+        const std::size_t size = node.leaf_size();
+        if (res.leaf_size_histogram.size() <= size)
+            res.leaf_size_histogram.resize(size + 1, 0);
+        ++res.leaf_size_histogram[size];
+
+        if (size == 0)
+        {
+            ++res.empty_leaf_count;
+            continue;
+        }
+        if (size == 1)
+            continue;
+
+        AabbType aabb;
+        for (IndexType i = node.leaf_start(); i < IndexType(node.leaf_start() + size); ++i)
+            aabb.extend(m_points[m_indices[i]].pos());
+        const VectorType extent = aabb.sizes();
+        if (extent.minCoeff() <= Scalar(0))
+        {
+            ++res.degenerate_leaf_count;
+            continue;
+        }
+        aspectRatioSum += double(extent.maxCoeff() / extent.minCoeff());
+        ++aspectRatioCount;
+    }
+    res.mean_leaf_aspect_ratio = aspectRatioCount == 0 ? 0. : aspectRatioSum / double(aspectRatioCount);
+    return res;
+}
+
 template<typename Traits>
 template<typename PointUserContainer, typename IndexUserContainer, typename Converter>
 inline void KdTreeBase<Traits>::buildWithSampling(PointUserContainer&& points,
@@ -132,47 +200,160 @@ inline void KdTreeBase<Traits>::buildWithSampling(PointUserContainer&& points,
     m_nodes.reserve(4 * point_count() / m_min_cell_size);
     m_nodes.emplace_back();
 
-    m_indices = std::move(sampling);
+    if constexpr (std::is_same<IndexUserContainer, IndexContainer>::value)
+        m_indices = std::move(sampling);
+    else // e.g. a std::vector, when IndexContainer uses a custom allocator
+        m_indices.assign(sampling.begin(), sampling.end());
 
-    this->build_rec(0, 0, sample_count(), 1);
+    Executor& ex = executor();
+    if (ex.concurrency() > 1 && sample_count() >= PARALLEL_BUILD_MIN_SAMPLES)
+        this->build_parallel(ex);
+    else
+        this->build_rec(m_nodes, m_leaf_count, MAX_NODE_COUNT, 0, 0, sample_count(), 1);
 
     PONCA_DEBUG_ASSERT(this->valid());
 }
 
 template<typename Traits>
-void KdTreeBase<Traits>::build_rec(NodeIndexType node_id, IndexType start, IndexType end, int level)
+void KdTreeBase<Traits>::build_rec(NodeContainer& nodes, NodeIndexType& leaf_count, std::size_t max_node_count,
+                                   NodeIndexType node_id, IndexType start, IndexType end, int level,
+                                   std::vector<BuildTask>* tasks, IndexType task_size)
 {
-    NodeType& node = m_nodes[node_id];
+    if (tasks != nullptr && end-start <= task_size)
+    {
+        tasks->push_back({node_id, start, end, level});
+        return;
+    }
+
     AabbType aabb;
     for(IndexType i=start; i<end; ++i)
         aabb.extend(m_points[m_indices[i]].pos());
 
+    NodeType& node = nodes[node_id];
     node.set_is_leaf(
         end-start <= m_min_cell_size ||
         level >= Traits::MAX_DEPTH ||
         // Since we add 2 nodes per inner node we need to stop if we can't add
         // them both
-        (NodeIndexType)m_nodes.size() > MAX_NODE_COUNT - 2);
+        (std::size_t)nodes.size() > max_node_count - 2);
 
     node.configure_range(start, end-start, aabb);
     if (node.is_leaf())
     {
-        ++m_leaf_count;
+        ++leaf_count;
     }
     else
     {
         int split_dim = 0;
         (Scalar(0.5) * aabb.diagonal()).maxCoeff(&split_dim);
-        node.configure_inner(aabb.center()[split_dim], m_nodes.size(), split_dim);
-        m_nodes.emplace_back();
-        m_nodes.emplace_back();
+        node.configure_inner(aabb.center()[split_dim], nodes.size(), split_dim);
+        // Read the node before adding its children, which may reallocate the container
+        const Scalar split_value = node.inner_split_value();
+        const NodeIndexType first_child_id = node.inner_first_child_id();
+        nodes.emplace_back();
+        nodes.emplace_back();
+
+        IndexType mid_id = this->partition(start, end, split_dim, split_value);
+        build_rec(nodes, leaf_count, max_node_count, first_child_id, start, mid_id, level+1, tasks, task_size);
+        build_rec(nodes, leaf_count, max_node_count, first_child_id+1, mid_id, end, level+1, tasks, task_size);
+    }
+}
+
+template<typename Traits>
+void KdTreeBase<Traits>::build_parallel(Executor& executor)
+{
+    // Top of the tree, split until the subtrees are small enough to balance the load between the threads
+    const IndexType task_size = std::max<IndexType>(
+        IndexType(m_min_cell_size), sample_count() / IndexType(8 * executor.concurrency()));
+    std::vector<BuildTask> tasks;
+    this->build_rec(m_nodes, m_leaf_count, MAX_NODE_COUNT, 0, 0, sample_count(), 1, &tasks, task_size);
+    if (tasks.empty())
+        return;
+
+    // Subtrees: each task works on its own range of samples, and gets an equal share of the remaining nodes
+    const std::size_t node_budget = std::max<std::size_t>(
+        2, (MAX_NODE_COUNT - std::size_t(m_nodes.size())) / tasks.size() + 1);
+    std::vector<NodeContainer> subtrees (tasks.size());
+    std::vector<NodeIndexType> leaf_counts (tasks.size(), 0);
+    executor.parallelFor(std::ptrdiff_t(tasks.size()), [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        for (std::ptrdiff_t t = begin; t < end; ++t)
+        {
+            const BuildTask& task = tasks[t];
+            NodeContainer& nodes = subtrees[t];
+            nodes.reserve(4 * (task.end - task.start) / m_min_cell_size + 1);
+            nodes.emplace_back();
+            this->build_rec(nodes, leaf_counts[t], node_budget, 0, task.start, task.end, task.level);
+        }
+    }, 1);
 
-        IndexType mid_id = this->partition(start, end, split_dim, node.inner_split_value());
-        build_rec(node.inner_first_child_id(), start, mid_id, level+1);
-        build_rec(node.inner_first_child_id()+1, mid_id, end, level+1);
+    // Merge: the root of a subtree replaces its placeholder, and the other nodes are appended
+    for (std::size_t t = 0; t < tasks.size(); ++t)
+    {
+        NodeContainer& nodes = subtrees[t];
+        const NodeIndexType offset = m_nodes.size() - 1;
+        for (NodeType& node : nodes)
+            if (! node.is_leaf())
+                node.configure_inner(node.inner_split_value(), node.inner_first_child_id() + offset, node.inner_split_dim());
+        m_nodes[tasks[t].node_id] = nodes[0];
+        for (std::size_t n = 1; n < nodes.size(); ++n)
+            m_nodes.emplace_back(nodes[n]);
+        m_leaf_count += leaf_counts[t];
     }
 }
 
+template<typename Traits>
+template<typename VectorContainer>
+void KdTreeBase<Traits>::k_nearest_neighbors_batch(const VectorContainer& queries, IndexType k,
+                                                   IndexContainer& neighbors) const
+{
+    neighbors.assign(queries.size() * std::size_t(k), IndexType(-1));
+    executor().parallelFor(std::ptrdiff_t(queries.size()), [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        for (std::ptrdiff_t q = begin; q < end; ++q)
+        {
+            auto out = neighbors.begin() + q * k;
+            for (IndexType j : k_nearest_neighbors(VectorType(queries[q]), k))
+                *out++ = j;
+        }
+    });
+}
+
+template<typename Traits>
+template<typename VectorContainer>
+void KdTreeBase<Traits>::range_neighbors_batch(const VectorContainer& queries, Scalar r,
+                                               std::vector<std::size_t>& offsets, IndexContainer& neighbors) const
+{
+    // The queries are processed by blocks, each collecting its neighbors in its own container
+    static constexpr std::ptrdiff_t BLOCK_SIZE = 256;
+    const auto query_count = std::ptrdiff_t(queries.size());
+    const std::ptrdiff_t block_count = (query_count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<IndexContainer> blocks (block_count);
+    offsets.assign(queries.size() + 1, 0);
+    executor().parallelFor(block_count, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        for (std::ptrdiff_t b = begin; b < end; ++b)
+            for (std::ptrdiff_t q = b * BLOCK_SIZE; q < std::min(query_count, (b + 1) * BLOCK_SIZE); ++q)
+            {
+                for (IndexType j : range_neighbors(VectorType(queries[q]), r))
+                    blocks[b].push_back(j);
+                offsets[q + 1] = blocks[b].size();
+            }
+    }, 1);
+
+    // Offsets of the blocks in the result
+    std::vector<std::size_t> block_offsets (block_count + 1, 0);
+    for (std::ptrdiff_t b = 0; b < block_count; ++b)
+    {
+        block_offsets[b + 1] = block_offsets[b] + blocks[b].size();
+        for (std::ptrdiff_t q = b * BLOCK_SIZE; q < std::min(query_count, (b + 1) * BLOCK_SIZE); ++q)
+            offsets[q + 1] += block_offsets[b];
+    }
+
+    neighbors.resize(block_offsets[block_count]);
+    executor().parallelFor(block_count, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        for (std::ptrdiff_t b = begin; b < end; ++b)
+            std::copy(blocks[b].begin(), blocks[b].end(), neighbors.begin() + block_offsets[b]);
+    }, 1);
+}
+
 template<typename Traits>
 auto KdTreeBase<Traits>::partition(IndexType start, IndexType end, int dim, Scalar value)
     -> IndexType
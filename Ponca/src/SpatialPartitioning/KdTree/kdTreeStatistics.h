@@ -0,0 +1,392 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Ponca {
+
+/*!
+ * \brief Statistics policy disabling the query instrumentation (default)
+ *
+ * \see KdTreeDefaultTraits::StatisticsPolicy
+ */
+struct KdTreeNoStatistics
+{
+    static constexpr bool ENABLED = false;
+};
+
+/*!
+ * \brief Statistics policy enabling the query instrumentation
+ *
+ * Each query counts the nodes and leaves it visits, the points it tests and accepts, and the largest size reached by
+ * its traversal stack. When the query is reset or destroyed, these counters are accumulated in per-thread
+ * KdTreeQueryStatistics, retrieved using KdTreeBase::query_statistics.
+ *
+ * To enable the instrumentation, define traits overriding the statistics policy:
+ * \code
+ * template <typename DataPoint>
+ * struct InstrumentedTraits : public KdTreeDefaultTraits<DataPoint>
+ * {
+ *     using StatisticsPolicy = KdTreeCollectStatistics;
+ * };
+ * using InstrumentedKdTree = KdTreeDenseBase<InstrumentedTraits<DataPoint>>;
+ * \endcode
+ */
+struct KdTreeCollectStatistics
+{
+    static constexpr bool ENABLED = true;
+};
+
+/*!
+ * \brief Counters of a single query
+ */
+struct KdTreeQueryCounters
+{
+    /// \brief Counters, used to index KdTreeQueryStatistics
+    enum Counter
+    {
+        NodesVisited = 0,   ///< Nodes (inner nodes and leaves) whose distance is below the descent threshold
+        LeavesVisited,      ///< Leaves whose points are tested
+        PointsTested,       ///< Points whose distance to the query is computed
+        PointsAccepted,     ///< Points reported to the query (e.g. neighbors of a range query)
+        StackHighWater,     ///< Largest size reached by the traversal stack
+        COUNTER_COUNT
+    };
+
+    std::uint64_t values[COUNTER_COUNT] {0, 0, 0, 0, 0};
+
+    inline std::uint64_t operator[](Counter c) const { return values[c]; }
+    inline bool empty() const
+    {
+        return std::all_of(std::begin(values), std::end(values), [](std::uint64_t v) { return v == 0; });
+    }
+};
+
+/*!
+ * \brief Distribution of the counters of several queries
+ *
+ * For each counter, the number of queries is stored in logarithmic buckets: bucket 0 counts the queries with a null
+ * counter, and bucket \f$ k > 0 \f$ the queries with a counter in \f$ [2^{k-1}, 2^k[ \f$.
+ */
+struct KdTreeQueryStatistics
+{
+    using Counter = KdTreeQueryCounters::Counter;
+    static constexpr int COUNTER_COUNT = KdTreeQueryCounters::COUNTER_COUNT;
+    static constexpr int BUCKET_COUNT  = 65;
+
+    std::uint64_t query_count {0};                               ///< Number of queries
+    std::uint64_t sum[COUNTER_COUNT] {};                         ///< Sum of each counter over the queries
+    std::uint64_t max[COUNTER_COUNT] {};                         ///< Maximum of each counter over the queries
+    std::uint64_t histogram[COUNTER_COUNT][BUCKET_COUNT] {};     ///< Number of queries per bucket
+
+    /// \brief Bucket of the histograms containing the value `v`
+    static inline int bucket(std::uint64_t v)
+    {
+        int b = 0;
+        for (; v != 0; v >>= 1) ++b;
+        return b;
+    }
+
+    /// \brief Mean value of a counter over the queries
+    inline double mean(Counter c) const
+    {
+        return query_count == 0 ? 0. : double(sum[c]) / double(query_count);
+    }
+
+    /// \brief Add the counters of a query
+    inline void add(const KdTreeQueryCounters& counters)
+    {
+        ++query_count;
+        for (int c = 0; c < COUNTER_COUNT; ++c)
+        {
+            sum[c] += counters.values[c];
+            max[c] = std::max(max[c], counters.values[c]);
+            ++histogram[c][bucket(counters.values[c])];
+        }
+    }
+
+    /// \brief Add the statistics of other queries
+    inline void merge(const KdTreeQueryStatistics& other)
+    {
+        query_count += other.query_count;
+        for (int c = 0; c < COUNTER_COUNT; ++c)
+        {
+            sum[c] += other.sum[c];
+            max[c] = std::max(max[c], other.max[c]);
+            for (int b = 0; b < BUCKET_COUNT; ++b)
+                histogram[c][b] += other.histogram[c][b];
+        }
+    }
+};
+
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    /// \brief Write a container of numbers as a JSON array
+    template <typename Container>
+    inline void printJsonArray(std::ostream& os, const Container& values)
+    {
+        os << "[";
+        bool first = true;
+        for (const auto& v : values)
+        {
+            os << (first ? "" : ", ") << v;
+            first = false;
+        }
+        os << "]";
+    }
+
+    /// \brief Number of bytes used by the elements of a container, and reserved by the container when it has a capacity
+    template <typename Container, typename = void>
+    struct ContainerBytes
+    {
+        static inline std::size_t used(const Container& c)     { return c.size() * sizeof(typename Container::value_type); }
+        static inline std::size_t reserved(const Container& c) { return used(c); }
+    };
+
+    template <typename Container>
+    struct ContainerBytes<Container, std::void_t<decltype(std::declval<const Container&>().capacity())>>
+    {
+        static inline std::size_t used(const Container& c)     { return c.size() * sizeof(typename Container::value_type); }
+        static inline std::size_t reserved(const Container& c) { return c.capacity() * sizeof(typename Container::value_type); }
+    };
+} // namespace internal
+#endif
+
+/*!
+ * \brief Structure and memory footprint of a KdTree
+ *
+ * \see KdTreeBase::stats
+ */
+struct KdTreeStats
+{
+    std::uint64_t point_count {0};               ///< Number of points stored in the tree
+    std::uint64_t sample_count {0};              ///< Number of samples indexed by the tree
+    std::uint64_t node_count {0};                ///< Number of nodes (inner nodes and leaves)
+    std::uint64_t leaf_count {0};                ///< Number of leaves
+
+    /// Number of leaves at each depth, the root having depth 0
+    std::vector<std::uint64_t> depth_histogram;
+    /// Number of leaves for each number of samples
+    std::vector<std::uint64_t> leaf_size_histogram;
+
+    std::uint64_t empty_leaf_count {0};          ///< Leaves without samples
+    /// Leaves with several samples but a bounding box flat along at least one dimension, e.g. with duplicated points
+    std::uint64_t degenerate_leaf_count {0};
+    /// Mean ratio between the largest and the smallest extents of the bounding boxes of the leaves, computed on the
+    /// leaves that are neither empty, degenerate nor reduced to a single sample
+    double mean_leaf_aspect_ratio {0};
+
+    std::uint64_t points_bytes {0};              ///< Bytes used by the points
+    std::uint64_t nodes_bytes {0};               ///< Bytes used by the nodes
+    std::uint64_t indices_bytes {0};             ///< Bytes used by the sample indices
+    std::uint64_t points_reserved_bytes {0};     ///< Bytes allocated by the point container
+    std::uint64_t nodes_reserved_bytes {0};      ///< Bytes allocated by the node container
+    std::uint64_t indices_reserved_bytes {0};    ///< Bytes allocated by the index container
+
+    /// \brief Depth of the deepest leaf
+    inline int max_depth() const { return depth_histogram.empty() ? 0 : int(depth_histogram.size()) - 1; }
+
+    /// \brief Mean number of samples per leaf
+    inline double mean_leaf_size() const { return leaf_count == 0 ? 0. : double(sample_count) / double(leaf_count); }
+
+    /// \brief Bytes used by the points, nodes and sample indices
+    inline std::uint64_t total_bytes() const { return points_bytes + nodes_bytes + indices_bytes; }
+
+    /// \brief Bytes allocated by the point, node and index containers
+    inline std::uint64_t total_reserved_bytes() const
+    {
+        return points_reserved_bytes + nodes_reserved_bytes + indices_reserved_bytes;
+    }
+
+    /// \brief Write the statistics as a JSON object
+    inline void print_json(std::ostream& os) const
+    {
+        os << "{";
+        os << "\"point_count\": " << point_count;
+        os << ", \"sample_count\": " << sample_count;
+        os << ", \"node_count\": " << node_count;
+        os << ", \"leaf_count\": " << leaf_count;
+        os << ", \"max_depth\": " << max_depth();
+        os << ", \"depth_histogram\": "; internal::printJsonArray(os, depth_histogram);
+        os << ", \"leaf_size_histogram\": "; internal::printJsonArray(os, leaf_size_histogram);
+        os << ", \"mean_leaf_size\": " << mean_leaf_size();
+        os << ", \"empty_leaf_count\": " << empty_leaf_count;
+        os << ", \"degenerate_leaf_count\": " << degenerate_leaf_count;
+        os << ", \"mean_leaf_aspect_ratio\": " << mean_leaf_aspect_ratio;
+        os << ", \"bytes\": {\"points\": " << points_bytes << ", \"nodes\": " << nodes_bytes
+           << ", \"indices\": " << indices_bytes << ", \"total\": " << total_bytes() << "}";
+        os << ", \"reserved_bytes\": {\"points\": " << points_reserved_bytes << ", \"nodes\": " << nodes_reserved_bytes
+           << ", \"indices\": " << indices_reserved_bytes << ", \"total\": " << total_reserved_bytes() << "}";
+        os << "}";
+    }
+};
+
+#ifndef PARSED_WITH_DOXYGEN
+namespace internal
+{
+    /// \brief Statistics policy of a traits type: `Traits::StatisticsPolicy` if defined, KdTreeNoStatistics otherwise
+    template <typename Traits, typename = void>
+    struct KdTreeStatisticsPolicy { using type = KdTreeNoStatistics; };
+
+    template <typename Traits>
+    struct KdTreeStatisticsPolicy<Traits, std::void_t<typename Traits::StatisticsPolicy>>
+    { using type = typename Traits::StatisticsPolicy; };
+
+    /// \brief Counters of a query, doing nothing when the instrumentation is disabled
+    template <bool Enabled>
+    struct KdTreeQueryRecorder
+    {
+        inline void visitNode() {}
+        inline void visitLeaf() {}
+        inline void testPoint() {}
+        inline void acceptPoint() {}
+        inline void stackSize(int) {}
+        inline bool empty() const { return true; }
+        inline void clear() {}
+    };
+
+    template <>
+    struct KdTreeQueryRecorder<true>
+    {
+        using Counter = KdTreeQueryCounters::Counter;
+
+        KdTreeQueryRecorder() = default;
+        // Copies start with fresh counters, and moves transfer the counters, so that a query is never accounted twice
+        KdTreeQueryRecorder(const KdTreeQueryRecorder&) {}
+        KdTreeQueryRecorder& operator=(const KdTreeQueryRecorder&) { clear(); return *this; }
+        KdTreeQueryRecorder(KdTreeQueryRecorder&& other) noexcept : counters(other.counters) { other.clear(); }
+        KdTreeQueryRecorder& operator=(KdTreeQueryRecorder&& other) noexcept
+        {
+            if (this != &other) { counters = other.counters; other.clear(); }
+            return *this;
+        }
+
+        inline void visitNode()   { ++counters.values[KdTreeQueryCounters::NodesVisited]; }
+        inline void visitLeaf()   { ++counters.values[KdTreeQueryCounters::LeavesVisited]; }
+        inline void testPoint()   { ++counters.values[KdTreeQueryCounters::PointsTested]; }
+        inline void acceptPoint() { ++counters.values[KdTreeQueryCounters::PointsAccepted]; }
+        inline void stackSize(int s)
+        {
+            auto& hw = counters.values[KdTreeQueryCounters::StackHighWater];
+            hw = std::max(hw, std::uint64_t(s));
+        }
+        inline bool empty() const { return counters.empty(); }
+        inline void clear() { counters = KdTreeQueryCounters(); }
+
+        KdTreeQueryCounters counters;
+    };
+
+    /// \brief Per-thread aggregation of the query counters, empty when the instrumentation is disabled
+    template <bool Enabled>
+    class KdTreeStatisticsCollector {};
+
+    template <>
+    class KdTreeStatisticsCollector<true>
+    {
+    public:
+        KdTreeStatisticsCollector() = default;
+        KdTreeStatisticsCollector(const KdTreeStatisticsCollector& other) { copyFrom(other); }
+        KdTreeStatisticsCollector& operator=(const KdTreeStatisticsCollector& other)
+        {
+            if (this != &other) { reset(); copyFrom(other); }
+            return *this;
+        }
+
+        /// \brief Accumulate the counters of a query in the statistics of the calling thread
+        inline void commit(const KdTreeQueryCounters& counters)
+        {
+            // Cache the storage of the calling thread, to lock only on the first query of each thread. The cache is
+            // keyed by collector, so that threads querying several trees alternately do not evict each other's entry
+            thread_local CacheEntry cache[CACHE_SIZE] {};
+            CacheEntry& entry = cache[m_id % CACHE_SIZE];
+            if (entry.id != m_id)
+            {
+                std::lock_guard<std::mutex> lock (m_mutex);
+                const auto tid = std::this_thread::get_id();
+                auto it = std::find_if(m_threads.begin(), m_threads.end(),
+                                       [tid](const ThreadEntry& e) { return e.first == tid; });
+                if (it == m_threads.end())
+                {
+                    m_threads.emplace_back(tid, std::make_unique<KdTreeQueryStatistics>());
+                    it = std::prev(m_threads.end());
+                }
+                entry.id    = m_id;
+                entry.stats = it->second.get();
+            }
+            entry.stats->add(counters);
+        }
+
+        /// \brief Statistics of each thread having run queries
+        inline std::vector<KdTreeQueryStatistics> perThread() const
+        {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            std::vector<KdTreeQueryStatistics> res;
+            for (const auto& e : m_threads) res.push_back(*e.second);
+            return res;
+        }
+
+        /// \brief Statistics of all the threads
+        inline KdTreeQueryStatistics merged() const
+        {
+            KdTreeQueryStatistics res;
+            for (const auto& s : perThread()) res.merge(s);
+            return res;
+        }
+
+        /// \brief Clear the statistics
+        inline void reset()
+        {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            m_threads.clear();
+            m_id = newId(); // invalidate the thread caches
+        }
+
+    private:
+        using ThreadEntry = std::pair<std::thread::id, std::unique_ptr<KdTreeQueryStatistics>>;
+
+        /// \brief Statistics of the calling thread for the collector `id`, cached per thread
+        struct CacheEntry
+        {
+            std::uint64_t id {0};
+            KdTreeQueryStatistics* stats {nullptr};
+        };
+        /// \brief Number of collectors cached per thread, the collectors being mapped to the entries by identifier
+        static constexpr std::uint64_t CACHE_SIZE = 8;
+
+        static inline std::uint64_t newId()
+        {
+            static std::atomic<std::uint64_t> counter {0};
+            return ++counter;
+        }
+
+        inline void copyFrom(const KdTreeStatisticsCollector& other)
+        {
+            std::lock_guard<std::mutex> lock (other.m_mutex);
+            for (const auto& e : other.m_threads)
+                m_threads.emplace_back(e.first, std::make_unique<KdTreeQueryStatistics>(*e.second));
+        }
+
+        std::uint64_t m_id {newId()};       ///< Unique identifier, used to validate the thread caches
+        mutable std::mutex m_mutex;         ///< Protects the list of threads
+        std::vector<ThreadEntry> m_threads; ///< Statistics of each thread
+    };
+}
+#endif
+
+} // namespace Ponca
@@ -8,8 +8,12 @@
 #pragma once
 
 #include "../../Common/Macro.h"
+#include "../../Common/allocators.h"
+#include "./kdTreeStatistics.h"
 
 #include <cstddef>
+#include <cstring>
+#include <vector>
 
 #include <Eigen/Geometry>
 
@@ -217,7 +221,9 @@ private:
         // We need an explicit constructor here, see https://stackoverflow.com/a/70428826
         constexpr Data() : m_leaf() {}
         // Needed to satisfy MoveInsertable requirement https://en.cppreference.com/w/cpp/named_req/MoveInsertable
-        constexpr Data(const Data&d) : m_leaf(d.m_leaf) {}
+        // The active member is unknown: copy the whole union, since inner nodes may be larger than leaves
+        Data(const Data&d) { std::memcpy(static_cast<void*>(this), &d, sizeof(Data)); }
+        Data& operator=(const Data&d) { std::memcpy(static_cast<void*>(this), &d, sizeof(Data)); return *this; }
 
         ~Data() {}
         LeafType m_leaf;
@@ -279,5 +285,51 @@ struct KdTreeDefaultTraits
     using NodeIndexType = std::size_t;
     using NodeType      = _NodeType<IndexType, NodeIndexType, DataPoint, LeafSizeType>;
     using NodeContainer = std::vector<NodeType>;
+
+    /*!
+     * \brief Instrumentation of the queries, disabled by default.
+     *
+     * Set to KdTreeCollectStatistics to collect query statistics (see KdTreeBase::query_statistics). Traits types not
+     * defining this type are not instrumented.
+     */
+    using StatisticsPolicy = KdTreeNoStatistics;
+};
+
+/*!
+ * \brief Traits of a kd-tree whose containers use a custom allocator
+ *
+ * Same as KdTreeDefaultTraits, with the points, indices and nodes stored in `std::vector`s using `_Allocator`, e.g.:
+ *  - ArenaAllocator, for short-lived trees rebuilt frequently (see MonotonicArena),
+ *  - HugePageAllocator, for large trees, to reduce the TLB misses of the queries,
+ *  - NumaLocalAllocator, to place the tree on the NUMA node of the threads using it. The node must be given to the
+ *    allocator: by default, the tree stays on the node of the thread building it, as with the default allocator.
+ *
+ * \code
+ * using Tree = KdTreeDenseBase<KdTreeAllocatorTraits<Point, HugePageAllocator>>;
+ * \endcode
+ *
+ * \tparam _Allocator Allocator template, instantiated for each container
+ * \see KnnGraphAllocatorTraits for the traits of the KnnGraph built on such trees
+ */
+template <typename _DataPoint,
+        template <typename /*T*/> typename _Allocator,
+        template <typename /*Index*/,
+                  typename /*NodeIndex*/,
+                  typename /*DataPoint*/,
+                  typename /*LeafSize*/> typename _NodeType = KdTreeDefaultNode>
+struct KdTreeAllocatorTraits : public KdTreeDefaultTraits<_DataPoint, _NodeType>
+{
+private:
+    using Base = KdTreeDefaultTraits<_DataPoint, _NodeType>;
+
+public:
+    /// \brief Allocator of the containers
+    template <typename T>
+    using Allocator = _Allocator<T>;
+
+    // Containers
+    using PointContainer = std::vector<typename Base::DataPoint, Allocator<typename Base::DataPoint>>;
+    using IndexContainer = std::vector<typename Base::IndexType, Allocator<typename Base::IndexType>>;
+    using NodeContainer  = std::vector<typename Base::NodeType, Allocator<typename Base::NodeType>>;
 };
 } // namespace Ponca
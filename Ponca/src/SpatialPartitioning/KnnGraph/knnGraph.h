@@ -7,12 +7,15 @@
 #pragma once
 
 #include "./knnGraphTraits.h"
+#include "./knnGraphStatistics.h"
 
 #include "Query/knnGraphKNearestQuery.h"
 #include "Query/knnGraphRangeQuery.h"
 
 #include "../KdTree/kdTree.h"
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 
 namespace Ponca {
@@ -64,11 +67,12 @@ public:
     ///
     /// \param k Number of requested neighbors. Might be reduced if k is larger than the kdtree size - 1
     ///          (query point is not included in query output, thus -1)
+    /// \param executor Executor running the queries, or nullptr to use defaultExecutor()
     ///
     /// \warning Stores a const reference to kdtree.point_data()
     /// \warning KdTreeTraits compatibility is checked with static assertion
     template<typename KdTreeTraits>
-    inline KnnGraphBase(const KdTreeBase<KdTreeTraits>& kdtree, int k = 6)
+    inline KnnGraphBase(const KdTreeBase<KdTreeTraits>& kdtree, int k = 6, Executor* executor = nullptr)
             : m_k(std::min(k,kdtree.sample_count()-1)),
               m_kdTreePoints(kdtree.points())
     {
@@ -90,8 +94,7 @@ public:
 
         m_indices.resize(cloudSize * m_k, -1);
 
-#pragma omp parallel for shared(kdtree, cloudSize) default(none)
-        for(int i=0; i<cloudSize; ++i)
+        executorOrDefault(executor).forEach(cloudSize, [this, &kdtree](std::ptrdiff_t i)
         {
             int j = 0;
             for(auto n : kdtree.k_nearest_neighbors(typename KdTreeTraits::IndexType(i),
@@ -100,7 +103,7 @@ public:
                 m_indices[i * m_k + j] = n;
                 ++j;
             }
-        }
+        });
     }
 
     // Query -------------------------------------------------------------------
@@ -120,6 +123,52 @@ public:
     /// \brief Number of vertices in the neighborhood graph
     inline int size() const { return m_indices.size()/m_k; }
 
+    // Utilities ---------------------------------------------------------------
+public:
+    /// \brief Compute the structure and memory footprint of the graph
+    /// \see KnnGraphStats::print_json
+    inline KnnGraphStats stats() const
+    {
+        KnnGraphStats res;
+        res.k            = m_k;
+        res.vertex_count = m_k == 0 ? 0 : size();
+        res.indices_bytes          = internal::ContainerBytes<IndexContainer>::used(m_indices);
+        res.indices_reserved_bytes = internal::ContainerBytes<IndexContainer>::reserved(m_indices);
+        res.points_bytes           = internal::ContainerBytes<PointContainer>::used(m_kdTreePoints);
+
+        double distanceSum = 0;
+        std::uint64_t distanceCount = 0;
+        for (std::uint64_t i = 0; i < res.vertex_count; ++i)
+        {
+            const auto begin = m_indices.begin() + i * m_k;
+            const auto end   = begin + m_k;
+            Scalar kthSquaredDistance {-1}; // the k-th neighbor is the farthest one
+            for (auto it = begin; it != end; ++it)
+            {
+                const IndexType j = *it;
+                if (j < 0)
+                {
+                    ++res.missing_neighbor_count;
+                    continue;
+                }
+                kthSquaredDistance = std::max(kthSquaredDistance,
+                                              (m_kdTreePoints[j].pos() - m_kdTreePoints[i].pos()).squaredNorm());
+                const auto opposite = m_indices.begin() + std::size_t(j) * m_k;
+                if (std::find(opposite, opposite + m_k, IndexType(i)) == opposite + m_k)
+                    ++res.asymmetric_edge_count;
+            }
+            if (kthSquaredDistance >= Scalar(0))
+            {
+                const double d = double(std::sqrt(kthSquaredDistance));
+                distanceSum += d;
+                res.max_kth_neighbor_distance = std::max(res.max_kth_neighbor_distance, d);
+                ++distanceCount;
+            }
+        }
+        res.mean_kth_neighbor_distance = distanceCount == 0 ? 0. : distanceSum / double(distanceCount);
+        return res;
+    }
+
     // Data --------------------------------------------------------------------
 private:
     const int m_k;
@@ -0,0 +1,53 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "../KdTree/kdTreeStatistics.h"
+
+#include <cstdint>
+#include <ostream>
+
+namespace Ponca {
+
+/*!
+ * \brief Structure and memory footprint of a KnnGraph
+ *
+ * \see KnnGraphBase::stats
+ */
+struct KnnGraphStats
+{
+    std::uint64_t vertex_count {0};              ///< Number of vertices
+    std::uint64_t k {0};                         ///< Number of neighbors per vertex
+    std::uint64_t missing_neighbor_count {0};    ///< Neighbor slots without a valid neighbor
+    /// Number of edges whose opposite edge is not in the graph
+    std::uint64_t asymmetric_edge_count {0};
+
+    double mean_kth_neighbor_distance {0};       ///< Mean distance between the vertices and their k-th neighbor
+    double max_kth_neighbor_distance {0};        ///< Largest distance between a vertex and its k-th neighbor
+
+    std::uint64_t indices_bytes {0};             ///< Bytes used by the neighbor indices
+    std::uint64_t indices_reserved_bytes {0};    ///< Bytes allocated by the index container
+    /// Bytes used by the points, which are not owned by the graph but shared with the KdTree it was built from
+    std::uint64_t points_bytes {0};
+
+    /// \brief Write the statistics as a JSON object
+    inline void print_json(std::ostream& os) const
+    {
+        os << "{";
+        os << "\"vertex_count\": " << vertex_count;
+        os << ", \"k\": " << k;
+        os << ", \"missing_neighbor_count\": " << missing_neighbor_count;
+        os << ", \"asymmetric_edge_count\": " << asymmetric_edge_count;
+        os << ", \"mean_kth_neighbor_distance\": " << mean_kth_neighbor_distance;
+        os << ", \"max_kth_neighbor_distance\": " << max_kth_neighbor_distance;
+        os << ", \"bytes\": {\"indices\": " << indices_bytes << ", \"shared_points\": " << points_bytes << "}";
+        os << ", \"reserved_bytes\": {\"indices\": " << indices_reserved_bytes << "}";
+        os << "}";
+    }
+};
+
+} // namespace Ponca
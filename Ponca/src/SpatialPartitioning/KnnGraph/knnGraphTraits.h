@@ -7,8 +7,12 @@
 
 #pragma once
 
+#include "../../Common/allocators.h"
+
 #include <Eigen/Geometry>
 
+#include <vector>
+
 namespace Ponca {
 
 /*!
@@ -45,4 +49,29 @@ public:
     using PointContainer = std::vector<DataPoint>;
     using IndexContainer = std::vector<IndexType>;
 };
+
+/*!
+ * \brief Traits of a KnnGraph whose containers use a custom allocator
+ *
+ * Must be used with the same allocator as the kd-tree the graph is built from (see KdTreeAllocatorTraits):
+ * \code
+ * KdTreeDenseBase<KdTreeAllocatorTraits<Point, HugePageAllocator>> tree (points);
+ * KnnGraphBase<KnnGraphAllocatorTraits<Point, HugePageAllocator>> graph (tree, k);
+ * \endcode
+ */
+template <typename _DataPoint, template <typename /*T*/> typename _Allocator>
+struct KnnGraphAllocatorTraits : public KnnGraphDefaultTraits<_DataPoint>
+{
+private:
+    using Base = KnnGraphDefaultTraits<_DataPoint>;
+
+public:
+    /// \brief Allocator of the containers
+    template <typename T>
+    using Allocator = _Allocator<T>;
+
+    // Containers
+    using PointContainer = std::vector<typename Base::DataPoint, Allocator<typename Base::DataPoint>>;
+    using IndexContainer = std::vector<typename Base::IndexType, Allocator<typename Base::IndexType>>;
+};
 } // namespace Ponca
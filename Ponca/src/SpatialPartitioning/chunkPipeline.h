@@ -0,0 +1,397 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#pragma once
+
+#include "./KdTree/kdTree.h"
+#include "../Common/Containers/boundedQueue.h"
+#include "../Common/executor.h"
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Ponca {
+
+/// \brief Timings and counters of a ChunkPipeline::run
+struct ChunkPipelineStats
+{
+    std::size_t chunk_count {0};     ///< Number of non-empty chunks processed
+    std::size_t core_count  {0};     ///< Number of points processed (and written)
+    std::size_t halo_count  {0};     ///< Number of halo points loaded in addition to the core points
+    double load_seconds  {0};        ///< Time spent in the load stage
+    double index_seconds {0};        ///< Time spent building the trees
+    double fit_seconds   {0};        ///< Time spent in the fitting stage
+    double write_seconds {0};        ///< Time spent in the write stage
+    double total_seconds {0};        ///< Wall-clock time of the run
+
+    /// \brief Time of the slowest stage, i.e. the lower bound of total_seconds
+    inline double bottleneck_seconds() const
+    {
+        return std::max(std::max(load_seconds, index_seconds), std::max(fit_seconds, write_seconds));
+    }
+};
+
+/*!
+ * \brief Process a large point cloud by spatial chunks, overlapping loading, indexing, fitting and writing
+ *
+ * The domain is split in a regular grid of chunks. Each chunk goes through four stages, connected by bounded queues
+ * (see BoundedQueue):
+ *  1. load: the user loader fills the points of the chunk lying in its `loadBox`, i.e. its `box` enlarged by the halo
+ *     margin. The points are then sorted so that the core points, i.e. the points of the chunk, come first, followed
+ *     by the halo points, i.e. the points of the neighboring chunks within the halo margin;
+ *  2. index: a KdTree is built on the core and halo points, in a single thread;
+ *  3. fit: the user fitter computes a result for each core point, in parallel (see setExecutor);
+ *  4. write: the user writer receives the results of the core points.
+ *
+ * Load, index and write run in their own threads, and fitting runs in the calling thread: while chunk N is fitted,
+ * chunk N+1 is indexed and chunk N+2 is loaded, and the throughput approaches the throughput of the slowest stage.
+ * Each point is the core point of exactly one chunk (the chunk containing it, or the nearest chunk for points outside
+ * the domain), so that results are never duplicated nor missing, while the halo provides the complete neighborhoods
+ * of the core points as long as the halo margin is at least the maximum query radius of the fitter.
+ *
+ * \code
+ * ChunkPipeline<Point> pipeline;
+ * pipeline.setDomain(domain);
+ * pipeline.setChunkSize(10);
+ * pipeline.setHaloMargin(scale);
+ * pipeline.run(
+ *     // Load the points (and their ids) lying in chunk.loadBox
+ *     [&](auto& chunk) { return reader.read(chunk.loadBox, chunk.points, chunk.ids); },
+ *     // Fit core point i of the chunk, using chunk.tree for the neighbor queries
+ *     [&](const auto& chunk, int i) {
+ *         Fit fit;
+ *         fit.setWeightFunc(WeightFunc(scale));
+ *         fit.computeWithIds(chunk.tree.range_neighbors(i, scale), chunk.tree.points());
+ *         return fit.kappa();
+ *     },
+ *     // Write the results of the core points, results[i] being the result of core point i
+ *     [&](const auto& chunk, const std::vector<Scalar>& results) { return writer.write(chunk.ids, results); });
+ * \endcode
+ *
+ * \tparam DataPoint Point type
+ * \tparam Tree Spatial partitioning structure built for each chunk, providing `build` and `points`
+ */
+template <typename _DataPoint, typename _Tree = KdTreeDense<_DataPoint>>
+class ChunkPipeline
+{
+public:
+    using DataPoint      = _DataPoint;                            /*!< \brief Point type used for computation */
+    using Tree           = _Tree;                                 /*!< \brief Structure built for each chunk */
+    using Scalar         = typename DataPoint::Scalar;            /*!< \brief Scalar type used for computation */
+    using VectorType     = typename DataPoint::VectorType;        /*!< \brief Vector type used for computation */
+    using AabbType       = Eigen::AlignedBox<Scalar, DataPoint::Dim>;
+    using PointContainer = typename Tree::PointContainer;
+    using GridIndex      = Eigen::Matrix<int, DataPoint::Dim, 1>;
+
+    /// \brief Chunk of points going through the pipeline
+    struct Chunk
+    {
+        int id {0};                      ///< Index of the chunk in the grid (first dimension varying fastest)
+        GridIndex cell;                  ///< Position of the chunk in the grid
+        AabbType box;                    ///< Region of the core points
+        AabbType loadBox;                ///< Region of the core and halo points
+        /// Points, filled by the loader. The core points are moved first by the pipeline, and the container is then
+        /// moved into `tree`: use `tree.points()` in the fitting and writing stages.
+        PointContainer points;
+        /// Optional identifiers of the points (e.g. indices in the file), filled by the loader and sorted as points
+        std::vector<std::size_t> ids;
+        int coreCount {0};               ///< Number of core points, stored first
+        Tree tree;                       ///< Structure built on the core and halo points
+
+        /// \brief Number of halo points, stored after the core points (once the tree is built)
+        inline int haloCount() const { return int(tree.point_count()) - coreCount; }
+    };
+
+    /*!
+     * \brief Set the region split into chunks, which should contain all the points
+     *
+     * Points outside of the domain are processed by the nearest border chunk if the loader returns them.
+     */
+    inline void setDomain(const AabbType& _domain) { m_domain = _domain; }
+
+    /// \brief Set the size of the chunks, along each dimension
+    inline void setChunkSize(Scalar _size) { m_chunkSize = _size; }
+
+    /// \brief Set the margin around the chunks from which halo points are loaded, e.g. the maximum fitting scale
+    inline void setHaloMargin(Scalar _margin) { m_haloMargin = std::max(_margin, Scalar(0)); }
+
+    /// \brief Set the number of chunks waiting between two stages
+    inline void setQueueCapacity(int _capacity) { m_queueCapacity = std::max(_capacity, 1); }
+
+    /// \brief Set the executor running the fitting stage, or nullptr to use defaultExecutor()
+    inline void setExecutor(Executor* _executor) { m_executor = _executor; }
+
+    inline const AabbType& domain() const { return m_domain; }
+    inline Scalar chunkSize() const { return m_chunkSize; }
+    inline Scalar haloMargin() const { return m_haloMargin; }
+    inline int queueCapacity() const { return m_queueCapacity; }
+
+    /// \brief Number of chunks along each dimension
+    inline GridIndex gridSize() const
+    {
+        GridIndex res;
+        for (int d = 0; d < DataPoint::Dim; ++d)
+            res[d] = std::max(1, int(std::ceil((m_domain.max()[d] - m_domain.min()[d]) / m_chunkSize)));
+        return res;
+    }
+
+    /// \brief Number of chunks
+    inline int chunkCount() const { return gridSize().prod(); }
+
+    /// \brief Chunk owning the point at `p` as a core point
+    inline GridIndex cellOf(const VectorType& p) const { return cellOf(p, gridSize()); }
+
+private:
+    inline GridIndex cellOf(const VectorType& p, const GridIndex& size) const
+    {
+        GridIndex res;
+        for (int d = 0; d < DataPoint::Dim; ++d)
+            res[d] = std::clamp(int(std::floor((p[d] - m_domain.min()[d]) / m_chunkSize)), 0, size[d] - 1);
+        return res;
+    }
+
+public:
+    /*!
+     * \brief Process all the chunks, return false if a stage failed
+     *
+     * \param load `bool(Chunk&)`: fill `chunk.points` (and optionally `chunk.ids`) with the points in `chunk.loadBox`.
+     *        Points outside of the `loadBox` are accepted, and processed if they belong to the chunk.
+     * \param fit `Result(const Chunk&, int i)`: compute the result of core point `i`. Called concurrently.
+     * \param write `bool(const Chunk&, const std::vector<Result>&)`: write the results of the core points.
+     *        Chunks are written in the order of their id.
+     *
+     * Stages are stopped as soon as the loader or the writer return false. When a stage throws (the loader, the
+     * construction of a KdTree, the fitter or the writer), all the stages are stopped and the first exception is
+     * rethrown.
+     */
+    template <typename Loader, typename Fitter, typename Writer>
+    inline bool run(Loader&& load, Fitter&& fit, Writer&& write);
+
+    /// \brief Timings and counters of the last run
+    inline const ChunkPipelineStats& stats() const { return m_stats; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static inline double seconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    /// \brief Prepare the chunk `id`
+    inline std::unique_ptr<Chunk> makeChunk(int id) const
+    {
+        auto chunk = std::make_unique<Chunk>();
+        const GridIndex size = gridSize();
+        chunk->id = id;
+        for (int d = 0, i = id; d < DataPoint::Dim; ++d)
+        {
+            chunk->cell[d] = i % size[d];
+            i /= size[d];
+        }
+        const VectorType min = m_domain.min() + chunk->cell.template cast<Scalar>() * m_chunkSize;
+        chunk->box     = AabbType(min, (min.array() + m_chunkSize).matrix().cwiseMin(m_domain.max()));
+        chunk->loadBox = AabbType(chunk->box.min().array() - m_haloMargin, chunk->box.max().array() + m_haloMargin);
+        return chunk;
+    }
+
+    /// \brief Move the core points of `chunk` first
+    inline void sortCorePoints(Chunk& chunk) const
+    {
+        const auto n = chunk.points.size();
+        PONCA_DEBUG_ASSERT(chunk.ids.empty() || chunk.ids.size() == n);
+        std::vector<std::size_t> order (n);
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        const GridIndex size = gridSize();
+        const auto firstHalo = std::stable_partition(order.begin(), order.end(),
+            [&](std::size_t i) { return cellOf(chunk.points[i].pos(), size) == chunk.cell; });
+        chunk.coreCount = int(firstHalo - order.begin());
+        if (chunk.coreCount == int(n)) return;
+
+        PointContainer points;
+        points.reserve(n);
+        for (auto i : order) points.push_back(chunk.points[i]);
+        chunk.points = std::move(points);
+        if (! chunk.ids.empty())
+        {
+            std::vector<std::size_t> ids (n);
+            for (std::size_t i = 0; i < n; ++i) ids[i] = chunk.ids[order[i]];
+            chunk.ids = std::move(ids);
+        }
+    }
+
+    AabbType m_domain;
+    Scalar m_chunkSize {1};
+    Scalar m_haloMargin {0};
+    int m_queueCapacity {2};
+    Executor* m_executor {nullptr};
+    ChunkPipelineStats m_stats;
+};
+
+template <typename _DataPoint, typename _Tree>
+template <typename Loader, typename Fitter, typename Writer>
+bool ChunkPipeline<_DataPoint, _Tree>::run(Loader&& load, Fitter&& fit, Writer&& write)
+{
+    using Result  = std::decay_t<std::invoke_result_t<Fitter&, const Chunk&, int>>;
+    using ChunkPtr = std::unique_ptr<Chunk>;
+    struct FittedChunk
+    {
+        ChunkPtr chunk;
+        std::vector<Result> results;
+    };
+
+    m_stats = ChunkPipelineStats();
+    const auto start = Clock::now();
+    const int nChunks = chunkCount();
+
+    const auto capacity = std::size_t(m_queueCapacity);
+    BoundedQueue<ChunkPtr> loaded {capacity}, indexed {capacity};
+    BoundedQueue<FittedChunk> fitted {capacity};
+    std::atomic<bool> failed {false};
+    auto abort = [&]() {
+        failed = true;
+        loaded.close();
+        indexed.close();
+        fitted.close();
+    };
+    // First exception thrown by a stage, rethrown once all the stages are stopped
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto fail = [&](std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (! error) error = std::move(e);
+        }
+        abort();
+    };
+
+    // Stops and joins the stage threads when leaving the function early (e.g. if a thread cannot be created)
+    std::thread loadStage, indexStage, writeStage;
+    struct StageGuard
+    {
+        decltype(abort)& stop;
+        std::thread* threads[3];
+        inline ~StageGuard()
+        {
+            bool running = false;
+            for (auto* t : threads) running = running || t->joinable();
+            if (! running) return;
+            stop();
+            for (auto* t : threads) if (t->joinable()) t->join();
+        }
+    } guard {abort, {&loadStage, &indexStage, &writeStage}};
+
+    // Each stage thread owns its counters, read after the threads are joined
+    std::size_t haloCount = 0;
+    loadStage = std::thread([&]() {
+        try
+        {
+            for (int id = 0; id < nChunks && ! failed; ++id)
+            {
+                const auto t = Clock::now();
+                ChunkPtr chunk = makeChunk(id);
+                if (! load(*chunk)) { abort(); break; }
+                sortCorePoints(*chunk);
+                m_stats.load_seconds += seconds(t);
+                if (chunk->coreCount == 0) continue;
+                haloCount += chunk->points.size() - std::size_t(chunk->coreCount);
+                if (! loaded.push(std::move(chunk))) break;
+            }
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+        loaded.close();
+    });
+
+    indexStage = std::thread([&]() {
+        try
+        {
+            // The executor is left to the fitting stage, running concurrently
+            SerialExecutor serial;
+            ChunkPtr chunk;
+            while (loaded.pop(chunk) && ! failed)
+            {
+                const auto t = Clock::now();
+                chunk->tree.set_executor(&serial);
+                chunk->tree.build(std::move(chunk->points));
+                chunk->tree.set_executor(nullptr);
+                chunk->points = PointContainer();
+                m_stats.index_seconds += seconds(t);
+                if (! indexed.push(std::move(chunk))) break;
+            }
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+        indexed.close();
+    });
+
+    writeStage = std::thread([&]() {
+        try
+        {
+            FittedChunk item;
+            while (fitted.pop(item) && ! failed)
+            {
+                const auto t = Clock::now();
+                const auto& results = static_cast<const std::vector<Result>&>(item.results);
+                if (! write(static_cast<const Chunk&>(*item.chunk), results)) abort();
+                m_stats.write_seconds += seconds(t);
+            }
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+    });
+
+    // Fitting stage, in the calling thread
+    try
+    {
+        ChunkPtr chunk;
+        while (indexed.pop(chunk) && ! failed)
+        {
+            const auto t = Clock::now();
+            const Chunk& c = *chunk;
+            std::vector<Result> results (std::size_t(c.coreCount));
+            executorOrDefault(m_executor).forEach(c.coreCount, [&](std::ptrdiff_t i) {
+                results[std::size_t(i)] = fit(c, int(i));
+            }, 64);
+            m_stats.fit_seconds += seconds(t);
+            ++m_stats.chunk_count;
+            m_stats.core_count += std::size_t(c.coreCount);
+            if (! fitted.push({std::move(chunk), std::move(results)})) break;
+        }
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+    fitted.close();
+
+    loadStage.join();
+    indexStage.join();
+    writeStage.join();
+    if (error) std::rethrow_exception(error);
+    m_stats.halo_count    = haloCount;
+    m_stats.total_seconds = seconds(start);
+    return ! failed;
+}
+
+} // namespace Ponca
@@ -0,0 +1,391 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/common/benchmark.h
+    \brief Minimal timing harness used by the benchmarks, writing machine-readable JSON results
+
+    Each benchmark executable creates a Runner, registers timed functions with Runner::run, and calls Runner::finish.
+    The following command line options are supported by all the benchmarks:
+     - `--filter=<str>`: only run the benchmarks whose name contains `<str>`
+     - `--json=<file>`: write the results to `<file>`
+     - `--min-time=<seconds>`: minimal duration of each repetition (default 0.1)
+     - `--repetitions=<n>`: number of timed repetitions (default 3)
+     - `--max-size=<n>`: largest point cloud size (default 1e6, sizes go up to 1e8)
+     - `--list`: print the names of the benchmarks without running them
+     - `--baseline=<file>`: compare the results to a JSON file written by a previous run, and fail on regressions
+     - `--threshold=<fraction>`: relative slowdown tolerated by the baseline comparison (default 0.15)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace PoncaBenchmark {
+
+/// \brief Command line options shared by all the benchmarks
+struct Options
+{
+    std::string filter;                  ///< Substring selecting the benchmarks to run
+    std::string jsonPath;                ///< Output file, empty to disable the JSON output
+    double minTime {0.1};                ///< Minimal duration of a repetition, in seconds
+    int repetitions {3};                 ///< Number of timed repetitions
+    std::size_t maxSize {1000000};       ///< Largest point cloud size
+    bool list {false};                   ///< Only list the benchmarks
+    std::string baselinePath;            ///< Results the run is compared to, empty to disable the comparison
+    double threshold {0.15};             ///< Relative slowdown above which a benchmark is reported as a regression
+};
+
+inline void printUsage(const char* exe)
+{
+    std::cout << "Usage: " << exe << " [--filter=<str>] [--json=<file>] [--min-time=<seconds>]"
+              << " [--repetitions=<n>] [--max-size=<n>] [--list] [--baseline=<file>] [--threshold=<fraction>]"
+              << std::endl;
+}
+
+/// \brief Parse the command line, return false when the benchmarks must not be run
+inline bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto value = [&arg](const std::string& prefix, std::string& out) {
+            if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+            out = arg.substr(prefix.size());
+            return true;
+        };
+        std::string v;
+        if      (value("--filter=", v))      options.filter = v;
+        else if (value("--json=", v))        options.jsonPath = v;
+        else if (value("--min-time=", v))    options.minTime = std::atof(v.c_str());
+        else if (value("--repetitions=", v)) options.repetitions = std::max(1, std::atoi(v.c_str()));
+        else if (value("--max-size=", v))    options.maxSize = std::size_t(std::atof(v.c_str()));
+        else if (value("--baseline=", v))    options.baselinePath = v;
+        else if (value("--threshold=", v))   options.threshold = std::atof(v.c_str());
+        else if (arg == "--list")            options.list = true;
+        else
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// \brief Prevent the compiler from optimizing away the computation of `value`
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/// \brief Timings of a benchmark
+struct Result
+{
+    std::string name;
+    std::uint64_t iterations {0};        ///< Total number of timed iterations
+    int repetitions {0};
+    double medianTime {0};               ///< Median over the repetitions of the time per iteration, in ns
+    double minTime {0};                  ///< Fastest repetition, in ns per iteration
+    double meanTime {0};                 ///< Mean over the repetitions, in ns per iteration
+    double stddevTime {0};               ///< Standard deviation over the repetitions, in ns per iteration
+    double madTime {0};                  ///< Median absolute deviation over the repetitions, in ns per iteration
+    std::uint64_t items {0};             ///< Number of items processed by an iteration
+    double itemsPerSecond {0};           ///< Throughput of the median repetition
+};
+
+inline double median(std::vector<double> values)
+{
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    const std::size_t n = values.size();
+    return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.;
+}
+
+/*!
+ * \brief Read the results of a JSON file written by Runner::printJson
+ *
+ * This is not a general JSON parser: it relies on the layout of Runner::printJson, which writes each benchmark on its
+ * own line. Returns an empty list if the file cannot be read.
+ */
+inline std::vector<Result> loadResults(const std::string& path)
+{
+    std::vector<Result> res;
+    std::ifstream file (path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const std::string nameKey = "\"name\": \"";
+        const auto namePos = line.find(nameKey);
+        if (namePos == std::string::npos) continue;
+        const auto nameEnd = line.find('"', namePos + nameKey.size());
+        if (nameEnd == std::string::npos) continue;
+
+        const auto number = [&line](const std::string& key) {
+            const auto pos = line.find("\"" + key + "\": ");
+            return pos == std::string::npos ? 0. : std::strtod(line.c_str() + pos + key.size() + 4, nullptr);
+        };
+        Result r;
+        r.name           = line.substr(namePos + nameKey.size(), nameEnd - namePos - nameKey.size());
+        r.iterations     = std::uint64_t(number("iterations"));
+        r.repetitions    = int(number("repetitions"));
+        r.medianTime     = number("median_time_ns");
+        r.minTime        = number("min_time_ns");
+        r.meanTime       = number("mean_time_ns");
+        r.stddevTime     = number("stddev_time_ns");
+        r.madTime        = number("mad_time_ns");
+        r.items          = std::uint64_t(number("items"));
+        r.itemsPerSecond = number("items_per_second");
+        res.push_back(r);
+    }
+    return res;
+}
+
+/*!
+ * \brief Compare results to a baseline, and report the regressions in `os`
+ *
+ * A benchmark regresses when its median time exceeds the baseline median by more than `threshold` (relative), and
+ * by more than three times the noise of the two runs. The noise is estimated by the median absolute deviations,
+ * scaled to be consistent with a standard deviation (factor 1.4826). Benchmarks missing from the baseline are
+ * reported, but are not regressions.
+ *
+ * \return The number of regressions
+ */
+inline int compareResults(const std::vector<Result>& baseline, const std::vector<Result>& results, double threshold,
+                          std::ostream& os)
+{
+    int regressions = 0;
+    os << std::left << std::setw(56) << "Benchmark" << std::right << std::setw(16) << "Baseline (ns)"
+       << std::setw(16) << "Current (ns)" << std::setw(10) << "Change" << std::endl;
+    for (const Result& r : results)
+    {
+        const auto b = std::find_if(baseline.begin(), baseline.end(), [&r](const Result& b) { return b.name == r.name; });
+        os << std::left << std::setw(56) << r.name << std::right;
+        if (b == baseline.end() || b->medianTime <= 0)
+        {
+            os << std::setw(16) << "-" << std::setw(16) << std::fixed << std::setprecision(0) << r.medianTime
+               << std::defaultfloat << "  (no baseline)" << std::endl;
+            continue;
+        }
+        const double change = (r.medianTime - b->medianTime) / b->medianTime;
+        const double noise  = 1.4826 * std::sqrt(b->madTime * b->madTime + r.madTime * r.madTime);
+        const bool regression = change > threshold && r.medianTime - b->medianTime > 3. * noise;
+        regressions += regression ? 1 : 0;
+        os << std::setw(16) << std::fixed << std::setprecision(0) << b->medianTime << std::setw(16) << r.medianTime
+           << std::setw(9) << std::showpos << std::setprecision(1) << 100. * change << "%" << std::noshowpos
+           << std::defaultfloat << (regression ? "  REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
+
+/*!
+ * \brief Run and time benchmarks, and report their results
+ *
+ * Each function registered with run is called once to warm the caches, then for each repetition as many times as
+ * needed to last at least Options::minTime.
+ */
+class Runner
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    inline Runner(std::string suite, Options options)
+        : m_suite(std::move(suite)), m_options(std::move(options)) {}
+
+    inline const Options& options() const { return m_options; }
+
+    /// \brief Point cloud sizes from 10^4 to 10^8, limited by Options::maxSize
+    inline std::vector<std::size_t> sizes() const
+    {
+        std::vector<std::size_t> res;
+        for (std::size_t n = 10000; n <= std::size_t(100000000) && n <= m_options.maxSize; n *= 10)
+            res.push_back(n);
+        return res;
+    }
+
+    /// \brief Tell if the benchmark `name` is selected by the filter
+    inline bool enabled(const std::string& name) const
+    {
+        return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+    }
+
+    /// \brief Tell if one of the benchmarks `names` will be run, i.e. if their input data must be generated
+    inline bool needsData(const std::vector<std::string>& names) const
+    {
+        return ! m_options.list &&
+               std::any_of(names.begin(), names.end(), [this](const std::string& n) { return enabled(n); });
+    }
+
+    /*!
+     * \brief Time the function `f`
+     * \param name Name of the benchmark, used in the reports and by the filter
+     * \param items Number of items (e.g. points or queries) processed by each call to `f`, used for the throughput
+     * \param f Function running one iteration
+     */
+    template <typename F>
+    inline void run(const std::string& name, std::uint64_t items, F&& f)
+    {
+        if (! enabled(name)) return;
+        if (m_options.list)
+        {
+            std::cout << name << std::endl;
+            return;
+        }
+
+        f(); // warm-up
+
+        Result res;
+        res.name        = name;
+        res.items       = items;
+        res.repetitions = m_options.repetitions;
+        std::vector<double> times;
+        for (int r = 0; r < m_options.repetitions; ++r)
+        {
+            std::uint64_t iterations = 0;
+            const auto start = Clock::now();
+            double elapsed = 0;
+            do
+            {
+                f();
+                ++iterations;
+                elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            } while (elapsed < m_options.minTime);
+            res.iterations += iterations;
+            times.push_back(elapsed * 1e9 / double(iterations));
+        }
+
+        std::sort(times.begin(), times.end());
+        const std::size_t n = times.size();
+        res.medianTime = median(times);
+        res.minTime    = times.front();
+        std::vector<double> deviations;
+        for (double t : times) deviations.push_back(std::abs(t - res.medianTime));
+        res.madTime = median(deviations);
+        for (double t : times) res.meanTime += t / double(n);
+        for (double t : times) res.stddevTime += (t - res.meanTime) * (t - res.meanTime) / double(n);
+        res.stddevTime = std::sqrt(res.stddevTime);
+        res.itemsPerSecond = double(items) * 1e9 / res.medianTime;
+
+        std::cout << std::left << std::setw(56) << res.name << std::right
+                  << std::setw(16) << std::fixed << std::setprecision(0) << res.medianTime << " ns"
+                  << std::setw(16) << std::scientific << std::setprecision(3) << res.itemsPerSecond << " items/s"
+                  << std::defaultfloat << std::endl;
+        m_results.push_back(res);
+    }
+
+    inline const std::vector<Result>& results() const { return m_results; }
+
+    /// \brief Write the results in JSON, to `os`
+    inline void printJson(std::ostream& os) const
+    {
+        const std::time_t now = std::time(nullptr);
+        char date[32];
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+        os << "{\n  \"context\": {";
+        os << "\n    \"suite\": \"" << m_suite << "\",";
+        os << "\n    \"date\": \"" << date << "\",";
+#ifdef PONCA_BENCHMARK_GIT_CHANGESET
+        os << "\n    \"git_changeset\": \"" << PONCA_BENCHMARK_GIT_CHANGESET << "\",";
+#endif
+#ifdef PONCA_BENCHMARK_BUILD_TYPE
+        os << "\n    \"build_type\": \"" << PONCA_BENCHMARK_BUILD_TYPE << "\",";
+#endif
+#ifdef __VERSION__
+        os << "\n    \"compiler\": \"" << __VERSION__ << "\",";
+#endif
+#ifdef _OPENMP
+        os << "\n    \"threads\": " << omp_get_max_threads() << ",";
+#else
+        os << "\n    \"threads\": 1,";
+#endif
+        os << "\n    \"min_time\": " << m_options.minTime << ",";
+        os << "\n    \"repetitions\": " << m_options.repetitions;
+        os << "\n  },\n  \"benchmarks\": [";
+        for (std::size_t i = 0; i < m_results.size(); ++i)
+        {
+            const Result& r = m_results[i];
+            os << (i == 0 ? "" : ",") << "\n    {";
+            os << "\"name\": \"" << r.name << "\"";
+            os << ", \"iterations\": " << r.iterations;
+            os << ", \"repetitions\": " << r.repetitions;
+            os << std::setprecision(12);
+            os << ", \"median_time_ns\": " << r.medianTime;
+            os << ", \"min_time_ns\": " << r.minTime;
+            os << ", \"mean_time_ns\": " << r.meanTime;
+            os << ", \"stddev_time_ns\": " << r.stddevTime;
+            os << ", \"mad_time_ns\": " << r.madTime;
+            os << ", \"items\": " << r.items;
+            os << ", \"items_per_second\": " << r.itemsPerSecond;
+            os << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    /// \brief Write the JSON report and compare to the baseline if requested, and return the exit code of the benchmark
+    inline int finish() const
+    {
+        if (m_options.list)
+            return EXIT_SUCCESS;
+
+        if (! m_options.jsonPath.empty())
+        {
+            std::ofstream file (m_options.jsonPath);
+            if (! file)
+            {
+                std::cerr << "Cannot write " << m_options.jsonPath << std::endl;
+                return EXIT_FAILURE;
+            }
+            printJson(file);
+        }
+
+        if (! m_options.baselinePath.empty())
+        {
+            const std::vector<Result> baseline = loadResults(m_options.baselinePath);
+            if (baseline.empty())
+            {
+                std::cerr << "Cannot read baseline " << m_options.baselinePath << std::endl;
+                return EXIT_FAILURE;
+            }
+            std::cout << "\nComparison to " << m_options.baselinePath << " (threshold "
+                      << 100. * m_options.threshold << "%)" << std::endl;
+            const int regressions = compareResults(baseline, m_results, m_options.threshold, std::cout);
+            if (regressions > 0)
+            {
+                std::cerr << regressions << " performance regression(s) detected" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+private:
+    std::string m_suite;
+    Options m_options;
+    std::vector<Result> m_results;
+};
+
+} // namespace PoncaBenchmark
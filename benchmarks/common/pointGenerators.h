@@ -0,0 +1,170 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/common/pointGenerators.h
+    \brief Point type and reproducible point cloud distributions used by the benchmarks
+ */
+
+#pragma once
+
+#include <Ponca/src/Common/defines.h>
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace PoncaBenchmark {
+
+/// \brief Point with position and normal vector
+template<typename _Scalar, int _Dim>
+class BenchPoint
+{
+public:
+    enum {Dim = _Dim};
+    typedef _Scalar Scalar;
+    typedef Eigen::Matrix<Scalar, Dim,   1> VectorType;
+    typedef Eigen::Matrix<Scalar, Dim, Dim> MatrixType;
+
+    PONCA_MULTIARCH inline BenchPoint(const VectorType &pos    = VectorType::Zero(),
+                                      const VectorType& normal = VectorType::Zero())
+        : m_pos(pos), m_normal(normal) {}
+
+    PONCA_MULTIARCH inline const VectorType& pos()    const { return m_pos; }
+    PONCA_MULTIARCH inline const VectorType& normal() const { return m_normal; }
+
+    PONCA_MULTIARCH inline VectorType& pos()    { return m_pos; }
+    PONCA_MULTIARCH inline VectorType& normal() { return m_normal; }
+
+private:
+    VectorType m_pos, m_normal;
+};
+
+/// \brief Point cloud distributions
+enum class Distribution
+{
+    Uniform,    ///< Uniform in the cube \f$ [-1, 1]^d \f$
+    Clustered,  ///< Mixture of small gaussian clusters, stressing the balance of the trees
+    Surface     ///< Uniform on the unit sphere, typical of scanned surfaces
+};
+
+inline const std::vector<Distribution>& distributions()
+{
+    static const std::vector<Distribution> res {Distribution::Uniform, Distribution::Clustered, Distribution::Surface};
+    return res;
+}
+
+inline std::string name(Distribution d)
+{
+    switch (d)
+    {
+        case Distribution::Uniform:   return "uniform";
+        case Distribution::Clustered: return "clustered";
+        case Distribution::Surface:   return "surface";
+    }
+    return "unknown";
+}
+
+/*!
+ * \brief Generate `n` points following the distribution `d`
+ *
+ * The points are generated from a fixed seed, so that successive runs of the benchmarks use the same data. Normals
+ * are the sphere normals for Distribution::Surface, and random unit vectors otherwise.
+ */
+template <typename DataPoint>
+std::vector<DataPoint> generatePoints(std::size_t n, Distribution d, std::uint64_t seed = 42)
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    std::mt19937_64 gen (seed);
+    std::uniform_real_distribution<double> uniform (-1., 1.);
+    std::normal_distribution<double> normal (0., 1.);
+    const auto randomVector = [&]() {
+        VectorType v;
+        for (int i = 0; i < DataPoint::Dim; ++i) v[i] = Scalar(uniform(gen));
+        return v;
+    };
+    const auto randomDirection = [&]() {
+        VectorType v;
+        do { for (int i = 0; i < DataPoint::Dim; ++i) v[i] = Scalar(normal(gen)); } while (v.squaredNorm() == Scalar(0));
+        return VectorType(v.normalized());
+    };
+
+    constexpr int nbClusters = 32;
+    std::vector<VectorType> centers;
+    std::vector<Scalar> sigmas;
+    for (int c = 0; c < nbClusters; ++c)
+    {
+        centers.push_back(Scalar(0.8) * randomVector());
+        sigmas.push_back(Scalar(0.01 + 0.05 * (uniform(gen) + 1.)));
+    }
+
+    std::vector<DataPoint> res;
+    res.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        switch (d)
+        {
+            case Distribution::Uniform:
+                res.emplace_back(randomVector(), randomDirection());
+                break;
+            case Distribution::Clustered:
+            {
+                const int c = int(std::uniform_int_distribution<int>(0, nbClusters - 1)(gen));
+                VectorType p;
+                for (int k = 0; k < DataPoint::Dim; ++k) p[k] = centers[c][k] + sigmas[c] * Scalar(normal(gen));
+                res.emplace_back(p, randomDirection());
+                break;
+            }
+            case Distribution::Surface:
+            {
+                const VectorType dir = randomDirection();
+                res.emplace_back(dir, dir);
+                break;
+            }
+        }
+    }
+    return res;
+}
+
+/// \brief Mean distance to the `m`-th nearest neighbor, estimated on a subset of the points of `tree`
+template <typename KdTree>
+typename KdTree::Scalar radiusForNeighborCount(const KdTree& tree, int m, int nbSamples = 256)
+{
+    using Scalar = typename KdTree::Scalar;
+    const auto& points = tree.points();
+    const int n = int(points.size());
+    Scalar sum = 0;
+    int count = 0;
+    for (int s = 0; s < nbSamples && s < n; ++s)
+    {
+        const int i = int((std::uint64_t(s) * std::uint64_t(n)) / std::uint64_t(std::min(nbSamples, n)));
+        Scalar d = 0;
+        for (int j : tree.k_nearest_neighbors(i, m))
+            d = std::max(d, (points[j].pos() - points[i].pos()).norm());
+        sum += d;
+        ++count;
+    }
+    return count == 0 ? Scalar(0) : sum / Scalar(count);
+}
+
+/// \brief Indices of `count` points of a cloud of size `n`, evenly spread in the index range
+inline std::vector<int> queryIndices(std::size_t n, std::size_t count)
+{
+    std::vector<int> res;
+    count = std::min(count, n);
+    res.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        res.push_back(int((i * n) / count));
+    return res;
+}
+
+} // namespace PoncaBenchmark
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+"""Compare two sets of Ponca benchmark results.
+
+Each input is either a JSON file written by a benchmark (--json=<file>), or a directory of such files (e.g. the
+results directory of the ponca-benchmarks-run target). Benchmarks are matched by name, and the relative change of the
+time per iteration is reported, negative values being speedups.
+
+With --threshold, the script fails when a benchmark regresses, using the rule of the performance_regression test: the
+median time must exceed the baseline by more than the threshold, and by more than three times the noise estimated from
+the median absolute deviations of the two runs.
+
+Usage:
+    compare_benchmarks.py <baseline> <contender> [--metric=median_time_ns] [--filter=<str>] [--json=<file>]
+                          [--threshold=<fraction>]
+"""
+
+import argparse
+import json
+import os
+import sys
+
+
+def load_results(path):
+    """Return a dictionary {benchmark name: result} from a JSON file or a directory of JSON files"""
+    files = [path]
+    if os.path.isdir(path):
+        files = sorted(os.path.join(path, f) for f in os.listdir(path) if f.endswith(".json"))
+    results = {}
+    for f in files:
+        with open(f) as stream:
+            data = json.load(stream)
+        for b in data.get("benchmarks", []):
+            results[b["name"]] = b
+    return results
+
+
+def compare(baseline, contender, metric, name_filter=""):
+    """Return the list of (name, baseline value, contender value, relative change) of the common benchmarks"""
+    rows = []
+    for name in sorted(set(baseline) & set(contender)):
+        if name_filter not in name:
+            continue
+        old, new = baseline[name][metric], contender[name][metric]
+        change = (new - old) / old if old > 0 else 0.
+        rows.append((name, old, new, change))
+    return rows
+
+
+def is_regression(old, new, threshold):
+    """Tell if the result `new` is significantly slower than `old`, see PoncaBenchmark::compareResults"""
+    old_time, new_time = old["median_time_ns"], new["median_time_ns"]
+    if old_time <= 0:
+        return False
+    noise = 1.4826 * (old.get("mad_time_ns", 0.) ** 2 + new.get("mad_time_ns", 0.) ** 2) ** 0.5
+    return (new_time - old_time) / old_time > threshold and new_time - old_time > 3. * noise
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline", help="baseline JSON file or directory")
+    parser.add_argument("contender", help="contender JSON file or directory")
+    parser.add_argument("--metric", default="median_time_ns",
+                        help="timing compared between the results (default: median_time_ns)")
+    parser.add_argument("--filter", default="", help="only compare the benchmarks whose name contains this string")
+    parser.add_argument("--json", help="write the comparison to this file")
+    parser.add_argument("--threshold", type=float,
+                        help="fail when a benchmark is slower than the baseline by more than this fraction")
+    args = parser.parse_args()
+
+    baseline, contender = load_results(args.baseline), load_results(args.contender)
+    rows = compare(baseline, contender, args.metric, args.filter)
+
+    width = max([len(r[0]) for r in rows] + [9])
+    print("{:<{w}} {:>16} {:>16} {:>9}".format("Benchmark", "Baseline", "Contender", "Change", w=width))
+    regressions = []
+    for name, old, new, change in rows:
+        regression = args.threshold is not None and is_regression(baseline[name], contender[name], args.threshold)
+        if regression:
+            regressions.append(name)
+        print("{:<{w}} {:>16.0f} {:>16.0f} {:>+8.1f}%{}".format(name, old, new, 100. * change,
+                                                               "  REGRESSION" if regression else "", w=width))
+
+    for name in sorted(set(baseline) - set(contender)):
+        if args.filter in name:
+            print("{:<{w}} only in baseline".format(name, w=width))
+    for name in sorted(set(contender) - set(baseline)):
+        if args.filter in name:
+            print("{:<{w}} only in contender".format(name, w=width))
+
+    if args.json:
+        with open(args.json, "w") as stream:
+            json.dump({"metric": args.metric,
+                       "benchmarks": [{"name": n, "baseline": o, "contender": c, "change": ch}
+                                      for n, o, c, ch in rows],
+                       "regressions": regressions}, stream, indent=2)
+    if regressions:
+        print("{} performance regression(s) detected".format(len(regressions)), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,140 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/src/eigen_solvers.cpp
+    \brief Benchmark the throughput and the accuracy of the SymmetricEigenSolver policies on 3x3 covariances
+
+    The covariances are generated with random orientations, and with eigenvalues typical of the neighborhoods of
+    point clouds: well conditioned (volumes), planar, linear, and with repeated eigenvalues. The `batch` benchmarks
+    use SymmetricEigenSolver::computeBatch. The accuracy of each policy, measured against the iterative solver in
+    double precision, is printed after the timings.
+ */
+
+#include "../common/benchmark.h"
+
+#include <Ponca/src/Fitting/symmetricEigenSolver.h>
+
+#include <Eigen/QR>
+
+#include <limits>
+#include <random>
+
+using namespace Ponca;
+using namespace PoncaBenchmark;
+
+using Scalar     = float;
+using MatrixType = Eigen::Matrix<Scalar, 3, 3>;
+using Solver     = SymmetricEigenSolver<MatrixType>;
+
+/// \brief Random covariances whose eigenvalues are proportional to `ratios`
+std::vector<MatrixType> generateCovariances(std::size_t n, const Eigen::Vector3d& ratios)
+{
+    std::mt19937 gen (42);
+    std::uniform_real_distribution<double> coeff (-1., 1.), scale (0.1, 10.);
+    std::vector<MatrixType> res (n);
+    for (auto& m : res)
+    {
+        Eigen::Matrix3d r = Eigen::Matrix3d::NullaryExpr([&]() { return coeff(gen); });
+        r = Eigen::HouseholderQR<Eigen::Matrix3d>(r).householderQ();
+        m = (r * (scale(gen) * ratios).asDiagonal() * r.transpose()).cast<Scalar>();
+    }
+    return res;
+}
+
+/// \brief Largest errors of the decompositions, relative to the largest eigenvalue
+struct Accuracy
+{
+    double eigenvalues {0};    ///< Compared to the iterative solver in double precision
+    double residual {0};       ///< \f$ \| \mathbf{M} \mathbf{V} - \mathbf{V} \Lambda \|_\infty \f$
+    double orthogonality {0};  ///< \f$ \| \mathbf{V}^T \mathbf{V} - \mathbf{I} \|_\infty \f$
+    std::size_t fallbacks {0}; ///< Number of decompositions computed by the iterative solver
+};
+
+Accuracy measure(const std::vector<MatrixType>& matrices, const std::vector<Solver>& solvers)
+{
+    Accuracy res;
+    for (std::size_t i = 0; i < matrices.size(); ++i)
+    {
+        const Eigen::Matrix3d m = matrices[i].cast<double>();
+        const Eigen::Vector3d reference = Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d>(m).eigenvalues();
+        const double scale = std::max(reference.cwiseAbs().maxCoeff(), std::numeric_limits<double>::min());
+        const Eigen::Vector3d values  = solvers[i].eigenvalues().cast<double>();
+        const Eigen::Matrix3d vectors = solvers[i].eigenvectors().cast<double>();
+        res.eigenvalues   = std::max(res.eigenvalues, (values - reference).cwiseAbs().maxCoeff() / scale);
+        res.residual      = std::max(res.residual,
+                                     (m * vectors - vectors * values.asDiagonal()).cwiseAbs().maxCoeff() / scale);
+        res.orthogonality = std::max(res.orthogonality,
+                                     (vectors.transpose() * vectors - Eigen::Matrix3d::Identity()).cwiseAbs().maxCoeff());
+        res.fallbacks += solvers[i].usedFallback() ? 1 : 0;
+    }
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (! parseOptions(argc, argv, options)) return EXIT_FAILURE;
+    Runner runner ("eigen_solvers", options);
+
+    constexpr std::size_t n = 1 << 16;
+    const std::vector<std::pair<std::string, Eigen::Vector3d>> families {
+        {"volume",   Eigen::Vector3d(1., 2., 3.)},
+        {"planar",   Eigen::Vector3d(1e-4, 1., 1.5)},
+        {"linear",   Eigen::Vector3d(1e-4, 1e-4, 1.)},
+        {"repeated", Eigen::Vector3d(1., 1., 2.)}};
+    const std::vector<std::pair<std::string, EigenSolverPolicy>> policies {
+        {"iterative", IterativeEigenSolver},
+        {"direct",    DirectEigenSolver},
+        {"fallback",  DirectEigenSolverWithFallback}};
+
+    std::vector<std::string> accuracies;
+    for (const auto& family : families)
+    {
+        std::vector<std::string> names;
+        for (const auto& policy : policies)
+            for (const std::string mode : {"single/", "batch/"}) names.push_back(mode + policy.first + "/" + family.first);
+        const std::vector<MatrixType> matrices =
+            runner.needsData(names) ? generateCovariances(n, family.second) : std::vector<MatrixType>();
+
+        for (const auto& policy : policies)
+        {
+            std::vector<Solver> solvers (matrices.size(), Solver(policy.second));
+            const std::string name = policy.first + "/" + family.first;
+            runner.run("single/" + name, matrices.size(), [&]() {
+                for (std::size_t i = 0; i < matrices.size(); ++i) solvers[i].compute(matrices[i]);
+                doNotOptimize(solvers.back().eigenvalues());
+            });
+            runner.run("batch/" + name, matrices.size(), [&]() {
+                Solver::computeBatch(matrices.data(), solvers.data(), int(matrices.size()));
+                doNotOptimize(solvers.back().eigenvalues());
+            });
+
+            if (matrices.empty() || ! runner.needsData({"single/" + name, "batch/" + name})) continue;
+            for (const std::string mode : {"single", "batch"})
+            {
+                if (mode == "single") for (std::size_t i = 0; i < matrices.size(); ++i) solvers[i].compute(matrices[i]);
+                else Solver::computeBatch(matrices.data(), solvers.data(), int(matrices.size()));
+                const Accuracy a = measure(matrices, solvers);
+                std::ostringstream line;
+                line << std::left << std::setw(32) << (mode + "/" + name) << std::right << std::scientific
+                     << std::setprecision(2) << std::setw(12) << a.eigenvalues << std::setw(12) << a.residual
+                     << std::setw(12) << a.orthogonality << std::setw(12) << std::fixed << std::setprecision(4)
+                     << double(a.fallbacks) / double(matrices.size());
+                accuracies.push_back(line.str());
+            }
+        }
+    }
+
+    if (! accuracies.empty())
+    {
+        std::cout << "\n" << std::left << std::setw(32) << "accuracy (max relative errors)" << std::right
+                  << std::setw(12) << "values" << std::setw(12) << "residual" << std::setw(12) << "orthogonal"
+                  << std::setw(12) << "fallbacks" << std::endl;
+        for (const auto& line : accuracies) std::cout << line << std::endl;
+    }
+    return runner.finish();
+}
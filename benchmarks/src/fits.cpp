@@ -0,0 +1,109 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/src/fits.cpp
+    \brief Benchmark the throughput of Basket::compute for several fit types and neighborhood sizes
+
+    Neighborhoods are gathered beforehand in contiguous containers, so that only the cost of the fits is measured.
+ */
+
+#include "../common/benchmark.h"
+#include "../common/pointGenerators.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covarianceLineFit.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/meanPlaneFit.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/sphereFit.h>
+#include <Ponca/src/Fitting/unorientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace Ponca;
+using namespace PoncaBenchmark;
+
+using DataPoint  = BenchPoint<double, 3>;
+using Scalar     = DataPoint::Scalar;
+using VectorType = DataPoint::VectorType;
+using WeightFunc = DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar>>;
+
+/// Neighbors of a query, with the scale of the weighting function
+struct Neighborhood
+{
+    VectorType center;
+    Scalar scale;
+    std::vector<DataPoint> neighbors;
+};
+
+template <typename Fit>
+void benchFit(Runner& runner, const std::string& name, const std::vector<Neighborhood>& neighborhoods)
+{
+    runner.run(name, neighborhoods.size(), [&]() {
+        int nbStable = 0;
+        for (const auto& n : neighborhoods)
+        {
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(n.scale));
+            fit.init(n.center);
+            nbStable += fit.compute(n.neighbors) == STABLE ? 1 : 0;
+        }
+        doNotOptimize(nbStable);
+    });
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (! parseOptions(argc, argv, options)) return EXIT_FAILURE;
+    Runner runner ("fits", options);
+
+    const std::size_t n = std::min<std::size_t>(100000, options.maxSize);
+    constexpr std::size_t nbQueries = 1000;
+    const std::vector<int> neighborCounts {16, 64, 256};
+
+    KdTreeDense<DataPoint> tree;
+    for (int m : neighborCounts)
+    {
+        const std::string suffix = "/m=" + std::to_string(m);
+        const std::vector<std::string> names {
+            "fit/MeanPlaneFit" + suffix, "fit/CovariancePlaneFit" + suffix, "fit/CovarianceLineFit" + suffix,
+            "fit/OrientedSphereFit" + suffix, "fit/UnorientedSphereFit" + suffix, "fit/SphereFit" + suffix,
+            "fit/MongePatch" + suffix};
+
+        // Neighborhoods of points sampled on a sphere, the scale reaching the m-th neighbor
+        std::vector<Neighborhood> neighborhoods;
+        if (runner.needsData(names))
+        {
+            if (tree.point_count() == 0) tree.build(generatePoints<DataPoint>(n, Distribution::Surface));
+            for (int i : queryIndices(n, nbQueries))
+            {
+                Neighborhood nei;
+                nei.center = tree.points()[i].pos();
+                nei.scale  = 0;
+                for (int j : tree.k_nearest_neighbors(i, m))
+                {
+                    nei.neighbors.push_back(tree.points()[j]);
+                    nei.scale = std::max(nei.scale, (tree.points()[j].pos() - nei.center).norm());
+                }
+                nei.scale *= Scalar(1.01);
+                neighborhoods.push_back(std::move(nei));
+            }
+        }
+
+        benchFit<Basket<DataPoint, WeightFunc, MeanPlaneFit>>(runner, names[0], neighborhoods);
+        benchFit<Basket<DataPoint, WeightFunc, CovariancePlaneFit>>(runner, names[1], neighborhoods);
+        benchFit<Basket<DataPoint, WeightFunc, CovarianceLineFit>>(runner, names[2], neighborhoods);
+        benchFit<Basket<DataPoint, WeightFunc, OrientedSphereFit>>(runner, names[3], neighborhoods);
+        benchFit<Basket<DataPoint, WeightFunc, UnorientedSphereFit>>(runner, names[4], neighborhoods);
+        benchFit<Basket<DataPoint, WeightFunc, SphereFit>>(runner, names[5], neighborhoods);
+        benchFit<Basket<DataPoint, WeightFunc, CovariancePlaneFit, MongePatch>>(runner, names[6], neighborhoods);
+    }
+    return runner.finish();
+}
@@ -0,0 +1,129 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/src/kdtree_allocators.cpp
+    \brief Benchmark the KdTree build and k-nearest queries with the allocators of the Common module
+
+    The `tiles` benchmarks build one small throwaway tree per tile of the cloud, as done when processing a cloud by
+    chunks: the arena is reset between the tiles instead of freeing the containers of each tree.
+
+    The `numa` benchmarks use the default node of NumaLocalAllocator, i.e. the node of the building thread: they
+    measure the cost of mapping the pages, the placement being the same as with `std`. Reference results are stored in
+    benchmarks/baselines/kdtree_allocators.json.
+ */
+
+#include "../common/benchmark.h"
+#include "../common/pointGenerators.h"
+
+#include <Ponca/src/Common/allocators.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace Ponca;
+using namespace PoncaBenchmark;
+
+using DataPoint = BenchPoint<float, 3>;
+
+template <template <typename> typename Allocator>
+using Tree = KdTreeDenseBase<KdTreeAllocatorTraits<DataPoint, Allocator>>;
+
+template <typename T>
+using StdAllocator = std::allocator<T>;
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (! parseOptions(argc, argv, options)) return EXIT_FAILURE;
+    Runner runner ("kdtree_allocators", options);
+
+    constexpr std::size_t tileSize  = 4096;
+    constexpr std::size_t nbQueries = 10000;
+    constexpr int k = 16;
+    MonotonicArena arena;
+
+    for (Distribution d : distributions())
+    {
+        for (std::size_t n : runner.sizes())
+        {
+            const std::string suffix = "/" + name(d) + "/" + std::to_string(n);
+            const bool needsData = runner.needsData({
+                "build/std" + suffix, "build/arena" + suffix, "build/hugepages" + suffix, "build/numa" + suffix,
+                "tiles/std" + suffix, "tiles/arena" + suffix,
+                "knearest/std" + suffix, "knearest/hugepages" + suffix, "knearest/numa" + suffix});
+            const auto points = needsData ? generatePoints<DataPoint>(n, d) : std::vector<DataPoint>();
+
+            // The timings include the copy of the points in the tree
+            runner.run("build/std" + suffix, n, [&]() {
+                Tree<StdAllocator> tree (points);
+                doNotOptimize(tree.node_count());
+            });
+            runner.run("build/arena" + suffix, n, [&]() {
+                {
+                    MonotonicArena::Scope scope (arena);
+                    Tree<ArenaAllocator> tree (points);
+                    doNotOptimize(tree.node_count());
+                }
+                arena.reset();
+            });
+            runner.run("build/hugepages" + suffix, n, [&]() {
+                Tree<HugePageAllocator> tree (points);
+                doNotOptimize(tree.node_count());
+            });
+            runner.run("build/numa" + suffix, n, [&]() {
+                Tree<NumaLocalAllocator> tree (points);
+                doNotOptimize(tree.node_count());
+            });
+
+            std::vector<std::vector<DataPoint>> tiles;
+            for (std::size_t begin = 0; begin < points.size(); begin += tileSize)
+                tiles.emplace_back(points.begin() + begin, points.begin() + std::min(points.size(), begin + tileSize));
+
+            runner.run("tiles/std" + suffix, n, [&]() {
+                for (const auto& tile : tiles)
+                {
+                    Tree<StdAllocator> tree (tile);
+                    doNotOptimize(tree.node_count());
+                }
+            });
+            runner.run("tiles/arena" + suffix, n, [&]() {
+                for (const auto& tile : tiles)
+                {
+                    {
+                        MonotonicArena::Scope scope (arena);
+                        Tree<ArenaAllocator> tree (tile);
+                        doNotOptimize(tree.node_count());
+                    }
+                    arena.reset();
+                }
+            });
+
+            // Queries only depend on the placement of the containers, not on the allocation cost
+            const std::vector<int> ids = queryIndices(n, nbQueries);
+            const auto knearest = [&](const auto& tree) {
+                return [&ids, t = &tree]() {
+                    int sum = 0;
+                    for (int i : ids)
+                        for (int j : t->k_nearest_neighbors(i, k)) sum += j;
+                    doNotOptimize(sum);
+                };
+            };
+            Tree<StdAllocator> stdTree;
+            Tree<HugePageAllocator> hugePageTree;
+            Tree<NumaLocalAllocator> numaTree;
+            if (needsData)
+            {
+                stdTree.build(points);
+                hugePageTree.build(points);
+                numaTree.build(points);
+            }
+            runner.run("knearest/std" + suffix, ids.size(), knearest(stdTree));
+            runner.run("knearest/hugepages" + suffix, ids.size(), knearest(hugePageTree));
+            runner.run("knearest/numa" + suffix, ids.size(), knearest(numaTree));
+        }
+    }
+    arena.release();
+    return runner.finish();
+}
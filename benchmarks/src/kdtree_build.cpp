@@ -0,0 +1,52 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/src/kdtree_build.cpp
+    \brief Benchmark the construction of dense and sparse KdTrees, for several sizes and distributions
+ */
+
+#include "../common/benchmark.h"
+#include "../common/pointGenerators.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace Ponca;
+using namespace PoncaBenchmark;
+
+using DataPoint = BenchPoint<float, 3>;
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (! parseOptions(argc, argv, options)) return EXIT_FAILURE;
+    Runner runner ("kdtree_build", options);
+
+    for (Distribution d : distributions())
+    {
+        for (std::size_t n : runner.sizes())
+        {
+            const std::string suffix = "/" + name(d) + "/" + std::to_string(n);
+            const bool needsData = runner.needsData({"build/dense" + suffix, "build/sparse" + suffix});
+            const auto points = needsData ? generatePoints<DataPoint>(n, d) : std::vector<DataPoint>();
+
+            // The timings include the copy of the points in the tree
+            runner.run("build/dense" + suffix, n, [&]() {
+                KdTreeDense<DataPoint> tree;
+                tree.build(points);
+                doNotOptimize(tree.node_count());
+            });
+
+            std::vector<int> sampling;
+            for (std::size_t i = 0; i < points.size(); i += 2) sampling.push_back(int(i));
+            runner.run("build/sparse" + suffix, n / 2, [&]() {
+                KdTreeSparse<DataPoint> tree (points, sampling);
+                doNotOptimize(tree.node_count());
+            });
+        }
+    }
+    return runner.finish();
+}
@@ -0,0 +1,94 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/src/kdtree_queries.cpp
+    \brief Benchmark the nearest, k-nearest and range queries of the KdTree
+
+    Range query radii are chosen to retrieve a given mean number of neighbors, so that the results are comparable
+    across sizes and distributions.
+ */
+
+#include "../common/benchmark.h"
+#include "../common/pointGenerators.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace Ponca;
+using namespace PoncaBenchmark;
+
+using DataPoint  = BenchPoint<float, 3>;
+using Scalar     = DataPoint::Scalar;
+using VectorType = DataPoint::VectorType;
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (! parseOptions(argc, argv, options)) return EXIT_FAILURE;
+    Runner runner ("kdtree_queries", options);
+
+    constexpr std::size_t nbQueries = 10000;
+    const std::vector<int> ks {1, 8, 32, 128};
+    const std::vector<int> neighborCounts {8, 32, 128};
+
+    for (Distribution d : distributions())
+    {
+        for (std::size_t n : runner.sizes())
+        {
+            const std::string suffix = "/" + name(d) + "/" + std::to_string(n);
+            const std::string nearestName = "nearest" + suffix;
+            std::vector<std::string> knearestNames, rangeNames;
+            for (int k : ks)             knearestNames.push_back("knearest" + suffix + "/k=" + std::to_string(k));
+            for (int m : neighborCounts) rangeNames.push_back("range" + suffix + "/m=" + std::to_string(m));
+
+            std::vector<std::string> names {nearestName};
+            names.insert(names.end(), knearestNames.begin(), knearestNames.end());
+            names.insert(names.end(), rangeNames.begin(), rangeNames.end());
+            const bool needsData = runner.needsData(names);
+
+            KdTreeDense<DataPoint> tree;
+            if (needsData) tree.build(generatePoints<DataPoint>(n, d));
+
+            const std::vector<int> ids = queryIndices(n, nbQueries);
+            // Query positions are shifted from the points, to avoid trivial nearest neighbors
+            std::vector<VectorType> positions;
+            if (needsData)
+                for (int i : ids)
+                    positions.push_back(tree.points()[i].pos() + VectorType::Constant(Scalar(1e-3)));
+
+            runner.run(nearestName, ids.size(), [&]() {
+                int sum = 0;
+                for (const auto& p : positions)
+                    for (int j : tree.nearest_neighbor(p)) sum += j;
+                doNotOptimize(sum);
+            });
+
+            for (std::size_t c = 0; c < ks.size(); ++c)
+            {
+                const int k = ks[c];
+                runner.run(knearestNames[c], ids.size(), [&]() {
+                    int sum = 0;
+                    for (int i : ids)
+                        for (int j : tree.k_nearest_neighbors(i, k)) sum += j;
+                    doNotOptimize(sum);
+                });
+            }
+
+            for (std::size_t c = 0; c < neighborCounts.size(); ++c)
+            {
+                const Scalar r = runner.needsData({rangeNames[c]}) ? radiusForNeighborCount(tree, neighborCounts[c])
+                                                                   : Scalar(0);
+                runner.run(rangeNames[c], ids.size(), [&]() {
+                    int sum = 0;
+                    for (int i : ids)
+                        for (int j : tree.range_neighbors(i, r)) sum += j;
+                    doNotOptimize(sum);
+                });
+            }
+        }
+    }
+    return runner.finish();
+}
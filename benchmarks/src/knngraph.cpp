@@ -0,0 +1,81 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/src/knngraph.cpp
+    \brief Benchmark the construction of the KnnGraph and its range queries
+ */
+
+#include "../common/benchmark.h"
+#include "../common/pointGenerators.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/KnnGraph/knnGraph.h>
+
+#include <optional>
+
+using namespace Ponca;
+using namespace PoncaBenchmark;
+
+using DataPoint = BenchPoint<float, 3>;
+using Scalar    = DataPoint::Scalar;
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (! parseOptions(argc, argv, options)) return EXIT_FAILURE;
+    Runner runner ("knngraph", options);
+
+    constexpr std::size_t nbQueries = 1000;
+    const std::vector<int> ks {8, 16};
+    const std::vector<int> neighborCounts {32, 128};
+
+    for (Distribution d : distributions())
+    {
+        for (std::size_t n : runner.sizes())
+        {
+            const std::string suffix = "/" + name(d) + "/" + std::to_string(n);
+            std::vector<std::string> names;
+            for (int k : ks)
+            {
+                names.push_back("knngraph_build" + suffix + "/k=" + std::to_string(k));
+                for (int m : neighborCounts)
+                    names.push_back("knngraph_range" + suffix + "/k=" + std::to_string(k) + "/m=" + std::to_string(m));
+            }
+
+            KdTreeDense<DataPoint> tree;
+            if (runner.needsData(names)) tree.build(generatePoints<DataPoint>(n, d));
+            const std::vector<int> ids = queryIndices(n, nbQueries);
+
+            for (int k : ks)
+            {
+                const std::string kSuffix = suffix + "/k=" + std::to_string(k);
+                runner.run("knngraph_build" + kSuffix, n, [&]() {
+                    KnnGraph<DataPoint> graph (tree, k);
+                    doNotOptimize(graph.size());
+                });
+
+                std::vector<std::string> rangeNames;
+                for (int m : neighborCounts) rangeNames.push_back("knngraph_range" + kSuffix + "/m=" + std::to_string(m));
+
+                std::optional<KnnGraph<DataPoint>> graph;
+                if (runner.needsData(rangeNames)) graph.emplace(tree, k);
+                for (std::size_t c = 0; c < neighborCounts.size(); ++c)
+                {
+                    const Scalar r = runner.needsData({rangeNames[c]}) ? radiusForNeighborCount(tree, neighborCounts[c])
+                                                                       : Scalar(0);
+                    runner.run(rangeNames[c], ids.size(), [&]() {
+                        int sum = 0;
+                        for (int i : ids)
+                            for (int j : graph->range_neighbors(i, r)) sum += j;
+                        doNotOptimize(sum);
+                    });
+                }
+            }
+        }
+    }
+    return runner.finish();
+}
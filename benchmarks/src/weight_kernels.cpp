@@ -0,0 +1,81 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file benchmarks/src/weight_kernels.cpp
+    \brief Benchmark the throughput of the weight kernels, evaluated one value at a time or by packets of 8 values
+ */
+
+#include "../common/benchmark.h"
+
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <random>
+
+using namespace Ponca;
+using namespace PoncaBenchmark;
+
+template <typename Scalar> using PolynomialWeightKernel3 = PolynomialWeightKernel<Scalar, 3>;
+template <typename Scalar> using PolynomialWeightKernel6 = PolynomialWeightKernel<Scalar, 6>;
+
+template <typename Scalar>
+using Packet = Eigen::Array<Scalar, 1, 8>;
+
+/// \brief Random values in [mmin, 1], stored by packets
+template <typename Scalar>
+std::vector<Packet<Scalar>> generateValues(std::size_t n, Scalar mmin)
+{
+    std::mt19937 gen (42);
+    std::uniform_real_distribution<Scalar> value (mmin, Scalar(1));
+    std::vector<Packet<Scalar>> res (n / Packet<Scalar>::SizeAtCompileTime);
+    for (auto& p : res) p = Packet<Scalar>::NullaryExpr([&]() { return value(gen); });
+    return res;
+}
+
+template <typename Scalar, template <typename> class KernelT>
+void benchmarkKernel(Runner& runner, const std::string& kernelName, Scalar mmin = 0)
+{
+    constexpr std::size_t n = 1 << 16;
+    const std::string name = kernelName + "/" + (std::is_same<Scalar, float>::value ? "float" : "double");
+    if (! runner.needsData({"scalar/" + name, "packet/" + name})) return;
+
+    const KernelT<Scalar> k;
+    const std::vector<Packet<Scalar>> values = generateValues<Scalar>(n, mmin);
+    runner.run("scalar/" + name, n, [&]() {
+        Scalar sum = 0;
+        for (const auto& v : values)
+            for (int j = 0; j < Packet<Scalar>::SizeAtCompileTime; ++j) sum += k.f(v(j));
+        doNotOptimize(sum);
+    });
+    runner.run("packet/" + name, n, [&]() {
+        Packet<Scalar> sum = Packet<Scalar>::Zero();
+        for (const auto& v : values) sum += k.f(v);
+        doNotOptimize(sum);
+    });
+}
+
+template <typename Scalar>
+void benchmarkKernels(Runner& runner)
+{
+    benchmarkKernel<Scalar, ConstantWeightKernel>   (runner, "constant");
+    benchmarkKernel<Scalar, SmoothWeightKernel>     (runner, "smooth");
+    benchmarkKernel<Scalar, WendlandWeightKernel>   (runner, "wendland");
+    benchmarkKernel<Scalar, SingularWeightKernel>   (runner, "singular", Scalar(0.1));
+    benchmarkKernel<Scalar, CompactExpWeightKernel> (runner, "compact_exp");
+    benchmarkKernel<Scalar, PolynomialWeightKernel3>(runner, "polynomial3");
+    benchmarkKernel<Scalar, PolynomialWeightKernel6>(runner, "polynomial6");
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (! parseOptions(argc, argv, options)) return EXIT_FAILURE;
+    Runner runner ("weight_kernels", options);
+
+    benchmarkKernels<float>(runner);
+    benchmarkKernels<double>(runner);
+    return runner.finish();
+}
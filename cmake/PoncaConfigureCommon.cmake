@@ -1,8 +1,12 @@
 set(ponca_Common_INCLUDE
     "${PONCA_src_ROOT}/Ponca/Common"
     "${PONCA_src_ROOT}/Ponca/Ponca"
+    "${PONCA_src_ROOT}/Ponca/src/Common/allocators.h"
     "${PONCA_src_ROOT}/Ponca/src/Common/defines.h"
+    "${PONCA_src_ROOT}/Ponca/src/Common/executor.h"
+    "${PONCA_src_ROOT}/Ponca/src/Common/Containers/boundedQueue.h"
     "${PONCA_src_ROOT}/Ponca/src/Common/Containers/limitedPriorityQueue.h"
+    "${PONCA_src_ROOT}/Ponca/src/Common/Containers/smallVector.h"
     "${PONCA_src_ROOT}/Ponca/src/Common/Containers/stack.h"
     )
 
@@ -17,8 +21,12 @@ target_sources(Common INTERFACE
     )
 
 
+# The default Executor runs the parallel loops in a pool of threads
+find_package(Threads REQUIRED)
+target_link_libraries(Common INTERFACE Threads::Threads)
+
 set_target_properties(Common PROPERTIES
-  INTERFACE_COMPILE_FEATURES cxx_std_11
+  INTERFACE_COMPILE_FEATURES cxx_std_17
 )
 
 install(TARGETS Common
@@ -17,19 +17,30 @@ set(ponca_Fitting_INCLUDE
     "${PONCA_src_ROOT}/Ponca/src/Fitting/enums.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/gls.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/gls.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/imageGridFit.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/imageGridMoments.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/implicitFieldCache.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/implicitMesher.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/lazyBasketDiff.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mean.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mean.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/meanPlaneFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mlsSphereFitDer.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mlsSphereFitDer.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/mlsProjection.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mongePatch.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/mongePatch.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/multiBasket.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/neighborCache.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/multiScaleFit.h"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/neighborPacket.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/orientedSphereFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/orientedSphereFit.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/plane.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/primitive.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/sphereFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/sphereFit.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/Fitting/symmetricEigenSolver.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/unorientedSphereFit.h"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/unorientedSphereFit.hpp"
     "${PONCA_src_ROOT}/Ponca/src/Fitting/weightFunc.h"
@@ -50,7 +61,7 @@ target_sources(Fitting INTERFACE
 add_dependencies(Fitting Common)
 
 set_target_properties(Fitting PROPERTIES
-  INTERFACE_COMPILE_FEATURES cxx_std_11
+  INTERFACE_COMPILE_FEATURES cxx_std_17
 )
 
 if(Eigen3_FOUND)
@@ -58,6 +69,10 @@ if(Eigen3_FOUND)
   target_link_libraries(Fitting PUBLIC INTERFACE Eigen3::Eigen)
 endif()
 
+# The parallel loops of the fitting tools (e.g. ImageGridFit, MlsProjection, ImplicitMesher) use the default Executor
+find_package(Threads REQUIRED)
+target_link_libraries(Fitting INTERFACE Threads::Threads)
+
 install(TARGETS Fitting
     EXPORT FittingTargets
     LIBRARY DESTINATION  ${CMAKE_INSTALL_LIBDIR}
@@ -0,0 +1,55 @@
+set(ponca_IO_INCLUDE
+    "${PONCA_src_ROOT}/Ponca/IO"
+    "${PONCA_src_ROOT}/Ponca/src/IO/mappedFile.h"
+    "${PONCA_src_ROOT}/Ponca/src/IO/stridedView.h"
+    "${PONCA_src_ROOT}/Ponca/src/IO/plyReader.h"
+    "${PONCA_src_ROOT}/Ponca/src/IO/plyReader.hpp"
+    "${PONCA_src_ROOT}/Ponca/src/IO/rawPointReader.h"
+    "${PONCA_src_ROOT}/Ponca/src/IO/pointAttributeWriter.h"
+    "${PONCA_src_ROOT}/Ponca/src/IO/pointAttributeWriter.hpp"
+    )
+
+add_library(IO INTERFACE)
+target_include_directories(IO INTERFACE
+    "$<BUILD_INTERFACE:${PONCA_src_ROOT}>"
+    "$<INSTALL_INTERFACE:include/>"
+    )
+target_sources(IO INTERFACE
+    "$<BUILD_INTERFACE:${ponca_IO_INCLUDE}>"
+    "$<INSTALL_INTERFACE:>"
+    )
+add_dependencies(IO Common)
+
+set_target_properties(IO PROPERTIES
+  INTERFACE_COMPILE_FEATURES cxx_std_17
+)
+
+if(Eigen3_FOUND)
+    target_link_libraries(IO PUBLIC INTERFACE Eigen3::Eigen)
+endif()
+
+# PointAttributeWriter writes files from a background thread
+find_package(Threads REQUIRED)
+target_link_libraries(IO INTERFACE Threads::Threads)
+
+install(TARGETS IO
+    EXPORT IOTargets
+    LIBRARY DESTINATION  ${CMAKE_INSTALL_LIBDIR}
+    ARCHIVE DESTINATION  ${CMAKE_INSTALL_LIBDIR}
+    INCLUDES DESTINATION ${CMAKE_INSTALL_INCDIR}
+)
+
+install(EXPORT IOTargets
+  FILE PoncaTargets-IO.cmake
+  NAMESPACE Ponca::
+  DESTINATION lib/cmake
+  COMPONENT Common
+)
+
+add_library(Ponca::IO ALIAS IO)
+
+#############################################
+# HACK: have the files showing in the IDE, under the name 'ponca-src'
+if( ${PONCA_GENERATE_IDE_TARGETS} )
+    add_custom_target(ponca_IO_IDE SOURCES ${ponca_IO_INCLUDE})
+endif()
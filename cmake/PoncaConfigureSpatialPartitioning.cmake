@@ -3,17 +3,23 @@ set(ponca_SpatialPartitioning_INCLUDE
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/defines.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/query.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/indexSquaredDistance.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/chunkPipeline.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTree.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTree.hpp"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeTraits.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/kdTreeStatistics.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeQuery.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeKNearestQueries.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeNearestQueries.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KdTree/Query/kdTreeRangeQueries.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KnnGraph/knnGraph.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KnnGraph/knnGraphStatistics.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KnnGraph/Query/knnGraphKNearestQuery.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KnnGraph/Query/knnGraphRangeQuery.h"
     "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/KnnGraph/Iterator/knnGraphRangeIterator.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/ImageGrid/imageGrid.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/ImageGrid/Query/imageGridWindowQuery.h"
+    "${PONCA_src_ROOT}/Ponca/src/SpatialPartitioning/ImageGrid/Iterator/imageGridWindowIterator.h"
     )
 
 add_library(SpatialPartitioning INTERFACE)
@@ -28,7 +34,7 @@ target_sources(SpatialPartitioning INTERFACE
 add_dependencies(SpatialPartitioning Common)
 
 set_target_properties(SpatialPartitioning PROPERTIES
-  INTERFACE_COMPILE_FEATURES cxx_std_11
+  INTERFACE_COMPILE_FEATURES cxx_std_17
 )
 
 if(Eigen3_FOUND)
@@ -36,6 +42,10 @@ if(Eigen3_FOUND)
     target_link_libraries(SpatialPartitioning PUBLIC INTERFACE Eigen3::Eigen)
 endif()
 
+# ChunkPipeline runs its stages in separate threads
+find_package(Threads REQUIRED)
+target_link_libraries(SpatialPartitioning INTERFACE Threads::Threads)
+
 install(TARGETS SpatialPartitioning
     EXPORT SpatialPartitioningTargets
     LIBRARY DESTINATION  ${CMAKE_INSTALL_LIBDIR}
@@ -13,6 +13,9 @@ namespace Ponca {
             typedef float Scalar;
             // \brief Defines type used ton encode vector values
             typedef Eigen::Matrix<Scalar, Dim, 1> VectorType;
+            // \brief Optional: defines the type used to accumulate sums during fitting (see CovarianceFitBase).
+            // Defaults to Scalar when not defined
+            // typedef double AccumulationScalar;
 
             // \brief Default constructor
             PONCA_MULTIARCH inline PointConcept();
@@ -0,0 +1,168 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Common/allocators.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/KnnGraph/knnGraph.h>
+
+#include <cstring>
+#include <set>
+
+using namespace std;
+using namespace Ponca;
+
+void testArena()
+{
+    MonotonicArena arena (4096);
+    std::size_t total = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        const std::size_t bytes = Eigen::internal::random<int>(1, 10000);
+        const std::size_t alignment = std::size_t(1) << Eigen::internal::random<int>(0, 6);
+        void* p = arena.allocate(bytes, alignment);
+        VERIFY(reinterpret_cast<std::uintptr_t>(p) % alignment == 0);
+        std::memset(p, i, bytes);
+        total += bytes;
+    }
+    VERIFY(arena.usedBytes() == total);
+    const std::size_t reserved = arena.reservedBytes();
+    VERIFY(reserved >= total);
+
+    // After a reset, the same allocations fit in the memory already reserved
+    arena.reset();
+    VERIFY(arena.usedBytes() == 0);
+    for (int i = 0; i < 10; ++i) arena.allocate(total / 20);
+    VERIFY(arena.reservedBytes() == reserved);
+
+    arena.release();
+    VERIFY(arena.reservedBytes() == 0);
+
+    // Containers allocate from the current arena, and from the heap otherwise
+    VERIFY(MonotonicArena::current() == nullptr);
+    {
+        MonotonicArena::Scope scope (arena);
+        VERIFY(MonotonicArena::current() == &arena);
+        std::vector<int, ArenaAllocator<int>> v (1000, 1);
+        VERIFY(v.get_allocator().arena() == &arena);
+        VERIFY(arena.usedBytes() >= 1000 * sizeof(int));
+    }
+    VERIFY(MonotonicArena::current() == nullptr);
+    std::vector<int, ArenaAllocator<int>> heap (1000, 1);
+    VERIFY(heap.get_allocator().arena() == nullptr);
+}
+
+void testPageAllocators()
+{
+    // Large allocations are mapped on huge page boundaries, small ones use the heap
+    std::vector<double, HugePageAllocator<double>> large (HugePageAllocator<double>::MIN_BYTES / sizeof(double) + 1, 1.);
+    std::vector<double, HugePageAllocator<double>> small (10, 1.);
+    if (internal::PAGE_MAPPING_SUPPORTED)
+        VERIFY(reinterpret_cast<std::uintptr_t>(large.data()) % internal::HUGE_PAGE_SIZE == 0);
+    large.resize(large.size() * 3, 2.);
+    VERIFY(large.front() == 1. && large.back() == 2. && small.back() == 1.);
+
+    std::vector<int, NumaLocalAllocator<int>> local (1 << 20, 3);
+    std::vector<int, NumaLocalAllocator<int>> node0 (1 << 20, 4, NumaLocalAllocator<int>(0));
+    VERIFY(local.back() == 3 && node0.back() == 4);
+    VERIFY(internal::currentNumaNode() >= 0);
+}
+
+template <typename Tree, typename Graph, typename DataPoint>
+void testTree(const std::vector<DataPoint>& points, const KdTreeDense<DataPoint>& reference)
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    Tree tree (points);
+    VERIFY(tree.valid());
+    VERIFY(tree.node_count() == reference.node_count());
+
+    const int k = Eigen::internal::random<int>(1, 16);
+    const Scalar r = Eigen::internal::random<Scalar>(0.05, 0.2);
+    for (int q = 0; q < 100; ++q)
+    {
+        const VectorType p = VectorType::Random();
+        std::set<int> a, b;
+        for (int j : tree.k_nearest_neighbors(p, k)) a.insert(j);
+        for (int j : reference.k_nearest_neighbors(p, k)) b.insert(j);
+        VERIFY(a == b);
+        a.clear(); b.clear();
+        for (int j : tree.range_neighbors(p, r)) a.insert(j);
+        for (int j : reference.range_neighbors(p, r)) b.insert(j);
+        VERIFY(a == b);
+    }
+
+    Graph graph (tree, k);
+    KnnGraph<DataPoint> referenceGraph (reference, k);
+    for (int i = 0; i < int(points.size()); i += 31)
+    {
+        std::set<int> a, b;
+        for (int j : graph.k_nearest_neighbors(i)) a.insert(j);
+        for (int j : referenceGraph.k_nearest_neighbors(i)) b.insert(j);
+        VERIFY(a == b);
+    }
+}
+
+template <template <typename> typename Allocator, typename DataPoint>
+void testAllocatorTraits(const std::vector<DataPoint>& points, const KdTreeDense<DataPoint>& reference)
+{
+    using Tree  = KdTreeDenseBase<KdTreeAllocatorTraits<DataPoint, Allocator>>;
+    using Graph = KnnGraphBase<KnnGraphAllocatorTraits<DataPoint, Allocator>>;
+    testTree<Tree, Graph>(points, reference);
+
+    // Samples given as a std::vector
+    std::vector<int> sampling;
+    for (int i = 0; i < int(points.size()); i += 3) sampling.push_back(i);
+    KdTreeSparseBase<KdTreeAllocatorTraits<DataPoint, Allocator>> sparse (points, sampling);
+    VERIFY(sparse.valid());
+    VERIFY(sparse.sample_count() == int(sampling.size()));
+}
+
+template <typename DataPoint>
+void testKdTree()
+{
+    using VectorType = typename DataPoint::VectorType;
+
+    std::vector<DataPoint> points (Eigen::internal::random<int>(5000, 50000));
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+    KdTreeDense<DataPoint> reference (points);
+
+    testAllocatorTraits<HugePageAllocator>(points, reference);
+    testAllocatorTraits<NumaLocalAllocator>(points, reference);
+    testAllocatorTraits<ArenaAllocator>(points, reference);
+
+    // Throwaway trees, built in an arena reset between the trees
+    MonotonicArena arena;
+    for (int i = 0; i < 3; ++i)
+    {
+        {
+            MonotonicArena::Scope scope (arena);
+            testAllocatorTraits<ArenaAllocator>(points, reference);
+            VERIFY(arena.usedBytes() > points.size() * sizeof(DataPoint));
+        }
+        arena.reset();
+    }
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test MonotonicArena" << endl;
+	testArena();
+	cout << "Test HugePageAllocator and NumaLocalAllocator" << endl;
+	testPageAllocators();
+	cout << "Test KdTree and KnnGraph with custom allocators (float)" << endl;
+	testKdTree<PointPositionNormal<float, 3>>();
+	cout << "Test KdTree and KnnGraph with custom allocators (double)" << endl;
+	testKdTree<PointPositionNormal<double, 3>>();
+}
@@ -16,6 +16,9 @@
 #include <Ponca/src/Fitting/basket.h>
 #include <Ponca/src/Fitting/orientedSphereFit.h>
 #include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/sphereFit.h>
+#include <Ponca/src/Fitting/unorientedSphereFit.h>
+#include <Ponca/src/Fitting/dryFit.h>
 #include <Ponca/src/Fitting/weightFunc.h>
 #include <Ponca/src/Fitting/weightKernel.h>
 #include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
@@ -26,7 +29,7 @@ using namespace std;
 using namespace Ponca;
 
 template<typename DataPoint>
-typename DataPoint::Scalar generateData(KdTree<DataPoint>& tree)
+typename DataPoint::Scalar generateData(KdTree<DataPoint>& tree, bool addNoise = false)
 {
     typedef typename DataPoint::Scalar Scalar;
     typedef typename DataPoint::VectorType VectorType;
@@ -51,7 +54,7 @@ typename DataPoint::Scalar generateData(KdTree<DataPoint>& tree)
 #endif
     for(int i = 0; i < int(vectorPoints.size()); ++i)
     {
-        vectorPoints[i] = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+        vectorPoints[i] = getPointOnSphere<DataPoint>(radius, center, addNoise, addNoise, false);
     }
 
     tree.clear();
@@ -98,16 +101,50 @@ void testBasicFunctionalities(const KdTree<typename Fit::DataPoint>& tree, typen
         fit2.compute(vectorPoints);
         //! [Fit Compute]
 
+        // use compute function with packets of neighbors
+        //! [Fit Compute Packets]
+        Fit fit4;
+        fit4.setWeightFunc(WeightFunc(analysisScale));
+        fit4.init(fitInitPos);
+        fit4.template computeWithPackets<4>(vectorPoints);
+        //! [Fit Compute Packets]
+
+        // use compute function with a neighbor cache, reused across the passes
+        //! [Fit Compute Cached]
+        Fit fit5;
+        fit5.setWeightFunc(WeightFunc(analysisScale));
+        fit5.init(fitInitPos);
+        fit5.computeCached(vectorPoints.begin(), vectorPoints.end());
+        //! [Fit Compute Cached]
+
+        // use precomputed weights
+        //! [Fit Compute Weighted]
+        std::vector<WeightedNeighbor<DataPoint>> weightedNeighbors;
+        for (const auto& p : vectorPoints) {
+            auto wres = fit1.getWeightFunc().w(p.pos(), p);
+            weightedNeighbors.push_back({wres.first, wres.second, &p});
+        }
+        Fit fit8;
+        fit8.setWeightFunc(WeightFunc(analysisScale));
+        fit8.init(fitInitPos);
+        fit8.computeWeighted(weightedNeighbors);
+        //! [Fit Compute Weighted]
+
         // also test comparison operators
         VERIFY(fit1 == fit1);
         VERIFY(fit2 == fit2);
         VERIFY(fit1 == fit2);
+        VERIFY(fit1 == fit5);
+        VERIFY(fit1 == fit8);
+        VERIFY(fit4.getCurrentState() == fit1.getCurrentState());
+        VERIFY(fit4.getNumNeighbors() == fit1.getNumNeighbors());
         VERIFY(! (fit1 != fit1));
         VERIFY(! (fit1 != fit2));
         VERIFY(! (fit2 != fit2));
 
         // we skip kdtree test for float: using the kdtree changes the order of the neighbors, which in turn changes the
-        // rounding error accumulations, and thus the final result
+        // rounding error accumulations, and thus the final result. Packets change the order of the sums too: they are
+        // compared up to rounding errors by testPackets
         if (! std::is_same<Scalar, float>::value)
         {
             //! [Fit computeWithIds]
@@ -119,6 +156,67 @@ void testBasicFunctionalities(const KdTree<typename Fit::DataPoint>& tree, typen
             VERIFY(fit3 == fit3);
             VERIFY(fit1 == fit3);
             VERIFY(! (fit1 != fit3));
+
+            NeighborCache<DataPoint> cache;
+            Fit fit6;
+            fit6.setWeightFunc(WeightFunc(analysisScale));
+            fit6.init(fitInitPos);
+            fit6.computeWithIdsCached( tree.range_neighbors(fitInitPos, analysisScale), vectorPoints, cache );
+            VERIFY(fit1 == fit6);
+
+            // reuse the squared distances computed by the spatial query
+            //! [Fit addNeighbor squared distance]
+            Fit fit7;
+            fit7.setWeightFunc(WeightFunc(analysisScale));
+            fit7.init(fitInitPos);
+            auto query = tree.range_neighbors(fitInitPos, analysisScale);
+            for (auto it = query.begin(); it != query.end(); ++it)
+                fit7.addNeighbor(vectorPoints[*it], it.squaredDistance());
+            fit7.finalize();
+            //! [Fit addNeighbor squared distance]
+            VERIFY(fit1 == fit7);
+        }
+    }
+}
+
+// Packets of neighbors must give the same fits than neighbor-by-neighbor accumulation, whatever the number of
+// neighbors in the last packet. Sums are accumulated in a different order, so the fits are compared up to rounding
+// errors: `f(reference, fit, scale)` compares the results. Use noisy samples and small scales, so that the fits are
+// well conditioned.
+template<typename Fit, typename Functor>
+void testPackets(const KdTree<typename Fit::DataPoint>& tree, typename Fit::Scalar analysisScale, Functor f)
+{
+    using DataPoint  = typename Fit::DataPoint;
+    using WeightFunc = typename Fit::WFunctor;
+    const auto& vectorPoints = tree.points();
+
+    for (int i = 0; i < int(vectorPoints.size()); i += 7)
+    {
+        // Neighbors are gathered in a contiguous container, to control the size of the last packet
+        std::vector<DataPoint> neighbors;
+        for (int j : tree.range_neighbors(vectorPoints[i].pos(), analysisScale))
+            neighbors.push_back(vectorPoints[j]);
+        neighbors.resize(neighbors.size() - std::min<std::size_t>(neighbors.size(), std::size_t(i % 5)));
+
+        Fit reference;
+        reference.setWeightFunc(WeightFunc(analysisScale));
+        reference.init(vectorPoints[i].pos());
+        const FIT_RESULT res = reference.compute(neighbors);
+
+        Fit fit4, fit8;
+        fit4.setWeightFunc(WeightFunc(analysisScale));
+        fit4.init(vectorPoints[i].pos());
+        VERIFY(fit4.template computeWithPackets<4>(neighbors) == res);
+        fit8.setWeightFunc(WeightFunc(analysisScale));
+        fit8.init(vectorPoints[i].pos());
+        VERIFY(fit8.template computeWithPackets<8>(neighbors) == res);
+
+        VERIFY(fit4.getNumNeighbors() == reference.getNumNeighbors());
+        VERIFY(fit8.getNumNeighbors() == reference.getNumNeighbors());
+        if (reference.isStable())
+        {
+            f(reference, fit4, analysisScale);
+            f(reference, fit8, analysisScale);
         }
     }
 }
@@ -193,6 +291,111 @@ void hasSamePlaneDerivatives(const Fit1& fit1, const Fit2& fit2) {
     VERIFY(dnor1.isApprox( dnor2 ));
 }
 
+// Projections of the evaluation position on the fitted primitives, compared relatively to the scale
+template<typename Fit>
+void isSamePlaneProjection(const Fit& fit1, const Fit& fit2, typename Fit::Scalar scale) {
+    using Scalar = typename Fit::Scalar;
+    const auto& center = fit1.getWeightFunc().basisCenter();
+    VERIFY((fit1.compactPlane().project(center) - fit2.compactPlane().project(center)).norm() <= testEpsilon<Scalar>() * scale);
+}
+
+template<typename Fit>
+void isSameSphereProjection(const Fit& fit1, const Fit& fit2, typename Fit::Scalar scale) {
+    using Scalar = typename Fit::Scalar;
+    const auto& center = fit1.getWeightFunc().basisCenter();
+    VERIFY((fit1.algebraicSphere().project(center) - fit2.algebraicSphere().project(center)).norm() <= testEpsilon<Scalar>() * scale);
+}
+
+template<typename Fit>
+void hasApproxPlaneDerivatives(const Fit& fit1, const Fit& fit2) {
+    using Scalar = typename Fit::Scalar;
+    VERIFY(fit1.covariancePlaneDer().dPotential().isApprox(fit2.covariancePlaneDer().dPotential(), testEpsilon<Scalar>()));
+    VERIFY(fit1.covariancePlaneDer().dNormal().isApprox(fit2.covariancePlaneDer().dNormal(), testEpsilon<Scalar>()));
+}
+
+// Weighting function defining its own w, which ignores the neighbors in the half-space x < 0 of the basis center.
+// Packets must weight the neighbors with this w, and not with wPacket (see UsePacketWeights).
+template<typename DataPoint>
+struct HalfSpaceWeightFunc : public DistWeightFunc<DataPoint, SmoothWeightKernel<typename DataPoint::Scalar>>
+{
+    using Base = DistWeightFunc<DataPoint, SmoothWeightKernel<typename DataPoint::Scalar>>;
+    using Base::Base;
+
+    typename Base::WeightReturnType w(const typename Base::VectorType& _q, const DataPoint& _attributes) const
+    {
+        auto res = Base::w(_q, _attributes);
+        if (res.second.x() < typename Base::Scalar(0)) res.first = typename Base::Scalar(0);
+        return res;
+    }
+};
+
+// Fit computed a second time around a shifted basis center: its weights change between the passes
+template <class DataPoint, class _WFunctor, typename T>
+class ShiftedSecondPass : public T
+{
+    PONCA_FITTING_DECLARE_DEFAULT_TYPES
+
+public:
+    void init(const VectorType& _evalPos) { Base::init(_evalPos); m_shifted = false; }
+
+    FIT_RESULT finalize()
+    {
+        const FIT_RESULT res = Base::finalize();
+        if (m_shifted) return res;
+        m_shifted = true;
+        const auto& w = Base::getWeightFunc();
+        Base::init(w.basisCenter() + VectorType::Constant(w.evalScale() / Scalar(2)));
+        return Base::m_eCurrentState = NEED_OTHER_PASS;
+    }
+
+private:
+    bool m_shifted {false};
+};
+
+// Weighting function of fits moving their basis between the passes (see IsPassInvariantWeight)
+template<typename DataPoint>
+struct MovingWeightFunc : public DistWeightFunc<DataPoint, SmoothWeightKernel<typename DataPoint::Scalar>>
+{
+    using DistWeightFunc<DataPoint, SmoothWeightKernel<typename DataPoint::Scalar>>::DistWeightFunc;
+};
+
+template<typename DataPoint>
+struct Ponca::IsPassInvariantWeight<MovingWeightFunc<DataPoint>> : std::false_type {};
+
+// Cached neighborhoods of fits whose weights change between the passes must be weighted again at each pass, and
+// must keep the neighbors outside the support of the first pass: the results are the same than without cache
+template<typename Fit>
+void testPassVariantCache(const KdTree<typename Fit::DataPoint>& tree, typename Fit::Scalar analysisScale)
+{
+    using WeightFunc = typename Fit::WFunctor;
+    static_assert(! IsPassInvariantWeight<WeightFunc>::value, "Weights must be recomputed at each pass");
+    const auto& vectorPoints = tree.points();
+
+    std::vector<int> ids (vectorPoints.size());
+    for (int i = 0; i < int(ids.size()); ++i) ids[i] = i;
+
+    for (int i = 0; i < int(vectorPoints.size()); i += 7)
+    {
+        Fit reference, fitCached, fitIdsCached;
+        for (Fit* f : {&reference, &fitCached, &fitIdsCached})
+        {
+            f->setWeightFunc(WeightFunc(analysisScale));
+            f->init(vectorPoints[i].pos());
+        }
+        const FIT_RESULT res = reference.compute(vectorPoints);
+        VERIFY(fitCached.computeCached(vectorPoints.begin(), vectorPoints.end()) == res);
+        VERIFY(fitIdsCached.computeWithIdsCached(ids, vectorPoints) == res);
+
+        for (const Fit* f : {&fitCached, &fitIdsCached})
+        {
+            VERIFY(f->getNumNeighbors() == reference.getNumNeighbors());
+            VERIFY(f->getWeightSum() == reference.getWeightSum());
+            if (reference.isStable())
+                VERIFY(*f == reference);
+        }
+    }
+}
+
 template<typename Scalar, int Dim>
 void callSubTests()
 {
@@ -226,12 +429,35 @@ void callSubTests()
     using PlaneScaleSpaceDiff = BasketDiff<TestPlane, FitScaleSpaceDer, CovariancePlaneDer>;
     //! [PlaneFitDerTypes]
 
+    using SphereFitType     = Basket<Point, WeightFunc, SphereFit>;
+    using UnorientedSphere  = Basket<Point, WeightFunc, UnorientedSphereFit>;
+    using DrySphere         = Basket<Point, WeightFunc, AlgebraicSphere, MeanNormal, MeanPosition, DryFit>;
+
+    // Packets are accumulated at once only when all the extensions support it
+    static_assert(TestPlane::template hasPacketAccumulation<8>(), "CovariancePlaneFit accumulates packets");
+    static_assert(Sphere::template hasPacketAccumulation<8>(), "OrientedSphereFit accumulates packets");
+    static_assert(Hybrid::template hasPacketAccumulation<4>(), "Hybrid fits accumulate packets");
+    static_assert(SphereFitType::template hasPacketAccumulation<8>(), "SphereFit accumulates packets");
+    static_assert(UnorientedSphere::template hasPacketAccumulation<8>(), "UnorientedSphereFit accumulates packets");
+    static_assert(! DrySphere::template hasPacketAccumulation<8>(), "DryFit does not accumulate packets");
+
+    // Weighting functions redefining w don't weight packets at once
+    using HalfSpacePlane     = Basket<Point, HalfSpaceWeightFunc<Point>, CovariancePlaneFit>;
+    using HalfSpacePlaneDiff = BasketDiff<HalfSpacePlane, FitScaleSpaceDer, CovariancePlaneDer>;
+    static_assert(UsePacketWeights<WeightFunc>::value, "DistWeightFunc weights packets at once");
+    static_assert(! UsePacketWeights<HalfSpaceWeightFunc<Point>>::value, "Derived weighting functions use their w");
+
+    // Fits moving their basis between the passes, with weights recomputed at each pass
+    using ShiftedPlane = Basket<Point, MovingWeightFunc<Point>, CovariancePlaneFit, ShiftedSecondPass>;
+
     using HybridScaleDiff = BasketDiff<Hybrid, FitScaleDer, CovariancePlaneDer>;
     using HybridSpaceDiff = BasketDiff<Hybrid, FitSpaceDer, CovariancePlaneDer>;
     using HybridScaleSpaceDiff = BasketDiff<Hybrid, FitScaleSpaceDer, CovariancePlaneDer>;
 
     KdTreeDense<Point> tree;
     Scalar scale = generateData(tree);
+    KdTreeDense<Point> noisyTree;
+    Scalar noisyScale = generateData(noisyTree, true) / Scalar(2);
 
     for(int i = 0; i < g_repeat; ++i)
     {
@@ -249,6 +475,30 @@ void callSubTests()
         CALL_SUBTEST((testBasicFunctionalities<HybridSpaceDiff>(tree, scale) ));
         CALL_SUBTEST((testBasicFunctionalities<HybridScaleSpaceDiff>(tree, scale) ));
 
+        // Packet accumulation, and packet weighting of BasketDiff
+        // Without noise, the Pratt eigen problem of SphereFit has a null eigenvalue, that rounding errors may turn into
+        // a negative one: the selected eigenvector then depends on the accumulation order
+        auto checkPacketPlane = [](const auto&f1, const auto&f2, Scalar t){isSamePlaneProjection(f1,f2,t);};
+        auto checkPacketSphere = [](const auto&f1, const auto&f2, Scalar t){isSameSphereProjection(f1,f2,t);};
+        auto checkPacketPlaneDerivative = [](const auto&f1, const auto&f2, Scalar t){
+            isSamePlaneProjection(f1,f2,t);
+            hasApproxPlaneDerivatives(f1, f2);
+        };
+        CALL_SUBTEST((testPackets<TestPlane>(noisyTree, noisyScale, checkPacketPlane) ));
+        CALL_SUBTEST((testPackets<Sphere>(noisyTree, noisyScale, checkPacketSphere) ));
+        CALL_SUBTEST((testPackets<Hybrid>(noisyTree, noisyScale, [](const auto&f1, const auto&f2, Scalar t){
+            isSamePlaneProjection(f1,f2,t);
+            isSameSphereProjection(f1,f2,t);
+        }) ));
+        CALL_SUBTEST((testPackets<SphereFitType>(noisyTree, noisyScale, checkPacketSphere) ));
+        CALL_SUBTEST((testPackets<UnorientedSphere>(noisyTree, noisyScale, checkPacketSphere) ));
+        CALL_SUBTEST((testPackets<DrySphere>(noisyTree, noisyScale, [](const auto&, const auto&, Scalar){}) ));
+        CALL_SUBTEST((testPackets<PlaneScaleSpaceDiff>(noisyTree, noisyScale, checkPacketPlaneDerivative) ));
+        CALL_SUBTEST((testPackets<HybridScaleSpaceDiff>(noisyTree, noisyScale, checkPacketPlaneDerivative) ));
+        CALL_SUBTEST((testPackets<HalfSpacePlane>(noisyTree, noisyScale, checkPacketPlane) ));
+        CALL_SUBTEST((testPackets<HalfSpacePlaneDiff>(noisyTree, noisyScale, checkPacketPlaneDerivative) ));
+        CALL_SUBTEST((testPassVariantCache<ShiftedPlane>(noisyTree, noisyScale) ));
+
         // Check that we get the same Sphere, whatever the extensions
         auto checkIsSameSphere = [](const auto&f1, const auto&f2){isSameSphere(f1,f2);};
         CALL_SUBTEST((testIsSame<Sphere, Hybrid>(tree, scale, checkIsSameSphere) ));
@@ -0,0 +1,151 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/chunkPipeline.h>
+
+#include <stdexcept>
+
+using namespace std;
+using namespace Ponca;
+
+// Number of neighbors, and sum of their global ids
+using NeighborSummary = std::pair<int, std::uint64_t>;
+
+template<typename DataPoint>
+void testChunkPipeline()
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using Pipeline   = ChunkPipeline<DataPoint>;
+    using Chunk      = typename Pipeline::Chunk;
+
+    const int N = Eigen::internal::random<int>(2000, 10000);
+    std::vector<DataPoint> points (N);
+    std::generate(points.begin(), points.end(), []() {
+        return DataPoint((VectorType::Random().array() + Scalar(1)) / Scalar(2)); });
+    const Scalar radius = Eigen::internal::random<Scalar>(0.02, 0.08);
+
+    // Reference: neighbors in the whole cloud
+    KdTreeDense<DataPoint> tree (points);
+    std::vector<NeighborSummary> reference (N);
+    for (int i = 0; i < N; ++i)
+        for (int j : tree.range_neighbors(i, radius))
+        {
+            ++reference[i].first;
+            reference[i].second += std::uint64_t(j);
+        }
+
+    Pipeline pipeline;
+    pipeline.setDomain(typename Pipeline::AabbType(VectorType::Zero(), VectorType::Ones()));
+    pipeline.setChunkSize(Eigen::internal::random<Scalar>(0.2, 0.6));
+    pipeline.setHaloMargin(radius);
+    pipeline.setQueueCapacity(Eigen::internal::random<int>(1, 3));
+
+    auto load = [&](Chunk& chunk) {
+        for (int i = 0; i < N; ++i)
+            if (chunk.loadBox.contains(points[i].pos()))
+            {
+                chunk.points.push_back(points[i]);
+                chunk.ids.push_back(std::size_t(i));
+            }
+        return true;
+    };
+    auto fit = [&](const Chunk& chunk, int i) {
+        NeighborSummary res {0, 0};
+        for (int j : chunk.tree.range_neighbors(i, radius))
+        {
+            ++res.first;
+            res.second += std::uint64_t(chunk.ids[j]);
+        }
+        return res;
+    };
+
+    std::vector<NeighborSummary> results (N);
+    std::vector<int> written (N, 0);
+    int lastChunk = -1;
+    bool ordered = true;
+    auto write = [&](const Chunk& chunk, const std::vector<NeighborSummary>& chunkResults) {
+        ordered = ordered && chunk.id > lastChunk;
+        lastChunk = chunk.id;
+        if (int(chunkResults.size()) != chunk.coreCount) return false;
+        for (int i = 0; i < chunk.coreCount; ++i)
+        {
+            const auto id = chunk.ids[i];
+            ++written[id];
+            results[id] = chunkResults[i];
+            // Core points belong to the chunk, halo points to its neighbors
+            if (pipeline.cellOf(chunk.tree.points()[i].pos()) != chunk.cell) return false;
+        }
+        for (int i = chunk.coreCount; i < int(chunk.tree.point_count()); ++i)
+            if (pipeline.cellOf(chunk.tree.points()[i].pos()) == chunk.cell) return false;
+        return true;
+    };
+
+    VERIFY(pipeline.run(load, fit, write));
+    VERIFY(ordered);
+    for (int i = 0; i < N; ++i)
+    {
+        VERIFY(written[i] == 1);   // each point is processed once, with its complete neighborhood
+        VERIFY(results[i] == reference[i]);
+    }
+
+    const ChunkPipelineStats& stats = pipeline.stats();
+    VERIFY(stats.core_count == std::size_t(N));
+    VERIFY(stats.chunk_count > 0 && stats.chunk_count <= std::size_t(pipeline.chunkCount()));
+    VERIFY(pipeline.chunkCount() == 1 || stats.halo_count > 0);
+    VERIFY(stats.bottleneck_seconds() <= stats.load_seconds + stats.index_seconds + stats.fit_seconds + stats.write_seconds);
+
+    // Failures stop the pipeline
+    int loadedChunks = 0;
+    VERIFY(! pipeline.run([&](Chunk& chunk) { return ++loadedChunks < 3 && load(chunk); }, fit,
+                          [](const Chunk&, const std::vector<NeighborSummary>&) { return true; }));
+    VERIFY(loadedChunks <= 3);
+    VERIFY(! pipeline.run(load, fit, [](const Chunk&, const std::vector<NeighborSummary>&) { return false; }));
+
+    // Exceptions thrown by a stage stop the pipeline, and are rethrown by run
+    const auto throws = [&](auto&& l, auto&& f, auto&& w) {
+        try
+        {
+            pipeline.run(l, f, w);
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+        return false;
+    };
+    const auto throwingLoad = [&](Chunk& chunk) -> bool {
+        if (chunk.id > 0) throw std::runtime_error("load failure");
+        return load(chunk);
+    };
+    const auto throwingFit = [&](const Chunk& chunk, int i) -> NeighborSummary {
+        if (i == chunk.coreCount / 2) throw std::runtime_error("fit failure");
+        return fit(chunk, i);
+    };
+    const auto throwingWrite = [](const Chunk&, const std::vector<NeighborSummary>&) -> bool {
+        throw std::runtime_error("write failure");
+    };
+    VERIFY(pipeline.chunkCount() == 1 || throws(throwingLoad, fit, write));
+    VERIFY(throws(load, throwingFit, write));
+    VERIFY(throws(load, fit, throwingWrite));
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test ChunkPipeline (float)" << endl;
+	testChunkPipeline<PointPosition<float, 3>>();
+	cout << "Test ChunkPipeline (double)" << endl;
+	testChunkPipeline<PointPosition<double, 3>>();
+}
@@ -0,0 +1,189 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Common/executor.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/KnnGraph/knnGraph.h>
+
+#include <atomic>
+#include <set>
+#include <stdexcept>
+
+using namespace std;
+using namespace Ponca;
+
+// Each index of [0, n) must be processed exactly once, including in nested loops
+void testCoverage(Executor& executor)
+{
+    for (std::ptrdiff_t n : {std::ptrdiff_t(0), std::ptrdiff_t(1), std::ptrdiff_t(7),
+                             std::ptrdiff_t(Eigen::internal::random<int>(1000, 100000))})
+    {
+        for (std::ptrdiff_t grain : {std::ptrdiff_t(0), std::ptrdiff_t(1), std::ptrdiff_t(64)})
+        {
+            std::vector<std::atomic<int>> counts (static_cast<std::size_t>(n));
+            executor.parallelFor(n, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+                VERIFY(0 <= begin && begin < end && end <= n);
+                for (std::ptrdiff_t i = begin; i < end; ++i) ++counts[i];
+            }, grain);
+            for (const auto& c : counts) VERIFY(c == 1);
+        }
+    }
+
+    const int outer = 16, inner = 1000;
+    std::vector<std::atomic<int>> counts (outer * inner);
+    executor.forEach(outer, [&](std::ptrdiff_t i) {
+        executor.forEach(inner, [&](std::ptrdiff_t j) { ++counts[i * inner + j]; });
+    }, 1);
+    for (const auto& c : counts) VERIFY(c == 1);
+}
+
+// Exceptions thrown by a task are rethrown by parallelFor, and leave the executor usable
+void testExceptions(Executor& executor)
+{
+    for (std::ptrdiff_t thrower : {std::ptrdiff_t(0), std::ptrdiff_t(5000), std::ptrdiff_t(9999)})
+    {
+        bool caught = false;
+        try
+        {
+            executor.forEach(10000, [thrower](std::ptrdiff_t i) {
+                if (i == thrower) throw std::runtime_error("task failure");
+            }, 16);
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        VERIFY(caught);
+
+        // Exception thrown from a nested loop
+        caught = false;
+        try
+        {
+            executor.forEach(16, [&executor, thrower](std::ptrdiff_t i) {
+                executor.forEach(1000, [i, thrower](std::ptrdiff_t j) {
+                    if (i * 1000 + j == thrower) throw std::runtime_error("nested task failure");
+                });
+            }, 1);
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        VERIFY(caught);
+    }
+    testCoverage(executor);
+}
+
+// Task system running each task in a new thread, joined on destruction
+struct ThreadTasks
+{
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+
+    void submit(std::function<void()> task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.emplace_back(std::move(task));
+    }
+    ~ThreadTasks() { for (auto& t : threads) t.join(); }
+};
+
+template<typename DataPoint>
+void testKdTree(Executor& executor)
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int N = Eigen::internal::random<int>(20000, 60000);
+    std::vector<DataPoint> points (N);
+    std::generate(points.begin(), points.end(), []() { return DataPoint(VectorType::Random()); });
+
+    // Reference tree, built serially
+    SerialExecutor serial;
+    KdTreeDense<DataPoint> reference;
+    reference.set_executor(&serial);
+    reference.build(points);
+
+    KdTreeDense<DataPoint> tree;
+    tree.set_executor(&executor);
+    tree.set_min_cell_size(Eigen::internal::random<int>(8, 64));
+    tree.build(points);
+    VERIFY(tree.valid());
+    VERIFY(tree.leaf_count() > 0);
+
+    std::vector<VectorType> queries (Eigen::internal::random<int>(500, 2000));
+    std::generate(queries.begin(), queries.end(), []() { return VectorType(VectorType::Random()); });
+    const int k = Eigen::internal::random<int>(1, 20);
+    const Scalar r = Eigen::internal::random<Scalar>(0.02, 0.1);
+
+    std::vector<int> knn;
+    tree.k_nearest_neighbors_batch(queries, k, knn);
+    std::vector<std::size_t> offsets;
+    std::vector<int> range;
+    tree.range_neighbors_batch(queries, r, offsets, range);
+    VERIFY(knn.size() == queries.size() * std::size_t(k));
+    VERIFY(offsets.size() == queries.size() + 1 && offsets.back() == range.size());
+
+    for (std::size_t q = 0; q < queries.size(); ++q)
+    {
+        // Same neighbors than the queries on the tree built serially
+        std::set<int> expected, batch (knn.begin() + q * k, knn.begin() + (q + 1) * k);
+        for (int j : reference.k_nearest_neighbors(queries[q], k)) expected.insert(j);
+        VERIFY(batch == expected);
+
+        expected.clear();
+        for (int j : reference.range_neighbors(queries[q], r)) expected.insert(j);
+        VERIFY((std::set<int>(range.begin() + offsets[q], range.begin() + offsets[q + 1]) == expected));
+        VERIFY(offsets[q + 1] - offsets[q] == expected.size());
+    }
+
+    // KnnGraph
+    KnnGraph<DataPoint> graph (tree, k, &executor);
+    KnnGraph<DataPoint> serialGraph (reference, k, &serial);
+    for (int i = 0; i < N; i += 97)
+    {
+        std::set<int> a, b;
+        for (int j : graph.k_nearest_neighbors(i)) a.insert(j);
+        for (int j : serialGraph.k_nearest_neighbors(i)) b.insert(j);
+        VERIFY(a == b);
+    }
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	SerialExecutor serial;
+	OpenMPExecutor openmp;
+	ThreadPoolExecutor pool (4);
+	ThreadTasks tasks;
+	TaskExecutor taskExecutor ([&tasks](std::function<void()> task) { tasks.submit(std::move(task)); }, 4);
+	std::vector<std::pair<std::string, Executor*>> executors {
+		{"SerialExecutor", &serial}, {"OpenMPExecutor", &openmp}, {"ThreadPoolExecutor", &pool},
+		{"TaskExecutor", &taskExecutor}, {"default executor", &defaultExecutor()}};
+
+	for (const auto& e : executors)
+	{
+		cout << "Test " << e.first << endl;
+		testCoverage(*e.second);
+		testExceptions(*e.second);
+		testKdTree<PointPositionNormal<float, 3>>(*e.second);
+		testKdTree<PointPositionNormal<double, 3>>(*e.second);
+	}
+
+	cout << "Test setDefaultExecutor" << endl;
+	setDefaultExecutor(&serial);
+	VERIFY(&defaultExecutor() == &serial);
+	VERIFY(&executorOrDefault(&pool) == &pool);
+	setDefaultExecutor(nullptr);
+	VERIFY(&defaultExecutor() != &serial);
+}
@@ -0,0 +1,153 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/fit_covariance_accumulation.cpp
+    \brief Test covariance accumulation precision, for float points far from the origin
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <limits>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// Point accumulated with a different precision than its storage precision
+template<typename _Scalar, int _Dim, typename _AccumulationScalar>
+class PointAccumulated : public PointPositionNormal<_Scalar, _Dim>
+{
+public:
+    using PointPositionNormal<_Scalar, _Dim>::PointPositionNormal;
+    typedef _AccumulationScalar AccumulationScalar;
+};
+
+template<typename Point>
+using PlaneFit = Basket<Point, DistWeightFunc<Point, SmoothWeightKernel<typename Point::Scalar>>, CovariancePlaneFit>;
+
+template<typename Fit>
+Fit computeFit(const vector<typename Fit::DataPoint>& _points,
+               const typename Fit::VectorType& _evalPos,
+               typename Fit::Scalar _scale)
+{
+    Fit fit;
+    fit.setWeightFunc(typename Fit::WeightFunction(_scale));
+    fit.init(_evalPos);
+    fit.compute(_points);
+    return fit;
+}
+
+template<typename Point, typename RefPoint>
+vector<Point> convertPoints(const vector<RefPoint>& _points)
+{
+    vector<Point> res;
+    res.reserve(_points.size());
+    for (const auto& p : _points)
+        res.emplace_back(p.pos().template cast<typename Point::Scalar>(),
+                         p.normal().template cast<typename Point::Scalar>());
+    return res;
+}
+
+void testFunction()
+{
+    using PointF  = PointPositionNormal<float, 3>;
+    using PointFD = PointAccumulated<float, 3, double>;
+    using PointD  = PointPositionNormal<double, 3>;
+    using VectorD = PointD::VectorType;
+
+    static_assert(std::is_same<PlaneFit<PointF>::AccumulationScalar, float>::value,
+                  "Points accumulate in their storage precision by default");
+    static_assert(std::is_same<PlaneFit<PointFD>::AccumulationScalar, double>::value,
+                  "Points can declare their accumulation precision");
+
+    // Sample a plane far from the origin, the samples being stored in float: they are exactly representable in double
+    const double scale    = Eigen::internal::random<double>(1., 10.);
+    const VectorD center  = VectorD::Random().normalized() * Eigen::internal::random<double>(1e3, 1e4);
+    const VectorD normal  = VectorD::Random().normalized();
+    const int nbPoints    = Eigen::internal::random<int>(100, 1000);
+
+    vector<PointF> pointsF(nbPoints);
+    for (auto& p : pointsF)
+    {
+        const PointD pd = getPointOnPlane<PointD>(center, normal, Eigen::internal::random<double>(0., 1.) * scale,
+                                                 false, false, false);
+        p = PointF(pd.pos().cast<float>(), pd.normal().cast<float>());
+    }
+    const auto pointsFD = convertPoints<PointFD>(pointsF);
+    const auto pointsD  = convertPoints<PointD>(pointsF);
+
+    // The evaluation position is away from the samples: the barycenter is far from the origin of the local basis,
+    // compared to the spread of the neighbors along the normal direction
+    const VectorD evalPos = (center + Eigen::internal::random<double>(0.2, 0.5) * scale * normal)
+                                .cast<float>().cast<double>();
+    const double analysisScale = double(float(2. * scale));
+
+    const auto fitD  = computeFit<PlaneFit<PointD>> (pointsD,  evalPos, analysisScale);
+    const auto fitF  = computeFit<PlaneFit<PointF>> (pointsF,  evalPos.cast<float>(), float(analysisScale));
+    const auto fitFD = computeFit<PlaneFit<PointFD>>(pointsFD, evalPos.cast<float>(), float(analysisScale));
+
+    VERIFY(fitD.isStable());
+    VERIFY(fitF.getCurrentState() == fitD.getCurrentState());
+    VERIFY(fitFD.getCurrentState() == fitD.getCurrentState());
+
+    const double epsilon = testEpsilon<float>();
+    const VectorD refNormal = fitD.primitiveGradient();
+    VERIFY(1. - std::abs(refNormal.dot(fitF.primitiveGradient().cast<double>())) <= epsilon);
+    VERIFY(1. - std::abs(refNormal.dot(fitFD.primitiveGradient().cast<double>())) <= epsilon);
+
+    // CovarianceFitBase does not hide the barycenter of MeanPosition, used with the other MeanPosition sums
+    VERIFY(fitFD.barycenter() == fitFD.meanPosition().barycenter());
+
+    // The barycenter on which the covariance is centered is accumulated in the same precision as the covariance: with
+    // the weights and local positions computed in float, it is only limited by the storage precision when
+    // accumulating in double
+    VectorD sumP = VectorD::Zero();
+    double sumW = 0;
+    for (const auto& p : pointsFD)
+    {
+        const auto wres = fitFD.getWeightFunc().w(p.pos(), p);
+        if (wres.first > 0.f)
+        {
+            sumP += double(wres.first) * wres.second.cast<double>();
+            sumW += double(wres.first);
+        }
+    }
+    const VectorD refBarycenter = sumP / sumW;
+    VERIFY((fitF.covarianceBarycenter().cast<double>()  - refBarycenter).norm() <= epsilon * analysisScale);
+    VERIFY((fitFD.covarianceBarycenter().cast<double>() - refBarycenter).norm()
+           <= double(std::numeric_limits<float>::epsilon()) * analysisScale);
+
+    // The smallest eigenvalue measures the spread of the samples along the normal, and suffers the most from
+    // cancellation: it is only limited by the storage precision when accumulating in double
+    const double refLambda0 = fitD.solver().eigenvalues()(0);
+    const double refTrace   = fitD.solver().eigenvalues().sum();
+    VERIFY(std::abs(double(fitF.solver().eigenvalues()(0))  - refLambda0) <= epsilon * refTrace);
+    VERIFY(std::abs(double(fitFD.solver().eigenvalues()(0)) - refLambda0) <= 1e-6 * refTrace);
+    VERIFY(std::abs(double(fitFD.surfaceVariation()) - fitD.surfaceVariation()) <= 1e-5);
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test covariance accumulation precision..." << endl;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction() ));
+    }
+}
@@ -78,6 +78,12 @@ void testFunction(bool _bUnoriented = false, bool _bAddPositionNoise = false, bo
 
         fit.compute(vectorPoints);
 
+        // Second pass replays the neighbors stored in a cache during the first one
+        Fit fitCached;
+        fitCached.setWeightFunc(WeightFunc(analysisScale));
+        fitCached.init(queryPos);
+        VERIFY(fitCached.computeCached(vectorPoints.begin(), vectorPoints.end()) == fit.getCurrentState());
+
         if( fit.isStable() ){
 
             // Check if the plane orientation is equal to the generation direction
@@ -93,6 +99,9 @@ void testFunction(bool _bUnoriented = false, bool _bAddPositionNoise = false, bo
               VERIFY(fit.kMean() <= epsilon);
               VERIFY(fit.GaussianCurvature() <= epsilon);
             }
+
+            VERIFY(std::abs(fit.kMean() - fitCached.kMean()) <= epsilon);
+            VERIFY(std::abs(fit.GaussianCurvature() - fitCached.GaussianCurvature()) <= epsilon);
         }
     }
 }
@@ -0,0 +1,283 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/image_grid.cpp
+    \brief Test image-space neighbor queries and per-pixel fitting on a depth image
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/imageGridFit.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/ImageGrid/imageGrid.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// Render the depth and normal buffers of a sphere seen by a pinhole camera located at the origin and looking at +z
+template<typename Scalar>
+void renderSphere(int _width, int _height, Scalar _f, Scalar _depth, Scalar _radius,
+                  vector<Scalar>& _depthBuffer, vector<Scalar>& _normalBuffer)
+{
+    using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+    const Vector3 center (0, 0, _depth);
+    const Scalar cx = Scalar(_width) / 2, cy = Scalar(_height) / 2;
+
+    _depthBuffer.assign(size_t(_width) * _height, Scalar(0));
+    _normalBuffer.assign(size_t(3) * _width * _height, Scalar(0));
+    for (int y = 0; y < _height; ++y)
+    {
+        for (int x = 0; x < _width; ++x)
+        {
+            const int idx = y * _width + x;
+            const Vector3 dir ((Scalar(x) - cx) / _f, (Scalar(y) - cy) / _f, Scalar(1));
+            // Nearest intersection of the ray t * dir with the sphere
+            const Scalar a = dir.squaredNorm();
+            const Scalar b = dir.dot(center);
+            const Scalar delta = b * b - a * (center.squaredNorm() - _radius * _radius);
+            if (delta < Scalar(0)) continue;
+            const Scalar t = (b - std::sqrt(delta)) / a;
+            const Vector3 n = (t * dir - center) / _radius;
+            _depthBuffer[idx] = t;
+            _normalBuffer[3*idx] = n.x(); _normalBuffer[3*idx+1] = n.y(); _normalBuffer[3*idx+2] = n.z();
+        }
+    }
+}
+
+template<typename DataPoint>
+void testWindowQuery(const ImageGrid<DataPoint>& _grid, int _x, int _y, int _radius)
+{
+    vector<int> expected;
+    for (int y = std::max(0, _y - _radius); y <= std::min(_grid.height() - 1, _y + _radius); ++y)
+        for (int x = std::max(0, _x - _radius); x <= std::min(_grid.width() - 1, _x + _radius); ++x)
+            if ((x - _x) * (x - _x) + (y - _y) * (y - _y) <= _radius * _radius && _grid.isValid(_grid.index(x, y)))
+                expected.push_back(_grid.index(x, y));
+
+    vector<int> result;
+    for (int j : _grid.window_neighbors(_x, _y, _radius))
+        result.push_back(j);
+
+    VERIFY(result == expected);
+}
+
+template<typename Fit>
+void testFunction()
+{
+    using DataPoint  = typename Fit::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = typename Fit::WeightFunction;
+
+    const int width  = Eigen::internal::random<int>(40, 80);
+    const int height = Eigen::internal::random<int>(40, 80);
+    const Scalar f       = Scalar(60);
+    const Scalar depth   = Scalar(5);
+    const Scalar radius  = Eigen::internal::random<Scalar>(Scalar(1.5), Scalar(2.5));
+
+    vector<Scalar> depthBuffer, normalBuffer;
+    renderSphere(width, height, f, depth, radius, depthBuffer, normalBuffer);
+
+    ImageGrid<DataPoint> grid;
+    grid.buildFromDepth(width, height, depthBuffer.data(), normalBuffer.data(),
+                        f, f, Scalar(width) / 2, Scalar(height) / 2);
+    VERIFY(grid.point_count() == width * height);
+    VERIFY(grid.valid_count() == int(std::count_if(depthBuffer.begin(), depthBuffer.end(),
+                                                   [](Scalar z) { return z > Scalar(0); })));
+
+    // Window queries, including windows crossing the image borders and the background
+    const int windowRadius = Eigen::internal::random<int>(2, 6);
+    for (int i = 0; i < 50; ++i)
+        testWindowQuery(grid, Eigen::internal::random<int>(0, width - 1),
+                        Eigen::internal::random<int>(0, height - 1), windowRadius);
+    testWindowQuery(grid, 0, 0, windowRadius);
+    testWindowQuery(grid, width - 1, height - 1, windowRadius);
+    testWindowQuery(grid, width / 2, height / 2, 0);
+
+    // Per-pixel fits: same results than fits computed independently
+    const Scalar pixelSize = depth / f;
+    const Scalar scale = Scalar(1.5) * windowRadius * pixelSize;
+
+    ImageGridFit<Fit> engine;
+    engine.setWeightFunc(WeightFunc(scale));
+    engine.setWindowRadius(windowRadius);
+    engine.setTileSize(Eigen::internal::random<int>(4, 32));
+
+    vector<Fit> fits (grid.point_count());
+    vector<char> computed (grid.point_count(), 0);
+    engine.compute(grid, [&fits, &computed](int _idx, const Fit& _fit) {
+        fits[_idx] = _fit;
+        ++computed[_idx];
+    });
+
+    for (int idx = 0; idx < grid.point_count(); ++idx)
+    {
+        VERIFY(computed[idx] == (grid.isValid(idx) ? 1 : 0));
+        if (! grid.isValid(idx)) continue;
+
+        Fit ref;
+        ref.setWeightFunc(WeightFunc(scale));
+        ref.init(grid.points()[idx].pos());
+        ref.computeWithIds(grid.window_neighbors(idx, windowRadius), grid.points());
+
+        VERIFY(ref.getCurrentState() == fits[idx].getCurrentState());
+        VERIFY(ref.getNumNeighbors() == fits[idx].getNumNeighbors());
+        if (ref.isStable())
+            VERIFY((ref.primitiveGradient() - fits[idx].primitiveGradient()).norm() <= testEpsilon<Scalar>());
+    }
+
+    // Curvature and normal images: compare to the analytic values far from the silhouette of the sphere
+    const auto kappa   = engine.computeImage(grid, [](const Fit& _fit) { return _fit.kappa(); }, Scalar(0));
+    const auto normals = engine.computeImage(grid, [](const Fit& _fit) { return _fit.primitiveGradient(); },
+                                             VectorType(VectorType::Zero()));
+    VERIFY(int(kappa.size()) == grid.point_count());
+
+    const Scalar innerRadius = Scalar(0.6) * radius * f / depth; // in pixels
+    int nbChecked = 0;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const int idx = grid.index(x, y);
+            const Scalar dx = Scalar(x) - Scalar(width) / 2, dy = Scalar(y) - Scalar(height) / 2;
+            if (! grid.isValid(idx))
+            {
+                VERIFY(kappa[idx] == Scalar(0));
+                continue;
+            }
+            if (dx * dx + dy * dy > innerRadius * innerRadius) continue;
+
+            VERIFY(std::abs(std::abs(kappa[idx]) - Scalar(1) / radius) <= Scalar(0.1) / radius);
+            VERIFY(std::abs(normals[idx].normalized().dot(grid.points()[idx].normal())) >= Scalar(0.99));
+            ++nbChecked;
+        }
+    }
+    VERIFY(nbChecked > 0);
+}
+
+/// Multi-pass fits: the window neighbors gathered for the first pass are replayed by the next ones
+template<typename Fit>
+void testMultiPass()
+{
+    using DataPoint  = typename Fit::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using WeightFunc = typename Fit::WeightFunction;
+
+    const int width = 48, height = 48;
+    const Scalar f = Scalar(60), depth = Scalar(5), radius = Scalar(2);
+    vector<Scalar> depthBuffer, normalBuffer;
+    renderSphere(width, height, f, depth, radius, depthBuffer, normalBuffer);
+
+    ImageGrid<DataPoint> grid;
+    grid.buildFromDepth(width, height, depthBuffer.data(), normalBuffer.data(),
+                        f, f, Scalar(width) / 2, Scalar(height) / 2);
+
+    const int windowRadius = Eigen::internal::random<int>(2, 6);
+    const Scalar scale = Scalar(1.5) * windowRadius * depth / f;
+    ImageGridFit<Fit> engine;
+    engine.setWeightFunc(WeightFunc(scale));
+    engine.setWindowRadius(windowRadius);
+
+    vector<int> neighbors;
+    for (int i = 0; i < 50; ++i)
+    {
+        const int idx = grid.index(Eigen::internal::random<int>(0, width - 1),
+                                   Eigen::internal::random<int>(0, height - 1));
+        if (! grid.isValid(idx)) continue;
+
+        Fit fit;
+        engine.computeAt(grid, idx, fit, neighbors);
+        const auto query = grid.window_neighbors(idx, windowRadius);
+        int nbQueried = 0;
+        for (int j : query) VERIFY(neighbors[nbQueried++] == j);
+        VERIFY(nbQueried == int(neighbors.size()));
+
+        Fit ref;
+        ref.setWeightFunc(WeightFunc(scale));
+        ref.init(grid.points()[idx].pos());
+        ref.computeWithIds(query, grid.points());
+
+        VERIFY(ref.getCurrentState() == fit.getCurrentState());
+        VERIFY(ref.getNumNeighbors() == fit.getNumNeighbors());
+        if (ref.isStable())
+            VERIFY(std::abs(ref.kMean() - fit.kMean()) <= testEpsilon<Scalar>() * (Scalar(1) + std::abs(ref.kMean())));
+    }
+}
+
+/// Weighting function discarding the neighbors across depth discontinuities. It is not derived from DistWeightFunc,
+/// and its neighbors are not weighted by packets (see UsePacketWeights).
+template<typename DataPoint>
+class DepthAwareWeightFunc
+{
+public:
+    using Scalar           = typename DataPoint::Scalar;
+    using VectorType       = typename DataPoint::VectorType;
+    using MatrixType       = typename DataPoint::MatrixType;
+    using DistWeight       = DistWeightFunc<DataPoint, SmoothWeightKernel<Scalar>>;
+    using WeightReturnType = typename DistWeight::WeightReturnType;
+
+    DepthAwareWeightFunc(const Scalar& _t = Scalar(1)) : m_dist(_t) {}
+
+    void init(const VectorType& _evalPos) { m_dist.init(_evalPos); }
+    const VectorType& basisCenter() const { return m_dist.basisCenter(); }
+    VectorType convertToLocalBasis(const VectorType& _q) const { return m_dist.convertToLocalBasis(_q); }
+    Scalar evalScale() const { return m_dist.evalScale(); }
+
+    WeightReturnType w(const VectorType& _q, const DataPoint& _attributes) const
+    {
+        auto res = m_dist.w(_q, _attributes);
+        if (std::abs(res.second.z()) > m_dist.evalScale() / Scalar(2)) res.first = Scalar(0);
+        return res;
+    }
+
+private:
+    DistWeight m_dist;
+};
+
+template<typename Scalar>
+void callSubTests()
+{
+    using Point = PointPositionNormal<Scalar, 3>;
+    using WeightSmoothFunc = DistWeightFunc<Point, SmoothWeightKernel<Scalar> >;
+    using Fit = Basket<Point, WeightSmoothFunc, OrientedSphereFit, GLSParam>;
+    using MongeFit = Basket<Point, WeightSmoothFunc, CovariancePlaneFit, MongePatch>;
+
+    using DepthAwareFit = Basket<Point, DepthAwareWeightFunc<Point>, OrientedSphereFit, GLSParam>;
+
+    static_assert(ImageGridFit<Fit>::usePackets, "Basket should process packets of neighbors");
+    static_assert(! ImageGridFit<DepthAwareFit>::usePackets, "Only DistWeightFunc weights packets of neighbors");
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Fit>() ));
+        CALL_SUBTEST(( testFunction<DepthAwareFit>() ));
+        CALL_SUBTEST(( testMultiPass<MongeFit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test image grid queries and fitting..." << endl;
+
+    callSubTests<float>();
+    callSubTests<double>();
+}
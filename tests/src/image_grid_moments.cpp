@@ -0,0 +1,201 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/image_grid_moments.cpp
+    \brief Test window moments computed from summed-area tables on a depth image
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/imageGridMoments.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/ImageGrid/imageGrid.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// Render the depth and normal buffers of a sphere seen by a pinhole camera located at the origin and looking at +z
+template<typename Scalar>
+void renderSphere(int _width, int _height, Scalar _f, Scalar _depth, Scalar _radius,
+                  vector<Scalar>& _depthBuffer, vector<Scalar>& _normalBuffer)
+{
+    using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+    const Vector3 center (0, 0, _depth);
+    const Scalar cx = Scalar(_width) / 2, cy = Scalar(_height) / 2;
+
+    _depthBuffer.assign(size_t(_width) * _height, Scalar(0));
+    _normalBuffer.assign(size_t(3) * _width * _height, Scalar(0));
+    for (int y = 0; y < _height; ++y)
+    {
+        for (int x = 0; x < _width; ++x)
+        {
+            const int idx = y * _width + x;
+            const Vector3 dir ((Scalar(x) - cx) / _f, (Scalar(y) - cy) / _f, Scalar(1));
+            const Scalar a = dir.squaredNorm();
+            const Scalar b = dir.dot(center);
+            const Scalar delta = b * b - a * (center.squaredNorm() - _radius * _radius);
+            if (delta < Scalar(0)) continue;
+            const Scalar t = (b - std::sqrt(delta)) / a;
+            const Vector3 n = (t * dir - center) / _radius;
+            _depthBuffer[idx] = t;
+            _normalBuffer[3*idx] = n.x(); _normalBuffer[3*idx+1] = n.y(); _normalBuffer[3*idx+2] = n.z();
+        }
+    }
+}
+
+/// Valid pixels of the square window of radius `_radius` centered on pixel \f$ (x, y) \f$
+template<typename DataPoint>
+vector<int> squareWindow(const ImageGrid<DataPoint>& _grid, int _x, int _y, int _radius)
+{
+    vector<int> ids;
+    for (int y = std::max(0, _y - _radius); y <= std::min(_grid.height() - 1, _y + _radius); ++y)
+        for (int x = std::max(0, _x - _radius); x <= std::min(_grid.width() - 1, _x + _radius); ++x)
+            if (_grid.isValid(_grid.index(x, y)))
+                ids.push_back(_grid.index(x, y));
+    return ids;
+}
+
+template<typename DataPoint, typename WeightFunctor>
+void testMoments(const ImageGrid<DataPoint>& _grid, int _x, int _y, int _radius,
+                 const ImageGridMoments<DataPoint>& _moments, WeightFunctor _weight)
+{
+    using Scalar  = typename DataPoint::Scalar;
+    using Vector  = Eigen::Matrix<double, 3, 1>;
+    using Matrix  = Eigen::Matrix<double, 3, 3>;
+
+    const auto m   = _moments.moments(_x, _y, _radius);
+    const auto ids = squareWindow(_grid, _x, _y, _radius);
+    VERIFY(m.count == int(ids.size()));
+    if (ids.empty()) return;
+
+    // Two-pass reference, in double precision
+    double sumW = 0;
+    Vector sumP = Vector::Zero();
+    for (int j : ids)
+    {
+        const double w = double(_weight(_grid.points()[j]));
+        sumW += w;
+        sumP += w * _grid.points()[j].pos().template cast<double>();
+    }
+    const Vector mean = sumP / sumW;
+    Matrix cov = Matrix::Zero();
+    for (int j : ids)
+    {
+        const Vector q = _grid.points()[j].pos().template cast<double>() - mean;
+        cov += double(_weight(_grid.points()[j])) * q * q.transpose();
+    }
+    cov /= sumW;
+
+    const double eps = double(testEpsilon<Scalar>());
+    VERIFY(std::abs(double(m.weightSum) - sumW) <= eps * sumW);
+    VERIFY((m.barycenter.template cast<double>() - mean).norm() <= eps * std::max(1., mean.norm()));
+    VERIFY((m.covariance.template cast<double>() - cov).norm() <= eps * std::max(1e-3, cov.norm()));
+}
+
+template<typename Scalar>
+void testFunction()
+{
+    using DataPoint  = PointPositionNormal<Scalar, 3>;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = DistWeightFunc<DataPoint, ConstantWeightKernel<Scalar> >;
+    using Fit        = Basket<DataPoint, WeightFunc, CovariancePlaneFit>;
+
+    const int width  = Eigen::internal::random<int>(40, 80);
+    const int height = Eigen::internal::random<int>(40, 80);
+    const Scalar f       = Scalar(60);
+    const Scalar depth   = Scalar(5);
+    const Scalar radius  = Eigen::internal::random<Scalar>(Scalar(1.5), Scalar(2.5));
+
+    vector<Scalar> depthBuffer, normalBuffer;
+    renderSphere(width, height, f, depth, radius, depthBuffer, normalBuffer);
+
+    ImageGrid<DataPoint> grid;
+    grid.buildFromDepth(width, height, depthBuffer.data(), normalBuffer.data(),
+                        f, f, Scalar(width) / 2, Scalar(height) / 2);
+
+    const int windowRadius = Eigen::internal::random<int>(1, 6);
+    const auto unitWeight  = [](const DataPoint&) { return Scalar(1); };
+    const auto facingWeight = [](const DataPoint& _p) { return Scalar(0.5) + std::abs(_p.normal().z()); };
+
+    // Moments of windows, including windows crossing the image borders and the background
+    ImageGridMoments<DataPoint> moments;
+    moments.build(grid);
+    VERIFY(moments.width() == width && moments.height() == height);
+    for (int i = 0; i < 50; ++i)
+        testMoments(grid, Eigen::internal::random<int>(0, width - 1),
+                    Eigen::internal::random<int>(0, height - 1), windowRadius, moments, unitWeight);
+    testMoments(grid, 0, 0, windowRadius, moments, unitWeight);
+    testMoments(grid, width - 1, height - 1, windowRadius, moments, unitWeight);
+    testMoments(grid, width / 2, height / 2, 0, moments, unitWeight);
+
+    ImageGridMoments<DataPoint> weightedMoments;
+    weightedMoments.build(grid, facingWeight);
+    for (int i = 0; i < 50; ++i)
+        testMoments(grid, Eigen::internal::random<int>(0, width - 1),
+                    Eigen::internal::random<int>(0, height - 1), windowRadius, weightedMoments, facingWeight);
+
+    // Normals: same results than a covariance plane fit over the same window
+    const auto normals = moments.computeNormals(grid, windowRadius);
+    VERIFY(int(normals.size()) == grid.point_count());
+
+    const Scalar innerRadius = Scalar(0.6) * radius * f / depth; // in pixels
+    int nbChecked = 0;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const int idx = grid.index(x, y);
+            if (! grid.isValid(idx))
+            {
+                VERIFY(normals[idx] == VectorType::Zero());
+                continue;
+            }
+
+            const auto ids = squareWindow(grid, x, y, windowRadius);
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(Scalar(10) * depth));
+            fit.init(grid.points()[idx].pos());
+            fit.computeWithIds(ids, grid.points());
+            VERIFY(fit.isStable() == (normals[idx] != VectorType::Zero()));
+            if (! fit.isStable()) continue;
+
+            VERIFY(normals[idx].dot(grid.points()[idx].pos()) <= Scalar(0));
+
+            const Scalar dx = Scalar(x) - Scalar(width) / 2, dy = Scalar(y) - Scalar(height) / 2;
+            if (dx * dx + dy * dy > innerRadius * innerRadius) continue;
+
+            VERIFY(std::abs(normals[idx].dot(fit.primitiveGradient().normalized())) >= Scalar(1) - testEpsilon<Scalar>());
+            VERIFY(normals[idx].dot(grid.points()[idx].normal()) >= Scalar(0.99));
+            ++nbChecked;
+        }
+    }
+    VERIFY(nbChecked > 0);
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test image grid moments..." << endl;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<float>() ));
+        CALL_SUBTEST(( testFunction<double>() ));
+    }
+}
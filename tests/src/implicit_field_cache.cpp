@@ -0,0 +1,187 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/implicit_field_cache.cpp
+    \brief Test the evaluation of implicit fields from cached fits, on single positions and on grids
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/implicitFieldCache.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <atomic>
+#include <set>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// Spatial partitioning structure counting its range queries, i.e. the fits computed by the cache
+template<typename Tree>
+struct CountingTree
+{
+    const Tree& tree;
+    mutable std::atomic<int> nbQueries {0};
+
+    template<typename VectorType, typename Scalar>
+    auto range_neighbors(const VectorType& _pos, Scalar _radius) const
+    {
+        ++nbQueries;
+        return tree.range_neighbors(_pos, _radius);
+    }
+    const auto& points() const { return tree.points(); }
+};
+
+template<typename Fit>
+void testFunction()
+{
+    using DataPoint  = typename Fit::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = typename Fit::WeightFunction;
+    using Field      = ImplicitFieldCache<Fit>;
+    using CellIndex  = typename Field::CellIndex;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(1000, 3000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 100);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt(Scalar(4. * M_PI) * radius * radius / nbPoints);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+
+    KdTreeDense<DataPoint> tree;
+    tree.build(points);
+
+    Field field;
+    field.setWeightFunc(WeightFunc(analysisScale));
+    field.setTolerance(Scalar(0.05));
+    VERIFY(field.size() == 0);
+
+    // Single positions: the fit of the cell is computed at its center, and reused in the whole cell
+    const Scalar epsilon = testEpsilon<Scalar>();
+    set<vector<int>> cells;
+    for (int i = 0; i < 100; ++i)
+    {
+        const VectorType q = points[i].pos()
+                           + Eigen::internal::random<Scalar>(-0.2, 0.2) * analysisScale * points[i].normal();
+        const CellIndex c = field.cell(q);
+        cells.insert(vector<int>(c.data(), c.data() + c.size()));
+
+        const Fit& cached = field.fitAt(tree, q);
+        VERIFY(field.size() == cells.size());
+        VERIFY(&cached == &field.fitAt(tree, q));
+        VERIFY(field.size() == cells.size());
+
+        Fit ref;
+        ref.setWeightFunc(WeightFunc(analysisScale));
+        ref.init(field.cellCenter(c));
+        ref.computeWithIds(tree.range_neighbors(field.cellCenter(c), analysisScale), tree.points());
+        VERIFY(ref.getCurrentState() == cached.getCurrentState());
+        if (! ref.isStable()) continue;
+
+        Scalar value;
+        VERIFY(field.potential(tree, q, value));
+        VERIFY(value == ref.potential(q));
+
+        // The cached field approximates the field fitted at the evaluation position
+        Fit direct;
+        direct.setWeightFunc(WeightFunc(analysisScale));
+        direct.init(q);
+        direct.computeWithIds(tree.range_neighbors(q, analysisScale), tree.points());
+        if (direct.isStable())
+            VERIFY(std::abs(value - direct.potential(q)) <= Scalar(0.1) * field.cellSize() + epsilon * radius);
+    }
+
+    // Grid evaluation: same values than single evaluations, sharing the cache
+    const int n = Eigen::internal::random<int>(8, 20);
+    const Scalar step = Scalar(2.4) * radius / Scalar(n - 1);
+    const VectorType origin = center - VectorType::Constant(Scalar(1.2) * radius);
+    const CellIndex size = CellIndex::Constant(n);
+    field.setBlockSize(Eigen::internal::random<int>(2, 8));
+
+    const Scalar invalid = Scalar(-1234);
+    const auto values = field.potentialGrid(tree, origin, step, size, invalid);
+    VERIFY(int(values.size()) == n * n * n);
+    const std::size_t cacheSize = field.size();
+
+    Field singleField;
+    singleField.setWeightFunc(WeightFunc(analysisScale));
+    singleField.setTolerance(field.tolerance());
+    int nbStable = 0;
+    for (int z = 0; z < n; ++z)
+        for (int y = 0; y < n; ++y)
+            for (int x = 0; x < n; ++x)
+            {
+                const VectorType pos = origin + step * VectorType(Scalar(x), Scalar(y), Scalar(z));
+                Scalar value = invalid;
+                nbStable += singleField.potential(tree, pos, value) ? 1 : 0;
+                VERIFY(value == values[(z * n + y) * n + x]);
+            }
+    VERIFY(nbStable > 0);
+
+    // A second evaluation of the same grid only reads the cache
+    const auto values2 = field.potentialGrid(tree, origin, step, size, invalid);
+    VERIFY(values2 == values);
+    VERIFY(field.size() == cacheSize);
+
+    // Cells larger than the blocks: each cell is shared by several blocks, but its fit is computed only once
+    Field coarseField;
+    coarseField.setWeightFunc(WeightFunc(analysisScale));
+    coarseField.setTolerance(Scalar(3) * step / analysisScale);
+    coarseField.setBlockSize(2);
+    CountingTree<KdTreeDense<DataPoint>> countingTree {tree};
+    const auto coarseValues = coarseField.potentialGrid(countingTree, origin, step, size, invalid);
+    VERIFY(coarseField.size() > 0);
+    VERIFY(std::size_t(countingTree.nbQueries) == coarseField.size());
+    for (int x = 0; x < n; ++x)
+    {
+        const VectorType pos = origin + step * VectorType::Constant(Scalar(x));
+        Scalar value = invalid;
+        coarseField.potential(tree, pos, value);
+        VERIFY(value == coarseValues[(x * n + x) * n + x]);
+    }
+    VERIFY(std::size_t(countingTree.nbQueries) == coarseField.size());
+
+    field.clear();
+    VERIFY(field.size() == 0);
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    using Point = PointPositionNormal<Scalar, 3>;
+    using WeightSmoothFunc = DistWeightFunc<Point, SmoothWeightKernel<Scalar> >;
+    using Fit = Basket<Point, WeightSmoothFunc, OrientedSphereFit>;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Fit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test implicit field cache..." << endl;
+
+    callSubTests<float>();
+    callSubTests<double>();
+}
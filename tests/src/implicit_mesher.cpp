@@ -0,0 +1,154 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/implicit_mesher.cpp
+    \brief Test the extraction of the zero level set of a fitted field, on a sampled sphere
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/implicitMesher.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// Spatial partitioning structure recording the positions of its range queries, i.e. of the fits computed by the mesher
+template<typename Tree>
+struct RecordingTree
+{
+    using VectorType = typename Tree::VectorType;
+
+    explicit RecordingTree(const Tree& _tree) : tree(_tree) {}
+
+    const Tree& tree;
+    mutable std::mutex mutex;
+    mutable vector<VectorType> queries;
+
+    template<typename Scalar>
+    auto range_neighbors(const VectorType& _pos, Scalar _radius) const
+    {
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            queries.push_back(_pos);
+        }
+        return tree.range_neighbors(_pos, _radius);
+    }
+    auto nearest_neighbor(const VectorType& _pos) const { return tree.nearest_neighbor(_pos); }
+    const auto& points() const { return tree.points(); }
+};
+
+template<typename Fit>
+void testFunction()
+{
+    using DataPoint  = typename Fit::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = typename Fit::WeightFunction;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(2000, 4000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 100);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt(Scalar(4. * M_PI) * radius * radius / nbPoints);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+
+    KdTreeDense<DataPoint> tree;
+    tree.build(points);
+
+    ImplicitMesher<Fit> mesher;
+    mesher.setWeightFunc(WeightFunc(analysisScale));
+    mesher.setCellSize(Scalar(0.25) * analysisScale);
+    mesher.setBlockSize(Eigen::internal::random<int>(3, 12));
+    const auto mesh = mesher.compute(tree);
+    VERIFY(! mesh.triangles.empty());
+
+    // The vertices lie on the sphere
+    const Scalar epsilon = testEpsilon<Scalar>();
+    for (const auto& v : mesh.vertices)
+        VERIFY(std::abs((v - center).norm() - radius) <= Scalar(0.1) * mesher.cellSize() + epsilon * radius);
+
+    // The triangles are oriented outward (toward increasing potential)
+    for (const auto& t : mesh.triangles)
+    {
+        const VectorType& a = mesh.vertices[t[0]];
+        const VectorType n = (mesh.vertices[t[1]] - a).cross(mesh.vertices[t[2]] - a);
+        VERIFY(n.dot((a + mesh.vertices[t[1]] + mesh.vertices[t[2]]) / Scalar(3) - center) >= Scalar(0));
+    }
+
+    // The mesh is closed and consistently oriented: each directed edge appears once, and its opposite once
+    map<pair<int, int>, int> edges;
+    for (const auto& t : mesh.triangles)
+        for (int i = 0; i < 3; ++i)
+            ++edges[{t[i], t[(i + 1) % 3]}];
+    for (const auto& e : edges)
+    {
+        VERIFY(e.second == 1);
+        const auto opposite = edges.find({e.first.second, e.first.first});
+        VERIFY(opposite != edges.end() && opposite->second == 1);
+    }
+
+    // Sphere topology: V - E + F = 2
+    VERIFY(int(mesh.vertices.size()) - int(edges.size() / 2) + int(mesh.triangles.size()) == 2);
+
+    // The result does not depend on the block decomposition
+    ImplicitMesher<Fit> otherMesher = mesher;
+    otherMesher.setBlockSize(mesher.blockSize() + 1);
+    const auto otherMesh = otherMesher.compute(tree);
+    VERIFY(otherMesh.vertices.size() == mesh.vertices.size());
+    VERIFY(otherMesh.triangles.size() == mesh.triangles.size());
+
+    // The lattice vertices shared by several blocks are evaluated once
+    RecordingTree<KdTreeDense<DataPoint>> recordingTree {tree};
+    const auto recordedMesh = mesher.compute(recordingTree);
+    VERIFY(recordedMesh.triangles.size() == mesh.triangles.size());
+    set<vector<Scalar>> positions;
+    for (const auto& q : recordingTree.queries)
+        positions.insert(vector<Scalar>(q.data(), q.data() + q.size()));
+    VERIFY(positions.size() == recordingTree.queries.size());
+}
+
+template<typename Scalar>
+void callSubTests()
+{
+    using Point = PointPositionNormal<Scalar, 3>;
+    using WeightSmoothFunc = DistWeightFunc<Point, SmoothWeightKernel<Scalar> >;
+    using Fit = Basket<Point, WeightSmoothFunc, OrientedSphereFit>;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Fit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test implicit surface meshing..." << endl;
+
+    callSubTests<float>();
+    callSubTests<double>();
+}
@@ -0,0 +1,187 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+
+#include <Ponca/IO>
+#include <Ponca/src/Fitting/enums.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+using namespace Ponca;
+
+// Per-point results of a batch of fits, as structures of arrays
+struct Results
+{
+    std::vector<Eigen::Vector3f> normals;
+    std::vector<double> kappa;
+    std::vector<float> tau;
+    std::vector<Eigen::Vector3d> directions;
+    std::vector<FIT_RESULT> states;
+};
+
+Results randomResults(int n)
+{
+    Results r;
+    for (int i = 0; i < n; ++i)
+    {
+        r.normals.push_back(Eigen::Vector3f::Random().normalized());
+        r.kappa.push_back(Eigen::internal::random<double>(-10, 10));
+        r.tau.push_back(Eigen::internal::random<float>(-1, 1));
+        r.directions.push_back(Eigen::Vector3d::Random().normalized());
+        r.states.push_back(FIT_RESULT(Eigen::internal::random<int>(0, 3)));
+    }
+    return r;
+}
+
+void declareColumns(PointAttributeWriter& writer)
+{
+    writer.addColumn<float>({"nx", "ny", "nz"});
+    writer.addColumn<double>("kappa");
+    writer.addColumn<float>("tau");
+    writer.addColumn<double>({"dx", "dy", "dz"});
+    writer.addColumn<FIT_RESULT>("state");
+}
+
+// Write the results in chunks of random sizes
+bool writeResults(PointAttributeWriter& writer, const Results& r)
+{
+    const int n = int(r.kappa.size());
+    for (int begin = 0; begin < n; )
+    {
+        const int count = std::min(n - begin, Eigen::internal::random<int>(1, 500));
+        if (! writer.writeChunk(count, {r.normals.data() + begin, r.kappa.data() + begin, r.tau.data() + begin,
+                                        r.directions.data() + begin, r.states.data() + begin}))
+            return false;
+        begin += count;
+    }
+    return writer.close();
+}
+
+template <typename T>
+T readValue(const char*& p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return v;
+}
+
+void testPly(bool knownCount, bool asynchronous)
+{
+    const int n = Eigen::internal::random<int>(1000, 5000);
+    const Results r = randomResults(n);
+    const std::string path = "io_attribute_writer.ply";
+
+    PointAttributeWriter writer;
+    declareColumns(writer);
+    writer.setBufferSize(Eigen::internal::random<int>(1, 64) * 1024);
+    VERIFY(writer.open(path, PointAttributeWriter::Format::BinaryPly,
+                       knownCount ? std::size_t(n) : PointAttributeWriter::UnknownCount, asynchronous));
+    VERIFY(writeResults(writer, r));
+    VERIFY(writer.writtenCount() == std::size_t(n));
+
+    PlyReader ply;
+    VERIFY(ply.open(path));
+    VERIFY(ply.vertexCount() == std::size_t(n));
+    const auto nx    = ply.field<float>("vertex", "nx");
+    const auto nz    = ply.field<float>("vertex", "nz");
+    const auto kappa = ply.field<double>("vertex", "kappa");
+    const auto tau   = ply.field<float>("vertex", "tau");
+    const auto dy    = ply.field<double>("vertex", "dy");
+    const auto state = ply.field<int>("vertex", "state");
+    VERIFY(kappa.type() == IOScalarType::Float64 && state.type() == IOScalarType::UInt8);
+    for (int i = 0; i < n; ++i)
+    {
+        VERIFY(nx[i] == r.normals[i].x() && nz[i] == r.normals[i].z());
+        VERIFY(kappa[i] == r.kappa[i] && tau[i] == r.tau[i]);
+        VERIFY(dy[i] == r.directions[i].y());
+        VERIFY(state[i] == int(r.states[i]));
+    }
+    ply.close();
+    std::remove(path.c_str());
+}
+
+void testColumnar()
+{
+    const int n = Eigen::internal::random<int>(1000, 5000);
+    const Results r = randomResults(n);
+    const std::string path = "io_attribute_writer.columns";
+
+    PointAttributeWriter writer;
+    declareColumns(writer);
+    VERIFY(writer.open(path, PointAttributeWriter::Format::Columnar));
+    VERIFY(writeResults(writer, r));
+
+    std::ifstream in (path, std::ios::binary);
+    const std::string content ((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const std::string endHeader = "end_header\n";
+    const auto headerSize = content.find(endHeader) + endHeader.size();
+    const std::string header = content.substr(0, headerSize);
+    VERIFY(header.find("ponca_columns\n") == 0);
+    VERIFY(header.find("count " + std::to_string(n) + " ") != std::string::npos);
+    VERIFY(header.find("column float 3 nx ny nz\n") != std::string::npos);
+    VERIFY(header.find("column uchar 1 state\n") != std::string::npos);
+
+    // Blocks: count, then each column
+    const char* p   = content.data() + headerSize;
+    const char* end = content.data() + content.size();
+    int i = 0;
+    while (p < end)
+    {
+        const auto count = int(readValue<std::uint64_t>(p));
+        VERIFY(count > 0 && i + count <= n);
+        for (int j = i; j < i + count; ++j)
+            for (int d = 0; d < 3; ++d) VERIFY(readValue<float>(p) == r.normals[j][d]);
+        for (int j = i; j < i + count; ++j) VERIFY(readValue<double>(p) == r.kappa[j]);
+        for (int j = i; j < i + count; ++j) VERIFY(readValue<float>(p) == r.tau[j]);
+        for (int j = i; j < i + count; ++j)
+            for (int d = 0; d < 3; ++d) VERIFY(readValue<double>(p) == r.directions[j][d]);
+        for (int j = i; j < i + count; ++j) VERIFY(readValue<unsigned char>(p) == (unsigned char)(r.states[j]));
+        i += count;
+    }
+    VERIFY(i == n && p == end);
+    std::remove(path.c_str());
+}
+
+void testErrors()
+{
+    const std::string path = "io_attribute_writer_errors.ply";
+    PointAttributeWriter writer;
+    VERIFY(! writer.open(path));   // no column
+
+    writer.addColumn<float>("value");
+    VERIFY(writer.open(path, PointAttributeWriter::Format::BinaryPly, 10));
+    std::vector<float> values (20, 1.f);
+    std::vector<double> wrongType (20, 1.);
+    VERIFY(! writer.writeChunk(5, {wrongType.data()}));
+    VERIFY(! writer.writeChunk(5, {values.data(), values.data()}));
+    VERIFY(! writer.writeChunk(20, {values.data()}));   // more points than announced
+    VERIFY(writer.writeChunk(5, {values.data()}));
+    VERIFY(! writer.close());                            // fewer points than announced
+    VERIFY(! writer.errorMessage().empty());
+    std::remove(path.c_str());
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test PointAttributeWriter (binary PLY)" << endl;
+	testPly(true, true);
+	testPly(false, true);
+	testPly(false, false);
+	cout << "Test PointAttributeWriter (columnar)" << endl;
+	testColumnar();
+	cout << "Test PointAttributeWriter errors" << endl;
+	testErrors();
+}
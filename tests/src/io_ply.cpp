@@ -0,0 +1,293 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/IO>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+using namespace std;
+using namespace Ponca;
+
+// Content of the test files
+struct Cloud
+{
+    std::vector<Eigen::Vector3f> positions, normals;
+    std::vector<unsigned char> red;
+    std::vector<int> label;
+    std::vector<std::vector<int>> faces;
+    std::vector<float> materials;
+};
+
+Cloud randomCloud(int n)
+{
+    Cloud c;
+    for (int i = 0; i < n; ++i)
+    {
+        c.positions.push_back(Eigen::Vector3f::Random());
+        c.normals.push_back(Eigen::Vector3f::Random().normalized());
+        c.red.push_back((unsigned char)(Eigen::internal::random<int>(0, 255)));
+        c.label.push_back(Eigen::internal::random<int>(-1000000, 1000000));
+    }
+    for (int i = 0; i < n / 2; ++i)
+    {
+        std::vector<int> face (Eigen::internal::random<int>(3, 6));
+        for (auto& v : face) v = Eigen::internal::random<int>(0, n - 1);
+        c.faces.push_back(face);
+    }
+    for (int i = 0; i < 7; ++i) c.materials.push_back(Eigen::internal::random<float>(0, 1));
+    return c;
+}
+
+template <typename T>
+void writeBinary(std::ofstream& out, T v, bool bigEndian)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &v, sizeof(T));
+    if (bigEndian == ioHostIsLittleEndian()) std::reverse(bytes, bytes + sizeof(T));
+    out.write(bytes, sizeof(T));
+}
+
+void writePly(const std::string& path, const Cloud& c, PlyReader::Format format)
+{
+    std::ofstream out (path, std::ios::binary);
+    out << "ply\n";
+    switch (format)
+    {
+        case PlyReader::Format::Ascii:              out << "format ascii 1.0\n"; break;
+        case PlyReader::Format::BinaryLittleEndian: out << "format binary_little_endian 1.0\n"; break;
+        case PlyReader::Format::BinaryBigEndian:    out << "format binary_big_endian 1.0\n"; break;
+    }
+    out << "comment generated by io_ply\n"
+        << "element vertex " << c.positions.size() << "\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "property float nx\nproperty float ny\nproperty float nz\n"
+        << "property uchar red\nproperty int label\n"
+        << "element face " << c.faces.size() << "\n"
+        << "property list uchar int vertex_indices\n"
+        << "element material " << c.materials.size() << "\n"
+        << "property float roughness\n"
+        << "end_header\n";
+
+    if (format == PlyReader::Format::Ascii)
+    {
+        out << std::setprecision(std::numeric_limits<float>::max_digits10);
+        for (std::size_t i = 0; i < c.positions.size(); ++i)
+            out << c.positions[i].x() << " " << c.positions[i].y() << " " << c.positions[i].z() << " "
+                << c.normals[i].x() << " " << c.normals[i].y() << " " << c.normals[i].z() << " "
+                << int(c.red[i]) << " " << c.label[i] << "\n";
+        for (const auto& f : c.faces)
+        {
+            out << f.size();
+            for (int v : f) out << " " << v;
+            out << "\n";
+        }
+        // No newline after the last line
+        for (std::size_t i = 0; i < c.materials.size(); ++i)
+            out << (i == 0 ? "" : "\n") << c.materials[i];
+        return;
+    }
+
+    const bool bigEndian = format == PlyReader::Format::BinaryBigEndian;
+    for (std::size_t i = 0; i < c.positions.size(); ++i)
+    {
+        for (int d = 0; d < 3; ++d) writeBinary(out, c.positions[i][d], bigEndian);
+        for (int d = 0; d < 3; ++d) writeBinary(out, c.normals[i][d], bigEndian);
+        writeBinary(out, c.red[i], bigEndian);
+        writeBinary(out, c.label[i], bigEndian);
+    }
+    for (const auto& f : c.faces)
+    {
+        writeBinary(out, (unsigned char)(f.size()), bigEndian);
+        for (int v : f) writeBinary(out, v, bigEndian);
+    }
+    for (float m : c.materials) writeBinary(out, m, bigEndian);
+}
+
+template<typename DataPoint>
+void checkTree(const PointView<typename DataPoint::Scalar, 3>& view, const Cloud& c, typename DataPoint::Scalar epsilon)
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    // Tree built from the file and from points in memory
+    KdTreeDense<DataPoint> fromFile;
+    fromFile.build(view, PointViewConverter());
+
+    std::vector<DataPoint> points;
+    for (std::size_t i = 0; i < c.positions.size(); ++i)
+        points.push_back(DataPoint(c.positions[i].cast<Scalar>(), c.normals[i].cast<Scalar>()));
+    KdTreeDense<DataPoint> fromMemory;
+    fromMemory.build(points);
+
+    // Conversion in a given executor
+    SerialExecutor serial;
+    KdTreeDense<DataPoint> fromFileSerial;
+    fromFileSerial.build(view, PointViewConverter {&serial});
+    VERIFY(fromFileSerial.point_count() == fromFile.point_count());
+    for (int i = 0; i < fromFile.point_count(); ++i)
+        VERIFY(fromFileSerial.points()[i].pos() == fromFile.points()[i].pos());
+
+    VERIFY(fromFile.point_count() == fromMemory.point_count());
+    for (std::size_t i = 0; i < points.size(); ++i)
+    {
+        VERIFY((fromFile.points()[i].pos()    - points[i].pos()).norm()    <= epsilon);
+        VERIFY((fromFile.points()[i].normal() - points[i].normal()).norm() <= epsilon);
+    }
+    if (epsilon == Scalar(0))
+        for (int q = 0; q < 20; ++q)
+        {
+            const VectorType query = VectorType::Random();
+            std::vector<int> a, b;
+            for (int j : fromFile.k_nearest_neighbors(query, 10)) a.push_back(j);
+            for (int j : fromMemory.k_nearest_neighbors(query, 10)) b.push_back(j);
+            VERIFY(a == b);
+        }
+}
+
+void testPly(PlyReader::Format format)
+{
+    const int n = Eigen::internal::random<int>(1000, 5000);
+    const Cloud c = randomCloud(n);
+    const std::string path = "io_ply_" + std::to_string(int(format)) + ".ply";
+    writePly(path, c, format);
+
+    PlyReader ply;
+    VERIFY(ply.open(path));
+    VERIFY(ply.format() == format);
+    VERIFY(ply.comments().size() == 1 && ply.comments()[0] == "generated by io_ply");
+    VERIFY(ply.elements().size() == 3);
+    VERIFY(ply.vertexCount() == std::size_t(n));
+    VERIFY(ply.element("face")->count == c.faces.size() && ply.element("face")->hasLists());
+    VERIFY(! ply.hasField("face", "vertex_indices"));
+    VERIFY(! ply.hasField("vertex", "green"));
+    VERIFY(ply.field<float>("vertex", "green").empty());
+
+    // Exact values for binary files, up to the float precision for ASCII files
+    const float epsilon = format == PlyReader::Format::Ascii ? 1e-6f : 0.f;
+    const auto x     = ply.field<float>("vertex", "x");
+    const auto nz    = ply.field<double>("vertex", "nz");
+    const auto red   = ply.field<int>("vertex", "red");
+    const auto label = ply.field<int>("vertex", "label");
+    VERIFY(x.size() == std::size_t(n) && red.type() == IOScalarType::UInt8);
+    for (int i = 0; i < n; ++i)
+    {
+        VERIFY(std::abs(x[i] - c.positions[i].x()) <= epsilon);
+        VERIFY(std::abs(nz[i] - double(c.normals[i].z())) <= epsilon);
+        VERIFY(red[i] == int(c.red[i]));
+        VERIFY(label[i] == c.label[i]);
+    }
+    // Element located after the faces
+    const auto roughness = ply.field<float>("material", "roughness");
+    VERIFY(roughness.size() == c.materials.size());
+    for (std::size_t i = 0; i < c.materials.size(); ++i)
+        VERIFY(std::abs(roughness[i] - c.materials[i]) <= epsilon);
+
+    // KdTree built directly from the file
+    const auto view = ply.points<float, 3>();
+    VERIFY(view.size() == std::size_t(n) && view.hasNormals());
+    checkTree<PointPositionNormal<float, 3>>(view, c, epsilon);
+    checkTree<PointPositionNormal<double, 3>>(ply.points<double, 3>(), c, epsilon);
+    KdTreeDense<PointPosition<float, 3>> positionsOnly;
+    positionsOnly.build(view, PointViewConverter());
+    VERIFY(positionsOnly.point_count() == n);
+
+    ply.close();
+    VERIFY(! ply.isOpen() && ply.elements().empty());
+
+    // Truncated file
+    if (format != PlyReader::Format::Ascii)
+    {
+        std::ifstream in (path, std::ios::binary);
+        std::string content ((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream(path, std::ios::binary).write(content.data(), std::streamsize(content.size() / 2));
+        VERIFY(! ply.open(path));
+        VERIFY(! ply.errorMessage().empty());
+    }
+    std::remove(path.c_str());
+}
+
+// Malformed header: the size of the element (2^62 items of 12 bytes) overflows, and must not be accepted
+void testOverflowingElementCount()
+{
+    const std::string path = "io_ply_overflow.ply";
+    {
+        std::ofstream out (path, std::ios::binary);
+        out << "ply\nformat binary_little_endian 1.0\n"
+            << "element vertex 4611686018427387904\n"
+            << "property float x\nproperty float y\nproperty float z\n"
+            << "end_header\n";
+        const float xyz[3] = {1.f, 2.f, 3.f};
+        out.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+    }
+    PlyReader ply;
+    VERIFY(! ply.open(path));
+    VERIFY(! ply.errorMessage().empty());
+    std::remove(path.c_str());
+}
+
+void testRawPoints()
+{
+    const int n = Eigen::internal::random<int>(1000, 5000);
+    const Cloud c = randomCloud(n);
+    const std::string path = "io_ply_raw.xyz";
+    {
+        std::ofstream out (path, std::ios::binary);
+        out.write("RAWPOINTS_HEADER", 16);
+        for (int i = 0; i < n; ++i)
+        {
+            for (int d = 0; d < 3; ++d) writeBinary(out, double(c.positions[i][d]), false);
+            for (int d = 0; d < 3; ++d) writeBinary(out, double(c.normals[i][d]), false);
+        }
+    }
+
+    RawPointReader raw;
+    VERIFY(raw.open(path, IOScalarType::Float64, true, 3, 16));
+    VERIFY(raw.size() == std::size_t(n) && raw.hasNormals());
+    const auto view = raw.points<double, 3>();
+    for (int i = 0; i < n; ++i)
+    {
+        VERIFY(view.position(i) == c.positions[i].cast<double>());
+        VERIFY(view.normal(i)   == c.normals[i].cast<double>());
+    }
+    VERIFY((raw.points<double, 2>().size() == 0));
+    checkTree<PointPositionNormal<double, 3>>(view, c, 0.);
+
+    // Layout not matching the size of the file
+    VERIFY(! raw.open(path, IOScalarType::Float32, false, 3, 15));
+    VERIFY(! raw.errorMessage().empty());
+    std::remove(path.c_str());
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test PLY reader (ascii)" << endl;
+	testPly(PlyReader::Format::Ascii);
+	cout << "Test PLY reader (binary little endian)" << endl;
+	testPly(PlyReader::Format::BinaryLittleEndian);
+	cout << "Test PLY reader (binary big endian)" << endl;
+	testPly(PlyReader::Format::BinaryBigEndian);
+	cout << "Test PLY reader (overflowing element count)" << endl;
+	testOverflowingElementCount();
+	cout << "Test raw point reader" << endl;
+	testRawPoints();
+
+	PlyReader missing;
+	VERIFY(! missing.open("io_ply_missing.ply"));
+	VERIFY(! missing.errorMessage().empty());
+}
@@ -0,0 +1,205 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/lazy_basket_diff.cpp
+    \brief Test that lazy derivatives computation gives the same results than BasketDiff
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/lazyBasketDiff.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename FitDer, typename Functor, typename DerFunctor>
+void testFunction(Functor _compare, DerFunctor _compareDer)
+{
+    using DataPoint  = typename FitDer::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = typename FitDer::WeightFunction;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10000);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt(Scalar(4. * M_PI) * radius * radius / nbPoints);
+
+    vector<DataPoint> vectorPoints(nbPoints);
+    for(auto& p : vectorPoints)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+
+#pragma omp parallel for
+    for(int i = 0; i < nbPoints; ++i)
+    {
+        const auto& evalPos = vectorPoints[i].pos();
+
+        FitDer fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(evalPos);
+        fit.compute(vectorPoints);
+
+        LazyBasketDiff<FitDer> lazyFit;
+        lazyFit.setWeightFunc(WeightFunc(analysisScale));
+        lazyFit.init(evalPos);
+        VERIFY(lazyFit.compute(vectorPoints) == fit.getCurrentState());
+        VERIFY(! lazyFit.isDiffComputed());
+        VERIFY(lazyFit.fit().getNumNeighbors() == fit.getNumNeighbors());
+        VERIFY(lazyFit.getNumCachedNeighbors() == fit.getNumNeighbors());
+
+        if(fit.isStable())
+        {
+            _compare(fit, lazyFit.fit());
+            VERIFY(! lazyFit.isDiffComputed());
+
+            _compareDer(fit, lazyFit.diff());
+            VERIFY(lazyFit.isDiffComputed());
+            VERIFY(lazyFit.diff().getCurrentState() == fit.getCurrentState());
+        }
+    }
+}
+
+// Fit computed a second time around a shifted basis center: its weights change between the passes
+template <class DataPoint, class _WFunctor, int DiffType, typename T>
+class ShiftedSecondPassDer : public T
+{
+    PONCA_FITTING_DECLARE_DEFAULT_TYPES
+
+public:
+    void init(const VectorType& _evalPos) { Base::init(_evalPos); m_shifted = false; }
+
+    FIT_RESULT finalize()
+    {
+        const FIT_RESULT res = Base::finalize();
+        if (m_shifted) return res;
+        m_shifted = true;
+        const auto& w = Base::getWeightFunc();
+        Base::init(w.basisCenter() + VectorType::Constant(w.evalScale() / Scalar(2)));
+        return Base::m_eCurrentState = NEED_OTHER_PASS;
+    }
+
+private:
+    bool m_shifted {false};
+};
+
+// Weighting function of fits moving their basis between the passes (see IsPassInvariantWeight)
+template<typename DataPoint>
+struct MovingWeightFunc : public DistWeightFunc<DataPoint, SmoothWeightKernel<typename DataPoint::Scalar>>
+{
+    using DistWeightFunc<DataPoint, SmoothWeightKernel<typename DataPoint::Scalar>>::DistWeightFunc;
+};
+
+template<typename DataPoint>
+struct Ponca::IsPassInvariantWeight<MovingWeightFunc<DataPoint>> : std::false_type {};
+
+// Derivatives of fits whose weights change between the passes: the cached weights must not be reused
+template<typename FitDer>
+void testPassVariantWeights()
+{
+    using DataPoint  = typename FitDer::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = typename FitDer::WeightFunction;
+    static_assert(! IsPassInvariantWeight<WeightFunc>::value, "Weights must be recomputed at each pass");
+
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10000);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt(Scalar(4. * M_PI) * radius * radius / nbPoints);
+
+    vector<DataPoint> vectorPoints(nbPoints);
+    for(auto& p : vectorPoints)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    for(int i = 0; i < std::min(20, nbPoints); ++i)
+    {
+        const auto& evalPos = vectorPoints[i].pos();
+
+        FitDer fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(evalPos);
+        fit.compute(vectorPoints);
+
+        LazyBasketDiff<FitDer> lazyFit;
+        lazyFit.setWeightFunc(WeightFunc(analysisScale));
+        lazyFit.init(evalPos);
+        lazyFit.compute(vectorPoints);
+        // neighbors outside the support are kept, as they may be in the support of the next passes
+        VERIFY(lazyFit.getNumCachedNeighbors() == nbPoints);
+
+        const FitDer& diff = lazyFit.diff();
+        VERIFY(diff.getCurrentState() == fit.getCurrentState());
+        VERIFY(diff.getNumNeighbors() == fit.getNumNeighbors());
+        VERIFY(std::abs(diff.getWeightSum() - fit.getWeightSum()) <= epsilon * fit.getWeightSum());
+        if (fit.isStable())
+            VERIFY(diff.dNormal().isApprox(fit.dNormal(), epsilon));
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    using Point = PointPositionNormal<Scalar, Dim>;
+    using WeightSmoothFunc = DistWeightFunc<Point, SmoothWeightKernel<Scalar> >;
+
+    using GLSDiff   = BasketDiff<Basket<Point, WeightSmoothFunc, OrientedSphereFit, GLSParam>,
+                                 FitScaleSpaceDer, OrientedSphereDer, GLSDer>;
+    using PlaneDiff = BasketDiff<Basket<Point, WeightSmoothFunc, CovariancePlaneFit>,
+                                 FitSpaceDer, CovariancePlaneDer>;
+    using ShiftedPlaneDiff = BasketDiff<Basket<Point, MovingWeightFunc<Point>, CovariancePlaneFit>,
+                                        FitSpaceDer, CovariancePlaneDer, ShiftedSecondPassDer>;
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    auto compareGLS = [epsilon](const auto& f1, const auto& f2) {
+        VERIFY(std::abs(f1.tau_normalized() - f2.tau_normalized()) <= epsilon);
+        VERIFY(std::abs(f1.kappa_normalized() - f2.kappa_normalized()) <= epsilon);
+        VERIFY(f1.eta_normalized().isApprox(f2.eta_normalized(), epsilon));
+    };
+    auto compareGLSDer = [epsilon](const auto& f1, const auto& f2) {
+        VERIFY(f1.dtau_normalized().isApprox(f2.dtau_normalized(), epsilon));
+        VERIFY(f1.dkappa_normalized().isApprox(f2.dkappa_normalized(), epsilon));
+    };
+    auto comparePlane = [epsilon](const auto& f1, const auto& f2) {
+        VERIFY(Scalar(1) - std::abs(f1.primitiveGradient().dot(f2.primitiveGradient())) <= epsilon);
+    };
+    auto comparePlaneDer = [epsilon](const auto& f1, const auto& f2) {
+        VERIFY(f1.dNormal().isApprox(f2.dNormal(), epsilon));
+    };
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<GLSDiff>(compareGLS, compareGLSDer) ));
+        CALL_SUBTEST(( testFunction<PlaneDiff>(comparePlane, comparePlaneDer) ));
+        CALL_SUBTEST(( testPassVariantWeights<ShiftedPlaneDiff>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test lazy derivatives computation..." << endl;
+
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+    callSubTests<long double, 3>();
+}
@@ -0,0 +1,124 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/mls_projection.cpp
+    \brief Test iterative MLS projection, with and without neighborhood reuse
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/mlsProjection.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename Fit>
+void testFunction()
+{
+    using DataPoint  = typename Fit::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = typename Fit::WeightFunction;
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(1000, 3000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 100);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt(Scalar(4. * M_PI) * radius * radius / nbPoints);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+
+    KdTreeDense<DataPoint> tree;
+    tree.build(points);
+
+    // Positions to project: samples moved along their normal
+    const int nbQueries = 200;
+    vector<VectorType> queries (nbQueries);
+    for (int i = 0; i < nbQueries; ++i)
+        queries[i] = points[i].pos()
+                   + Eigen::internal::random<Scalar>(-0.2, 0.2) * analysisScale * points[i].normal();
+
+    MlsProjection<Fit> projector;
+    projector.setWeightFunc(WeightFunc(analysisScale));
+    projector.setTolerance(Scalar(0.1) * testEpsilon<Scalar>());
+    VERIFY(projector.scale() == analysisScale);
+
+    MlsProjection<Fit> requeryProjector = projector;
+    requeryProjector.setNeighborhoodMargin(Scalar(0));
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    const auto projected = projector.projectAll(tree, queries);
+    VERIFY(int(projected.size()) == nbQueries);
+
+    for (int i = 0; i < nbQueries; ++i)
+    {
+        Fit fit;
+        VectorType proj;
+        int nbIter;
+        const FIT_RESULT res = projector.project(tree, queries[i], proj, fit, nbIter);
+        VERIFY(nbIter >= 1 && nbIter <= projector.maxIterations());
+
+        // Same computations than the parallel projection
+        VERIFY(proj == projected[i]);
+        if (res != STABLE) continue;
+
+        // The projection is on the fitted primitive, and on the sampled sphere
+        VERIFY(std::abs(fit.potential(proj)) <= epsilon * radius);
+        VERIFY(std::abs((proj - center).norm() - radius) <= epsilon * radius);
+
+        // Reusing the neighborhoods gives the same projections than querying the neighbors at each iteration. The
+        // neighbors may be accumulated in a different order: the number of iterations to reach the tolerance may differ
+        Fit requeryFit;
+        VectorType requeryProj;
+        int requeryNbIter;
+        VERIFY(requeryProjector.project(tree, queries[i], requeryProj, requeryFit, requeryNbIter) == res);
+        VERIFY((requeryProj - proj).norm() <= epsilon * radius);
+    }
+
+    // Projection of the samples themselves
+    const auto projectedSamples = projector.projectAll(tree, tree.points());
+    VERIFY(int(projectedSamples.size()) == tree.point_count());
+    for (int i = 0; i < tree.point_count(); ++i)
+        VERIFY(std::abs((projectedSamples[i] - center).norm() - radius) <= epsilon * radius);
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    using Point = PointPositionNormal<Scalar, Dim>;
+    using WeightSmoothFunc = DistWeightFunc<Point, SmoothWeightKernel<Scalar> >;
+    using Fit = Basket<Point, WeightSmoothFunc, OrientedSphereFit>;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<Fit>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test iterative MLS projection..." << endl;
+
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+}
@@ -0,0 +1,258 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/multi_basket.cpp
+    \brief Test that fits computed by a MultiBasket are the same than fits computed independently
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/multiBasket.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template<typename Fit>
+Fit computeFit(const vector<typename Fit::DataPoint>& _points,
+               const typename Fit::VectorType& _evalPos,
+               const typename Fit::WeightFunction& _w)
+{
+    Fit fit;
+    fit.setWeightFunc(_w);
+    fit.init(_evalPos);
+    fit.compute(_points);
+    return fit;
+}
+
+template<typename Fit>
+void verifySameState(const Fit& _f1, const Fit& _f2)
+{
+    VERIFY(_f1.getCurrentState() == _f2.getCurrentState());
+    VERIFY(_f1.getNumNeighbors() == _f2.getNumNeighbors());
+    VERIFY(_f1.getWeightSum() == _f2.getWeightSum());
+}
+
+/// \brief Index range counting its traversals
+struct CountedRange
+{
+    const vector<int>* ids;
+    int* traversals;
+    vector<int>::const_iterator begin() const { ++*traversals; return ids->begin(); }
+    vector<int>::const_iterator end() const { return ids->end(); }
+};
+
+template<typename PlaneFit, typename GLSFit, typename MongeFit, typename PlaneConstFit>
+void testFunction()
+{
+    using DataPoint  = typename PlaneFit::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc      = typename PlaneFit::WeightFunction;
+    using WeightConstFunc = typename PlaneConstFit::WeightFunction;
+    using Fit = MultiBasket<PlaneFit, GLSFit, MongeFit, PlaneConstFit>;
+
+    static_assert(Fit::Size == 4, "Wrong number of fits");
+    static_assert(Fit::weightFunctionCount == 2, "Fits sharing a weighting function type should share the weights");
+
+    //generate sampled sphere
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10000);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt(Scalar(4. * M_PI) * radius * radius / nbPoints);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+
+    KdTreeDense<DataPoint> tree;
+    tree.build(points);
+
+    const Scalar epsilon = testEpsilon<Scalar>();
+    const int nbTests = std::min(50, nbPoints);
+    for(int i = 0; i < nbTests; ++i)
+    {
+        const auto& evalPos = points[i].pos();
+
+        const auto plane      = computeFit<PlaneFit>     (points, evalPos, WeightFunc(analysisScale));
+        const auto gls        = computeFit<GLSFit>       (points, evalPos, WeightFunc(analysisScale));
+        const auto monge      = computeFit<MongeFit>     (points, evalPos, WeightFunc(analysisScale));
+        const auto planeConst = computeFit<PlaneConstFit>(points, evalPos, WeightConstFunc(analysisScale));
+
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.setWeightFunc(WeightConstFunc(analysisScale));
+        fit.init(evalPos);
+        const FIT_RESULT res = fit.compute(points);
+        VERIFY(res != NEED_OTHER_PASS && ! fit.needAnotherPass());
+        VERIFY(res == fit.getCurrentState());
+
+        // The neighbors are accumulated in the same order with the same weights: the results are identical
+        verifySameState(plane, fit.template get<PlaneFit>());
+        verifySameState(gls, fit.template get<GLSFit>());
+        verifySameState(monge, fit.template get<2>());
+        verifySameState(planeConst, fit.template get<3>());
+        if (plane.isStable())
+            VERIFY(plane == fit.template get<PlaneFit>());
+        if (gls.isStable())
+            VERIFY(gls == fit.template get<GLSFit>());
+        if (monge.isStable())
+        {
+            VERIFY(monge.kMean() == fit.template get<MongeFit>().kMean());
+            VERIFY(monge.GaussianCurvature() == fit.template get<MongeFit>().GaussianCurvature());
+        }
+        if (planeConst.isStable())
+            VERIFY(planeConst == fit.template get<PlaneConstFit>());
+
+        // The ids are traversed once, even if the Monge patch needs two passes: the neighbors are replayed
+        vector<int> ids;
+        for (int j : tree.range_neighbors(evalPos, analysisScale)) ids.push_back(j);
+        int traversals = 0;
+        Fit fitIds;
+        fitIds.setWeightFunc(WeightFunc(analysisScale));
+        fitIds.setWeightFunc(WeightConstFunc(analysisScale));
+        fitIds.init(evalPos);
+        fitIds.computeWithIds(CountedRange{&ids, &traversals}, points);
+        VERIFY(traversals == 1);
+        VERIFY(fitIds.template get<MongeFit>().getNumNeighbors() == monge.getNumNeighbors());
+        VERIFY(fitIds.template get<MongeFit>().getCurrentState() == monge.getCurrentState());
+
+        // Single traversal of a range query, using the squared distances computed by the query
+        Fit fitTree;
+        fitTree.setWeightFunc(WeightFunc(analysisScale));
+        fitTree.setWeightFunc(WeightConstFunc(analysisScale));
+        fitTree.init(evalPos);
+        auto query = tree.range_neighbors(evalPos, analysisScale);
+        do {
+            fitTree.startNewPass();
+            for (auto it = query.begin(); it != query.end(); ++it)
+                fitTree.addNeighbor(points[*it], it.squaredDistance());
+        } while (fitTree.finalize() == NEED_OTHER_PASS);
+
+        // The neighbors are accumulated in a different order: the results are only approximately equal.
+        // The neighbor counts of the constant kernel are not compared: the range query excludes the neighbors lying
+        // exactly at the query radius, while their constant weight is not null
+        VERIFY(fitTree.template get<PlaneFit>().getNumNeighbors() == plane.getNumNeighbors());
+        VERIFY(fitTree.template get<MongeFit>().getNumNeighbors() == monge.getNumNeighbors());
+        if (plane.isStable())
+            VERIFY(Scalar(1) - std::abs(plane.primitiveGradient().dot(
+                       fitTree.template get<PlaneFit>().primitiveGradient())) <= epsilon);
+    }
+}
+
+/// Fit computed a second time around a shifted basis center: its weighting function changes between the passes
+template <class DataPoint, class _WFunctor, typename T>
+class ShiftedSecondPass : public T
+{
+    PONCA_FITTING_DECLARE_DEFAULT_TYPES
+
+public:
+    void init(const VectorType& _evalPos) { Base::init(_evalPos); m_shifted = false; }
+
+    FIT_RESULT finalize()
+    {
+        const FIT_RESULT res = Base::finalize();
+        if (m_shifted) return res;
+        m_shifted = true;
+        const auto& w = Base::getWeightFunc();
+        Base::init(w.basisCenter() + VectorType::Constant(w.evalScale() / Scalar(2)));
+        return Base::m_eCurrentState = NEED_OTHER_PASS;
+    }
+
+private:
+    bool m_shifted {false};
+};
+
+/// The weights are not shared between fits whose weighting functions differ, e.g. after a change of basis
+template<typename PlaneFit, typename ShiftedFit>
+void testChangingBasis()
+{
+    using DataPoint  = typename PlaneFit::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+    using WeightFunc = typename PlaneFit::WeightFunction;
+    using Fit = MultiBasket<PlaneFit, ShiftedFit>;
+
+    static_assert(Fit::weightFunctionCount == 1, "Both fits use the same weighting function type");
+
+    const int nbPoints = Eigen::internal::random<int>(100, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10000);
+    const Scalar analysisScale = Scalar(10.) * std::sqrt(Scalar(4. * M_PI) * radius * radius / nbPoints);
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false);
+
+    for(int i = 0; i < std::min(20, nbPoints); ++i)
+    {
+        const auto& evalPos = points[i].pos();
+        const auto plane   = computeFit<PlaneFit>  (points, evalPos, WeightFunc(analysisScale));
+        const auto shifted = computeFit<ShiftedFit>(points, evalPos, WeightFunc(analysisScale));
+
+        // All the neighbors are given at each pass: compute skips the neighbors outside the support of the first pass
+        Fit fit;
+        fit.setWeightFunc(WeightFunc(analysisScale));
+        fit.init(evalPos);
+        do {
+            fit.startNewPass();
+            for (const auto& p : points) fit.addNeighbor(p);
+        } while (fit.finalize() == NEED_OTHER_PASS);
+
+        // The plane fit is finalized after the first pass, while the shifted fit needs another one with its own weights
+        verifySameState(plane, fit.template get<PlaneFit>());
+        verifySameState(shifted, fit.template get<ShiftedFit>());
+        VERIFY(fit.template get<ShiftedFit>().getWeightFunc().basisCenter() == shifted.getWeightFunc().basisCenter());
+        if (shifted.isStable())
+            VERIFY(shifted == fit.template get<ShiftedFit>());
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    using Point = PointPositionNormal<Scalar, Dim>;
+
+    using WeightSmoothFunc   = DistWeightFunc<Point, SmoothWeightKernel<Scalar> >;
+    using WeightConstantFunc = DistWeightFunc<Point, ConstantWeightKernel<Scalar> >;
+
+    using PlaneSmooth   = Basket<Point, WeightSmoothFunc, CovariancePlaneFit>;
+    using GLSSmooth     = Basket<Point, WeightSmoothFunc, OrientedSphereFit, GLSParam>;
+    using MongeSmooth   = Basket<Point, WeightSmoothFunc, CovariancePlaneFit, MongePatch>;
+    using PlaneConstant = Basket<Point, WeightConstantFunc, CovariancePlaneFit>;
+    using PlaneShifted  = Basket<Point, WeightSmoothFunc, CovariancePlaneFit, ShiftedSecondPass>;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<PlaneSmooth, GLSSmooth, MongeSmooth, PlaneConstant>() ));
+        CALL_SUBTEST(( testChangingBasis<PlaneSmooth, PlaneShifted>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test multi-basket fitting..." << endl;
+
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+}
@@ -0,0 +1,170 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/multi_scale_fit.cpp
+    \brief Test that multi-scale fitting gives the same results than independent fits at each scale
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/gls.h>
+#include <Ponca/src/Fitting/mongePatch.h>
+#include <Ponca/src/Fitting/multiScaleFit.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template <typename Scalar>
+bool isClose(Scalar _a, Scalar _b, Scalar _epsilon)
+{
+    return std::abs(_a - _b) <= _epsilon * std::max(Scalar(1), std::max(std::abs(_a), std::abs(_b)));
+}
+
+template<typename DataPoint>
+vector<DataPoint> generateData(typename DataPoint::Scalar& _maxScale)
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int nbPoints  = Eigen::internal::random<int>(500, 1000);
+    const Scalar radius = Eigen::internal::random<Scalar>(1., 10.);
+    const VectorType center = VectorType::Random() * Eigen::internal::random<Scalar>(1, 100);
+    _maxScale = radius;
+
+    vector<DataPoint> points(nbPoints);
+    for(auto& p : points)
+        p = getPointOnSphere<DataPoint>(radius, center, false, false, false);
+    return points;
+}
+
+template<typename Fit, typename Functor>
+void testFunction(Functor _compare)
+{
+    using DataPoint  = typename Fit::DataPoint;
+    using Scalar     = typename DataPoint::Scalar;
+    using WeightFunc = typename Fit::WeightFunction;
+
+    Scalar maxScale;
+    const auto points = generateData<DataPoint>(maxScale);
+    KdTreeDense<DataPoint> tree;
+    tree.build(points);
+
+    // Scales are not given in increasing order on purpose
+    const int nbScales = Eigen::internal::random<int>(2, 20);
+    vector<Scalar> scales (nbScales);
+    for (auto& s : scales)
+        s = Eigen::internal::random<Scalar>(maxScale / Scalar(10), maxScale);
+
+    MultiScaleFit<Fit> msFit;
+    msFit.setScales(scales);
+    VERIFY(msFit.scaleCount() == nbScales);
+    for (int s = 1; s < nbScales; ++s)
+        VERIFY(msFit.scale(s-1) <= msFit.scale(s));
+
+    const int nbTests = std::min(20, int(points.size()));
+    for(int i = 0; i < nbTests; ++i)
+    {
+        const auto& evalPos = points[i].pos();
+        msFit.init(evalPos);
+        msFit.computeWithIds(tree.range_neighbors(evalPos, msFit.maxScale()), tree.points());
+
+        for (int s = 0; s < nbScales; ++s)
+        {
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(msFit.scale(s)));
+            fit.init(evalPos);
+            fit.compute(points);
+
+            VERIFY(fit.getCurrentState() == msFit.fit(s).getCurrentState());
+            VERIFY(fit.getNumNeighbors() == msFit.fit(s).getNumNeighbors());
+            if (fit.isStable())
+                _compare(fit, msFit.fit(s));
+        }
+    }
+}
+
+// Without scale, nothing is computed
+template<typename Fit>
+void testNoScale()
+{
+    using DataPoint = typename Fit::DataPoint;
+    using Scalar    = typename DataPoint::Scalar;
+
+    Scalar maxScale;
+    const auto points = generateData<DataPoint>(maxScale);
+
+    MultiScaleFit<Fit> msFit;
+    msFit.setScales(vector<Scalar>());
+    VERIFY(msFit.scaleCount() == 0);
+    msFit.init(points[0].pos());
+    VERIFY(msFit.compute(points) == UNDEFINED);
+    VERIFY(msFit.computeWithIds(vector<int> {0, 1, 2}, points) == UNDEFINED);
+    VERIFY(msFit.fits().empty());
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    using Point = PointPositionNormal<Scalar, Dim>;
+
+    using WeightSmoothFunc   = DistWeightFunc<Point, SmoothWeightKernel<Scalar> >;
+    using WeightConstantFunc = DistWeightFunc<Point, ConstantWeightKernel<Scalar> >;
+
+    using GLSSmooth      = Basket<Point, WeightSmoothFunc, OrientedSphereFit, GLSParam>;
+    using GLSConstant    = Basket<Point, WeightConstantFunc, OrientedSphereFit, GLSParam>;
+    using PlaneConstant  = Basket<Point, WeightConstantFunc, CovariancePlaneFit>;
+    using MongeConstant  = Basket<Point, WeightConstantFunc, CovariancePlaneFit, MongePatch>;
+
+    static_assert(! MultiScaleFit<GLSSmooth>::isIncremental, "Smooth weights depend on the scale");
+    static_assert(MultiScaleFit<GLSConstant>::isIncremental, "Constant weights do not depend on the scale");
+
+    // The order of accumulation changes between the two computations, so results are only approximately equal
+    const Scalar epsilon = testEpsilon<Scalar>();
+    auto compareGLS = [epsilon](const auto& f1, const auto& f2) {
+        VERIFY(isClose(f1.tau_normalized(), f2.tau_normalized(), epsilon));
+        VERIFY(isClose(f1.kappa_normalized(), f2.kappa_normalized(), epsilon));
+        VERIFY(f1.eta_normalized().isApprox(f2.eta_normalized(), epsilon));
+    };
+    auto comparePlane = [epsilon](const auto& f1, const auto& f2) {
+        VERIFY(Scalar(1) - std::abs(f1.primitiveGradient().dot(f2.primitiveGradient())) <= epsilon);
+    };
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        CALL_SUBTEST(( testFunction<GLSSmooth>(compareGLS) ));
+        CALL_SUBTEST(( testFunction<GLSConstant>(compareGLS) ));
+        CALL_SUBTEST(( testFunction<PlaneConstant>(comparePlane) ));
+        // Multi-pass fit: falls back to a non-incremental computation
+        CALL_SUBTEST(( testFunction<MongeConstant>(comparePlane) ));
+        CALL_SUBTEST(( testNoScale<GLSSmooth>() ));
+        CALL_SUBTEST(( testNoScale<PlaneConstant>() ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test multi-scale fitting..." << endl;
+
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+    callSubTests<long double, 3>();
+}
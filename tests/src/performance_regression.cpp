@@ -0,0 +1,116 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/performance_regression.cpp
+    \brief Run a fixed subset of the benchmarks and compare it to a stored baseline
+
+    The benchmarks use the same names as the benchmark suite, so the baseline can also be compared to the results of
+    ponca-benchmarks-run. The test fails when a benchmark is significantly slower than its baseline, see
+    PoncaBenchmark::compareResults. Without arguments, the baseline and threshold given at configuration time are used
+    (PONCA_PERFORMANCE_BASELINE and PONCA_PERFORMANCE_THRESHOLD). The baseline is refreshed by the
+    update_performance_baseline target.
+ */
+
+#include "../../benchmarks/common/benchmark.h"
+#include "../../benchmarks/common/pointGenerators.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/orientedSphereFit.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+using namespace Ponca;
+using namespace PoncaBenchmark;
+
+using DataPoint  = BenchPoint<float, 3>;
+using Scalar     = DataPoint::Scalar;
+
+using FitPoint   = BenchPoint<double, 3>;
+using WeightFunc = DistWeightFunc<FitPoint, SmoothWeightKernel<double>>;
+
+template <typename Fit>
+void benchFit(Runner& runner, const std::string& name, const KdTreeDense<FitPoint>& tree, int m)
+{
+    struct Neighborhood { typename FitPoint::VectorType center; double scale; std::vector<FitPoint> neighbors; };
+    std::vector<Neighborhood> neighborhoods;
+    for (int i : queryIndices(tree.point_count(), 1000))
+    {
+        Neighborhood nei {tree.points()[i].pos(), 0., {}};
+        for (int j : tree.k_nearest_neighbors(i, m))
+        {
+            nei.neighbors.push_back(tree.points()[j]);
+            nei.scale = std::max(nei.scale, (tree.points()[j].pos() - nei.center).norm());
+        }
+        nei.scale *= 1.01;
+        neighborhoods.push_back(std::move(nei));
+    }
+
+    runner.run(name, neighborhoods.size(), [&]() {
+        int nbStable = 0;
+        for (const auto& n : neighborhoods)
+        {
+            Fit fit;
+            fit.setWeightFunc(WeightFunc(n.scale));
+            fit.init(n.center);
+            nbStable += fit.compute(n.neighbors) == STABLE ? 1 : 0;
+        }
+        doNotOptimize(nbStable);
+    });
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    options.minTime     = 0.05;
+    options.repetitions = 9;
+#ifdef PONCA_PERFORMANCE_BASELINE
+    options.baselinePath = PONCA_PERFORMANCE_BASELINE;
+#endif
+#ifdef PONCA_PERFORMANCE_THRESHOLD
+    options.threshold = PONCA_PERFORMANCE_THRESHOLD;
+#endif
+    if (! parseOptions(argc, argv, options)) return EXIT_FAILURE;
+    Runner runner ("performance_regression", options);
+
+    // Fixed subset: deterministic inputs, sized to run in a few seconds
+    constexpr std::size_t n = 100000;
+    const auto points = generatePoints<DataPoint>(n, Distribution::Surface);
+
+    runner.run("build/dense/surface/100000", n, [&]() {
+        KdTreeDense<DataPoint> tree;
+        tree.build(points);
+        doNotOptimize(tree.node_count());
+    });
+
+    KdTreeDense<DataPoint> tree;
+    tree.build(points);
+    const std::vector<int> ids = queryIndices(n, 10000);
+
+    runner.run("knearest/surface/100000/k=32", ids.size(), [&]() {
+        int sum = 0;
+        for (int i : ids)
+            for (int j : tree.k_nearest_neighbors(i, 32)) sum += j;
+        doNotOptimize(sum);
+    });
+
+    const Scalar r = radiusForNeighborCount(tree, 32);
+    runner.run("range/surface/100000/m=32", ids.size(), [&]() {
+        int sum = 0;
+        for (int i : ids)
+            for (int j : tree.range_neighbors(i, r)) sum += j;
+        doNotOptimize(sum);
+    });
+
+    KdTreeDense<FitPoint> fitTree;
+    fitTree.build(generatePoints<FitPoint>(n, Distribution::Surface));
+    benchFit<Basket<FitPoint, WeightFunc, CovariancePlaneFit>>(runner, "fit/CovariancePlaneFit/m=64", fitTree, 64);
+    benchFit<Basket<FitPoint, WeightFunc, OrientedSphereFit>>(runner, "fit/OrientedSphereFit/m=64", fitTree, 64);
+
+    return runner.finish();
+}
@@ -0,0 +1,160 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+
+#include <numeric>
+
+using namespace Ponca;
+
+template <typename DataPoint>
+struct InstrumentedTraits : public KdTreeDefaultTraits<DataPoint>
+{
+    using StatisticsPolicy = KdTreeCollectStatistics;
+};
+
+template<typename DataPoint>
+void testQueryStatistics()
+{
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using VectorContainer = typename KdTreeDense<DataPoint>::PointContainer;
+    using Tree            = KdTreeDenseBase<InstrumentedTraits<DataPoint>>;
+    using Stats           = KdTreeQueryStatistics;
+
+    static_assert(! KdTreeDense<DataPoint>::STATISTICS_ENABLED, "Queries must not be instrumented by default");
+    static_assert(Tree::STATISTICS_ENABLED, "Queries should be instrumented");
+
+    const int N = 5000;
+    const int k = 10;
+    const Scalar r = Scalar(0.1);
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    KdTreeDense<DataPoint> reference;
+    reference.build(points);
+    Tree tree;
+    tree.set_min_cell_size(8);
+    tree.build(points);
+    VERIFY(tree.query_statistics().query_count == 0);
+
+    // Instrumented queries return the same results
+    std::vector<int> nbNeighbors (N);
+#pragma omp parallel for
+    for (int i = 0; i < N; ++i)
+    {
+        std::vector<int> res, ref;
+        for (int j : tree.range_neighbors(i, r)) res.push_back(j);
+        for (int j : reference.range_neighbors(i, r)) ref.push_back(j);
+        std::sort(res.begin(), res.end());
+        std::sort(ref.begin(), ref.end());
+        VERIFY(res == ref);
+        nbNeighbors[i] = int(res.size());
+    }
+
+    // One sample per query, the accepted points being the neighbors
+    Stats stats = tree.query_statistics();
+    VERIFY(stats.query_count == std::uint64_t(N));
+    VERIFY(stats.sum[Stats::Counter::PointsAccepted] ==
+           std::uint64_t(std::accumulate(nbNeighbors.begin(), nbNeighbors.end(), 0)));
+    VERIFY(stats.sum[Stats::Counter::PointsTested] >= stats.sum[Stats::Counter::PointsAccepted]);
+    VERIFY(stats.sum[Stats::Counter::NodesVisited] >= stats.sum[Stats::Counter::LeavesVisited]);
+    VERIFY(stats.histogram[Stats::Counter::LeavesVisited][0] == 0);
+    VERIFY(stats.max[Stats::Counter::StackHighWater] <= std::uint64_t(2 * Tree::MAX_DEPTH));
+    VERIFY(stats.mean(Stats::Counter::PointsAccepted) ==
+           double(stats.sum[Stats::Counter::PointsAccepted]) / double(N));
+
+    // Histograms and per-thread statistics are consistent with the aggregated statistics
+    for (int c = 0; c < Stats::COUNTER_COUNT; ++c)
+    {
+        std::uint64_t total = 0;
+        for (int b = 0; b < Stats::BUCKET_COUNT; ++b) total += stats.histogram[c][b];
+        VERIFY(total == stats.query_count);
+        VERIFY(Stats::bucket(stats.max[c]) < Stats::BUCKET_COUNT);
+        VERIFY(stats.histogram[c][Stats::bucket(stats.max[c])] > 0);
+    }
+    std::uint64_t perThreadCount = 0;
+    for (const auto& s : tree.query_statistics_per_thread()) perThreadCount += s.query_count;
+    VERIFY(perThreadCount == stats.query_count);
+
+    // Nearest and k-nearest queries
+    tree.reset_query_statistics();
+    VERIFY(tree.query_statistics().query_count == 0);
+    for (int i = 0; i < 100; ++i)
+    {
+        for (int j : tree.k_nearest_neighbors(i, k)) { (void)j; }
+        for (int j : tree.nearest_neighbor(VectorType(VectorType::Random()))) { (void)j; }
+    }
+    stats = tree.query_statistics();
+    VERIFY(stats.query_count == 200);
+    VERIFY(stats.histogram[Stats::Counter::PointsAccepted][0] == 0);
+
+    // Queries alternating between two trees are accounted to their own tree
+    Tree other;
+    other.build(points);
+    tree.reset_query_statistics();
+    for (int i = 0; i < 100; ++i)
+    {
+        for (int j : tree.range_neighbors(i, r)) { (void)j; }
+        for (int j : other.range_neighbors(i, r)) { (void)j; }
+        for (int j : other.nearest_neighbor(i)) { (void)j; }
+    }
+    VERIFY(tree.query_statistics().query_count == 100);
+    VERIFY(other.query_statistics().query_count == 200);
+
+    // Moved queries transfer their counters: the query is accounted once
+    tree.reset_query_statistics();
+    {
+        auto query = tree.range_neighbors(0, r);
+        for (int j : query) { (void)j; }
+        auto moved = std::move(query);
+        (void)moved;
+    }
+    VERIFY(tree.query_statistics().query_count == 1);
+
+    // A copy of the tree keeps the statistics
+    stats = tree.query_statistics();
+    const Tree copy = tree;
+    VERIFY(copy.query_statistics().query_count == stats.query_count);
+}
+
+template<typename DataPoint>
+void testQueryLayout()
+{
+    using Traits = KdTreeDefaultTraits<DataPoint>;
+    using Query  = KdTreeQuery<Traits>;
+    using Scalar = typename DataPoint::Scalar;
+
+    // Queries which are not instrumented only store the tree and the traversal stack
+    struct Expected
+    {
+        const KdTreeBase<Traits>* kdtree;
+        Stack<IndexSquaredDistance<typename Traits::IndexType, Scalar>, 2 * Traits::MAX_DEPTH> stack;
+    };
+    static_assert(sizeof(Query) == sizeof(Expected), "Disabled query counters should not take space");
+    static_assert(std::is_nothrow_move_constructible<KdTreeQuery<InstrumentedTraits<DataPoint>>>::value,
+                  "Queries should be movable");
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test KdTree query statistics (float)" << endl;
+	testQueryStatistics<TestPoint<float, 3>>();
+	testQueryLayout<TestPoint<float, 3>>();
+	cout << "Test KdTree query statistics (double)" << endl;
+	testQueryStatistics<TestPoint<double, 3>>();
+	testQueryLayout<TestPoint<double, 3>>();
+}
@@ -0,0 +1,144 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+#include "../common/has_duplicate.h"
+#include "../common/kdtree_utils.h"
+
+#include <Ponca/src/SpatialPartitioning/KdTree/kdTree.h>
+#include <Ponca/src/SpatialPartitioning/KnnGraph/knnGraph.h>
+
+#include <sstream>
+
+using namespace Ponca;
+
+template<typename Tree>
+void checkKdTreeStats(const Tree& tree)
+{
+    using DataPoint = typename Tree::DataPoint;
+    using NodeType  = typename Tree::NodeType;
+    using IndexType = typename Tree::IndexType;
+
+    const KdTreeStats stats = tree.stats();
+    VERIFY(stats.point_count  == std::uint64_t(tree.point_count()));
+    VERIFY(stats.sample_count == std::uint64_t(tree.sample_count()));
+    VERIFY(stats.node_count   == std::uint64_t(tree.node_count()));
+    VERIFY(stats.leaf_count   == std::uint64_t(tree.leaf_count()));
+
+    // Histograms cover all the leaves and samples
+    std::uint64_t leaves = 0, samples = 0;
+    for (auto n : stats.depth_histogram) leaves += n;
+    VERIFY(leaves == stats.leaf_count);
+    leaves = 0;
+    for (std::size_t s = 0; s < stats.leaf_size_histogram.size(); ++s)
+    {
+        leaves  += stats.leaf_size_histogram[s];
+        samples += s * stats.leaf_size_histogram[s];
+    }
+    VERIFY(leaves == stats.leaf_count);
+    VERIFY(samples == stats.sample_count);
+    VERIFY(stats.max_depth() < Tree::MAX_DEPTH);
+    VERIFY(stats.leaf_count == 0 || stats.mean_leaf_aspect_ratio == 0 || stats.mean_leaf_aspect_ratio >= 1);
+    VERIFY(stats.empty_leaf_count + stats.degenerate_leaf_count <= stats.leaf_count);
+
+    // Memory footprint
+    VERIFY(stats.points_bytes  == tree.point_count()  * sizeof(DataPoint));
+    VERIFY(stats.nodes_bytes   == tree.node_count()   * sizeof(NodeType));
+    VERIFY(stats.indices_bytes == tree.sample_count() * sizeof(IndexType));
+    VERIFY(stats.points_reserved_bytes  == tree.points().capacity()  * sizeof(DataPoint));
+    VERIFY(stats.nodes_reserved_bytes   == tree.nodes().capacity()   * sizeof(NodeType));
+    VERIFY(stats.indices_reserved_bytes == tree.samples().capacity() * sizeof(IndexType));
+    VERIFY(stats.total_bytes() == stats.points_bytes + stats.nodes_bytes + stats.indices_bytes);
+    VERIFY(stats.total_reserved_bytes() >= stats.total_bytes());
+
+    std::ostringstream json;
+    stats.print_json(json);
+    const std::string str = json.str();
+    VERIFY(str.front() == '{' && str.back() == '}');
+    VERIFY(str.find("\"depth_histogram\": [") != std::string::npos);
+    VERIFY(str.find("\"nodes\": " + std::to_string(stats.nodes_bytes)) != std::string::npos);
+}
+
+template<typename DataPoint>
+void testKdTreeStats()
+{
+    using Scalar          = typename DataPoint::Scalar;
+    using VectorType      = typename DataPoint::VectorType;
+    using VectorContainer = typename KdTreeDense<DataPoint>::PointContainer;
+
+    const int N = Eigen::internal::random<int>(1000, 5000);
+    auto points = VectorContainer(N);
+    std::generate(points.begin(), points.end(), []() {return DataPoint(VectorType::Random()); });
+
+    // Empty tree
+    KdTreeDense<DataPoint> tree;
+    const KdTreeStats empty = tree.stats();
+    VERIFY(empty.leaf_count == 0 && empty.depth_histogram.empty() && empty.total_bytes() == 0);
+
+    // Dense tree
+    tree.set_min_cell_size(Eigen::internal::random<int>(4, 64));
+    tree.build(points);
+    checkKdTreeStats(tree);
+    const KdTreeStats stats = tree.stats();
+    VERIFY(stats.leaf_size_histogram.size() <= std::size_t(tree.min_cell_size()) + 1);
+    VERIFY(stats.degenerate_leaf_count == 0);
+
+    // Sparse tree
+    std::vector<int> sampling;
+    for (int i = 0; i < N; i += 2) sampling.push_back(i);
+    KdTreeSparse<DataPoint> sparse (points, sampling);
+    checkKdTreeStats(sparse);
+    VERIFY(sparse.stats().sample_count < sparse.stats().point_count);
+
+    // Duplicated points end up in degenerate leaves
+    auto duplicated = points;
+    for (int i = 0; i < 200; ++i) duplicated.push_back(points.front());
+    KdTreeDense<DataPoint> duplicatedTree;
+    duplicatedTree.set_min_cell_size(16);
+    duplicatedTree.build(duplicated);
+    checkKdTreeStats(duplicatedTree);
+    VERIFY(duplicatedTree.stats().degenerate_leaf_count > 0);
+
+    // KnnGraph
+    const int k = Eigen::internal::random<int>(4, 12);
+    KnnGraph<DataPoint> graph (tree, k);
+    const KnnGraphStats graphStats = graph.stats();
+    VERIFY(graphStats.vertex_count == std::uint64_t(N));
+    VERIFY(graphStats.k == std::uint64_t(k));
+    VERIFY(graphStats.missing_neighbor_count == 0);
+    VERIFY(graphStats.asymmetric_edge_count <= graphStats.vertex_count * graphStats.k);
+    VERIFY(graphStats.indices_bytes == std::uint64_t(N) * k * sizeof(int));
+    VERIFY(graphStats.points_bytes == stats.points_bytes);
+
+    double maxDistance = 0;
+    for (int i = 0; i < N; ++i)
+    {
+        Scalar d = 0;
+        for (int j : tree.k_nearest_neighbors(i, k))
+            d = std::max(d, (points[j].pos() - points[i].pos()).norm());
+        maxDistance = std::max(maxDistance, double(d));
+    }
+    VERIFY(std::abs(graphStats.max_kth_neighbor_distance - maxDistance) <= 1e-6 * maxDistance);
+    VERIFY(graphStats.mean_kth_neighbor_distance <= graphStats.max_kth_neighbor_distance);
+
+    std::ostringstream json;
+    graphStats.print_json(json);
+    VERIFY(json.str().find("\"vertex_count\": " + std::to_string(N)) != std::string::npos);
+}
+
+int main(int argc, char** argv)
+{
+	if (!init_testing(argc, argv))
+	{
+		return EXIT_FAILURE;
+	}
+
+	cout << "Test KdTree and KnnGraph statistics (float)" << endl;
+	testKdTreeStats<TestPoint<float, 3>>();
+	cout << "Test KdTree and KnnGraph statistics (double)" << endl;
+	testKdTreeStats<TestPoint<double, 3>>();
+}
@@ -0,0 +1,200 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+
+/*!
+    \file test/symmetric_eigen_solver.cpp
+    \brief Test accuracy of the eigen solver policies, and their use in covariance plane fitting
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/basket.h>
+#include <Ponca/src/Fitting/covariancePlaneFit.h>
+#include <Ponca/src/Fitting/symmetricEigenSolver.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+/// Generate a random covariance matrix with eigenvalues (_l0, _l1, _l2)
+template<typename MatrixType>
+MatrixType randomCovariance(typename MatrixType::Scalar _l0, typename MatrixType::Scalar _l1, typename MatrixType::Scalar _l2)
+{
+    using VectorType = Eigen::Matrix<typename MatrixType::Scalar, 3, 1>;
+    MatrixType r = Eigen::HouseholderQR<MatrixType>(MatrixType::Random()).householderQ();
+    return r * VectorType(_l0, _l1, _l2).asDiagonal() * r.transpose();
+}
+
+template<typename MatrixType>
+void testSolverAccuracy(typename MatrixType::Scalar _l0, typename MatrixType::Scalar _l1, typename MatrixType::Scalar _l2)
+{
+    using Scalar = typename MatrixType::Scalar;
+    const Scalar epsilon = testEpsilon<Scalar>();
+    const MatrixType cov = randomCovariance<MatrixType>(_l0, _l1, _l2);
+
+    SymmetricEigenSolver<MatrixType> iterative (IterativeEigenSolver);
+    SymmetricEigenSolver<MatrixType> direct    (DirectEigenSolver);
+    SymmetricEigenSolver<MatrixType> robust    (DirectEigenSolverWithFallback);
+    iterative.compute(cov);
+    direct.compute(cov);
+    robust.compute(cov);
+
+    VERIFY(iterative.info() == Eigen::Success);
+    VERIFY(! iterative.usedFallback());
+    VERIFY(! direct.usedFallback());
+    VERIFY(robust.isAccurate(cov));
+
+    // Eigenvalues are sorted in increasing order, whatever the policy
+    const Scalar scale = iterative.eigenvalues().cwiseAbs().maxCoeff();
+    VERIFY((direct.eigenvalues() - iterative.eigenvalues()).cwiseAbs().maxCoeff() <= epsilon * scale);
+    VERIFY((robust.eigenvalues() - iterative.eigenvalues()).cwiseAbs().maxCoeff() <= epsilon * scale);
+
+    // The decomposition must reconstruct the input matrix
+    const MatrixType rec = robust.eigenvectors() * robust.eigenvalues().asDiagonal() * robust.eigenvectors().transpose();
+    VERIFY((rec - cov).cwiseAbs().maxCoeff() <= epsilon * scale);
+}
+
+// The tolerance decides when the closed-form solution is replaced by the iterative one
+template<typename MatrixType>
+void testSolverTolerance()
+{
+    using Scalar = typename MatrixType::Scalar;
+    const MatrixType cov = randomCovariance<MatrixType>(Scalar(1), Scalar(2), Scalar(3));
+
+    SymmetricEigenSolver<MatrixType> solver (DirectEigenSolverWithFallback);
+    VERIFY(solver.tolerance() == SymmetricEigenSolver<MatrixType>::defaultTolerance());
+    solver.setTolerance(Scalar(1));
+    solver.compute(cov);
+    VERIFY(! solver.usedFallback());
+    solver.setTolerance(Scalar(-1));
+    solver.compute(cov);
+    VERIFY(solver.usedFallback());
+}
+
+// Batches mix the policies, conditionings, and the sizes of the last packet
+template<typename MatrixType>
+void testSolverBatch()
+{
+    using Scalar = typename MatrixType::Scalar;
+    using Solver = SymmetricEigenSolver<MatrixType>;
+    const Scalar epsilon = testEpsilon<Scalar>();
+
+    const int count = Eigen::internal::random<int>(1, 4 * Solver::BatchSize);
+    vector<MatrixType> matrices (count);
+    vector<Solver> solvers (count), references (count);
+    const EigenSolverPolicy policies[] = {IterativeEigenSolver, DirectEigenSolver, DirectEigenSolverWithFallback};
+    for (int i = 0; i < count; ++i)
+    {
+        const Scalar l = Eigen::internal::random<Scalar>(Scalar(0.1), Scalar(10));
+        switch (i % 5)
+        {
+            case 0: matrices[i] = randomCovariance<MatrixType>(l, Scalar(2) * l, Scalar(3) * l); break;
+            case 1: matrices[i] = randomCovariance<MatrixType>(Scalar(1e-6) * l, l, Scalar(1.5) * l); break;
+            case 2: matrices[i] = randomCovariance<MatrixType>(Scalar(1e-6) * l, Scalar(1e-6) * l, l); break;
+            case 3: matrices[i] = randomCovariance<MatrixType>(l, l, Scalar(2) * l); break;
+            default: matrices[i] = randomCovariance<MatrixType>(l, l, l); break;
+        }
+        const EigenSolverPolicy policy = policies[Eigen::internal::random<int>(0, 2)];
+        solvers[i].setPolicy(policy);
+        references[i].setPolicy(IterativeEigenSolver);
+        references[i].compute(matrices[i]);
+    }
+    Solver::computeBatch(matrices.data(), solvers.data(), count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const Solver& solver = solvers[i];
+        VERIFY(solver.info() == Eigen::Success);
+        const Scalar scale = references[i].eigenvalues().cwiseAbs().maxCoeff();
+        VERIFY((solver.eigenvalues() - references[i].eigenvalues()).cwiseAbs().maxCoeff() <= epsilon * scale);
+        const MatrixType rec = solver.eigenvectors() * solver.eigenvalues().asDiagonal() * solver.eigenvectors().transpose();
+        VERIFY((rec - matrices[i]).cwiseAbs().maxCoeff() <= epsilon * scale);
+        if (solver.policy() == DirectEigenSolverWithFallback)
+            VERIFY(solver.isAccurate(matrices[i]));
+        if (solver.policy() != DirectEigenSolverWithFallback)
+            VERIFY(! solver.usedFallback());
+    }
+}
+
+template<typename DataPoint, typename Fit, typename WeightFunc>
+void testPlaneFit(EigenSolverPolicy _policy)
+{
+    using Scalar     = typename DataPoint::Scalar;
+    using VectorType = typename DataPoint::VectorType;
+
+    const int nbPoints     = Eigen::internal::random<int>(100, 1000);
+    const Scalar width     = Eigen::internal::random<Scalar>(1., 10.);
+    const Scalar scale     = Scalar(15.) * std::sqrt( width * width / nbPoints);
+    const VectorType center    = VectorType::Random() * Eigen::internal::random<Scalar>(1, 10000);
+    const VectorType direction = VectorType::Random().normalized();
+    const Scalar epsilon = testEpsilon<Scalar>();
+
+    vector<DataPoint> vectorPoints(nbPoints);
+    for(auto& p : vectorPoints)
+        p = getPointOnPlane<DataPoint>(center, direction, width, false, false, false);
+
+    for(int i = 0; i < int(vectorPoints.size()); ++i)
+    {
+        Fit reference, fit;
+        reference.setWeightFunc(WeightFunc(scale));
+        reference.init(vectorPoints[i].pos());
+        fit.setWeightFunc(WeightFunc(scale));
+        fit.setSolverPolicy(_policy);
+        fit.init(vectorPoints[i].pos());
+
+        VERIFY(reference.compute(vectorPoints) == fit.compute(vectorPoints));
+        if (fit.isStable())
+        {
+            // Eigenvectors are defined up to their sign
+            VERIFY(Scalar(1.) - std::abs(fit.primitiveGradient().dot(direction)) <= epsilon);
+            VERIFY(Scalar(1.) - std::abs(fit.primitiveGradient().dot(reference.primitiveGradient())) <= epsilon);
+            VERIFY(std::abs(fit.surfaceVariation() - reference.surfaceVariation()) <= epsilon);
+        }
+    }
+}
+
+template<typename Scalar, int Dim>
+void callSubTests()
+{
+    using MatrixType = Eigen::Matrix<Scalar, 3, 3>;
+    using Point      = PointPositionNormal<Scalar, Dim>;
+    using WeightFunc = DistWeightFunc<Point, SmoothWeightKernel<Scalar> >;
+    using Fit        = Basket<Point, WeightFunc, CovariancePlaneFit>;
+
+    for(int i = 0; i < g_repeat; ++i)
+    {
+        const Scalar l = Eigen::internal::random<Scalar>(Scalar(0.1), Scalar(10));
+        // well conditioned, planar, linear and isotropic covariances
+        CALL_SUBTEST(( testSolverAccuracy<MatrixType>(l, Scalar(2) * l, Scalar(3) * l) ));
+        CALL_SUBTEST(( testSolverAccuracy<MatrixType>(Scalar(1e-6) * l, l, Scalar(1.5) * l) ));
+        CALL_SUBTEST(( testSolverAccuracy<MatrixType>(Scalar(1e-6) * l, Scalar(1e-6) * l, l) ));
+        CALL_SUBTEST(( testSolverAccuracy<MatrixType>(l, l, l) ));
+        CALL_SUBTEST(( testSolverTolerance<MatrixType>() ));
+        CALL_SUBTEST(( testSolverBatch<MatrixType>() ));
+
+        CALL_SUBTEST(( testPlaneFit<Point, Fit, WeightFunc>(DirectEigenSolver) ));
+        CALL_SUBTEST(( testPlaneFit<Point, Fit, WeightFunc>(DirectEigenSolverWithFallback) ));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Test symmetric eigen solver policies..." << endl;
+
+    callSubTests<float, 3>();
+    callSubTests<double, 3>();
+    callSubTests<long double, 3>();
+}
@@ -20,6 +20,29 @@
 using namespace std;
 using namespace Ponca;
 
+template <typename Scalar> using PolynomialWeightKernel1 = PolynomialWeightKernel<Scalar, 1>;
+template <typename Scalar> using PolynomialWeightKernel2 = PolynomialWeightKernel<Scalar, 2>;
+template <typename Scalar> using PolynomialWeightKernel5 = PolynomialWeightKernel<Scalar, 5>;
+
+template<typename Scalar>
+void testPolynomialIsSmooth()
+{
+    Scalar step = Scalar(0.05);
+    int n = int(Scalar(1)/Scalar(step));
+
+    PolynomialWeightKernel<Scalar, 2> p;
+    SmoothWeightKernel<Scalar> k;
+    Scalar epsilon = testEpsilon<Scalar>();
+
+    for(int i=0; i<=n; ++i)
+    {
+        Scalar a = i*step;
+        VERIFY(std::abs(p.f(a)   - k.f(a))   < epsilon);
+        VERIFY(std::abs(p.df(a)  - k.df(a))  < epsilon);
+        VERIFY(std::abs(p.ddf(a) - k.ddf(a)) < epsilon);
+    }
+}
+
 template<class Kernel>
 void testFunctionAutoDiff()
 {
@@ -86,6 +109,36 @@ void testFunction(typename Kernel::Scalar mmin = 0, typename Kernel::Scalar mmax
     }
 }
 
+template<class Kernel>
+void testFunctionSquared(typename Kernel::Scalar mmin = 0, typename Kernel::Scalar mmax = 1)
+{
+    typedef typename Kernel::Scalar Scalar;
+
+    Scalar step = Scalar(0.05);
+    int n = int((mmax - mmin)/Scalar(step));
+
+    Kernel k;
+    Scalar epsilon = testEpsilon<Scalar>();
+
+    // compare evaluation from x^2 to evaluation from x
+    for(int i=1; i<n; ++i)
+    {
+        Scalar a = mmin + i*step;
+        VERIFY(std::abs(k.f_sq(a*a) - k.f(a)) < epsilon);
+    }
+}
+
+template<typename Scalar, template <typename > class KernelT>
+void callSquaredSubTests(Scalar mmin = 0, Scalar mmax = 1)
+{
+    typedef KernelT<Scalar> Kernel;
+    typedef DistWeightFunc<PointPositionNormal<Scalar, 3>, Kernel> WeightFunc;
+    static_assert(WeightFunc::isSquaredKernel, "Kernel should be evaluated from squared distances");
+    CALL_SUBTEST(( testFunctionSquared<Kernel>(mmin, mmax) ));
+
+    cout << "ok" << endl;
+}
+
 template<typename Scalar, template <typename > class KernelT>
 void callSubTests(Scalar mmin = 0, Scalar mmax = 1)
 {
@@ -115,18 +168,40 @@ int main(int argc, char** argv)
     cout << "Verify smooth weight kernel derivatives" << endl;
     callSubTests<long double, SmoothWeightKernel>();
     callAutoDiffSubTests<long double, SmoothWeightKernel>();
+    callSquaredSubTests<long double, SmoothWeightKernel>();
+    callSquaredSubTests<float, SmoothWeightKernel>();
 
     cout << "Verify Wendland weight kernel derivatives" << endl;
     callSubTests<long double, WendlandWeightKernel>();
     callAutoDiffSubTests<long double, WendlandWeightKernel>();
+    static_assert(! DistWeightFunc<PointPositionNormal<float, 3>, WendlandWeightKernel<float>>::isSquaredKernel,
+                  "Wendland kernel cannot be evaluated from squared distances");
 
     cout << "Verify singular weight kernel derivatives" << endl;
     // do not compute for x<0.4, as the derivatives are too big
     // (which leads to numerical errors with some compiler (confirmed with MSVC)
     callSubTests<long double, SingularWeightKernel>(0.4);
     callAutoDiffSubTests<long double, SingularWeightKernel>();
+    callSquaredSubTests<long double, SingularWeightKernel>(0.4);
 
     cout << "Verify Compact Exponential weight kernel derivatives" << endl;
     callSubTests<long double, CompactExpWeightKernel>();
+    callSquaredSubTests<long double, CompactExpWeightKernel>();
     /// autodiffs are not compatible with pow, used in this class
+
+    cout << "Verify polynomial weight kernel derivatives" << endl;
+    callSubTests<long double, PolynomialWeightKernel1>();
+    callAutoDiffSubTests<long double, PolynomialWeightKernel1>();
+    callSquaredSubTests<long double, PolynomialWeightKernel1>();
+    callSubTests<long double, PolynomialWeightKernel2>();
+    callAutoDiffSubTests<long double, PolynomialWeightKernel2>();
+    callSquaredSubTests<long double, PolynomialWeightKernel2>();
+    callSubTests<long double, PolynomialWeightKernel5>();
+    callAutoDiffSubTests<long double, PolynomialWeightKernel5>();
+    callSquaredSubTests<long double, PolynomialWeightKernel5>();
+    CALL_SUBTEST(( testPolynomialIsSmooth<float>() ));
+    CALL_SUBTEST(( testPolynomialIsSmooth<long double>() ));
+
+    cout << "Verify constant weight kernel" << endl;
+    callSquaredSubTests<float, ConstantWeightKernel>();
 }
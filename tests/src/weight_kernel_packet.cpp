@@ -0,0 +1,134 @@
+/*
+ This Source Code Form is subject to the terms of the Mozilla Public
+ License, v. 2.0. If a copy of the MPL was not distributed with this
+ file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+/*!
+    \file test/weight_kernel_packet.cpp
+    \brief Test weight kernel packet evaluation against scalar evaluation
+
+    The throughput of both evaluations is measured by benchmarks/src/weight_kernels.cpp
+ */
+
+#include "../common/testing.h"
+#include "../common/testUtils.h"
+
+#include <Ponca/src/Fitting/neighborPacket.h>
+#include <Ponca/src/Fitting/weightFunc.h>
+#include <Ponca/src/Fitting/weightKernel.h>
+
+#include <limits>
+#include <vector>
+
+using namespace std;
+using namespace Ponca;
+
+template <typename Scalar> using PolynomialWeightKernel3 = PolynomialWeightKernel<Scalar, 3>;
+template <typename Scalar> using PolynomialWeightKernel6 = PolynomialWeightKernel<Scalar, 6>;
+
+template <typename Scalar>
+bool isClose(Scalar _a, Scalar _b, Scalar _epsilon)
+{
+    return std::abs(_a - _b) <= _epsilon * std::max(Scalar(1), std::max(std::abs(_a), std::abs(_b)));
+}
+
+/// \brief Tolerance of the comparisons between packet and scalar evaluations
+/// Evaluations using the same formula can still differ by a few ulps, e.g. when the compiler contracts them to FMA
+template <typename Scalar>
+Scalar packetTolerance(bool _sameFormula)
+{
+    return _sameFormula ? Scalar(8) * std::numeric_limits<Scalar>::epsilon() : testEpsilon<Scalar>();
+}
+
+template<class Kernel>
+void testFunction(bool _sameFormula, typename Kernel::Scalar mmin = 0)
+{
+    typedef typename Kernel::Scalar Scalar;
+    typedef Eigen::Array<Scalar, 1, 8> Packet;
+
+    Kernel k;
+    Scalar epsilon = packetTolerance<Scalar>(_sameFormula);
+
+    // compare packet evaluation to scalar evaluation
+    for(int i = 0; i < 100; ++i)
+    {
+        Packet x = mmin + (Packet::Random().abs() * (Scalar(1) - mmin));
+        Packet f = k.f(x);
+        for(int j = 0; j < Packet::SizeAtCompileTime; ++j)
+            VERIFY(isClose(f(j), k.f(x(j)), epsilon));
+    }
+}
+
+template<class DataPoint, class Kernel>
+void testWeightFunc(bool _sameFormula)
+{
+    typedef typename DataPoint::Scalar Scalar;
+    typedef typename DataPoint::VectorType VectorType;
+    typedef DistWeightFunc<DataPoint, Kernel> WeightFunc;
+    typedef NeighborPacket<DataPoint, 8> Packet;
+
+    static_assert(WeightFunc::isPacketKernel, "Kernel should provide a packet API");
+
+    Scalar epsilon = packetTolerance<Scalar>(_sameFormula);
+    WeightFunc wf (Eigen::internal::random<Scalar>(0.1, 1.));
+    wf.init(VectorType::Random());
+
+    vector<DataPoint> points (Packet::Size);
+    for(int i = 0; i < g_repeat * 10; ++i)
+    {
+        Packet packet;
+        for (auto& p : points)
+        {
+            p = DataPoint(wf.evalPos() + VectorType::Random());
+            packet.push(p);
+        }
+
+        typename Packet::ScalarPacket   w;
+        typename Packet::PositionPacket localQ;
+        wf.wPacket(packet.positions, w, localQ);
+        for (int j = 0; j < Packet::Size; ++j)
+        {
+            auto wres = wf.w(points[j].pos(), points[j]);
+            for (int d = 0; d < VectorType::SizeAtCompileTime; ++d)
+                VERIFY(isClose(wres.second(d), localQ(d, j), epsilon));
+            VERIFY(isClose(wres.first, w(j), epsilon));
+        }
+    }
+}
+
+template<typename Scalar, template <typename > class KernelT>
+void callSubTests(bool _sameFormula, Scalar mmin = 0)
+{
+    typedef KernelT<Scalar> Kernel;
+    typedef PointPositionNormal<Scalar, 3> Point;
+
+    CALL_SUBTEST(( testFunction<Kernel>(_sameFormula, mmin) ));
+    CALL_SUBTEST(( testWeightFunc<Point, Kernel>(_sameFormula) ));
+}
+
+template<typename Scalar>
+void callAllSubTests()
+{
+    // Eigen vectorized exponential is not exactly std::exp
+    callSubTests<Scalar, ConstantWeightKernel>   (true);
+    callSubTests<Scalar, SmoothWeightKernel>     (true);
+    callSubTests<Scalar, WendlandWeightKernel>   (true);
+    callSubTests<Scalar, SingularWeightKernel>   (true, Scalar(0.1));
+    callSubTests<Scalar, CompactExpWeightKernel> (false);
+    callSubTests<Scalar, PolynomialWeightKernel3>(true);
+    callSubTests<Scalar, PolynomialWeightKernel6>(true);
+}
+
+int main(int argc, char** argv)
+{
+    if(!init_testing(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    cout << "Verify weight kernel packet evaluation (float)" << endl;
+    callAllSubTests<float>();
+    cout << "Verify weight kernel packet evaluation (double)" << endl;
+    callAllSubTests<double>();
+}